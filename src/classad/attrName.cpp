@@ -0,0 +1,253 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#include "classad/common.h"
+#include "classad/attrName.h"
+#include "classadMutex.h"
+
+using namespace std;
+
+namespace classad {
+
+	// The table is a fixed array of chains that are only ever added to,
+	// at the head.  A new entry is completely built before it is linked
+	// in, so lookups can walk the chains without locking (expressions
+	// are evaluated from several threads when matchmaking in parallel,
+	// and from daemon worker threads); adding an entry, and counting
+	// references to entries outside the table, is done under a mutex.
+	// Being zero-initialized, the table is usable from static
+	// constructors.
+static const size_t ATTR_NAME_BUCKETS = 1 << 13;
+static AttrNameEntry *attr_name_table[ATTR_NAME_BUCKETS];
+static size_t attr_name_count = 0;
+static size_t attr_name_limit = 250000;
+static bool attr_name_overflowed = false;
+static ClassAdMutex attr_name_mutex = CLASSAD_MUTEX_INITIALIZER;
+
+	// Once the table is full, a bit per hash bucket of names that have
+	// been given an entry outside the table.  Bits are only ever set, so
+	// Find can rule out most names that aren't in any ad without locking
+	// or allocating.
+static const size_t UNTABLED_HASH_BITS = 1 << 16;
+static const size_t BITS_PER_WORD = sizeof(unsigned long) * 8;
+static unsigned long untabled_hashes[UNTABLED_HASH_BITS / BITS_PER_WORD];
+
+	// Chains are read without the lock, so the head of a chain is
+	// published with release semantics and read with acquire semantics
+	// (MSVC gives volatile accesses those semantics).
+static inline const AttrNameEntry *
+load_chain( AttrNameEntry *const *bucket )
+{
+#if defined(__GNUC__)
+	return __atomic_load_n( bucket, __ATOMIC_ACQUIRE );
+#else
+	return *(AttrNameEntry *const volatile *)bucket;
+#endif
+}
+
+static inline void
+store_chain( AttrNameEntry **bucket, AttrNameEntry *entry )
+{
+#if defined(__GNUC__)
+	__atomic_store_n( bucket, entry, __ATOMIC_RELEASE );
+#else
+	*(AttrNameEntry *volatile *)bucket = entry;
+#endif
+}
+
+	// Set (under the lock) once a name has been left out of the table.
+static inline bool
+table_overflowed( )
+{
+#if defined(__GNUC__)
+	return __atomic_load_n( &attr_name_overflowed, __ATOMIC_ACQUIRE );
+#else
+	return *(volatile bool *)&attr_name_overflowed;
+#endif
+}
+
+static inline void
+mark_untabled_hash( size_t hash )
+{
+	size_t bit = hash & (UNTABLED_HASH_BITS-1);
+	unsigned long mask = 1UL << (bit % BITS_PER_WORD);
+#if defined(__GNUC__)
+	__atomic_fetch_or( &untabled_hashes[bit / BITS_PER_WORD], mask, __ATOMIC_RELEASE );
+#else
+	*(volatile unsigned long *)&untabled_hashes[bit / BITS_PER_WORD] |= mask;
+#endif
+}
+
+static inline bool
+untabled_hash_marked( size_t hash )
+{
+	size_t bit = hash & (UNTABLED_HASH_BITS-1);
+	unsigned long mask = 1UL << (bit % BITS_PER_WORD);
+#if defined(__GNUC__)
+	return ( __atomic_load_n( &untabled_hashes[bit / BITS_PER_WORD], __ATOMIC_ACQUIRE ) & mask ) != 0;
+#else
+	return ( *(volatile unsigned long *)&untabled_hashes[bit / BITS_PER_WORD] & mask ) != 0;
+#endif
+}
+
+static inline size_t
+hash_attr_name( const char *name )
+{
+	size_t h = 0;
+	for( const unsigned char *ch = (const unsigned char*)name; *ch; ch++ ) {
+		h = 5*h + (*ch | 0x20);
+	}
+	return h;
+}
+
+	// Find the entry for name, spelled exactly so if exact is true.
+static const AttrNameEntry *
+find_attr_name( const AttrNameEntry *chain, const char *name, size_t hash,
+				bool exact )
+{
+	for( const AttrNameEntry *e = chain; e; e = e->next ) {
+		if( e->hash != hash ) {
+			continue;
+		}
+		if( exact ? strcmp( e->name.c_str(), name ) == 0
+				  : strcasecmp( e->name.c_str(), name ) == 0 ) {
+			return e;
+		}
+	}
+	return NULL;
+}
+
+
+const AttrNameEntry *AttrName::
+Intern( const char *name )
+{
+	size_t hash = hash_attr_name( name );
+	AttrNameEntry **bucket = &attr_name_table[hash & (ATTR_NAME_BUCKETS-1)];
+	const AttrNameEntry *found = find_attr_name( load_chain( bucket ), name, hash, true );
+	if( found ) {
+		return found;
+	}
+
+	ClassAdMutexLock lock( attr_name_mutex );
+
+		// another thread may have added it since we looked
+	found = find_attr_name( *bucket, name, hash, true );
+	if( found ) {
+		return found;
+	}
+
+	const AttrNameEntry *other = find_attr_name( *bucket, name, hash, false );
+	AttrNameEntry *entry = new AttrNameEntry;
+	entry->name = name;
+	entry->hash = hash;
+	entry->folded = other ? other->folded : entry;
+	entry->next = NULL;
+	entry->refs = 1;
+	if( attr_name_count >= attr_name_limit ) {
+			// the table is full; this entry belongs to the caller
+		entry->in_table = false;
+		mark_untabled_hash( hash );
+#if defined(__GNUC__)
+		__atomic_store_n( &attr_name_overflowed, true, __ATOMIC_RELEASE );
+#else
+		*(volatile bool *)&attr_name_overflowed = true;
+#endif
+		return entry;
+	}
+	entry->in_table = true;
+	entry->next = *bucket;
+	store_chain( bucket, entry );
+	attr_name_count++;
+	return entry;
+}
+
+const AttrNameEntry *AttrName::
+Intern( const std::string &name )
+{
+	return Intern( name.c_str() );
+}
+
+bool AttrName::
+Find( const string &name, AttrName &attr )
+{
+	size_t hash = hash_attr_name( name.c_str() );
+	const AttrNameEntry *found =
+		find_attr_name( load_chain( &attr_name_table[hash & (ATTR_NAME_BUCKETS-1)] ),
+						name.c_str(), hash, false );
+	if( found ) {
+		Release( attr.entry );
+		attr.entry = found;
+		return true;
+	}
+	if( !table_overflowed( ) || !untabled_hash_marked( hash ) ) {
+		return false;
+	}
+		// the name may be in an ad without being in the table
+	attr = AttrName( name );
+	return true;
+}
+
+size_t AttrName::
+NumInterned( )
+{
+	return attr_name_count;
+}
+
+size_t AttrName::
+SetTableLimit( size_t max_names )
+{
+	ClassAdMutexLock lock( attr_name_mutex );
+	size_t old_limit = attr_name_limit;
+	attr_name_limit = max_names;
+	return old_limit;
+}
+
+void AttrName::
+Ref( const AttrNameEntry *e, int delta )
+{
+	bool last;
+	{
+		ClassAdMutexLock lock( attr_name_mutex );
+		e->refs += delta;
+		last = e->refs <= 0;
+	}
+	if( last ) {
+		delete e;
+	}
+}
+
+bool AttrName::
+SameUntabled( const AttrNameEntry *e1, const AttrNameEntry *e2, bool exact )
+{
+	if( e1->hash != e2->hash ) {
+		return false;
+	}
+	return exact ? e1->name == e2->name
+				 : strcasecmp( e1->name.c_str(), e2->name.c_str() ) == 0;
+}
+
+const string &AttrName::
+EmptyName( )
+{
+	static const string empty;
+	return empty;
+}
+
+} // classad
@@ -43,7 +43,7 @@ AttributeReference( ExprTree *tree, const string &attrname, bool absolut )
 #if defined(SCOPE_REFACTOR)
 	parentScope = NULL;
 #endif
-	attributeStr = attrname;
+	attributeName = AttrName( attrname );
 	expr = tree;
 	absolute = absolut;
 }
@@ -99,7 +99,7 @@ CopyFrom(const AttributeReference &ref)
 #if defined(SCOPE_REFACTOR)
 	parentScope = ref.parentScope;
 #endif
-	attributeStr = ref.attributeStr;
+	attributeName = ref.attributeName;
 	if( ref.expr && ( expr=ref.expr->Copy( ) ) == NULL ) {
         success = false;
 	} else {
@@ -115,7 +115,7 @@ bool AttributeReference::SetComponents( ExprTree *tree, const std::string &attr,
 		if (expr) delete expr;
 		expr = tree;
 	}
-	attributeStr = attr;
+	attributeName = AttrName( attr );
 	absolute = abs;
 	return true;
 }
@@ -136,7 +136,7 @@ SameAs(const ExprTree *tree) const
         const AttributeReference *other_ref = (const AttributeReference *) pSelfTree;
         
         if (   absolute     != other_ref->absolute
-            || attributeStr != other_ref->attributeStr) {
+            || !attributeName.SameSpelling( other_ref->attributeName )) {
             is_same = false;
         } else if (    (expr == NULL && other_ref->expr == NULL)
                     || (expr == other_ref->expr)
@@ -171,7 +171,7 @@ void AttributeReference::
 GetComponents( ExprTree *&tree, string &attr, bool &abs ) const
 {
 	tree = expr;
-	attr = attributeStr;
+	attr = attributeName;
 	abs = absolute;
 }
 
@@ -265,7 +265,7 @@ _Evaluate (EvalState &state, Value &val, ExprTree *&sig ) const
 		}
 		default:  CLASSAD_EXCEPT( "ClassAd:  Should not reach here" );
 	}
-	if(!rval || !(sig=new AttributeReference(exprSig,attributeStr,absolute))){
+	if(!rval || !(sig=new AttributeReference(exprSig,attributeName,absolute))){
 		if( rval ) {
 			CondorErrno = ERR_MEM_ALLOC_FAILED;
 			CondorErrMsg = "";
@@ -316,7 +316,7 @@ _Flatten( EvalState &state, Value &val, ExprTree*&ntree, int*) const
 				state.depth_remaining++;
 
 				if( rval && expr_ntree ) {
-					ntree = MakeAttributeReference(expr_ntree,attributeStr);
+					ntree = MakeAttributeReference(expr_ntree,attributeName);
 					if( ntree ) {
 						state.curAd = curAd;
 						return true;
@@ -421,7 +421,7 @@ FindExpr(EvalState &state, ExprTree *&tree, ExprTree *&sig, bool wantSig) const
 			} else {
 				AttributeReference *attrRef = NULL;
 				attrRef = MakeAttributeReference( currExpr->Copy( ),
-												  attributeStr,
+												  attributeName,
 												  false );
 				val.Clear( );
 					// Create new EvalState, within this scope, because
@@ -466,9 +466,9 @@ FindExpr(EvalState &state, ExprTree *&tree, ExprTree *&sig, bool wantSig) const
 		 * Expect alternateScope to be removed from a future release.
 		 */
 	if (!current) { return EVAL_UNDEF; }
-	int rc = current->LookupInScope( attributeStr, tree, state );
+	int rc = current->LookupInScope( attributeName, tree, state );
 	if ( !expr && !absolute && rc == EVAL_UNDEF && current->alternateScope ) {
-		rc = current->alternateScope->LookupInScope( attributeStr, tree, state );
+		rc = current->alternateScope->LookupInScope( attributeName, tree, state );
 	}
 	return rc;
 }
@@ -278,7 +278,7 @@ GetComponents( vector< pair< string, ExprTree* > > &attrs ) const
 	for( AttrList::const_iterator itr=attrList.begin(); itr!=attrList.end(); 
 		itr++ ) {
 			// make_pair is a STL function
-		attrs.push_back( make_pair( itr->first, itr->second ) );
+		attrs.push_back( make_pair( itr->first.str(), itr->second ) );
 	}
 }
 
@@ -288,9 +288,9 @@ GetComponents( vector< pair< string, ExprTree* > > &attrs,
 {
 	attrs.clear( );
 	for ( References::const_iterator wl_itr = whitelist.begin(); wl_itr != whitelist.end(); wl_itr++ ) {
-		AttrList::const_iterator attr_itr = attrList.find( *wl_itr );
+		AttrList::const_iterator attr_itr = find( *wl_itr );
 		if ( attr_itr != attrList.end() ) {
-			attrs.push_back( make_pair( attr_itr->first, attr_itr->second ) );
+			attrs.push_back( make_pair( attr_itr->first.str(), attr_itr->second ) );
 		}
 	}
 }
@@ -337,7 +337,7 @@ bool ClassAd::
 InsertAttr( const string &name, long long value)
 {
 	// Optimized insert of long long values that overwrite the destination value if the destination is a literal.
-	classad::ExprTree* & expr = attrList[name];
+	classad::ExprTree* & expr = attrList[AttrName(name)];
 	if (expr) {
 		if (expr->GetKind() == LITERAL_NODE) {
 			((Literal*)expr)->SetLong(value);
@@ -401,7 +401,7 @@ bool ClassAd::
 InsertAttr( const string &name, double value)
 {
 	// Optimized insert of Real values that overwrite the destination value if the destination is a literal.
-	classad::ExprTree* & expr = attrList[name];
+	classad::ExprTree* & expr = attrList[AttrName(name)];
 	if (expr) {
 		if (expr->GetKind() == LITERAL_NODE) {
 			((Literal*)expr)->SetReal(value);
@@ -432,7 +432,7 @@ bool ClassAd::
 InsertAttr( const string &name, bool value )
 {
 	// Optimized insert of bool values that overwrite the destination value if the destination is a literal.
-	classad::ExprTree* & expr = attrList[name];
+	classad::ExprTree* & expr = attrList[AttrName(name)];
 	if (expr) {
 		if (expr->GetKind() == LITERAL_NODE) {
 			((Literal*)expr)->SetBool(value);
@@ -469,7 +469,7 @@ bool ClassAd::
 InsertAttr( const string &name, const char * str, size_t len)
 {
 	// Optimized insert of long long values that overwrite the destination value if the destination is a literal.
-	classad::ExprTree* & expr = attrList[name];
+	classad::ExprTree* & expr = attrList[AttrName(name)];
 	if (expr) {
 		if (expr->GetKind() == LITERAL_NODE) {
 			((Literal*)expr)->SetString(str, len);
@@ -560,8 +560,17 @@ bool ClassAd::InsertViaCache( std::string& name, const std::string & rhs, bool l
 
 bool ClassAd::Insert( const std::string& attrName, ExprTree * tree )
 {
-	bool bRet = false;
-	
+		// sanity check here, so that an empty name is never interned
+	if( attrName.empty() ) {
+		CondorErrno = ERR_MISSING_ATTRNAME;
+		CondorErrMsg= "no attribute name when inserting expression in classad";
+		return false;
+	}
+	return Insert( AttrName( attrName ), tree );
+}
+
+bool ClassAd::Insert( const AttrName& attrName, ExprTree * tree )
+{
 		// sanity checks
 	if( attrName.empty() ) {
 		CondorErrno = ERR_MISSING_ATTRNAME;
@@ -604,7 +613,7 @@ bool ClassAd::InsertLiteral(const std::string & name, Literal* lit)
 	ppv = lit;
 #else
 	//pair<AttrList::iterator,bool> insert_result = attrList.insert( AttrList::value_type(name,lit) );
-	pair<AttrList::iterator,bool> insert_result = attrList.insert( std::make_pair(name, lit) );
+	pair<AttrList::iterator,bool> insert_result = attrList.insert( std::make_pair(AttrName(name), lit) );
 
 	if( !insert_result.second ) {
 			// replace existing value
@@ -629,19 +638,39 @@ DeepInsert( ExprTree *scopeExpr, const string &name, ExprTree *tree )
 ClassAd::iterator ClassAd::
 find(string const& attrName)
 {
-    return attrList.find(attrName);
+	AttrName name;
+	if ( !AttrName::Find(attrName, name) ) {
+		return attrList.end();
+	}
+    return attrList.find(name);
 }
  
 ClassAd::const_iterator ClassAd::
 find(string const& attrName) const
 {
-    return attrList.find(attrName);
+	AttrName name;
+	if ( !AttrName::Find(attrName, name) ) {
+		return attrList.end();
+	}
+    return attrList.find(name);
 }
 // --- end STL-like functions
 
 // --- begin lookup methods
 ExprTree *ClassAd::
 Lookup( const string &name ) const
+{
+	AttrName	attr;
+
+		// a name that was never interned isn't in any ad
+	if( !AttrName::Find( name, attr ) ) {
+		return NULL;
+	}
+	return Lookup( attr );
+}
+
+ExprTree *ClassAd::
+Lookup( const AttrName &name ) const
 {
 	ExprTree *tree;
 	AttrList::const_iterator itr;
@@ -663,7 +692,7 @@ LookupIgnoreChain( const string &name ) const
 	ExprTree *tree;
 	AttrList::const_iterator itr;
 
-	itr = attrList.find( name );
+	itr = find( name );
 	if (itr != attrList.end()) {
 		tree = itr->second;
 	} else {
@@ -694,7 +723,24 @@ LookupInScope( const string &name, const ClassAd *&finalScope ) const
 int ClassAd::
 LookupInScope(const string &name, ExprTree*& expr, EvalState &state) const
 {
-	extern int exprHash( const ExprTree* const&, int );
+	AttrName	attr;
+
+		// a name that was never interned isn't in any ad, though it may
+		// still be one of the special names
+	if( !AttrName::Find( name, attr ) ) {
+		if( getSpecialAttrNames().find( name ) == getSpecialAttrNames().end() ) {
+			expr = NULL;
+			return( EVAL_UNDEF );
+		}
+		attr = AttrName( name );
+	}
+	return LookupInScope( attr, expr, state );
+}
+
+
+int ClassAd::
+LookupInScope(const AttrName &name, ExprTree*& expr, EvalState &state) const
+{
 	const ClassAd *current = this, *superScope;
 	Value			val;
 
@@ -715,7 +761,7 @@ LookupInScope(const string &name, ExprTree*& expr, EvalState &state) const
 		} else {
 			superScope = current->parentScope;
 		}
-		if ( getSpecialAttrNames().find(name) == getSpecialAttrNames().end() ) {
+		if ( getSpecialAttrNames().find(name.str()) == getSpecialAttrNames().end() ) {
 			// continue searching from the superScope ...
 			current = superScope;
 			if( current == this ) {		// NAC - simple loop checker
@@ -759,7 +805,7 @@ Delete( const string &name )
 	bool deleted_attribute;
 
     deleted_attribute = false;
-	AttrList::iterator itr = attrList.find( name );
+	AttrList::iterator itr = find( name );
 	if( itr != attrList.end( ) ) {
 		delete itr->second;
 		attrList.erase( itr );
@@ -807,7 +853,7 @@ Remove( const string &name )
 	ExprTree *tree;
 
 	tree = NULL;
-	AttrList::iterator itr = attrList.find( name );
+	AttrList::iterator itr = find( name );
 	if( itr != attrList.end( ) ) {
 		tree = itr->second;
 		attrList.erase( itr );
@@ -0,0 +1,167 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#ifndef __CLASSAD_ATTR_NAME_H__
+#define __CLASSAD_ATTR_NAME_H__
+
+#include "classad/common.h"
+
+namespace classad {
+
+	// An entry in the process-wide attribute name table.  There is one
+	// entry per distinct spelling of a name; all spellings that differ
+	// only in case share the hash and the folded entry.  Entries in the
+	// table are never freed.  Once the table is full, new names get an
+	// entry of their own that is not in the table (in_table is false);
+	// those are counted by refs and freed with the last AttrName using
+	// them.
+struct AttrNameEntry {
+	std::string			name;
+	size_t				hash;
+	const AttrNameEntry	*folded;
+	AttrNameEntry		*next;
+	bool				in_table;
+	mutable int			refs;
+};
+
+/** An interned attribute name.  Every distinct attribute name is stored
+	once in a process-wide table, and an AttrName is just a pointer into
+	that table, so a ClassAd keyed by AttrName does not carry its own copy
+	of each name, and comparing two names (case-insensitively, as ClassAd
+	attribute names are compared) is a pointer comparison.
+	<p>
+	An AttrName keeps the exact spelling it was created with, which is
+	what str() returns.  It converts to a const std::string &, so it can
+	be used most places a name string is expected.
+	<p>
+	Attribute names come from ads received over the network, so the
+	table is bounded (see SetTableLimit()).  Names first seen after it
+	is full are not added to it; they compare by string instead of by
+	pointer and are freed when no longer used.
+*/
+class AttrName
+{
+	public:
+		/// Constructor; the new object refers to no name.
+		AttrName( ) : entry( NULL ) { }
+
+		/** Constructor; interns the given name.
+			@param name The attribute name.
+		*/
+		explicit AttrName( const std::string &name ) : entry( Intern( name ) ) { }
+		explicit AttrName( const char *name ) : entry( Intern( name ) ) { }
+
+		AttrName( const AttrName &attr ) : entry( attr.entry ) { Hold( entry ); }
+		AttrName &operator=( const AttrName &attr ) {
+			Hold( attr.entry );
+			Release( entry );
+			entry = attr.entry;
+			return *this;
+		}
+		~AttrName( ) { Release( entry ); }
+
+		/** Find a name without interning it.  A name that has never been
+			interned cannot be an attribute of any ClassAd, so lookups
+			use this to avoid growing the table.  Once the table is full,
+			a name that isn't in it may still be in an ad if a name with
+			the same hash has been given an entry outside the table; then
+			attr is set to a name outside the table and true is returned.
+			@param name The attribute name.
+			@param attr Set to the interned name, if there is one.
+			@return true if the name (in any case) has been interned.
+		*/
+		static bool Find( const std::string &name, AttrName &attr );
+
+		/// @return The name as it was spelled when this object was created.
+		const std::string &str( ) const { return entry ? entry->name : EmptyName( ); }
+		operator const std::string &( ) const { return str( ); }
+		const char *c_str( ) const { return str( ).c_str( ); }
+		size_t size( ) const { return str( ).size( ); }
+		size_t length( ) const { return str( ).length( ); }
+		bool empty( ) const { return str( ).empty( ); }
+
+		/// @return The case-insensitive hash of the name.
+		size_t Hash( ) const { return entry ? entry->hash : 0; }
+
+		/// @return true if the two names are the same, ignoring case.
+		bool SameName( const AttrName &attr ) const {
+			return Folded( ) == attr.Folded( ) ||
+				( Untabled( attr ) && SameUntabled( entry, attr.entry, false ) );
+		}
+
+		/// @return true if the two names are spelled exactly the same.
+		bool SameSpelling( const AttrName &attr ) const {
+			return entry == attr.entry ||
+				( Untabled( attr ) && SameUntabled( entry, attr.entry, true ) );
+		}
+
+		/// @return The number of distinct spellings in the table.
+		static size_t NumInterned( );
+
+		/** Set the most distinct spellings the table will hold.  Names
+			already in the table stay there.
+			@param max_names The limit.
+			@return The previous limit.
+		*/
+		static size_t SetTableLimit( size_t max_names );
+
+	private:
+		const AttrNameEntry *Folded( ) const { return entry ? entry->folded : NULL; }
+		bool Untabled( const AttrName &attr ) const {
+			return entry && attr.entry && ( !entry->in_table || !attr.entry->in_table );
+		}
+
+		static void Hold( const AttrNameEntry *e ) { if( e && !e->in_table ) Ref( e, 1 ); }
+		static void Release( const AttrNameEntry *e ) { if( e && !e->in_table ) Ref( e, -1 ); }
+		static void Ref( const AttrNameEntry *e, int delta );
+		static bool SameUntabled( const AttrNameEntry *e1, const AttrNameEntry *e2,
+								  bool exact );
+
+		static const AttrNameEntry *Intern( const std::string &name );
+		static const AttrNameEntry *Intern( const char *name );
+		static const std::string &EmptyName( );
+
+		const AttrNameEntry *entry;
+};
+
+	// Comparisons against plain strings follow std::string semantics
+	// (case-sensitive), like the std::string keys they replace.
+inline bool operator==( const AttrName &a, const std::string &s ) { return a.str() == s; }
+inline bool operator==( const std::string &s, const AttrName &a ) { return a.str() == s; }
+inline bool operator!=( const AttrName &a, const std::string &s ) { return a.str() != s; }
+inline bool operator!=( const std::string &s, const AttrName &a ) { return a.str() != s; }
+inline bool operator==( const AttrName &a, const char *s ) { return a.str() == s; }
+inline bool operator!=( const AttrName &a, const char *s ) { return a.str() != s; }
+
+struct AttrNameHash {
+	inline size_t operator()( const AttrName &a ) const {
+		return a.Hash( );
+	}
+};
+
+struct AttrNameEq {
+	inline bool operator()( const AttrName &a1, const AttrName &a2 ) const {
+		return a1.SameName( a2 );
+	}
+};
+
+} // classad
+
+#endif//__CLASSAD_ATTR_NAME_H__
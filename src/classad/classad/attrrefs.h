@@ -113,7 +113,7 @@ class AttributeReference : public ExprTree
 #endif
 		ExprTree	*expr;
 		bool		absolute;
-    	std::string attributeStr;
+    	AttrName	attributeName;	// interned when the reference is made
 };
 
 } // classad
@@ -38,7 +38,7 @@ typedef std::map<const ClassAd*, References> PortReferences;
 #include "classad/rectangle.h"
 #endif
 
-typedef classad_unordered<std::string, ExprTree*, ClassadAttrNameHash, CaseIgnEqStr> AttrList;
+typedef classad_unordered<AttrName, ExprTree*, AttrNameHash, AttrNameEq> AttrList;
 typedef std::set<std::string, CaseIgnLTStr> DirtyAttrList;
 
 void ClassAdLibraryVersion(int &major, int &minor, int &patch);
@@ -100,6 +100,7 @@ class ClassAd : public ExprTree
 		*/
 #if 1
 		bool Insert( const std::string& attrName, ExprTree* expr);   // (ignores cache)
+		bool Insert( const AttrName& attrName, ExprTree* expr);      // (ignores cache)
 		bool Insert( const std::string& attrName, ClassAd* expr) { return Insert(attrName, (ExprTree*)expr); }    // (ignores cache)
 		bool InsertLiteral(const std::string& attrName, Literal* lit); // (ignores cache)
 
@@ -260,6 +261,15 @@ class ClassAd : public ExprTree
 		*/
 		ExprTree *Lookup( const std::string &attrName ) const;
 
+		/** Finds the expression bound to an interned attribute name.
+				Behaves just like Lookup(), but the name doesn't need to
+				be hashed and compared.
+			@param attrName The name of the attribute.
+			@return The expression bound to the name in the ClassAd, or NULL
+				otherwise.
+		*/
+		ExprTree *Lookup( const AttrName &attrName ) const;
+
 		/** Finds the expression bound to an attribute name, ignoring chained parent.
 		        Behaves just like Lookup(), except any parent ad chained to this
 				ad is ignored.
@@ -753,6 +763,7 @@ class ClassAd : public ExprTree
 		friend 	class ExprTree;
 		friend 	class EvalState;
 		friend 	class ClassAdIterator;
+		friend 	class CompiledExpr;
 
 		bool _GetExternalReferences( const ExprTree *, const ClassAd *, 
 					EvalState &, References&, bool fullNames ) const;
@@ -776,6 +787,7 @@ class ClassAd : public ExprTree
 		virtual bool _Flatten( EvalState&, Value&, ExprTree*&, int* ) const;
 	
 		int LookupInScope( const std::string&, ExprTree*&, EvalState& ) const;
+		int LookupInScope( const AttrName&, ExprTree*&, EvalState& ) const;
 		AttrList	  attrList;
 		DirtyAttrList dirtyAttrList;
 		bool          do_dirty_tracking;
@@ -30,6 +30,8 @@
 #include "classad/jsonSource.h"
 #include "classad/jsonSink.h"
 #include "classad/matchClassad.h"
+#include "classad/compiledExpr.h"
+#include "classad/regexCache.h"
 #include "classad/collection.h"
 #include "classad/collectionBase.h"
 #include "classad/query.h"
@@ -0,0 +1,133 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#ifndef __CLASSAD_COMPILED_EXPR_H__
+#define __CLASSAD_COMPILED_EXPR_H__
+
+#include <vector>
+#include "classad/exprTree.h"
+
+namespace classad {
+
+/** A flat, stack-based program equivalent to an expression tree.
+	Compiling an expression lowers operators, literals and simple
+	attribute references (attr, .attr, scope.attr) into a linear
+	instruction stream, folds constant sub-expressions, and gives every
+	distinct attribute reference a slot so that it is looked up and
+	evaluated at most once per evaluation.  Sub-expressions that cannot
+	be lowered (function calls, lists, nested ads, complex scopes) are
+	evaluated in place by the tree walker, so the result of Evaluate()
+	is always the same as that of evaluating the source tree.
+	<p>
+	The program holds pointers into the source tree, which must outlive
+	it and must not be modified while the program is in use.  A compiled
+	program is not modified by Evaluate(), so it may be shared by
+	several threads as long as each thread uses its own EvalState.
+*/
+class CompiledExpr
+{
+	public:
+		/// Constructor
+		CompiledExpr();
+
+		/// Destructor
+		~CompiledExpr();
+
+		/** Compile an expression, discarding any previous program.
+			@param tree The expression to compile.
+			@return true on success, false otherwise.
+		*/
+		bool Compile( const ExprTree *tree );
+
+		/** Evaluate the program.  This has the same semantics as
+			tree->Evaluate(state, val) for the compiled tree.
+			@param state The current state; curAd must be the scope in
+				which the source expression is to be evaluated.
+			@param val The result of the evaluation.
+			@return true on success, false on failure.
+		*/
+		bool Evaluate( EvalState &state, Value &val ) const;
+
+		/// @return The expression the program was compiled from.
+		const ExprTree *GetSource( ) const { return source; }
+
+		/// @return The number of instructions in the program.
+		int NumInstructions( ) const { return (int)program.size(); }
+
+		/// @return The number of distinct attribute slots in the program.
+		int NumAttrSlots( ) const { return (int)slots.size(); }
+
+	private:
+		enum OpCode {
+			PUSH_CONST,		// push constants[arg]
+			LOAD_ATTR,		// push value of slots[arg], evaluating it once
+			EVAL_TREE,		// push value of trees[arg]
+			UNARY_OP,		// replace top with (op top)
+			BINARY_OP,		// replace top two with (op next top)
+			AND_SC,			// if top is false, jump to target
+			OR_SC,			// if top is true, jump to target
+			TERNARY_SEL,	// pop boolean selector or jump to arg
+			JUMP,			// jump to target
+			POP_EVAL_TREE	// replace top with value of trees[arg]
+		};
+
+		struct Instr {
+			OpCode				code;
+			Operation::OpKind	op;
+			int					arg;
+			int					target;
+		};
+
+			// An attribute reference.  A scoped reference (scope.attr)
+			// refers to the slot of its scope, so that the scope ad is
+			// resolved once and each attribute is looked up in it
+			// directly.
+		struct AttrSlotInfo {
+			const ExprTree		*ref;
+			std::string			key;
+			AttrName			attr;
+			int					scope;
+		};
+
+		bool CompileNode( const ExprTree *tree, int depth );
+		bool FoldConstant( const ExprTree *tree, Value &val ) const;
+		int  Emit( OpCode code, int arg = 0,
+				   Operation::OpKind op = Operation::__NO_OP__ );
+		int  AttrSlot( const AttributeReference *ref );
+		bool EvalSlot( int slot, EvalState &state, Value *vals,
+					   char *done ) const;
+		void Clear( );
+
+		const ExprTree					*source;
+		std::vector<Instr>				program;
+		std::vector<Value>				constants;
+		std::vector<const ExprTree*>	trees;
+		std::vector<AttrSlotInfo>		slots;
+		int								max_depth;
+
+		// The copy constructor and assignment operator are private, as
+		// nothing needs to copy compiled programs.
+		CompiledExpr( const CompiledExpr & );
+		CompiledExpr &operator=( const CompiledExpr & );
+};
+
+} // classad
+
+#endif//__CLASSAD_COMPILED_EXPR_H__
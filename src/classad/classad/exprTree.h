@@ -23,6 +23,7 @@
 
 #include "classad/classad_stl.h"
 #include "classad/common.h"
+#include "classad/attrName.h"
 #include "classad/value.h"
 
 namespace classad {
@@ -227,6 +228,7 @@ class ExprTree
 		friend class ExprListIterator;
 		friend class ClassAd;
 		friend class CachedExprEnvelope;
+		friend class CompiledExpr;
 
 		/// Copy constructor
         ExprTree(const ExprTree &tree);
@@ -21,10 +21,13 @@
 #ifndef __CLASSAD_MATCH_CLASSAD_H__
 #define __CLASSAD_MATCH_CLASSAD_H__
 
+#include <map>
 #include "classad/classad.h"
 
 namespace classad {
 
+class CompiledExpr;
+
 /** Special case of a ClassAd which make it easy to do matching.  
     The top-level ClassAd equivalent to the following, with some
     minor implementation differences for efficiency.  Because of
@@ -188,11 +191,32 @@ class MatchClassAd : public ClassAd
 		*/
 		static bool UnoptimizeAdForMatchmaking( ClassAd *ad );
 
+		/** Selects whether symmetricMatch(), rightMatchesLeft() and
+			leftMatchesRight() evaluate the requirements of the left and
+			right ads through compiled programs (see CompiledExpr) rather
+			than by walking their expression trees.  This pays off for
+			an ad that is matched against many others, such as a job
+			being matched against every machine.  Compiled programs are
+			cached by requirements expression, so FlushCompiledExprs()
+			must be called before an ad that was matched with compilation
+			enabled is modified or deleted.
+			@param left True to compile the left ad's requirements.
+			@param right True to compile the right ad's requirements.
+		*/
+		void SetCompiledEval( bool left, bool right );
+
+		/** Discards all compiled requirements cached by this match ad.
+		*/
+		void FlushCompiledExprs( );
+
 	protected:
 		const ClassAd *ladParent, *radParent;
 		ClassAd *lCtx, *rCtx, *lad, *rad;
 		ExprTree *symmetric_match, *right_matches_left, *left_matches_right;
 
+		bool compile_left, compile_right;
+		std::map<const ExprTree*, CompiledExpr*> compiled_exprs;
+
     private:
         // The copy constructor and assignment operator are defined
         // to be private so we don't have to write them, or worry about
@@ -218,6 +242,14 @@ class MatchClassAd : public ClassAd
 		   @return true if the given expression evaluates to true
 		*/
 		bool EvalMatchExpr(ExprTree *match_expr);
+
+		/** Evaluates the requirements of the given ad, which must be
+			lad or rad, the same way as evaluating match_expr (the
+			corresponding LEFT.requirements or RIGHT.requirements).
+			@return true on success, false otherwise
+		*/
+		bool EvalRequirements(ClassAd *ad, bool compile, ExprTree *match_expr,
+							  Value &val);
 };
 
 } // classad
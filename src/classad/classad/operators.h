@@ -250,6 +250,8 @@ class Operation : public ExprTree
 		static void compareAbsoluteTimes(OpKind, Value&, Value&, Value&);
 		static void compareRelativeTimes(OpKind, Value&, Value&, Value&);
 
+		friend class CompiledExpr;
+
 #if defined(SCOPE_REFACTOR)
 		const ClassAd *parentScope;
 #endif
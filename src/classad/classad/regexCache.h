@@ -0,0 +1,97 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#ifndef __CLASSAD_REGEX_CACHE_H__
+#define __CLASSAD_REGEX_CACHE_H__
+
+#include <string>
+#include <stddef.h>
+
+namespace classad {
+
+struct RegexCacheEntry;
+
+/** A handle on a PCRE pattern compiled through a process-wide cache.
+	The cache is keyed by pattern and compile options, so expressions
+	such as regexp("^node[0-9]+\\.", Machine) compile their pattern
+	once instead of for every ad they are evaluated against.  Compiled
+	patterns are studied (and JIT-compiled where PCRE supports it).  The
+	JIT counts toward the match limit differently from the interpreter
+	and has a smaller stack, so a match that runs out of JIT stack is
+	run again by the interpreter with PCRE's default limits, as it was
+	before patterns were cached.
+	<p>
+	The cache holds at most SetRegexCacheSize() patterns, discarding
+	the least recently used; a pattern that is discarded while a handle
+	still refers to it is freed when the last handle lets go.  Handles
+	may be used from several threads at once.  Without PCRE, Compile()
+	always fails.
+*/
+class CachedRegex
+{
+	public:
+		CachedRegex();
+		CachedRegex( const CachedRegex &other );
+		CachedRegex &operator=( const CachedRegex &other );
+		~CachedRegex();
+
+		/** Get the compiled form of a pattern, compiling it if it
+			isn't in the cache.
+			@param pattern The pattern.
+			@param options Options for pcre_compile().
+			@param errptr Set to the error message on failure (may be NULL).
+			@param erroffset Set to the error offset on failure (may be NULL).
+			@return true on success, false otherwise.
+		*/
+		bool Compile( const char *pattern, int options,
+					  const char **errptr = NULL, int *erroffset = NULL );
+
+		/// Has a pattern been compiled successfully?
+		bool IsCompiled() const { return m_entry != NULL; }
+
+		/// Forget the pattern.
+		void Clear();
+
+		/** Match as pcre_exec() does.
+			@return The pcre_exec() result: the number of captured
+				substrings plus one on success, negative on failure.
+		*/
+		int Exec( const char *subject, int length, int start, int options,
+				  int *ovector, int ovecsize ) const;
+
+		/// Number of capturing subpatterns in the pattern
+		int CaptureCount() const;
+
+		/// Memory used by the compiled pattern
+		size_t MemUsed() const;
+
+	private:
+		RegexCacheEntry *m_entry;
+};
+
+/// Set the maximum number of patterns kept in the cache
+void SetRegexCacheSize( size_t max_entries );
+
+/// Discard all cached patterns that are not in use
+void ClearRegexCache( );
+
+} // classad
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "classad/common.h"
 #include "classad/classadCache.h"
+#include "classadMutex.h"
 #include "classad/sink.h"
 #include "classad/source.h"
 #include <assert.h>
@@ -27,6 +28,15 @@
 using namespace classad;
 using namespace std;
 
+	// The cache is shared by every ClassAd in the process, and ads are
+	// changed and freed on more than one thread (the schedd checks the
+	// jobs it loads in parallel, and the collector's query threads free
+	// their copies of ads), so the map is only touched with this held.
+	// An entry is freed once its last envelope goes, which removes it
+	// from the map; until then another thread may find it expired in
+	// the map, and replaces it with a new entry.
+static ClassAdMutex cache_mutex = CLASSAD_MUTEX_INITIALIZER;
+
 /**
  * ClassAdCache - is meant to be the storage container which is used to cache classads,
  * I've tried some fancy tricks but they don't actually yield much better performance 
@@ -91,6 +101,7 @@ public:
 #endif
 	{
 		pCacheData pRet;
+		ClassAdMutexLock lock(cache_mutex);
 
 		cache_iterator itr = m_Cache.find(szName);
 		bool bValidName=false;
@@ -102,10 +113,8 @@ public:
 			szName = itr->first;
 #endif
 
-			// check the value cache
-			if (vtr != itr->second.end()) {
-				pRet = vtr->second.lock();
-
+			// check the value cache; an expired entry is on its way out
+			if (vtr != itr->second.end() && (pRet = vtr->second.lock())) {
 				m_HitCount++;
 				if (pVal) {
 					delete pVal;
@@ -144,6 +153,7 @@ public:
 #endif
 	{
 		pCacheData pRet;
+		ClassAdMutexLock lock(cache_mutex);
 
 		cache_iterator itr = m_Cache.find(szName);
 		bool bValidName=false;
@@ -155,9 +165,8 @@ public:
 			szName = itr->first;
 #endif
 
-			// check the value cache
-			if (vtr != itr->second.end()) {
-				pRet = vtr->second.lock();
+			// check the value cache; an expired entry is on its way out
+			if (vtr != itr->second.end() && (pRet = vtr->second.lock())) {
 				m_HitCount++;
 				// don't to any more checks just return.
 				return pRet;
@@ -184,13 +193,18 @@ public:
 		// and possibly other places as well.
 		if (m_destroyed) return false;
 
+		ClassAdMutexLock lock(cache_mutex);
 		cache_iterator itr = m_Cache.find(szName);
 
 		if (itr != m_Cache.end()) {
+			value_iterator vtr = itr->second.find(szValue);
+				// the entry may already have been replaced by a live one
+			if (vtr == itr->second.end() || ! vtr->second.expired()) {
+				return false;
+			}
 			if (itr->second.size() == 1) {
 				m_Cache.erase(itr);
 			} else {
-				value_iterator vtr = itr->second.find(szValue);
 				itr->second.erase(vtr);
 			}
 
@@ -206,6 +220,7 @@ public:
 	{
 	  FILE * fp = fopen ( szFile.c_str(), "a+" );
 	  bool bRet = false;
+	  ClassAdMutexLock lock(cache_mutex);
 
 	  if (fp)
 	  {
@@ -279,6 +294,7 @@ public:
 		unsigned long cSingletonValues = 0;
 		unsigned long cAttribsWithOnlySingletonValues = 0;
 		unsigned long cSingletonAttribs = 0;
+		ClassAdMutexLock lock(cache_mutex);
 
 		if (m_HitCount+m_MissCount) {
 			double dTot = m_HitCount + m_MissCount;
@@ -319,6 +335,7 @@ public:
 	};
 
 	void get_counts(unsigned long &hits, unsigned long &misses, unsigned long &querys, unsigned long & hitdels, unsigned long &removals, unsigned long &unparse) {
+		ClassAdMutexLock lock(cache_mutex);
 		hits = m_HitCount;
 		misses = m_MissCount;
 		querys = m_QueryCount;
@@ -330,6 +347,14 @@ public:
 
 
 static classad_shared_ptr<ClassAdCache> _cache;
+
+	// The cache, created on first use.
+static ClassAdCache * shared_cache()
+{
+	ClassAdMutexLock lock(cache_mutex);
+	if ( ! _cache) { _cache.reset( new ClassAdCache() ); }
+	return _cache.get();
+}
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -372,9 +397,8 @@ ExprTree * CachedExprEnvelope::cache (const std::string & pName, ExprTree * pTre
 		break;
 
 	default:
-		if ( ! _cache) { _cache.reset( new ClassAdCache() ); }
 		pNewEnv = new CachedExprEnvelope();
-		pNewEnv->m_pLetter = _cache->cache(pName, szValue, pTree);
+		pNewEnv->m_pLetter = shared_cache()->cache(pName, szValue, pTree);
 		pRet = pNewEnv;
 		break;
 	}
@@ -388,9 +412,8 @@ ExprTree * CachedExprEnvelope::cache_lazy (std::string & pName, const std::strin
 ExprTree * CachedExprEnvelope::cache_lazy (const std::string & pName, const std::string & szValue)
 #endif
 {
-	if ( ! _cache) { _cache.reset( new ClassAdCache() ); }
 	CachedExprEnvelope *pEnv = new CachedExprEnvelope();
-	pEnv->m_pLetter = _cache->insert_lazy(pName, szValue);
+	pEnv->m_pLetter = shared_cache()->insert_lazy(pName, szValue);
 	return pEnv;
 }
 
@@ -416,12 +439,7 @@ CachedExprEnvelope * CachedExprEnvelope::check_hit (string & szName, const strin
 {
    CachedExprEnvelope * pRet = 0; 
 
-   if (!_cache)
-   {
-	_cache.reset(new ClassAdCache());
-   }
-
-   pCacheData cache_check = _cache->cache( szName, szValue, 0);
+   pCacheData cache_check = shared_cache()->cache( szName, szValue, 0);
 
    if (cache_check)
    {
@@ -433,18 +451,61 @@ CachedExprEnvelope * CachedExprEnvelope::check_hit (string & szName, const strin
 }
 
 
+	// A lazily parsed entry is shared by every ad that has the same
+	// attribute and value, and those ads may be read by several threads
+	// at once (the collector's threaded queries), so the parsed tree is
+	// installed with a compare-and-swap.  A thread that loses the race
+	// frees its own tree and uses the winner's.
+static inline ExprTree *
+load_parsed( ExprTree * const * slot )
+{
+#if defined(__GNUC__)
+	return __atomic_load_n( slot, __ATOMIC_ACQUIRE );
+#elif defined(WIN32)
+	return (ExprTree *)InterlockedCompareExchangePointer( (PVOID volatile *)slot, NULL, NULL );
+#else
+	return *slot;
+#endif
+}
+
+static inline ExprTree *
+install_parsed( ExprTree ** slot, ExprTree * expr )
+{
+#if defined(__GNUC__)
+	ExprTree * expected = NULL;
+	if ( __atomic_compare_exchange_n( slot, &expected, expr, false,
+									  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+		return expr;
+	}
+	delete expr;
+	return expected;
+#elif defined(WIN32)
+	ExprTree * other = (ExprTree *)InterlockedCompareExchangePointer( (PVOID volatile *)slot, expr, NULL );
+	if ( ! other) {
+		return expr;
+	}
+	delete expr;
+	return other;
+#else
+	*slot = expr;
+	return expr;
+#endif
+}
+
 ExprTree * CachedExprEnvelope::get() const
 {
 	ExprTree * expr = NULL;
 	
 	if (m_pLetter) {
 		CacheEntry * ptr = m_pLetter.get();
-		expr = ptr->pData;
+		expr = load_parsed(&ptr->pData);
 		if ( ! expr) {
 			ClassAdParser parser;
 			parser.SetOldClassAd(true);
 			expr = parser.ParseExpression(ptr->szValue);
-			ptr->pData = expr;
+			if (expr) {
+				expr = install_parsed(&ptr->pData, expr);
+			}
 		}
 	}
 	
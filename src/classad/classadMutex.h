@@ -0,0 +1,108 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#ifndef __CLASSAD_MUTEX_H__
+#define __CLASSAD_MUTEX_H__
+
+#include "classad/common.h"
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+namespace classad {
+
+	// A mutex for the library's process-wide tables.  The library is
+	// used from plain threads as well as OpenMP ones, so this is a real
+	// lock rather than an OpenMP critical section.  It is an aggregate,
+	// initialized with CLASSAD_MUTEX_INITIALIZER, so that one declared
+	// at namespace scope works from static constructors; it is never
+	// destroyed.
+struct ClassAdMutex {
+#ifdef WIN32
+	volatile LONG		state;		// 0 = not set up, 1 = setting up, 2 = ready
+	CRITICAL_SECTION	cs;
+#else
+	pthread_mutex_t		mutex;
+#endif
+
+	void Lock( );
+	void Unlock( );
+};
+
+#ifdef WIN32
+
+#define CLASSAD_MUTEX_INITIALIZER { 0 }
+
+inline void ClassAdMutex::
+Lock( )
+{
+	if( state != 2 ) {
+		if( InterlockedCompareExchange( &state, 1, 0 ) == 0 ) {
+			InitializeCriticalSection( &cs );
+			InterlockedExchange( &state, 2 );
+		} else {
+			while( state != 2 ) {
+				Sleep( 0 );
+			}
+		}
+	}
+	EnterCriticalSection( &cs );
+}
+
+inline void ClassAdMutex::
+Unlock( )
+{
+	LeaveCriticalSection( &cs );
+}
+
+#else
+
+#define CLASSAD_MUTEX_INITIALIZER { PTHREAD_MUTEX_INITIALIZER }
+
+inline void ClassAdMutex::
+Lock( )
+{
+	pthread_mutex_lock( &mutex );
+}
+
+inline void ClassAdMutex::
+Unlock( )
+{
+	pthread_mutex_unlock( &mutex );
+}
+
+#endif
+
+	// Holds a ClassAdMutex for the life of the object.
+class ClassAdMutexLock {
+	public:
+		ClassAdMutexLock( ClassAdMutex &m ) : mutex( m ) { mutex.Lock( ); }
+		~ClassAdMutexLock( ) { mutex.Unlock( ); }
+
+	private:
+		ClassAdMutexLock( const ClassAdMutexLock & );
+		ClassAdMutexLock &operator=( const ClassAdMutexLock & );
+
+		ClassAdMutex &mutex;
+};
+
+} // classad
+
+#endif//__CLASSAD_MUTEX_H__
@@ -39,6 +39,13 @@
 #include <iostream>
 #include <ctype.h>
 #include <assert.h>
+#if defined(USE_PCRE)
+  #ifdef HAVE_PCRE_H
+    #include <pcre.h>
+  #elif defined HAVE_PCRE_PCRE_H
+    #include <pcre/pcre.h>
+  #endif
+#endif
 
 using namespace std;
 using namespace classad;
@@ -94,6 +101,7 @@ static void test_parsing(const Parameters &parameters, Results &results);
 static void test_classad(const Parameters &parameters, Results &results);
 static void test_exprlist(const Parameters &parameters, Results &results);
 static void test_value(const Parameters &parameters, Results &results);
+static void test_match(const Parameters &parameters, Results &results);
 static void test_collection(const Parameters &parameters, Results &results);
 static void test_utils(const Parameters &parameters, Results &results);
 static bool check_in_view(ClassAdCollection *collection, string view_name, string classad_name);
@@ -288,6 +296,7 @@ int main(
     if (parameters.check_all || parameters.check_literal) {
     }
     if (parameters.check_all || parameters.check_match) {
+        test_match(parameters, results);
     }
     if (parameters.check_all || parameters.check_operator) {
     }
@@ -543,6 +552,43 @@ static void test_classad(const Parameters &, Results &results)
     TEST("update from chain is merged",(have_attribute==true));
     TEST("update from chain has attribute c==6",(i==6));
 
+    /* ----- Test interned attribute names ----- */
+    ClassAd classad4;
+    AttrName attr_name;
+    classad4.InsertAttr("InternedName", 5);
+    TEST("interned name is found in any case", AttrName::Find("INTERNEDNAME", attr_name));
+    TEST("interned name keeps its first spelling", attr_name.str() == "InternedName");
+    TEST("interned name lookup", classad4.Lookup(attr_name) == classad4.Lookup("internedname"));
+    TEST("interned names compare without case", AttrName("internedNAME").SameName(attr_name));
+    TEST("interned spellings are distinct", !AttrName("internedNAME").SameSpelling(attr_name));
+    classad4.InsertAttr("INTERNEDNAME", 6);
+    have_attribute = classad4.EvaluateAttrInt("InternedName", i);
+    TEST("insert in another case replaces the attribute", have_attribute && i == 6 && classad4.size() == 1);
+    TEST("attribute keeps the spelling it was inserted with", classad4.begin()->first.str() == "InternedName");
+    TEST("unknown names are not interned by lookups",
+         classad4.Lookup("NeverInsertedAnywhere") == NULL &&
+         !AttrName::Find("NeverInsertedAnywhere", attr_name));
+    size_t num_interned = AttrName::NumInterned();
+    have_attribute = classad4.EvaluateAttrInt("NeverEvaluatedAnywhere", i);
+    TEST("unknown names are not interned by scoped lookups",
+         !have_attribute && AttrName::NumInterned() == num_interned);
+
+    size_t table_limit = AttrName::SetTableLimit(num_interned);
+    classad4.InsertAttr("PastTheLimit", 7);
+    TEST("names past the table limit are not interned", AttrName::NumInterned() == num_interned);
+    have_attribute = classad4.EvaluateAttrInt("pastthelimit", i);
+    TEST("names past the table limit can be looked up", have_attribute && i == 7);
+    TEST("names past the table limit are found", AttrName::Find("PASTTHELIMIT", attr_name) &&
+         attr_name.SameName(AttrName("PastTheLimit")) && !attr_name.SameSpelling(AttrName("PastTheLimit")));
+    classad4.InsertAttr("PASTTHELIMIT", 8);
+    have_attribute = classad4.EvaluateAttrInt("PastTheLimit", i);
+    TEST("names past the table limit replace in any case", have_attribute && i == 8 && classad4.size() == 2);
+    TEST("names past the table limit can be deleted", classad4.Delete("PastThelimit") && classad4.size() == 1);
+    TEST("names in no ad are not found past the table limit",
+         !AttrName::Find("NeverInsertedPastTheLimit", attr_name) &&
+         classad4.Lookup("NeverInsertedPastTheLimit") == NULL);
+    AttrName::SetTableLimit(table_limit);
+
     return;
 }
 
@@ -779,6 +825,112 @@ static void test_value(const Parameters &, Results &results)
     return;
 }
 
+/*********************************************************************
+ *
+ * Function: test_match
+ * Purpose:  Test the MatchClassAd class and compiled expressions
+ *
+ *********************************************************************/
+static void test_match(const Parameters &, Results &results)
+{
+    ClassAdParser parser;
+
+    cout << "Testing the MatchClassAd class...\n";
+
+    ClassAd *job = parser.ParseClassAd(
+        "[ Owner = \"alice\"; ImageSize = 1000; RequestMemory = 2048;"
+        "  Requirements = TARGET.Arch == \"X86_64\" && TARGET.Memory >= MY.RequestMemory"
+        "                 && (TARGET.HasDocker =?= true || TARGET.Disk > ImageSize * 2);"
+        "  Rank = TARGET.Memory; ]");
+    ClassAd *machine = parser.ParseClassAd(
+        "[ Arch = \"x86_64\"; Memory = 4096; Disk = 500; HasDocker = true;"
+        "  Requirements = TARGET.Owner != \"bob\" && TARGET.ImageSize < Memory * 1024; ]");
+    ClassAd *small = parser.ParseClassAd(
+        "[ Arch = \"X86_64\"; Memory = 1024; Disk = 50000;"
+        "  Requirements = true; ]");
+
+    MatchClassAd mad(job, machine);
+    TEST("Job and machine match", mad.symmetricMatch());
+    mad.SetCompiledEval(true, true);
+    TEST("Job and machine match (compiled)", mad.symmetricMatch());
+    TEST("Machine matches job (compiled)", mad.rightMatchesLeft());
+    TEST("Job matches machine (compiled)", mad.leftMatchesRight());
+    mad.RemoveRightAd();
+    mad.ReplaceRightAd(small);
+    TEST("Job does not match small machine (compiled)", !mad.symmetricMatch());
+    mad.SetCompiledEval(false, false);
+    TEST("Job does not match small machine", !mad.symmetricMatch());
+    mad.RemoveLeftAd();
+    mad.RemoveRightAd();
+
+        // Compiled programs must give the same value as the tree walk
+    const char *exprs[] = {
+        "1 + 2 * 3",
+        "A + B * 2 - C / 2",
+        "A < B && B < C",
+        "A > B || undefined",
+        "false && error",
+        "true || error",
+        "undefined && false",
+        "X is undefined",
+        "X isnt undefined && X > 1",
+        "A > 1 ? \"big\" : \"small\"",
+        "X ? 1 : 2",
+        "\"abc\" == \"ABC\"",
+        "S =?= \"FOO\"",
+        "strcat(S, \"bar\") == \"foobar\"",
+        "L[1] + size(L)",
+        "Nested.Inner * 2",
+        "-A + ~B + !D",
+        "(A + B) * (A + B) + A * A",
+        "A / 0",
+        "X ?: A",
+        ".A + 1",
+    };
+    ClassAd *scope = parser.ParseClassAd(
+        "[ A = 3; B = 4.5; C = 10; D = false; S = \"foo\"; L = { 1, 2, 3 };"
+        "  Nested = [ Inner = 21; ]; ]");
+    for (size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++) {
+        ExprTree *tree = parser.ParseExpression(exprs[i]);
+        if (tree == NULL) {
+            TEST(exprs[i], false);
+            continue;
+        }
+        tree->SetParentScope(scope);
+
+        Value tree_val, compiled_val;
+        EvalState tree_state, compiled_state;
+        tree_state.SetScopes(scope);
+        compiled_state.SetScopes(scope);
+
+        CompiledExpr prog;
+        bool tree_ok = tree->Evaluate(tree_state, tree_val);
+        TEST("Expression compiles", prog.Compile(tree));
+        bool compiled_ok = prog.Evaluate(compiled_state, compiled_val);
+        TEST(exprs[i], tree_ok == compiled_ok &&
+             tree_val.SameAs(compiled_val));
+        delete tree;
+    }
+
+    CompiledExpr folded;
+    ExprTree *constant = parser.ParseExpression("(1 + 2) * 3 > 8");
+    folded.Compile(constant);
+    TEST("Constant expression is folded", folded.NumInstructions() == 1);
+    delete constant;
+
+    CompiledExpr slotted;
+    ExprTree *refs = parser.ParseExpression("MY.A > 1 && my.a < 10 && TARGET.A == A");
+    slotted.Compile(refs);
+    TEST("Attribute references share slots", slotted.NumAttrSlots() == 5);
+    delete refs;
+
+    delete scope;
+    delete job;
+    delete machine;
+    delete small;
+    return;
+}
+
 /*********************************************************************
  *
  * Function: test_collection
@@ -1023,6 +1175,30 @@ static void test_utils(const Parameters &, Results &results)
     TEST("Dec 31, 2005->6, 364", weekday==6 && yearday==364);
     day_numbers(2004, 12, 31, weekday, yearday);
     TEST("Dec 31, 2005->5, 365", weekday==5 && yearday==365);
+
+#if defined(USE_PCRE)
+    {
+        CachedRegex re1, re2, re3;
+        const char *error = NULL;
+        int erroffset = 0;
+        int ovector[30];
+        TEST("Regex compiles", re1.Compile("^node([0-9]+)\\.", 0, &error, &erroffset));
+        TEST("Regex matches", re1.Exec("node17.cs", 9, 0, 0, ovector, 30) == 2);
+        TEST("Regex captures", ovector[2] == 4 && ovector[3] == 6);
+        TEST("Regex doesn't match", re1.Exec("host17.cs", 9, 0, 0, ovector, 30) < 0);
+        TEST("Cached regex compiles", re2.Compile("^node([0-9]+)\\.", 0));
+        TEST("Cached regex has captures", re2.CaptureCount() == 1);
+        TEST("Bad regex doesn't compile", !re3.Compile("node(", 0, &error, &erroffset) && !re3.IsCompiled());
+        SetRegexCacheSize(1);
+        TEST("Other regex compiles", re3.Compile("^host", PCRE_CASELESS));
+        TEST("Evicted regex still matches", re1.Exec("node17.cs", 9, 0, 0, ovector, 30) == 2);
+        CachedRegex re4(re1);
+        re1.Clear();
+        TEST("Copied regex matches", re4.Exec("node17.cs", 9, 0, 0, ovector, 30) == 2);
+        SetRegexCacheSize(1000);
+        ClearRegexCache();
+    }
+#endif
     return;
 }
 
@@ -0,0 +1,500 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#include "classad/common.h"
+#include "classad/exprTree.h"
+#include "classad/compiledExpr.h"
+
+using namespace std;
+
+namespace classad {
+
+	// Number of stack entries and attribute slots that Evaluate() keeps
+	// on the C stack.  Larger programs allocate their registers.
+static const int INLINE_REGS = 32;
+
+	// Deeper expressions are left to the tree walker, which has its
+	// own recursion limit.
+static const int MAX_COMPILE_DEPTH = 500;
+
+CompiledExpr::
+CompiledExpr() : source(NULL), max_depth(0)
+{
+}
+
+
+CompiledExpr::
+~CompiledExpr()
+{
+}
+
+
+void CompiledExpr::
+Clear( )
+{
+	source = NULL;
+	program.clear();
+	constants.clear();
+	trees.clear();
+	slots.clear();
+	max_depth = 0;
+}
+
+
+bool CompiledExpr::
+Compile( const ExprTree *tree )
+{
+	Clear();
+	if( !tree ) {
+		return false;
+	}
+	source = tree;
+	if( !CompileNode( tree, 0 ) ) {
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+
+int CompiledExpr::
+Emit( OpCode code, int arg, Operation::OpKind op )
+{
+	Instr instr;
+	instr.code = code;
+	instr.op = op;
+	instr.arg = arg;
+	instr.target = 0;
+	program.push_back( instr );
+	return (int)program.size() - 1;
+}
+
+
+int CompiledExpr::
+AttrSlot( const AttributeReference *ref )
+{
+	ExprTree	*scope = NULL;
+	string		attr;
+	bool		absolute = false;
+	int			scope_slot = -1;
+	string		key;
+
+	ref->GetComponents( scope, attr, absolute );
+	if( scope ) {
+			// only simple scopes like MY.attr and TARGET.attr get a slot
+		scope = const_cast<ExprTree*>( scope->self() );
+		if( scope->GetKind() != ExprTree::ATTRREF_NODE ) {
+			return -1;
+		}
+		ExprTree	*scope_scope = NULL;
+		string		scope_attr;
+		bool		scope_absolute = false;
+		((const AttributeReference*)scope)->GetComponents( scope_scope,
+										scope_attr, scope_absolute );
+		if( scope_scope || scope_absolute ) {
+			return -1;
+		}
+		scope_slot = AttrSlot( (const AttributeReference*)scope );
+		key = slots[scope_slot].key;
+		key += '.';
+	} else if( absolute ) {
+		key = ".";
+	}
+	key += attr;
+
+		// attribute names are case-insensitive, so are slot names
+	for( string::iterator it = key.begin(); it != key.end(); ++it ) {
+		*it = tolower( *it );
+	}
+
+	for( size_t i = 0; i < slots.size(); i++ ) {
+		if( slots[i].key == key ) {
+			return (int)i;
+		}
+	}
+	AttrSlotInfo info;
+	info.ref = ref;
+	info.key = key;
+	info.attr = AttrName( attr );
+	info.scope = scope_slot;
+	slots.push_back( info );
+	return (int)slots.size() - 1;
+}
+
+
+bool CompiledExpr::
+FoldConstant( const ExprTree *tree, Value &val ) const
+{
+	switch( tree->GetKind() ) {
+		case ExprTree::LITERAL_NODE:
+			break;
+
+		case ExprTree::OP_NODE: {
+			Operation::OpKind	op;
+			ExprTree			*c1 = NULL, *c2 = NULL, *c3 = NULL;
+			Value				dummy;
+
+			((const Operation*)tree)->GetComponents( op, c1, c2, c3 );
+			if( op == Operation::SUBSCRIPT_OP ) {
+				return false;
+			}
+			if( ( c1 && !FoldConstant( c1->self(), dummy ) ) ||
+				( c2 && !FoldConstant( c2->self(), dummy ) ) ||
+				( c3 && !FoldConstant( c3->self(), dummy ) ) ) {
+				return false;
+			}
+			break;
+		}
+
+		default:
+			return false;
+	}
+
+	EvalState state;
+	if( !tree->Evaluate( state, val ) ) {
+		return false;
+	}
+
+		// lists and ads are referenced, not copied, by values
+	return !( val.IsClassAdValue() || val.IsListValue() );
+}
+
+
+bool CompiledExpr::
+CompileNode( const ExprTree *tree, int depth )
+{
+	if( !tree || depth >= MAX_COMPILE_DEPTH ) {
+		return false;
+	}
+	tree = tree->self();
+	if( depth + 1 > max_depth ) {
+		max_depth = depth + 1;
+	}
+
+	Value val;
+	if( FoldConstant( tree, val ) ) {
+		constants.push_back( val );
+		Emit( PUSH_CONST, (int)constants.size() - 1 );
+		return true;
+	}
+
+	switch( tree->GetKind() ) {
+		case ExprTree::ATTRREF_NODE: {
+			int slot = AttrSlot( (const AttributeReference*)tree );
+			if( slot >= 0 ) {
+				Emit( LOAD_ATTR, slot );
+				return true;
+			}
+			break;
+		}
+
+		case ExprTree::OP_NODE: {
+			Operation::OpKind	op;
+			ExprTree			*c1 = NULL, *c2 = NULL, *c3 = NULL;
+
+			((const Operation*)tree)->GetComponents( op, c1, c2, c3 );
+			switch( op ) {
+				case Operation::PARENTHESES_OP:
+					return CompileNode( c1, depth );
+
+				case Operation::UNARY_PLUS_OP:
+				case Operation::UNARY_MINUS_OP:
+				case Operation::LOGICAL_NOT_OP:
+				case Operation::BITWISE_NOT_OP:
+					if( !CompileNode( c1, depth ) ) {
+						return false;
+					}
+					Emit( UNARY_OP, 0, op );
+					return true;
+
+				case Operation::LOGICAL_AND_OP:
+				case Operation::LOGICAL_OR_OP: {
+						// the right operand is skipped when the left
+						// operand decides the result, as in the tree walk
+					if( !CompileNode( c1, depth ) ) {
+						return false;
+					}
+					int sc = Emit( op == Operation::LOGICAL_AND_OP ?
+								   AND_SC : OR_SC );
+					if( !CompileNode( c2, depth + 1 ) ) {
+						return false;
+					}
+					Emit( BINARY_OP, 0, op );
+					program[sc].target = (int)program.size();
+					return true;
+				}
+
+				case Operation::TERNARY_OP: {
+					if( !c2 ) {
+							// the "elvis" form is left to the tree walk
+						break;
+					}
+					if( !CompileNode( c1, depth ) ) {
+						return false;
+					}
+					int sel = Emit( TERNARY_SEL );
+					if( !CompileNode( c2, depth ) ) {
+						return false;
+					}
+					int end_true = Emit( JUMP );
+					program[sel].target = (int)program.size();
+					if( !CompileNode( c3, depth ) ) {
+						return false;
+					}
+					int end_false = Emit( JUMP );
+
+						// a selector that is not a boolean is rare; let the
+						// tree walk sort out what the result should be
+					program[sel].arg = (int)program.size();
+					trees.push_back( tree );
+					Emit( POP_EVAL_TREE, (int)trees.size() - 1 );
+
+					program[end_true].target = (int)program.size();
+					program[end_false].target = (int)program.size();
+					return true;
+				}
+
+				default:
+					if( c1 && c2 && !c3 ) {
+						if( !CompileNode( c1, depth ) ||
+							!CompileNode( c2, depth + 1 ) ) {
+							return false;
+						}
+						Emit( BINARY_OP, 0, op );
+						return true;
+					}
+					break;
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+
+		// everything else (function calls, lists, ads, complex attribute
+		// references) is evaluated by walking the tree
+	trees.push_back( tree );
+	Emit( EVAL_TREE, (int)trees.size() - 1 );
+	return true;
+}
+
+
+bool CompiledExpr::
+EvalSlot( int slot, EvalState &state, Value *vals, char *done ) const
+{
+	if( done[slot] ) {
+		return true;
+	}
+
+	const AttrSlotInfo &info = slots[slot];
+	Value &val = vals[slot];
+	const ClassAd *scope_ad = NULL;
+
+	if( info.scope < 0 ) {
+		if( !info.ref->Evaluate( state, val ) ) {
+			return false;
+		}
+		done[slot] = 1;
+		return true;
+	}
+
+		// This is AttributeReference::FindExpr() for scope.attr, with
+		// the value of the scope coming from its own slot.
+	if( !EvalSlot( info.scope, state, vals, done ) ) {
+		return false;
+	}
+	const Value &scope_val = vals[info.scope];
+	if( scope_val.IsUndefinedValue() ) {
+		val.SetUndefinedValue();
+	} else if( scope_val.IsErrorValue() ) {
+		val.SetErrorValue();
+	} else if( scope_val.IsClassAdValue( scope_ad ) ) {
+		const ClassAd	*curAd = state.curAd;
+		ExprTree		*tree = NULL;
+		bool			rval = true;
+
+		switch( scope_ad->LookupInScope( info.attr, tree, state ) ) {
+			case ExprTree::EVAL_OK:
+				if( state.depth_remaining <= 0 ) {
+					val.SetErrorValue();
+					rval = false;
+					break;
+				}
+				state.depth_remaining--;
+				rval = tree->Evaluate( state, val );
+				state.depth_remaining++;
+				break;
+			case ExprTree::EVAL_UNDEF:
+				val.SetUndefinedValue();
+				break;
+			case ExprTree::EVAL_ERROR:
+				val.SetErrorValue();
+				break;
+			default:
+				rval = false;
+				break;
+		}
+		state.curAd = curAd;
+		if( !rval ) {
+			return false;
+		}
+	} else if( scope_val.IsListValue() ) {
+			// attribute of every ad in a list; leave it to the tree walk
+		if( !info.ref->Evaluate( state, val ) ) {
+			return false;
+		}
+	} else {
+		val.SetErrorValue();
+	}
+	done[slot] = 1;
+	return true;
+}
+
+
+bool CompiledExpr::
+Evaluate( EvalState &state, Value &val ) const
+{
+	if( !source ) {
+		val.SetErrorValue();
+		return false;
+	}
+	if( state.debug ) {
+			// the tree walk is what knows how to print debug output
+		return source->Evaluate( state, val );
+	}
+
+	int					nslots = (int)slots.size();
+	int					nregs = max_depth + nslots;
+	Value				inline_regs[INLINE_REGS];
+	char				inline_done[INLINE_REGS];
+	vector<Value>		heap_regs;
+	vector<char>		heap_done;
+	Value				*stack = inline_regs;
+	char				*done = inline_done;
+
+	if( nregs > INLINE_REGS ) {
+		heap_regs.resize( nregs );
+		heap_done.resize( nslots );
+		stack = &heap_regs[0];
+		done = nslots ? &heap_done[0] : NULL;
+	}
+	Value *slot_vals = stack + max_depth;
+	for( int i = 0; i < nslots; i++ ) {
+		done[i] = 0;
+	}
+
+	Value	result;
+	Value	dummy;
+	bool	b;
+	int		sp = 0;
+	int		pc = 0;
+	int		end = (int)program.size();
+
+	while( pc < end ) {
+		const Instr &instr = program[pc++];
+		switch( instr.code ) {
+			case PUSH_CONST:
+				stack[sp++].CopyFrom( constants[instr.arg] );
+				break;
+
+			case LOAD_ATTR:
+				if( !EvalSlot( instr.arg, state, slot_vals, done ) ) {
+					val.SetErrorValue();
+					return false;
+				}
+				stack[sp++].CopyFrom( slot_vals[instr.arg] );
+				break;
+
+			case EVAL_TREE:
+				if( !trees[instr.arg]->Evaluate( state, stack[sp] ) ) {
+					val.SetErrorValue();
+					return false;
+				}
+				sp++;
+				break;
+
+			case UNARY_OP:
+				if( Operation::_doOperation( instr.op, stack[sp-1], dummy,
+						dummy, true, false, false, result, &state ) ==
+					Operation::SIG_NONE ) {
+					val.SetErrorValue();
+					return false;
+				}
+				stack[sp-1].CopyFrom( result );
+				break;
+
+			case BINARY_OP:
+				if( Operation::_doOperation( instr.op, stack[sp-2], stack[sp-1],
+						dummy, true, true, false, result, &state ) ==
+					Operation::SIG_NONE ) {
+					val.SetErrorValue();
+					return false;
+				}
+				sp--;
+				stack[sp-1].CopyFrom( result );
+				break;
+
+			case AND_SC:
+				if( stack[sp-1].IsBooleanValueEquiv( b ) && !b ) {
+					stack[sp-1].SetBooleanValue( false );
+					pc = instr.target;
+				}
+				break;
+
+			case OR_SC:
+				if( stack[sp-1].IsBooleanValueEquiv( b ) && b ) {
+					stack[sp-1].SetBooleanValue( true );
+					pc = instr.target;
+				}
+				break;
+
+			case TERNARY_SEL:
+				if( stack[sp-1].IsBooleanValueEquiv( b ) ) {
+					sp--;
+					if( !b ) {
+						pc = instr.target;
+					}
+				} else {
+					pc = instr.arg;
+				}
+				break;
+
+			case JUMP:
+				pc = instr.target;
+				break;
+
+			case POP_EVAL_TREE:
+				if( !trees[instr.arg]->Evaluate( state, stack[sp-1] ) ) {
+					val.SetErrorValue();
+					return false;
+				}
+				break;
+
+			default:
+				CLASSAD_EXCEPT( "ClassAd:  Should not reach here" );
+		}
+	}
+
+	val.CopyFrom( stack[0] );
+	return true;
+}
+
+} // classad
@@ -27,6 +27,7 @@
 #include "classad/source.h"
 #include "classad/sink.h"
 #include "classad/util.h"
+#include "classad/regexCache.h"
 
 #ifndef WIN32
 #include <sys/time.h>
@@ -2926,9 +2927,7 @@ static bool regexp_helper(
 		return( true );
 	}
 #elif defined (USE_PCRE)
-    const char  *error_message;
-    int         error_offset;
-    pcre        *re;
+    CachedRegex re;
 
     options     = 0;
     if( have_options ){
@@ -2949,28 +2948,27 @@ static bool regexp_helper(
         }
     }
 
-    re = pcre_compile( pattern, options, &error_message,
-                      &error_offset, NULL );
-    if ( re == NULL ){
+		// the pattern is usually a literal, so it is compiled only
+		// the first time through
+    if ( !re.Compile( pattern, options ) ){
 			// error in pattern
 		result.SetErrorValue( );
     } else {
-		int group_count;
-		pcre_fullinfo(re, NULL, PCRE_INFO_CAPTURECOUNT, &group_count);
-		int oveccount = 3 * (group_count + 1); // +1 for the string itself
-		int * ovector = (int *) malloc(oveccount * sizeof(int));
-
+		const int OVECTOR_STACK_SIZE = 3 * 16;
+		int ovector_stack[OVECTOR_STACK_SIZE];
+		int oveccount = 3 * (re.CaptureCount() + 1); // +1 for the string itself
+		int * ovector = ovector_stack;
+		if ( oveccount > OVECTOR_STACK_SIZE ) {
+			ovector = (int *) malloc(oveccount * sizeof(int));
+		}
 
-        status = pcre_exec(re, NULL, target, (int)strlen(target),
-                           0, 0, ovector, oveccount);
+        status = re.Exec(target, (int)strlen(target), 0, 0, ovector, oveccount);
         if (status >= 0) {
             result.SetBooleanValue( true );
         } else {
             result.SetBooleanValue( false );
         }
 
-		pcre_free(re);
-
 		if( replace && status<0 ) {
 			result.SetStringValue( "" );
 		}
@@ -3014,7 +3012,9 @@ static bool regexp_helper(
 			}
 		}
 
-		free( ovector );
+		if ( ovector != ovector_stack ) {
+			free( ovector );
+		}
     }
     return true;
 #endif
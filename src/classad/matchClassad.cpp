@@ -21,11 +21,16 @@
 #include "classad/common.h"
 #include "classad/source.h"
 #include "classad/matchClassad.h"
+#include "classad/compiledExpr.h"
 
 using namespace std;
 
 static char const *ATTR_UNOPTIMIZED_REQUIREMENTS = "UnoptimizedRequirements";
 
+	// Upper bound on the number of compiled requirements kept by a
+	// MatchClassAd between calls to FlushCompiledExprs().
+static const size_t MAX_COMPILED_EXPRS = 1024;
+
 namespace classad {
 
 MatchClassAd::
@@ -37,6 +42,7 @@ MatchClassAd()
 	symmetric_match = NULL;
 	right_matches_left = NULL;
 	left_matches_right = NULL;
+	compile_left = compile_right = false;
 	InitMatchClassAd( NULL, NULL );
 }
 
@@ -46,6 +52,7 @@ MatchClassAd( ClassAd *adl, ClassAd *adr ) : ClassAd()
 {
 	lad = rad = lCtx = rCtx = NULL;
 	ladParent = radParent = NULL;
+	compile_left = compile_right = false;
 	InitMatchClassAd( adl, adr );
 }
 
@@ -53,6 +60,7 @@ MatchClassAd( ClassAd *adl, ClassAd *adr ) : ClassAd()
 MatchClassAd::
 ~MatchClassAd()
 {
+	FlushCompiledExprs( );
 }
 
 
@@ -377,6 +385,20 @@ UnoptimizeAdForMatchmaking( ClassAd *ad )
 	return true;
 }
 
+static bool
+IsMatchValue( const Value &val )
+{
+	bool result = false;
+	if( val.IsBooleanValueEquiv( result ) ) {
+		return result;
+	}
+	long long int_result = 0;
+	if( val.IsIntegerValue( int_result ) ) {
+		return int_result != 0;
+	}
+	return false;
+}
+
 bool MatchClassAd::
 EvalMatchExpr(ExprTree *match_expr)
 {
@@ -386,34 +408,117 @@ EvalMatchExpr(ExprTree *match_expr)
 	}
 
 	if( EvaluateExpr( match_expr, val ) ) {
-		bool result = false;
-		if( val.IsBooleanValueEquiv( result ) ) {
-			return result;
+		return IsMatchValue( val );
+	}
+	return false;
+}
+
+void MatchClassAd::
+SetCompiledEval( bool left, bool right )
+{
+	compile_left = left;
+	compile_right = right;
+}
+
+void MatchClassAd::
+FlushCompiledExprs( )
+{
+	std::map<const ExprTree*, CompiledExpr*>::iterator it;
+	for( it = compiled_exprs.begin(); it != compiled_exprs.end(); ++it ) {
+		delete it->second;
+	}
+	compiled_exprs.clear();
+}
+
+bool MatchClassAd::
+EvalRequirements( ClassAd *ad, bool compile, ExprTree *match_expr, Value &val )
+{
+	if( !match_expr ) {
+		return false;
+	}
+
+	ExprTree *requirements = NULL;
+	if( compile && ad ) {
+		requirements = ad->Lookup( ATTR_REQUIREMENTS );
+	}
+	if( !requirements ) {
+			// inherited from a parent scope, or not there at all
+		return EvaluateExpr( match_expr, val );
+	}
+
+	CompiledExpr *prog = NULL;
+	std::map<const ExprTree*, CompiledExpr*>::iterator it =
+		compiled_exprs.find( requirements );
+	if( it != compiled_exprs.end() ) {
+		prog = it->second;
+	} else {
+		if( compiled_exprs.size() >= MAX_COMPILED_EXPRS ) {
+			FlushCompiledExprs( );
 		}
-		long long int_result = 0;
-		if( val.IsIntegerValue( int_result ) ) {
-			return int_result != 0;
+		prog = new CompiledExpr( );
+		if( !prog->Compile( requirements ) ) {
+			delete prog;
+			prog = NULL;
 		}
+		compiled_exprs[requirements] = prog;
 	}
-	return false;
+	if( !prog ) {
+		return EvaluateExpr( match_expr, val );
+	}
+
+		// Set up the state the same way evaluating LEFT.requirements or
+		// RIGHT.requirements in this ad would: the requirements are
+		// evaluated in the scope of the candidate ad, one level down.
+	EvalState state;
+	state.SetScopes( this );
+	state.curAd = ad;
+	state.depth_remaining--;
+	return prog->Evaluate( state, val );
 }
 
 bool MatchClassAd::
 symmetricMatch()
 {
-	return EvalMatchExpr( symmetric_match );
+	if( !compile_left && !compile_right ) {
+		return EvalMatchExpr( symmetric_match );
+	}
+
+		// Same as symmetricMatch = RIGHT.requirements && LEFT.requirements
+	Value rval, lval, val;
+	bool b;
+	if( !EvalRequirements( rad, compile_right, left_matches_right, rval ) ) {
+		return false;
+	}
+	if( rval.IsBooleanValueEquiv( b ) && !b ) {
+		return false;
+	}
+	if( !EvalRequirements( lad, compile_left, right_matches_left, lval ) ) {
+		return false;
+	}
+	Operation::Operate( Operation::LOGICAL_AND_OP, rval, lval, val );
+	return IsMatchValue( val );
 }
 
 bool MatchClassAd::
 rightMatchesLeft()
 {
-	return EvalMatchExpr( right_matches_left );
+	if( !compile_left ) {
+		return EvalMatchExpr( right_matches_left );
+	}
+	Value val;
+	return EvalRequirements( lad, true, right_matches_left, val ) &&
+		IsMatchValue( val );
 }
 
 bool MatchClassAd::
 leftMatchesRight()
 {
-	return EvalMatchExpr( left_matches_right );
+	if( !compile_right ) {
+		return EvalMatchExpr( left_matches_right );
+	}
+	Value val;
+	return EvalRequirements( rad, true, left_matches_right, val ) &&
+		IsMatchValue( val );
 }
 
 } // classad
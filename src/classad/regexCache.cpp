@@ -0,0 +1,306 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#include "classad/common.h"
+#include "classad/regexCache.h"
+#include "classadMutex.h"
+#include <map>
+#include <list>
+
+#if defined(WIN32) && !defined(USE_PCRE) && !defined(USE_POSIX_REGEX)
+  #define USE_PCRE
+  #define HAVE_PCRE_H
+#endif
+
+#if defined USE_PCRE
+  #ifdef HAVE_PCRE_H
+    #include <pcre.h>
+  #elif defined HAVE_PCRE_PCRE_H
+    #include <pcre/pcre.h>
+  #endif
+#endif
+
+using namespace std;
+
+namespace classad {
+
+#if defined USE_PCRE
+
+	// A compiled pattern.  refs counts the handles using it, plus one
+	// while it is in the cache; it is freed when that drops to zero.
+struct RegexCacheEntry {
+	pcre *re;
+	pcre_extra *extra;
+	int capture_count;
+	int refs;
+	list<RegexCacheEntry*>::iterator lru;
+	map<pair<int,string>, RegexCacheEntry*>::iterator index;
+};
+
+typedef map<pair<int,string>, RegexCacheEntry*> RegexIndex;
+typedef list<RegexCacheEntry*> RegexLRU;
+
+	// Only touched with regex_mutex held.  Pointers, so the cache works
+	// during static initialization.
+static RegexIndex *regex_index = NULL;
+static RegexLRU *regex_lru = NULL;		// most recently used first
+static size_t regex_cache_max = 1000;
+static ClassAdMutex regex_mutex = CLASSAD_MUTEX_INITIALIZER;
+
+static void
+free_entry( RegexCacheEntry *entry )
+{
+	if( entry->extra ) {
+#ifdef PCRE_CONFIG_JIT
+		pcre_free_study( entry->extra );
+#else
+		pcre_free( entry->extra );
+#endif
+	}
+	pcre_free( entry->re );
+	delete entry;
+}
+
+	// Drop one reference; the caller holds the lock.
+static void
+unref_entry( RegexCacheEntry *entry )
+{
+	if( --entry->refs == 0 ) {
+		free_entry( entry );
+	}
+}
+
+	// Remove the least recently used entries until there are at most
+	// max of them; the caller holds the lock.
+static void
+trim_cache( size_t max )
+{
+	while( regex_lru && regex_lru->size() > max ) {
+		RegexCacheEntry *entry = regex_lru->back();
+		regex_lru->pop_back();
+		regex_index->erase( entry->index );
+		unref_entry( entry );
+	}
+}
+
+static RegexCacheEntry *
+compile_entry( const char *pattern, int options, const char **errptr, int *erroffset )
+{
+	const char *error_message = NULL;
+	int error_offset = 0;
+
+	pcre *re = pcre_compile( pattern, options, &error_message, &error_offset, NULL );
+	if( !re ) {
+		if( errptr ) *errptr = error_message;
+		if( erroffset ) *erroffset = error_offset;
+		return NULL;
+	}
+
+	RegexCacheEntry *entry = new RegexCacheEntry;
+	entry->re = re;
+	entry->refs = 0;
+#ifdef PCRE_STUDY_JIT_COMPILE
+	entry->extra = pcre_study( re, PCRE_STUDY_JIT_COMPILE, &error_message );
+#else
+	entry->extra = pcre_study( re, 0, &error_message );
+#endif
+	entry->capture_count = 0;
+	pcre_fullinfo( re, entry->extra, PCRE_INFO_CAPTURECOUNT, &entry->capture_count );
+	return entry;
+}
+
+CachedRegex::
+CachedRegex( ) : m_entry( NULL )
+{
+}
+
+CachedRegex::
+CachedRegex( const CachedRegex &other ) : m_entry( NULL )
+{
+	*this = other;
+}
+
+CachedRegex &CachedRegex::
+operator=( const CachedRegex &other )
+{
+	if( this != &other ) {
+		Clear( );
+		ClassAdMutexLock lock( regex_mutex );
+		m_entry = other.m_entry;
+		if( m_entry ) {
+			m_entry->refs++;
+		}
+	}
+	return *this;
+}
+
+CachedRegex::
+~CachedRegex( )
+{
+	Clear( );
+}
+
+void CachedRegex::
+Clear( )
+{
+	if( !m_entry ) {
+		return;
+	}
+	{
+		ClassAdMutexLock lock( regex_mutex );
+		unref_entry( m_entry );
+	}
+	m_entry = NULL;
+}
+
+bool CachedRegex::
+Compile( const char *pattern, int options, const char **errptr, int *erroffset )
+{
+	Clear( );
+
+	pair<int,string> key( options, pattern );
+	bool found = false;
+
+	{
+		ClassAdMutexLock lock( regex_mutex );
+		if( !regex_index ) {
+			regex_index = new RegexIndex;
+			regex_lru = new RegexLRU;
+		}
+		RegexIndex::iterator it = regex_index->find( key );
+		if( it != regex_index->end( ) ) {
+			m_entry = it->second;
+			m_entry->refs++;
+			regex_lru->splice( regex_lru->begin( ), *regex_lru, m_entry->lru );
+			found = true;
+		}
+	}
+	if( found ) {
+		return true;
+	}
+
+		// Compile outside the lock.  If another thread compiles the
+		// same pattern meanwhile, the first one into the cache wins.
+	RegexCacheEntry *entry = compile_entry( pattern, options, errptr, erroffset );
+	if( !entry ) {
+		return false;
+	}
+
+	{
+		ClassAdMutexLock lock( regex_mutex );
+		RegexIndex::iterator it = regex_index->find( key );
+		if( it != regex_index->end( ) ) {
+			free_entry( entry );
+			entry = it->second;
+			regex_lru->splice( regex_lru->begin( ), *regex_lru, entry->lru );
+		} else if( regex_cache_max > 0 ) {
+			regex_lru->push_front( entry );
+			entry->lru = regex_lru->begin( );
+			entry->index = regex_index->insert( RegexIndex::value_type( key, entry ) ).first;
+			entry->refs++;	// the cache's reference
+			trim_cache( regex_cache_max );
+		}
+		entry->refs++;
+		m_entry = entry;
+	}
+	return true;
+}
+
+int CachedRegex::
+Exec( const char *subject, int length, int start, int options,
+	  int *ovector, int ovecsize ) const
+{
+	if( !m_entry ) {
+		return PCRE_ERROR_NULL;
+	}
+	int rc = pcre_exec( m_entry->re, m_entry->extra, subject, length, start,
+						options, ovector, ovecsize );
+#ifdef PCRE_ERROR_JIT_STACKLIMIT
+	if( rc == PCRE_ERROR_JIT_STACKLIMIT && m_entry->extra ) {
+			// The JIT runs out of stack on some patterns that the
+			// interpreter, with its usual match limits, can match.
+			// Fall back to the interpreter so results don't change.
+		pcre_extra interp = *m_entry->extra;
+		interp.flags &= ~PCRE_EXTRA_EXECUTABLE_JIT;
+		rc = pcre_exec( m_entry->re, &interp, subject, length, start,
+						options, ovector, ovecsize );
+	}
+#endif
+	return rc;
+}
+
+int CachedRegex::
+CaptureCount( ) const
+{
+	return m_entry ? m_entry->capture_count : 0;
+}
+
+size_t CachedRegex::
+MemUsed( ) const
+{
+	size_t size = 0;
+	if( m_entry ) {
+		pcre_fullinfo( m_entry->re, NULL, PCRE_INFO_SIZE, &size );
+	}
+	return size;
+}
+
+void
+SetRegexCacheSize( size_t max_entries )
+{
+	ClassAdMutexLock lock( regex_mutex );
+	regex_cache_max = max_entries;
+	trim_cache( max_entries );
+}
+
+void
+ClearRegexCache( )
+{
+	ClassAdMutexLock lock( regex_mutex );
+	trim_cache( 0 );
+}
+
+#else /* !USE_PCRE */
+
+struct RegexCacheEntry { };
+
+CachedRegex::CachedRegex( ) : m_entry( NULL ) { }
+CachedRegex::CachedRegex( const CachedRegex & ) : m_entry( NULL ) { }
+CachedRegex &CachedRegex::operator=( const CachedRegex & ) { return *this; }
+CachedRegex::~CachedRegex( ) { }
+void CachedRegex::Clear( ) { }
+
+bool CachedRegex::
+Compile( const char *, int, const char **errptr, int *erroffset )
+{
+	if( errptr ) *errptr = "regular expressions are not supported";
+	if( erroffset ) *erroffset = 0;
+	return false;
+}
+
+int CachedRegex::Exec( const char *, int, int, int, int *, int ) const { return -1; }
+int CachedRegex::CaptureCount( ) const { return 0; }
+size_t CachedRegex::MemUsed( ) const { return 0; }
+void SetRegexCacheSize( size_t ) { }
+void ClearRegexCache( ) { }
+
+#endif /* USE_PCRE */
+
+} // classad
@@ -119,6 +119,9 @@ int CollectorDaemon::max_pending_query_workers = 50;
 int CollectorDaemon::max_query_worktime = 0;
 int CollectorDaemon::active_query_workers = 0;
 int CollectorDaemon::pending_query_workers = 0;
+bool CollectorDaemon::stream_queries = false;
+bool CollectorDaemon::threaded_queries = false;
+int CollectorDaemon::query_stream_timeslice = 20;
 
 #ifdef TRACK_QUERIES_BY_SUBSYS
 bool CollectorDaemon::want_track_queries_by_subsys = false;
@@ -141,6 +144,37 @@ extern "C"
 void
 computeProjection(ClassAd *full_ad, SimpleList<MyString> *projectionList,StringList &expanded_projection);
 
+// The queries that may be answered on a thread from the pool; see
+// COLLECTOR_THREADED_QUERIES.
+static const int threaded_query_commands[] = {
+	QUERY_STARTD_ADS,
+	QUERY_STARTD_PVT_ADS,
+#ifdef HAVE_EXT_POSTGRESQL
+	QUERY_QUILL_ADS,
+#endif
+	QUERY_SCHEDD_ADS,
+	QUERY_MASTER_ADS,
+	QUERY_CKPT_SRVR_ADS,
+	QUERY_SUBMITTOR_ADS,
+	QUERY_LICENSE_ADS,
+	QUERY_STORAGE_ADS,
+	QUERY_ACCOUNTING_ADS,
+	QUERY_NEGOTIATOR_ADS,
+	QUERY_HAD_ADS,
+	QUERY_XFER_SERVICE_ADS,
+	QUERY_LEASE_MANAGER_ADS,
+	QUERY_ANY_ADS,
+	QUERY_GRID_ADS,
+	QUERY_GENERIC_ADS,
+};
+
+static void set_threaded_query_commands(bool thread_safe)
+{
+	for (size_t i = 0; i < COUNTOF(threaded_query_commands); i++) {
+		daemonCore->Set_Command_Thread_Safe(threaded_query_commands[i], thread_safe);
+	}
+}
+
 void CollectorDaemon::Init()
 {
 	dprintf(D_ALWAYS, "In CollectorDaemon::Init()\n");
@@ -212,6 +246,7 @@ void CollectorDaemon::Init()
 		(CommandHandler)receive_query_cedar,"receive_query_cedar",NULL,READ);
 	daemonCore->Register_CommandWithPayload(QUERY_GENERIC_ADS,"QUERY_GENERIC_ADS",
 		(CommandHandler)receive_query_cedar,"receive_query_cedar",NULL,READ);
+	set_threaded_query_commands(threaded_queries);
 	
 	// install command handlers for invalidations
 	daemonCore->Register_CommandWithPayload(INVALIDATE_STARTD_ADS,"INVALIDATE_STARTD_ADS",
@@ -274,6 +309,10 @@ void CollectorDaemon::Init()
 		(CommandHandler)receive_update,"receive_update",NULL,ADVERTISE_STARTD_PERM);
 	daemonCore->Register_CommandWithPayload(MERGE_STARTD_AD,"MERGE_STARTD_AD",
 		(CommandHandler)receive_update,"receive_update",NULL,NEGOTIATOR);
+	daemonCore->Register_CommandWithPayload(UPDATE_STARTD_AD_DELTA,"UPDATE_STARTD_AD_DELTA",
+		(CommandHandler)receive_update,"receive_update",NULL,ADVERTISE_STARTD_PERM);
+	daemonCore->Register_CommandWithPayload(UPDATE_STARTD_ADS,"UPDATE_STARTD_ADS",
+		(CommandHandler)receive_startd_ads,"receive_startd_ads",NULL,ADVERTISE_STARTD_PERM);
 	daemonCore->Register_CommandWithPayload(UPDATE_SCHEDD_AD,"UPDATE_SCHEDD_AD",
 		(CommandHandler)receive_update,"receive_update",NULL,ADVERTISE_SCHEDD_PERM);
 	daemonCore->Register_CommandWithPayload(UPDATE_SUBMITTOR_AD,"UPDATE_SUBMITTOR_AD",
@@ -367,6 +406,52 @@ public:
 };
 
 
+// A query answered in-process from a pinned snapshot of the ad table.
+// Matching ads are sent as they are found, a time slice at a time, and
+// the stream waits for the socket to drain whenever the client falls
+// behind, so other commands are handled in between.  Streams answer the
+// queries that stay on the main thread: all of them when there is no
+// thread pool or COLLECTOR_THREADED_QUERIES is off, and otherwise those
+// that never go to the pool, such as queries for the collector's own ad.
+// The rest go to receive_query_shared() on a pool thread instead, which
+// pins the ads the same way.
+class CollectorQueryStream : public Service {
+public:
+	CollectorQueryStream(CollectorDaemon::pending_query_entry_t *query_entry);
+	~CollectorQueryStream();
+
+	int start();
+	int resume(Stream *);
+
+private:
+	int sendSome();
+	int finish(bool success);
+
+	ReliSock *m_sock;
+	ClassAd *m_query;
+	AdTypes m_whichAds;
+	bool m_is_locate;
+	std::string m_subsys;
+
+	ExprTree *m_filter;
+	std::string m_adType;
+	int m_resultLimit;
+	classad::References m_proj;
+	std::string m_projection;
+	bool m_evaluate_projection;
+
+	unsigned int m_pin;
+	std::vector<ClassAd *> m_ads;
+	size_t m_next;
+	int m_numAds;
+	int m_failed;
+	bool m_sent_end;
+	bool m_unfinished_eom;
+	bool m_registered;
+	UtcTime m_begin;
+	double m_query_time;
+};
+
 int CollectorDaemon::receive_query_cedar(Service* /*s*/,
 										 int command,
 										 Stream* sock)
@@ -380,6 +465,11 @@ int CollectorDaemon::receive_query_cedar(Service* /*s*/,
 	ClassAd *cad = new ClassAd();
 	ASSERT(cad);
 
+	if ( threaded_queries && ! CondorThreads::holds_state_exclusive() ) {
+		delete cad;
+		return receive_query_shared(command, sock);
+	}
+
 	_condor_variable_auto_accum_runtime<collector_runtime_probe> rt(&HandleQuery_runtime);
 	//double rt_last = rt.begin;
 
@@ -572,6 +662,202 @@ END:
 }
 
 
+// A copy of an ad matched by a threaded query, holding just the
+// attributes that will be sent, that can be sent without the daemon
+// state lock.
+static ClassAd *
+copy_query_result(ClassAd *ad, const classad::References &proj)
+{
+	ClassAd *copy;
+	if (proj.empty()) {
+		copy = new ClassAd(*ad);
+		copy->ChainCollapse();
+		return copy;
+	}
+	copy = new ClassAd();
+	for (classad::References::const_iterator it = proj.begin(); it != proj.end(); ++it) {
+		ExprTree *tree = ad->Lookup(*it);
+		if (tree) {
+			tree = tree->Copy();
+			copy->Insert(*it, tree);
+		}
+	}
+	return copy;
+}
+
+// How many matching ads a threaded query copies before it lets go of
+// the daemon state lock to send them.
+static const size_t QUERY_SEND_BATCH = 256;
+
+// Answer a query on a thread from the pool, in parallel with other
+// queries and without the big lock; see Set_Command_Thread_Safe() for
+// what is safe to touch here.  The ad tables can't change while we hold
+// the daemon state lock, but walking them, pinning them, rewriting the
+// query filter and the runtime statistics are shared with the other
+// queries, so those are done under lock_state_readers().  The state lock
+// is let go whenever we talk to the client, so a slow client can't hold
+// up the handlers that update the tables; the ads are pinned meanwhile,
+// and what we send are copies taken while we held it.
+int CollectorDaemon::receive_query_shared(int command, Stream* sock)
+{
+	ClassAd query;
+	_condor_runtime rt;
+
+	sock->decode();
+	sock->timeout(1);
+
+	CondorThreads::unlock_state_shared();
+	bool got_query = getClassAdEx(sock, query, GET_CLASSAD_NO_CACHE) && sock->end_of_message();
+	CondorThreads::lock_state_shared();
+	if ( ! got_query) {
+		dprintf(D_ALWAYS,"Failed to receive query on TCP: aborting\n");
+		return FALSE;
+	}
+
+	AdTypes whichAds = receive_query_public( command );
+	bool is_locate = query.Lookup(ATTR_LOCATION_QUERY) != NULL;
+
+	if ( max_query_worktime > 0 ) {
+		time_t new_deadline = time(NULL) + max_query_worktime;
+		time_t sock_deadline = sock->get_deadline();
+		if ( sock_deadline > 0 ) {
+			new_deadline = MIN(new_deadline,sock_deadline);
+		}
+		sock->set_deadline(new_deadline);
+	}
+
+	ExprTree *filter = NULL;
+	std::string adType;
+	int resultLimit = INT_MAX;
+	std::string requirements;
+	std::vector<ClassAd *> ads;
+
+	CondorThreads::lock_state_readers();
+	unsigned int pin = collector.pinAds();
+	if (whichAds != (AdTypes) -1) {
+		filter = prepare_query_filter(whichAds, &query, adType, resultLimit);
+	}
+	if (filter) {
+		ExprTreeToString(filter, requirements);
+		if ( ! collector.indexedAds(whichAds, filter, ads)) {
+			collector.snapshotAds(whichAds, ads);
+		}
+	}
+	CondorThreads::unlock_state_readers();
+
+	classad::References proj;
+	std::string projection;
+	bool evaluate_projection = get_query_projection(&query, proj, projection);
+
+	sock->timeout(QueryTimeout);
+	sock->encode();
+
+	int numAds = 0;
+	int failed = 0;
+	int return_status = TRUE;
+	double send_time = 0;
+		// the copies hold only the projected attributes already
+	classad::References no_proj;
+	std::string no_projection;
+	std::vector<ClassAd *> batch;
+	size_t i = 0;
+	bool done = false;
+	while (return_status && ! done) {
+		for ( ; i < ads.size() && numAds < resultLimit && batch.size() < QUERY_SEND_BATCH; i++) {
+			ClassAd *cad = ads[i];
+			if ( ! query_ad_type_matches(cad, adType)) {
+				continue;
+			}
+
+			classad::Value result;
+			bool val;
+			if ( ! EvalExprTree(filter, cad, NULL, result) ||
+				 ! result.IsBooleanValueEquiv(val) || ! val)
+			{
+				failed++;
+				continue;
+			}
+
+			numAds++;
+			if (evaluate_projection) {
+				proj.clear();
+				projection.clear();
+				if (query.EvalString(ATTR_PROJECTION, cad, projection) && ! projection.empty()) {
+					StringTokenIterator list(projection);
+					const std::string * attr;
+					while ((attr = list.next_string())) { proj.insert(*attr); }
+				}
+			}
+			batch.push_back(copy_query_result(cad, proj));
+		}
+		done = i >= ads.size() || numAds >= resultLimit;
+
+		_condor_runtime send_rt;
+		CondorThreads::unlock_state_shared();
+		for (size_t b = 0; b < batch.size() && return_status; b++) {
+			if ( ! send_query_result(sock, &query, whichAds, batch[b], no_proj, no_projection,
+									 false, 0))
+			{
+				dprintf(D_ALWAYS, "Error sending query result to client -- aborting\n");
+				return_status = FALSE;
+			}
+			else if (sock->deadline_expired()) {
+				dprintf(D_ALWAYS,
+					"QueryWorker: max_worktime expired while sending query result to client -- aborting\n");
+				return_status = FALSE;
+			}
+		}
+		if (return_status && done) {
+			// end of query response ...
+			int more = 0;
+			if ( ! sock->code(more)) {
+				dprintf(D_ALWAYS, "Error sending EndOfResponse (0) to client\n");
+			}
+			if ( ! sock->end_of_message()) {
+				dprintf(D_ALWAYS, "Error flushing CEDAR socket\n");
+			}
+		}
+		CondorThreads::lock_state_shared();
+		send_time += send_rt.elapsed_runtime();
+
+		for (size_t b = 0; b < batch.size(); b++) {
+			delete batch[b];
+		}
+		batch.clear();
+	}
+
+	CondorThreads::lock_state_readers();
+	collector.unpinAds(pin);
+	CondorThreads::unlock_state_readers();
+
+	if (return_status) {
+
+		dprintf (D_ALWAYS,
+			 "Query info: matched=%d; skipped=%d; query_time=%f; send_time=%f; type=%s; requirements={%s}; locate=%d; limit=%d; from=%s; peer=%s; projection={%s}; threaded=1\n",
+			 numAds,
+			 failed,
+			 rt.elapsed_runtime() - send_time,
+			 send_time,
+			 AdTypeToString(whichAds),
+			 requirements.c_str(),
+			 is_locate,
+			 (resultLimit == INT_MAX) ? 0 : resultLimit,
+			 "",
+			 sock->peer_description(),
+			 projection.c_str());
+	}
+
+	CondorThreads::lock_state_readers();
+	if (is_locate) {
+		HandleLocate_runtime += rt.elapsed_runtime();
+	} else {
+		HandleQuery_runtime += rt.elapsed_runtime();
+	}
+	CondorThreads::unlock_state_readers();
+
+	return return_status;
+}
+
 // Return 1 if forked a worker, 0 if not, and -1 upon an error.
 int CollectorDaemon::QueryReaper(Service *, int pid, int /* exit_status */ )
 {
@@ -655,6 +941,23 @@ int CollectorDaemon::QueryReaper(Service *, int pid, int /* exit_status */ )
 		}
 	}  // end of while queue_entry == NULL
 
+	// If configured to, answer the query in-process from a snapshot of the
+	// ads rather than forking.  The stream counts as an active worker until
+	// it finishes, so the queue limits above still apply.  Queries for the
+	// pool threads never get here; see receive_query_shared().
+	if ( stream_queries ) {
+		CollectorQueryStream *stream = new CollectorQueryStream(query_entry);
+		free(query_entry);
+		active_query_workers++;
+		collectorStats.global.ActiveQueryWorkers = active_query_workers;
+		dprintf(D_FULLDEBUG,
+				"QueryWorker: streaming %squery in-process ( max %d active %d pending %d )\n",
+				high_prio_query ? "high priority " : "",
+				max_query_workers, active_query_workers, pending_query_workers);
+		stream->start();
+		return 1;
+	}
+
 	// If we have made it here, we are allowed to fork another worker
 	// to handle the query represented by query_entry. Fork one!
 	// First stash a copy of query_entry->sock and query_entry->cad so 
@@ -734,58 +1037,12 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 	string projection = "";
 		// turn projection string into a set of attributes
 	classad::References proj;
-	bool evaluate_projection = false;
-	if (cad->LookupString(ATTR_PROJECTION, projection) && ! projection.empty()) {
-		StringTokenIterator list(projection);
-		const std::string * attr;
-		while ((attr = list.next_string())) { proj.insert(*attr); }
-	} else if (cad->Lookup(ATTR_PROJECTION)) {
-		// if projection is not a simple string, then assume that evaluating it as a string in the context of the ad will work better
-		// (the negotiator sends this sort of projection)
-		evaluate_projection = true;
-	}
+	bool evaluate_projection = get_query_projection(cad, proj, projection);
 
 	while ( (curr_ad=results.Next()) )
 	{
-		// if querying collector ads, and the collectors own ad appears in this list.
-		// then we want to shove in current statistics. we do this by chaining a
-		// temporary stats ad into the ad to be returned, and publishing updated
-		// statistics into the stats ad.  we do this because if the verbosity level
-		// is increased we do NOT want to put the high-verbosity attributes into
-		// our persistent collector ad.
-		ClassAd * stats_ad = NULL;
-		if ((whichAds == COLLECTOR_AD) && collector.isSelfAd(curr_ad)) {
-			dprintf(D_ALWAYS,"Query includes collector's self ad\n");
-			// update stats in the collector ad before we return it.
-			MyString stats_config;
-			cad->LookupString("STATISTICS_TO_PUBLISH",stats_config);
-			if (stats_config != "stored") {
-				dprintf(D_ALWAYS,"Updating collector stats using a chained ad and config=%s\n", stats_config.Value());
-				stats_ad = new ClassAd();
-				daemonCore->dc_stats.Publish(*stats_ad, stats_config.Value());
-				daemonCore->monitor_data.ExportData(stats_ad, true);
-				collectorStats.publishGlobal(stats_ad, stats_config.Value());
-				stats_ad->ChainToAd(curr_ad);
-				curr_ad = stats_ad; // send the stats ad instead of the self ad.
-			}
-		}
-
-		if (evaluate_projection) {
-			proj.clear();
-			projection.clear();
-			if (cad->EvalString(ATTR_PROJECTION, curr_ad, projection) && ! projection.empty()) {
-				StringTokenIterator list(projection);
-				const std::string * attr;
-				while ((attr = list.next_string())) { proj.insert(*attr); }
-			}
-		}
-
-		bool send_failed = (!sock->code(more) || !putClassAd(sock, *curr_ad, 0, proj.empty() ? NULL : &proj));
-        
-		if (stats_ad) {
-			stats_ad->Unchain();
-			delete stats_ad;
-		}
+		bool send_failed = !send_query_result(sock, cad, whichAds, curr_ad,
+								proj, projection, evaluate_projection, 0);
 
 		if (send_failed)
         {
@@ -840,6 +1097,274 @@ END:
 	return return_status;
 }
 
+// Turn the projection of a query into a set of attributes.  Returns true
+// if the projection is an expression that must be evaluated against each
+// ad instead.
+bool CollectorDaemon::get_query_projection(ClassAd *query, classad::References &proj, std::string &projection)
+{
+	if (query->LookupString(ATTR_PROJECTION, projection) && ! projection.empty()) {
+		StringTokenIterator list(projection);
+		const std::string * attr;
+		while ((attr = list.next_string())) { proj.insert(*attr); }
+	} else if (query->Lookup(ATTR_PROJECTION)) {
+		// if projection is not a simple string, then assume that evaluating it as a string in the context of the ad will work better
+		// (the negotiator sends this sort of projection)
+		return true;
+	}
+	return false;
+}
+
+// Send one matching ad in response to a query.  Returns the result of
+// putClassAd(), so 2 means a non-blocking send was backlogged.
+int CollectorDaemon::send_query_result(Stream *sock, ClassAd *query, AdTypes whichAds, ClassAd *curr_ad,
+									   classad::References &proj, std::string &projection,
+									   bool evaluate_projection, int put_options)
+{
+	int more = 1;
+
+	// if querying collector ads, and the collectors own ad appears in this list.
+	// then we want to shove in current statistics. we do this by chaining a
+	// temporary stats ad into the ad to be returned, and publishing updated
+	// statistics into the stats ad.  we do this because if the verbosity level
+	// is increased we do NOT want to put the high-verbosity attributes into
+	// our persistent collector ad.
+	ClassAd * stats_ad = NULL;
+	if ((whichAds == COLLECTOR_AD) && collector.isSelfAd(curr_ad)) {
+		dprintf(D_ALWAYS,"Query includes collector's self ad\n");
+		// update stats in the collector ad before we return it.
+		MyString stats_config;
+		query->LookupString("STATISTICS_TO_PUBLISH",stats_config);
+		if (stats_config != "stored") {
+			dprintf(D_ALWAYS,"Updating collector stats using a chained ad and config=%s\n", stats_config.Value());
+			stats_ad = new ClassAd();
+			daemonCore->dc_stats.Publish(*stats_ad, stats_config.Value());
+			daemonCore->monitor_data.ExportData(stats_ad, true);
+			collectorStats.publishGlobal(stats_ad, stats_config.Value());
+			stats_ad->ChainToAd(curr_ad);
+			curr_ad = stats_ad; // send the stats ad instead of the self ad.
+		}
+	}
+
+	if (evaluate_projection) {
+		proj.clear();
+		projection.clear();
+		if (query->EvalString(ATTR_PROJECTION, curr_ad, projection) && ! projection.empty()) {
+			StringTokenIterator list(projection);
+			const std::string * attr;
+			while ((attr = list.next_string())) { proj.insert(*attr); }
+		}
+	}
+
+	int retval = 0;
+	if (sock->code(more)) {
+		retval = putClassAd(sock, *curr_ad, put_options, proj.empty() ? NULL : &proj);
+	}
+
+	if (stats_ad) {
+		stats_ad->Unchain();
+		delete stats_ad;
+	}
+
+	return retval;
+}
+
+CollectorQueryStream::CollectorQueryStream(CollectorDaemon::pending_query_entry_t *query_entry)
+	: m_sock(static_cast<ReliSock *>(query_entry->sock)),
+	  m_query(query_entry->cad),
+	  m_whichAds(query_entry->whichAds),
+	  m_is_locate(query_entry->is_locate),
+	  m_subsys(query_entry->subsys),
+	  m_filter(NULL),
+	  m_resultLimit(INT_MAX),
+	  m_evaluate_projection(false),
+	  m_pin(0),
+	  m_next(0),
+	  m_numAds(0),
+	  m_failed(0),
+	  m_sent_end(false),
+	  m_unfinished_eom(false),
+	  m_registered(false),
+	  m_begin(true),
+	  m_query_time(0)
+{
+	m_pin = CollectorDaemon::collector.pinAds();
+}
+
+CollectorQueryStream::~CollectorQueryStream()
+{
+	CollectorDaemon::collector.unpinAds(m_pin);
+	delete m_query;
+}
+
+// Returns what a command handler would; the stream deletes itself unless
+// it has to wait for the socket.
+int CollectorQueryStream::start()
+{
+	if (m_whichAds != (AdTypes) -1) {
+		m_filter = CollectorDaemon::prepare_query_filter(m_whichAds, m_query, m_adType, m_resultLimit);
+	}
+	if (m_filter && ! CollectorDaemon::collector.indexedAds(m_whichAds, m_filter, m_ads)) {
+		CollectorDaemon::collector.snapshotAds(m_whichAds, m_ads);
+	}
+	m_evaluate_projection = CollectorDaemon::get_query_projection(m_query, m_proj, m_projection);
+
+	m_sock->timeout(CollectorDaemon::QueryTimeout);
+	m_sock->encode();
+
+	int retval = sendSome();
+	if (retval == 2) {
+		if (daemonCore->Register_Socket(m_sock, "Collector Query Response",
+				(SocketHandlercpp)&CollectorQueryStream::resume,
+				"CollectorQueryStream::resume", this, ALLOW, HANDLE_WRITE) < 0)
+		{
+			dprintf(D_ALWAYS, "QueryWorker: failed to register socket for query response\n");
+			return finish(false);
+		}
+		m_registered = true;
+		return KEEP_STREAM;
+	}
+	return finish(retval != 0);
+}
+
+int CollectorQueryStream::resume(Stream *)
+{
+	int retval = sendSome();
+	if (retval == 2) {
+		return KEEP_STREAM;
+	}
+	return finish(retval != 0);
+}
+
+// Returns 1 when the response is complete, 2 if there is more to send,
+// and 0 on failure.
+int CollectorQueryStream::sendSome()
+{
+	BlockingModeGuard guard(m_sock, true);
+	UtcTime slice_begin(true);
+
+	if (m_unfinished_eom) {
+		int retval = m_sock->finish_end_of_message();
+		if (m_sock->clear_backlog_flag()) {
+			return 2;
+		}
+		m_unfinished_eom = false;
+		return retval ? 1 : 0;
+	}
+
+	if (m_sock->deadline_expired()) {
+		dprintf(D_ALWAYS,
+			"QueryWorker: max_worktime expired while sending query result to client -- aborting\n");
+		return 0;
+	}
+
+	int scanned = 0;
+	while (m_next < m_ads.size() && m_numAds < m_resultLimit) {
+		ClassAd *cad = m_ads[m_next++];
+
+		if (CollectorDaemon::query_ad_type_matches(cad, m_adType)) {
+			classad::Value result;
+			bool val;
+			if (EvalExprTree(m_filter, cad, NULL, result) &&
+				result.IsBooleanValueEquiv(val) && val)
+			{
+				m_numAds++;
+				int retval = CollectorDaemon::send_query_result(m_sock, m_query, m_whichAds, cad,
+								m_proj, m_projection, m_evaluate_projection,
+								PUT_CLASSAD_NON_BLOCKING);
+				if ( ! retval) {
+					dprintf(D_ALWAYS, "Error sending query result to client -- aborting\n");
+					return 0;
+				}
+				if (retval == 2) {
+					return 2;
+				}
+			} else {
+				m_failed++;
+			}
+		}
+
+			// give the rest of the collector a turn once our time is up
+		if ((++scanned % 64) == 0 &&
+			UtcTime::getTimeDouble() - slice_begin.combined() >= CollectorDaemon::query_stream_timeslice / 1000.0)
+		{
+			return 2;
+		}
+	}
+
+	if ( ! m_sent_end) {
+		m_query_time = UtcTime::getTimeDouble() - m_begin.combined();
+		m_sent_end = true;
+
+		// end of query response ...
+		int more = 0;
+		if ( ! m_sock->code(more)) {
+			dprintf(D_ALWAYS, "Error sending EndOfResponse (0) to client\n");
+			return 0;
+		}
+	}
+
+	int retval = m_sock->end_of_message_nonblocking();
+	if (m_sock->clear_backlog_flag()) {
+		m_unfinished_eom = true;
+		return 2;
+	}
+	if ( ! retval) {
+		dprintf(D_ALWAYS, "Error flushing CEDAR socket\n");
+		return 0;
+	}
+	return 1;
+}
+
+int CollectorQueryStream::finish(bool success)
+{
+	if (success) {
+		dprintf (D_ALWAYS,
+			 "Query info: matched=%d; skipped=%d; query_time=%f; send_time=%f; type=%s; requirements={%s}; locate=%d; limit=%d; from=%s; peer=%s; projection={%s}; streamed=1\n",
+			 m_numAds,
+			 m_failed,
+			 m_query_time,
+			 UtcTime::getTimeDouble() - m_begin.combined() - m_query_time,
+			 AdTypeToString(m_whichAds),
+			 ExprTreeToString(m_filter),
+			 m_is_locate,
+			 (m_resultLimit == INT_MAX) ? 0 : m_resultLimit,
+			 m_subsys.c_str(),
+			 m_sock->peer_description(),
+			 m_projection.c_str());
+	}
+
+		// once registered, DaemonCore owns the socket and deletes it
+		// when we return something other than KEEP_STREAM
+	if ( ! m_registered) {
+		delete m_sock;
+	}
+	m_sock = NULL;
+	delete this;
+
+	CollectorDaemon::query_stream_done();
+	return success ? TRUE : FALSE;
+}
+
+void CollectorDaemon::query_stream_done()
+{
+	if (active_query_workers > 0) {
+		active_query_workers--;
+	}
+	collectorStats.global.ActiveQueryWorkers = active_query_workers;
+
+		// start the next queued query from a timer, since we may be
+		// inside a socket handler for the stream that just finished
+	if (query_queue_high_prio.Length() + query_queue_low_prio.Length() > 0) {
+		daemonCore->Register_Timer(0, (TimerHandler)&CollectorDaemon::dispatch_pending_queries,
+								   "CollectorDaemon::dispatch_pending_queries");
+	}
+}
+
+void CollectorDaemon::dispatch_pending_queries()
+{
+	QueryReaper(NULL, -1, -1);
+}
+
 AdTypes
 CollectorDaemon::receive_query_public( int command )
 {
@@ -1146,13 +1671,31 @@ int CollectorDaemon::receive_update(Service* /*s*/, int command, Stream* sock)
 				command);
 		}
 
+		if (insert == -4 && sock->type() == Stream::reli_sock)
+		{
+			/* a delta update we couldn't apply, and have asked the
+				startd to follow with a full update.  It was read in
+				full, so keep the connection for that update. */
+			return stashSocket( (ReliSock *)sock );
+		}
+
 		return FALSE;
 
 	}
 	CollectorEngine_ru_collect_runtime += rt.tick(rt_last);
 
+		// a delta has been merged into the stored ad, so from here on
+		// treat it like a full update of that ad
+	if (command == UPDATE_STARTD_AD_DELTA) {
+		command = UPDATE_STARTD_AD;
+	}
+
 	/* let the off-line plug-in have at it */
 	offline_plugin_.update ( command, *cad );
+		// it may have changed indexed attributes of the stored ad
+	if ( offline_plugin_.enabled() ) {
+		collector.reindexAd ( cad );
+	}
 
 #if defined(HAVE_DLOPEN)
 	CollectorPluginManager::Update(command, *cad);
@@ -1181,6 +1724,49 @@ int CollectorDaemon::receive_update(Service* /*s*/, int command, Stream* sock)
 	return TRUE;
 }
 
+// Handle a batched update of all the slots of a startd.  Each slot ad
+// is then handled as if it came in its own UPDATE_STARTD_AD.
+int CollectorDaemon::receive_startd_ads(Service* /*s*/, int /*command*/, Stream* sock)
+{
+	std::vector<ClassAd *> ads;
+
+	daemonCore->dc_stats.AddToAnyProbe("UpdatesReceived", 1);
+
+	condor_sockaddr from = ((Sock*)sock)->peer_addr();
+
+	if (collector.collectStartdAds((Sock*)sock, from, ads) < 0) {
+		return FALSE;
+	}
+
+	for (size_t i = 0; i < ads.size(); i++) {
+		ClassAd *cad = ads[i];
+
+		offline_plugin_.update ( UPDATE_STARTD_AD, *cad );
+		if ( offline_plugin_.enabled() ) {
+			collector.reindexAd ( cad );
+		}
+
+#if defined(HAVE_DLOPEN)
+		CollectorPluginManager::Update(UPDATE_STARTD_AD, *cad);
+#endif
+
+		if (viewCollectorTypes) {
+			forward_classad_to_view_collector(UPDATE_STARTD_AD,
+											  ATTR_MY_TYPE,
+											  cad);
+		} else {
+			send_classad_to_sock(UPDATE_STARTD_AD, cad);
+		}
+	}
+
+	if( sock->type() == Stream::reli_sock ) {
+			// stash this socket for future updates...
+		return stashSocket( (ReliSock *)sock );
+	}
+
+	return TRUE;
+}
+
 int CollectorDaemon::receive_update_expect_ack( Service* /*s*/,
 												int command,
 												Stream *stream )
@@ -1288,8 +1874,12 @@ int CollectorDaemon::receive_update_expect_ack( Service* /*s*/,
     }
 
     /* let the off-line plug-in have at it */
-	if(cad)
-    offline_plugin_.update ( command, *cad );
+	if(cad) {
+		offline_plugin_.update ( command, *cad );
+		if ( offline_plugin_.enabled() ) {
+			collector.reindexAd ( cad );
+		}
+	}
 
 #if defined(HAVE_DLOPEN)
     CollectorPluginManager::Update ( command, *cad );
@@ -1342,15 +1932,23 @@ CollectorDaemon::stashSocket( ReliSock* sock )
 	return KEEP_STREAM;
 }
 
-int CollectorDaemon::query_scanFunc (ClassAd *cad)
+bool CollectorDaemon::query_ad_type_matches (ClassAd *cad, const std::string &adType)
 {
-	if ( !__adType__.empty() ) {
+	if ( !adType.empty() ) {
 		std::string type = "";
 		cad->LookupString( ATTR_MY_TYPE, type );
-		if ( strcasecmp( type.c_str(), __adType__.c_str() ) != 0 ) {
-			return 1;
+		if ( strcasecmp( type.c_str(), adType.c_str() ) != 0 ) {
+			return false;
 		}
 	}
+	return true;
+}
+
+int CollectorDaemon::query_scanFunc (ClassAd *cad)
+{
+	if ( ! query_ad_type_matches( cad, __adType__ ) ) {
+		return 1;
+	}
 
 	classad::Value result;
 	bool val;
@@ -1370,38 +1968,39 @@ int CollectorDaemon::query_scanFunc (ClassAd *cad)
 }
 
 
-void CollectorDaemon::process_query_public (AdTypes whichAds,
-											ClassAd *query,
-											List<ClassAd>* results)
+// Set up the filter, ad type and result limit for a query.  Returns
+// the filter expression, which belongs to the query ad, or NULL if the
+// query can't be answered.
+ExprTree *CollectorDaemon::prepare_query_filter (AdTypes whichAds,
+												 ClassAd *query,
+												 std::string &adType,
+												 int &resultLimit)
 {
+	ExprTree *filter;
+
 #if defined(ADD_TARGET_SCOPING)
 	RemoveExplicitTargetRefs( *query );
 #endif
-	// set up for hashtable scan
-	__query__ = query;
-	__numAds__ = 0;
-	__failed__ = 0;
-	__ClassAdResultList__ = results;
 	// An empty adType means don't check the MyType of the ads.
 	// This means either the command indicates we're only checking one
 	// type of ad, or the query's TargetType is "Any" (match all ad types).
-	__adType__ = "";
+	adType = "";
 	if ( whichAds == GENERIC_AD || whichAds == ANY_AD ) {
-		query->LookupString( ATTR_TARGET_TYPE, __adType__ );
-		if ( strcasecmp( __adType__.c_str(), "any" ) == 0 ) {
-			__adType__ = "";
+		query->LookupString( ATTR_TARGET_TYPE, adType );
+		if ( strcasecmp( adType.c_str(), "any" ) == 0 ) {
+			adType = "";
 		}
 	}
 
-	__filter__ = query->LookupExpr( ATTR_REQUIREMENTS );
-	if ( __filter__ == NULL ) {
+	filter = query->LookupExpr( ATTR_REQUIREMENTS );
+	if ( filter == NULL ) {
 		dprintf (D_ALWAYS, "Query missing %s\n", ATTR_REQUIREMENTS );
-		return;
+		return NULL;
 	}
 
-	__resultLimit__ = INT_MAX; // no limit
-	if ( ! query->LookupInteger(ATTR_LIMIT_RESULTS, __resultLimit__) || __resultLimit__ <= 0) {
-		__resultLimit__ = INT_MAX; // no limit
+	resultLimit = INT_MAX; // no limit
+	if ( ! query->LookupInteger(ATTR_LIMIT_RESULTS, resultLimit) || resultLimit <= 0) {
+		resultLimit = INT_MAX; // no limit
 	}
 
 	// See if we should exclude Collector Ads from generic queries.  Still
@@ -1413,13 +2012,13 @@ void CollectorDaemon::process_query_public (AdTypes whichAds,
 		dprintf(D_FULLDEBUG, "Received query with generic type; filtering collector ads\n");
 		MyString modified_filter;
 		modified_filter.formatstr("(%s) && (MyType =!= \"Collector\")",
-			ExprTreeToString(__filter__));
+			ExprTreeToString(filter));
 		query->AssignExpr(ATTR_REQUIREMENTS,modified_filter.Value());
-		__filter__ = query->LookupExpr(ATTR_REQUIREMENTS);
-		if ( __filter__ == NULL ) {
+		filter = query->LookupExpr(ATTR_REQUIREMENTS);
+		if ( filter == NULL ) {
 			dprintf (D_ALWAYS, "Failed to parse modified filter: %s\n", 
 				modified_filter.Value());
-			return;
+			return NULL;
 		}
 		dprintf(D_FULLDEBUG,"Query after modification: *%s*\n",modified_filter.Value());
 	}
@@ -1435,19 +2034,46 @@ void CollectorDaemon::process_query_public (AdTypes whichAds,
 		if (!checks_absent) {
 			MyString modified_filter;
 			modified_filter.formatstr("(%s) && (%s =!= True)",
-				ExprTreeToString(__filter__),ATTR_ABSENT);
+				ExprTreeToString(filter),ATTR_ABSENT);
 			query->AssignExpr(ATTR_REQUIREMENTS,modified_filter.Value());
-			__filter__ = query->LookupExpr(ATTR_REQUIREMENTS);
-			if ( __filter__ == NULL ) {
+			filter = query->LookupExpr(ATTR_REQUIREMENTS);
+			if ( filter == NULL ) {
 				dprintf (D_ALWAYS, "Failed to parse modified filter: %s\n", 
 					modified_filter.Value());
-				return;
+				return NULL;
 			}
 			dprintf(D_FULLDEBUG,"Query after modification: *%s*\n",modified_filter.Value());
 		}
 	}
 
-	if (!collector.walkHashTable (whichAds, query_scanFunc))
+	return filter;
+}
+
+void CollectorDaemon::process_query_public (AdTypes whichAds,
+											ClassAd *query,
+											List<ClassAd>* results)
+{
+	// set up for hashtable scan
+	__query__ = query;
+	__numAds__ = 0;
+	__failed__ = 0;
+	__ClassAdResultList__ = results;
+	__filter__ = prepare_query_filter( whichAds, query, __adType__, __resultLimit__ );
+	if ( __filter__ == NULL ) {
+		return;
+	}
+
+	// Only look at the ads an index says could match, if it can.
+	std::vector<ClassAd *> candidates;
+	if (collector.indexedAds(whichAds, __filter__, candidates)) {
+		dprintf(D_FULLDEBUG, "Query index narrowed the scan to %d ads\n", (int)candidates.size());
+		for (size_t i = 0; i < candidates.size(); i++) {
+			if ( ! query_scanFunc(candidates[i])) {
+				break;
+			}
+		}
+	}
+	else if (!collector.walkHashTable (whichAds, query_scanFunc))
 	{
 		dprintf (D_ALWAYS, "Error sending query response\n");
 	}
@@ -1540,11 +2166,13 @@ void CollectorDaemon::process_invalidation (AdTypes whichAds, ClassAd &query, St
         if (expireInvalidatedAds)
         {
             collector.walkHashTable (whichAds, expiration_scanFunc);
+            collector.reindexAttribute (ATTR_LAST_HEARD_FROM);
             collector.invokeHousekeeper (whichAds);
         } else if (param_boolean("HOUSEKEEPING_ON_INVALIDATE", true)) 
 		{
 			// first set all the "LastHeardFrom" attributes to low values ...
 			collector.walkHashTable (whichAds, invalidation_scanFunc);
+			collector.reindexAttribute (ATTR_LAST_HEARD_FROM);
 
 			// ... then invoke the housekeeper
 			collector.invokeHousekeeper (whichAds);
@@ -1840,6 +2468,17 @@ void CollectorDaemon::Config()
 	}
 
 	collector.m_allowOnlyOneNegotiator = param_boolean("COLLECTOR_ALLOW_ONLY_ONE_NEGOTIATOR", false);
+	collector.setShareStartdAttributes(param_boolean("COLLECTOR_SHARE_STARTD_ATTRIBUTES", false));
+
+	std::vector<std::string> index_attrs;
+	tmp = param("COLLECTOR_QUERY_INDEX_ATTRIBUTES");
+	if (tmp) {
+		StringTokenIterator list(tmp);
+		const std::string *attr;
+		while ((attr = list.next_string())) { index_attrs.push_back(*attr); }
+		free(tmp);
+	}
+	collector.setQueryIndexAttributes(index_attrs);
 	// This it temporary (for 8.7.0) just in case we need to turn off the new getClassAdEx options
 	collector.m_get_ad_options = param_integer("COLLECTOR_GETAD_OPTIONS", GET_CLASSAD_FAST | GET_CLASSAD_LAZY_PARSE);
 	collector.m_get_ad_options &= (GET_CLASSAD_LAZY_PARSE | GET_CLASSAD_FAST | GET_CLASSAD_NO_CACHE);
@@ -1949,6 +2588,14 @@ void CollectorDaemon::Config()
 	max_pending_query_workers = param_integer ("COLLECTOR_QUERY_WORKERS_PENDING", 50, 0);
 	max_query_worktime = param_integer("COLLECTOR_QUERY_MAX_WORKTIME",0,0);
 	reserved_for_highprio_query_workers = param_integer("COLLECTOR_QUERY_WORKERS_RESERVE_FOR_HIGH_PRIO",1,0);
+	stream_queries = param_boolean("COLLECTOR_STREAM_QUERIES", false);
+
+		// Queries for the collector's own ad publish fresh statistics
+		// into it, so those are never answered on a pool thread.
+	threaded_queries = CondorThreads::pool_size() > 0 &&
+		param_boolean("COLLECTOR_THREADED_QUERIES", false);
+	set_threaded_query_commands(threaded_queries);
+	query_stream_timeslice = param_integer("COLLECTOR_STREAM_QUERY_TIMESLICE", 20, 1);
 
 	// max_query_workers had better be at least one greater than reserved_for_highprio_query_workers,
 	// or condor_status queries will never be answered.
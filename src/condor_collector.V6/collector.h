@@ -85,7 +85,10 @@ class CollectorUniverseStats {
  * also consolidate the stats under that umbrella b/c the data is there. 
  *
  *----------------------------------------------------------------*/
+class CollectorQueryStream;
+
 class CollectorDaemon {
+	friend class CollectorQueryStream;
 
 public:
 
@@ -99,12 +102,20 @@ public:
 	// command handlers
 	static int receive_query_cedar(Service*, int, Stream*);
 	static int receive_query_cedar_worker_thread(void *, Stream*);
+	static int receive_query_shared(int, Stream*);
 	static AdTypes receive_query_public( int );
 	static int receive_invalidation(Service*, int, Stream*);
 	static int receive_update(Service*, int, Stream*);
+	static int receive_startd_ads(Service*, int, Stream*);
     static int receive_update_expect_ack(Service*, int, Stream*);
 
 	static void process_query_public(AdTypes, ClassAd*, List<ClassAd>*);
+	static ExprTree *prepare_query_filter(AdTypes, ClassAd*, std::string &adType, int &resultLimit);
+	static bool query_ad_type_matches(ClassAd*, const std::string &adType);
+	static bool get_query_projection(ClassAd*, classad::References &proj, std::string &projection);
+	static int send_query_result(Stream*, ClassAd *query, AdTypes, ClassAd*,
+								 classad::References &proj, std::string &projection,
+								 bool evaluate_projection, int put_options);
 	static ClassAd * process_global_query( const char *constraint, void *arg );
 	static int select_by_match( ClassAd *cad );
 	static void process_invalidation(AdTypes, ClassAd&, Stream*);
@@ -165,6 +176,11 @@ public:
 	static int reserved_for_highprio_query_workers; // from config file
 	static int active_query_workers;
 	static int pending_query_workers;
+	static bool stream_queries;  // from config file
+	static int query_stream_timeslice;  // from config file, in milliseconds
+	static bool threaded_queries;  // from config file, if there is a thread pool
+	static void query_stream_done();
+	static void dispatch_pending_queries();
 
 #ifdef TRACK_QUERIES_BY_SUBSYS
 	static bool want_track_queries_by_subsys;
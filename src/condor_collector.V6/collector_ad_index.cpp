@@ -0,0 +1,380 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "collector_ad_index.h"
+
+using classad::Operation;
+
+bool
+CollectorAdIndex::Key::operator<(const Key &rhs) const
+{
+	if (is_string != rhs.is_string) {
+		return !is_string;		// numbers sort before strings
+	}
+	if (is_string) {
+		return str < rhs.str;
+	}
+	return number < rhs.number;
+}
+
+CollectorAdIndex::CollectorAdIndex()
+{
+}
+
+bool
+CollectorAdIndex::setAttributes(const std::vector<std::string> &attrs)
+{
+	std::set<std::string, classad::CaseIgnLTStr> wanted(attrs.begin(), attrs.end());
+
+	if (wanted.size() == m_attrs.size()) {
+		std::set<std::string, classad::CaseIgnLTStr>::iterator wit = wanted.begin();
+		AttrMap::iterator it = m_attrs.begin();
+		while (it != m_attrs.end() && strcasecmp(wit->c_str(), it->first.c_str()) == 0) {
+			++wit;
+			++it;
+		}
+		if (it == m_attrs.end()) {
+			return false;
+		}
+	}
+
+	m_ads.clear();
+	m_attrs.clear();
+	for (size_t i = 0; i < attrs.size(); i++) {
+		m_attrs[attrs[i]];
+	}
+	return true;
+}
+
+bool
+CollectorAdIndex::indexes(const char *attr) const
+{
+	return m_attrs.find(attr) != m_attrs.end();
+}
+
+bool
+CollectorAdIndex::MakeKey(const classad::Value &val, Key &key)
+{
+	std::string str;
+	long long ival;
+	double rval;
+
+	if (val.IsStringValue(str)) {
+		key.is_string = true;
+		key.number = 0;
+		key.str = str;
+		for (size_t i = 0; i < key.str.size(); i++) {
+			key.str[i] = tolower(key.str[i]);
+		}
+		return true;
+	}
+	if (val.IsIntegerValue(ival)) {
+		key.is_string = false;
+		key.number = (double)ival;
+		return true;
+	}
+	if (val.IsRealValue(rval) && rval == rval) {
+		key.is_string = false;
+		key.number = rval;
+		return true;
+	}
+	return false;
+}
+
+void
+CollectorAdIndex::Insert(ClassAd *ad)
+{
+	if (m_attrs.empty()) {
+		return;
+	}
+
+	std::vector<Entry> &entries = m_ads[ad];
+	for (AttrMap::iterator it = m_attrs.begin(); it != m_attrs.end(); ++it) {
+		classad::ExprTree *tree = ad->Lookup(it->first);
+		if ( ! tree) {
+			continue;
+		}
+
+		Entry entry;
+		entry.index = &it->second;
+		entry.other = true;
+		if (tree->GetKind() == classad::ExprTree::LITERAL_NODE) {
+			classad::Value val;
+			static_cast<classad::Literal *>(tree)->GetValue(val);
+			entry.other = ! MakeKey(val, entry.key);
+		}
+
+		if (entry.other) {
+			entry.index->other.insert(ad);
+		} else {
+			entry.index->values[entry.key].insert(ad);
+		}
+		entries.push_back(entry);
+	}
+}
+
+void
+CollectorAdIndex::Remove(ClassAd *ad)
+{
+	AdMap::iterator it = m_ads.find(ad);
+	if (it == m_ads.end()) {
+		return;
+	}
+
+	std::vector<Entry> &entries = it->second;
+	for (size_t i = 0; i < entries.size(); i++) {
+		AttrIndex *index = entries[i].index;
+		if (entries[i].other) {
+			index->other.erase(ad);
+		} else {
+			ValueMap::iterator vit = index->values.find(entries[i].key);
+			if (vit != index->values.end()) {
+				vit->second.erase(ad);
+				if (vit->second.empty()) {
+					index->values.erase(vit);
+				}
+			}
+		}
+	}
+	m_ads.erase(it);
+}
+
+bool
+CollectorAdIndex::Update(ClassAd *ad)
+{
+	if (m_ads.find(ad) == m_ads.end()) {
+		return false;
+	}
+	Remove(ad);
+	Insert(ad);
+	return true;
+}
+
+void
+CollectorAdIndex::Rebuild(CollectorHashTable &table)
+{
+	ClassAd *ad;
+
+	m_ads.clear();
+	for (AttrMap::iterator it = m_attrs.begin(); it != m_attrs.end(); ++it) {
+		it->second.values.clear();
+		it->second.other.clear();
+	}
+	if (m_attrs.empty()) {
+		return;
+	}
+
+	table.startIterations();
+	while (table.iterate(ad)) {
+		Insert(ad);
+	}
+}
+
+	// Is tree a comparison between an indexed attribute of the ad
+	// (Attr or MY.Attr) and a literal?
+bool
+CollectorAdIndex::IsIndexable(classad::ExprTree *tree, const AttrMap &attrs, Conjunct &conj)
+{
+	Operation::OpKind op;
+	classad::ExprTree *left, *right, *unused;
+
+	if (tree->GetKind() != classad::ExprTree::OP_NODE) {
+		return false;
+	}
+	static_cast<Operation *>(tree)->GetComponents(op, left, right, unused);
+
+	switch (op) {
+	case Operation::EQUAL_OP:
+	case Operation::META_EQUAL_OP:
+	case Operation::LESS_THAN_OP:
+	case Operation::LESS_OR_EQUAL_OP:
+	case Operation::GREATER_THAN_OP:
+	case Operation::GREATER_OR_EQUAL_OP:
+		break;
+	default:
+		return false;
+	}
+
+	if (left->GetKind() == classad::ExprTree::LITERAL_NODE) {
+			// turn 5 < Attr into Attr > 5
+		std::swap(left, right);
+		switch (op) {
+		case Operation::LESS_THAN_OP: op = Operation::GREATER_THAN_OP; break;
+		case Operation::LESS_OR_EQUAL_OP: op = Operation::GREATER_OR_EQUAL_OP; break;
+		case Operation::GREATER_THAN_OP: op = Operation::LESS_THAN_OP; break;
+		case Operation::GREATER_OR_EQUAL_OP: op = Operation::LESS_OR_EQUAL_OP; break;
+		default: break;
+		}
+	}
+	if (left->GetKind() != classad::ExprTree::ATTRREF_NODE ||
+		right->GetKind() != classad::ExprTree::LITERAL_NODE)
+	{
+		return false;
+	}
+
+	classad::ExprTree *scope;
+	std::string attr;
+	bool absolute;
+	static_cast<classad::AttributeReference *>(left)->GetComponents(scope, attr, absolute);
+	if (absolute) {
+		return false;
+	}
+	if (scope) {
+		classad::ExprTree *outer;
+		std::string scope_name;
+		if (scope->GetKind() != classad::ExprTree::ATTRREF_NODE) {
+			return false;
+		}
+		static_cast<classad::AttributeReference *>(scope)->GetComponents(outer, scope_name, absolute);
+		if (outer || absolute || strcasecmp(scope_name.c_str(), "MY") != 0) {
+			return false;
+		}
+	}
+
+	AttrMap::const_iterator it = attrs.find(attr);
+	if (it == attrs.end()) {
+		return false;
+	}
+
+	classad::Value val;
+	static_cast<classad::Literal *>(right)->GetValue(val);
+	if ( ! MakeKey(val, conj.key)) {
+		return false;
+	}
+		// only numbers have a useful order
+	if (conj.key.is_string && op != Operation::EQUAL_OP && op != Operation::META_EQUAL_OP) {
+		return false;
+	}
+
+	conj.index = &it->second;
+	conj.op = op;
+	return true;
+}
+
+void
+CollectorAdIndex::FindConjuncts(classad::ExprTree *tree, const AttrMap &attrs,
+								std::vector<Conjunct> &conjs)
+{
+	Operation::OpKind op;
+	classad::ExprTree *left, *right, *unused;
+	Conjunct conj;
+
+	if ( ! tree) {
+		return;
+	}
+	if (IsIndexable(tree, attrs, conj)) {
+		conjs.push_back(conj);
+		return;
+	}
+	if (tree->GetKind() != classad::ExprTree::OP_NODE) {
+		return;
+	}
+	static_cast<Operation *>(tree)->GetComponents(op, left, right, unused);
+	if (op == Operation::PARENTHESES_OP) {
+		FindConjuncts(left, attrs, conjs);
+	} else if (op == Operation::LOGICAL_AND_OP) {
+		FindConjuncts(left, attrs, conjs);
+		FindConjuncts(right, attrs, conjs);
+	}
+}
+
+void
+CollectorAdIndex::GetRange(const Conjunct &conj,
+						   ValueMap::const_iterator &begin, ValueMap::const_iterator &end)
+{
+	const ValueMap &values = conj.index->values;
+
+	switch (conj.op) {
+	case Operation::EQUAL_OP:
+	case Operation::META_EQUAL_OP:
+		begin = values.find(conj.key);
+		end = begin;
+		if (end != values.end()) {
+			++end;
+		}
+		break;
+	case Operation::LESS_THAN_OP:
+		begin = values.begin();
+		end = values.lower_bound(conj.key);
+		break;
+	case Operation::LESS_OR_EQUAL_OP:
+		begin = values.begin();
+		end = values.upper_bound(conj.key);
+		break;
+	case Operation::GREATER_THAN_OP:
+		begin = values.upper_bound(conj.key);
+		end = values.end();
+		break;
+	default:
+		begin = values.lower_bound(conj.key);
+		end = values.end();
+		break;
+	}
+}
+
+size_t
+CollectorAdIndex::CountCandidates(const Conjunct &conj)
+{
+	size_t count = conj.index->other.size();
+	ValueMap::const_iterator begin, end;
+
+	GetRange(conj, begin, end);
+		// a range of numbers stops where the strings start
+	for ( ; begin != end && begin->first.is_string == conj.key.is_string; ++begin) {
+		count += begin->second.size();
+	}
+	return count;
+}
+
+bool
+CollectorAdIndex::Candidates(classad::ExprTree *filter, std::vector<ClassAd *> &ads) const
+{
+	std::vector<Conjunct> conjs;
+
+	if (m_attrs.empty()) {
+		return false;
+	}
+	FindConjuncts(filter, m_attrs, conjs);
+	if (conjs.empty()) {
+		return false;
+	}
+
+	size_t best = 0;
+	size_t best_count = CountCandidates(conjs[0]);
+	for (size_t i = 1; i < conjs.size(); i++) {
+		size_t count = CountCandidates(conjs[i]);
+		if (count < best_count) {
+			best = i;
+			best_count = count;
+		}
+	}
+
+	const Conjunct &conj = conjs[best];
+	ValueMap::const_iterator begin, end;
+
+	ads.reserve(ads.size() + best_count);
+	ads.insert(ads.end(), conj.index->other.begin(), conj.index->other.end());
+	GetRange(conj, begin, end);
+	for ( ; begin != end && begin->first.is_string == conj.key.is_string; ++begin) {
+		ads.insert(ads.end(), begin->second.begin(), begin->second.end());
+	}
+	return true;
+}
@@ -0,0 +1,113 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __COLLECTOR_AD_INDEX_H__
+#define __COLLECTOR_AD_INDEX_H__
+
+#include "condor_classad.h"
+#include "hashkey.h"
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+
+/* CollectorAdIndex keeps the ads of one collector table sorted by the
+ * values of a few attributes, so that a query whose Requirements say
+ * Attr == "value" or Attr >= number only needs to look at the ads that
+ * can match, rather than every ad in the table.
+ *
+ * Only string and number literals are indexed.  An ad whose attribute
+ * is an expression (or a boolean, undefined, etc.) is kept in a list
+ * of its own that every lookup includes, and an ad without the
+ * attribute is left out, since a comparison with it can't be true.
+ * The candidates returned are a superset of the matching ads; the
+ * caller still evaluates the whole Requirements against each.
+ *
+ * The owner must call Remove() before an ad leaves the table or is
+ * changed in place, and Insert() once the ad is in its final form.
+ */
+class CollectorAdIndex {
+
+ public:
+	CollectorAdIndex();
+
+		// Set the attributes to index; clears the index.  Returns
+		// false if the list is the same as before (and leaves the
+		// index alone).
+	bool setAttributes(const std::vector<std::string> &attrs);
+	bool indexes(const char *attr) const;
+	bool empty() const { return m_attrs.empty(); }
+
+	void Insert(ClassAd *ad);
+	void Remove(ClassAd *ad);
+		// File an ad that has been changed in place under its new
+		// values.  Returns false, and does nothing, if the ad isn't in
+		// this index.
+	bool Update(ClassAd *ad);
+	void Rebuild(CollectorHashTable &table);
+
+		// Look for a conjunct of filter that an index can answer, and
+		// if there is one, append the candidate ads of the most
+		// selective one to ads.  Returns false if no index applies.
+	bool Candidates(classad::ExprTree *filter, std::vector<ClassAd *> &ads) const;
+
+ private:
+
+	struct Key {
+		bool is_string;
+		double number;
+		std::string str;	// lower case, since == ignores case
+		bool operator<(const Key &rhs) const;
+	};
+	typedef std::map<Key, std::set<ClassAd *> > ValueMap;
+
+	struct AttrIndex {
+		ValueMap values;
+		std::set<ClassAd *> other;	// ads with a value we can't index
+	};
+	typedef std::map<std::string, AttrIndex, classad::CaseIgnLTStr> AttrMap;
+
+		// where an ad was filed, so it can be found again after the
+		// ad has changed
+	struct Entry {
+		AttrIndex *index;
+		bool other;
+		Key key;
+	};
+	typedef std::map<ClassAd *, std::vector<Entry> > AdMap;
+
+	struct Conjunct {
+		const AttrIndex *index;
+		classad::Operation::OpKind op;
+		Key key;
+	};
+
+	static bool MakeKey(const classad::Value &val, Key &key);
+	static bool IsIndexable(classad::ExprTree *tree, const AttrMap &attrs, Conjunct &conj);
+	static void FindConjuncts(classad::ExprTree *tree, const AttrMap &attrs,
+							  std::vector<Conjunct> &conjs);
+	static void GetRange(const Conjunct &conj,
+						 ValueMap::const_iterator &begin, ValueMap::const_iterator &end);
+	static size_t CountCandidates(const Conjunct &conj);
+
+	AttrMap m_attrs;
+	AdMap m_ads;
+};
+
+#endif /* __COLLECTOR_AD_INDEX_H__ */
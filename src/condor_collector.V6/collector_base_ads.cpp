@@ -0,0 +1,167 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_attributes.h"
+#include "collector_base_ads.h"
+#include <set>
+
+CollectorBaseAds::CollectorBaseAds() :
+	m_enabled(false),
+	m_shared(0),
+	m_unshared(0),
+	m_attrs_removed(0)
+{
+}
+
+CollectorBaseAds::~CollectorBaseAds()
+{
+		// the engine deletes the ads chained to these first
+	for (BaseMap::iterator it = m_bases.begin(); it != m_bases.end(); ++it) {
+		delete it->second.ad;
+	}
+	for (size_t i = 0; i < m_retired.size(); i++) {
+		delete m_retired[i];
+	}
+}
+
+bool
+CollectorBaseAds::BaseKey(ClassAd *ad, std::string &key)
+{
+	std::string slot_type;
+	if (!ad->LookupString(ATTR_MACHINE, key)) {
+		return false;
+	}
+		// partitionable, dynamic and static slots have different
+		// attributes, so each gets a base of its own
+	ad->LookupString(ATTR_SLOT_TYPE, slot_type);
+	key += '\n';
+	key += slot_type;
+	return true;
+}
+
+void
+CollectorBaseAds::Share(ClassAd *ad)
+{
+	std::string key;
+
+	if (!m_enabled || !ad || ad->GetChainedParentAd() || !BaseKey(ad, key)) {
+		return;
+	}
+
+	BaseMap::iterator it = m_bases.find(key);
+	if (it == m_bases.end()) {
+		Base base;
+		base.ad = new ClassAd(*ad);
+		base.replaced = false;
+		it = m_bases.insert(BaseMap::value_type(key, base)).first;
+	}
+	else {
+			// Count the attributes the ad has in common with the base,
+			// and how many of those have the same value.
+		ClassAd *base_ad = it->second.ad;
+		int in_base = 0;
+		int same = 0;
+		for (classad::ClassAd::iterator itr = ad->begin(); itr != ad->end(); itr++) {
+			classad::ExprTree *tree = base_ad->Lookup(itr->first);
+			if (tree) {
+				in_base++;
+				if (tree->SameAs(itr->second)) {
+					same++;
+				}
+			}
+		}
+
+		if (in_base != base_ad->size() || same * 2 < in_base) {
+			if (it->second.replaced) {
+				m_unshared++;
+				return;
+			}
+			m_retired.push_back(base_ad);
+			it->second.ad = new ClassAd(*ad);
+			it->second.replaced = true;
+		}
+	}
+
+	ad->ChainToAd(it->second.ad);
+	m_attrs_removed += ad->PruneChildAd();
+	m_shared++;
+}
+
+void
+CollectorBaseAds::Unshare(ClassAd *ad)
+{
+	if (ad && ad->GetChainedParentAd()) {
+		ad->ChainCollapse();
+	}
+}
+
+void
+CollectorBaseAds::Collect(CollectorHashTable &table, const std::vector<ClassAd *> &held)
+{
+	std::set<const classad::ClassAd *> in_use;
+	ClassAd *ad;
+
+	table.startIterations();
+	while (table.iterate(ad)) {
+		const classad::ClassAd *parent = ad->GetChainedParentAd();
+		if (parent) {
+			in_use.insert(parent);
+		}
+	}
+	for (size_t i = 0; i < held.size(); i++) {
+		const classad::ClassAd *parent = held[i]->GetChainedParentAd();
+		if (parent) {
+			in_use.insert(parent);
+		}
+	}
+
+	int freed = 0;
+	size_t kept = 0;
+	for (size_t i = 0; i < m_retired.size(); i++) {
+		if (in_use.count(m_retired[i])) {
+			m_retired[kept++] = m_retired[i];
+		} else {
+			delete m_retired[i];
+			freed++;
+		}
+	}
+	m_retired.resize(kept);
+
+	BaseMap::iterator it = m_bases.begin();
+	while (it != m_bases.end()) {
+		if (in_use.count(it->second.ad)) {
+			it->second.replaced = false;
+			++it;
+		} else {
+			delete it->second.ad;
+			m_bases.erase(it++);
+			freed++;
+		}
+	}
+
+	dprintf(D_FULLDEBUG, "\t\tShared %d startd ads (%d attributes) with base ads, "
+			"%d didn't fit; freed %d unused base ads, %d remain\n",
+			m_shared, m_attrs_removed, m_unshared, freed, NumBaseAds());
+
+	m_shared = 0;
+	m_unshared = 0;
+	m_attrs_removed = 0;
+}
@@ -0,0 +1,88 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __COLLECTOR_BASE_ADS_H__
+#define __COLLECTOR_BASE_ADS_H__
+
+#include "condor_classad.h"
+#include "hashkey.h"
+#include <string>
+#include <map>
+#include <vector>
+
+/* CollectorBaseAds lets the slot ads of a machine share the attributes
+ * they have in common.  The first ad stored for each machine and slot
+ * type becomes a base ad, and every ad stored after it keeps only the
+ * attributes whose values differ from the base, with the base chained
+ * in as its parent.  Lookups, evaluation and putClassAd() see through
+ * the chain, so the stored ads behave as if they were complete.
+ *
+ * An ad is only chained to a base whose attributes it all has, so the
+ * base never adds attributes to it.  When an ad doesn't fit the base,
+ * or shares less than half of it, the base is replaced by a copy of
+ * that ad (at most once per machine between calls to Collect()).  Ads
+ * still chained to an old base keep it until Collect() finds that no
+ * stored ad uses it.
+ */
+class CollectorBaseAds {
+
+ public:
+	CollectorBaseAds();
+	~CollectorBaseAds();
+
+	void setEnabled(bool enabled) { m_enabled = enabled; }
+	bool enabled() const { return m_enabled; }
+
+		// Strip the attributes ad shares with the base for its machine
+		// and chain it to the base.  ad must be the newly stored copy,
+		// not chained to anything.
+	void Share(ClassAd *ad);
+
+		// Copy the attributes ad gets from its base into it and unchain
+		// it, so that attributes can be deleted from it.  (Deleting an
+		// attribute from a chained ad only hides the base's value
+		// behind an UNDEFINED one.)
+	void Unshare(ClassAd *ad);
+
+		// Free the base ads that no ad in table, nor any of the held
+		// ads (ads that have left table but may still be in use), is
+		// chained to.
+	void Collect(CollectorHashTable &table, const std::vector<ClassAd *> &held);
+
+	int NumBaseAds() const { return (int)m_bases.size() + (int)m_retired.size(); }
+
+ private:
+
+	struct Base {
+		ClassAd *ad;
+		bool replaced;		// replaced since the last Collect()
+	};
+	typedef std::map<std::string, Base> BaseMap;
+
+	static bool BaseKey(ClassAd *ad, std::string &key);
+
+	bool m_enabled;
+	BaseMap m_bases;
+	std::vector<ClassAd *> m_retired;	// replaced, but maybe still in use
+	int m_shared;		// ads chained since the last Collect()
+	int m_unshared;		// ads that didn't fit their base
+	int m_attrs_removed;
+};
+
+#endif /* __COLLECTOR_BASE_ADS_H__ */
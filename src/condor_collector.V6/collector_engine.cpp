@@ -36,6 +36,8 @@ extern "C" void event_mgr (void);
 #include "condor_daemon_core.h"
 #include "file_sql.h"
 #include "classad_merge.h"
+#include "daemon.h"
+#include "dc_message.h"
 
 extern FILESQL *FILEObj;
 
@@ -46,11 +48,15 @@ extern FILESQL *FILEObj;
 
 static void killHashTable (CollectorHashTable &);
 static int killGenericHashTable(CollectorHashTable *);
-static void purgeHashTable (CollectorHashTable &);
 
 int 	engine_clientTimeoutHandler (Service *);
 int 	engine_housekeepingHandler  (Service *);
 
+	// how often we'll ask one slot for a full update, and how long we
+	// wait on its startd when we do
+static const int FULL_UPDATE_REQUEST_INTERVAL = 60;
+static const int FULL_UPDATE_REQUEST_TIMEOUT = 10;
+
 CollectorEngine::CollectorEngine (CollectorStats *stats ) :
 	StartdAds     (GREATER_TABLE_SIZE, &adNameHashFunction),
 	StartdPrivateAds(GREATER_TABLE_SIZE, &adNameHashFunction),
@@ -74,6 +80,8 @@ CollectorEngine::CollectorEngine (CollectorStats *stats ) :
 	LeaseManagerAds(LESSER_TABLE_SIZE , &adNameHashFunction),
 	GridAds       (LESSER_TABLE_SIZE , &adNameHashFunction),
 	GenericAds    (LESSER_TABLE_SIZE , &stringHashFunction),
+	m_updateGeneration(0),
+	m_pinSerial(0),
 	__self_ad__(0)
 {
 	clientTimeout = 20;
@@ -114,6 +122,11 @@ CollectorEngine::
 	killHashTable (GridAds);
 	GenericAds.walk(killGenericHashTable);
 
+	while ( ! m_releasedAds.empty()) {
+		delete m_releasedAds.front().second;
+		m_releasedAds.pop_front();
+	}
+
 	if(m_collector_requirements) {
 		delete m_collector_requirements;
 		m_collector_requirements = NULL;
@@ -255,7 +268,8 @@ CollectorEngine::invalidateAds(AdTypes adType, ClassAd &query)
 				dprintf(D_ALWAYS,
 						"\t\t**** Invalidating ad: \"%s\"\n",
 						hkString.Value());
-				delete ad;
+				unindexAd(*table, ad);
+				releaseAd(ad);
 				count++;
 			}
 		}
@@ -335,6 +349,142 @@ walkHashTable (AdTypes adType, int (*scanFunction)(ClassAd *))
 	return 1;
 }
 
+static std::vector<ClassAd *> *snapshot_ads = NULL;
+
+static int
+snapshotScanFunc (ClassAd *ad)
+{
+	snapshot_ads->push_back(ad);
+	return 1;
+}
+
+int CollectorEngine::
+snapshotAds (AdTypes adType, std::vector<ClassAd *> &ads)
+{
+	snapshot_ads = &ads;
+	int ret = walkHashTable(adType, snapshotScanFunc);
+	snapshot_ads = NULL;
+	return ret;
+}
+
+unsigned int CollectorEngine::
+pinAds ()
+{
+	unsigned int pin = m_pinSerial++;
+	m_pins.insert(pin);
+	return pin;
+}
+
+void CollectorEngine::
+unpinAds (unsigned int pin)
+{
+	std::multiset<unsigned int>::iterator it = m_pins.find(pin);
+	if (it != m_pins.end()) {
+		m_pins.erase(it);
+	}
+
+		// An ad released when the next pin would have been N can only
+		// be in the snapshots of pins before N, so it can be freed once
+		// the oldest pin left is N or newer.
+	while ( ! m_releasedAds.empty() &&
+			(m_pins.empty() || m_releasedAds.front().first <= *m_pins.begin()))
+	{
+		delete m_releasedAds.front().second;
+		m_releasedAds.pop_front();
+	}
+}
+
+void CollectorEngine::
+setQueryIndexAttributes (const std::vector<std::string> &attrs)
+{
+	if (attrs.empty()) {
+		m_indexes.clear();
+		return;
+	}
+
+		// the lesser tables are small enough to scan
+	CollectorHashTable *tables[] = {
+		&StartdAds, &StartdPrivateAds, &ScheddAds, &SubmittorAds, &LicenseAds,
+		&MasterAds, &StorageAds, &XferServiceAds, &AccountingAds
+	};
+	for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+		CollectorAdIndex &index = m_indexes[tables[i]];
+		if (index.setAttributes(attrs)) {
+			index.Rebuild(*tables[i]);
+		}
+	}
+}
+
+bool CollectorEngine::
+indexedAds (AdTypes adType, classad::ExprTree *filter, std::vector<ClassAd *> &ads)
+{
+	CollectorHashTable *table;
+	CollectorEngine::HashFunc func;
+
+	if (m_indexes.empty() || !LookupByAdType(adType, table, func)) {
+		return false;
+	}
+	std::map<CollectorHashTable *, CollectorAdIndex>::iterator it = m_indexes.find(table);
+	if (it == m_indexes.end()) {
+		return false;
+	}
+	return it->second.Candidates(filter, ads);
+}
+
+void CollectorEngine::
+reindexAttribute (const char *attr)
+{
+	std::map<CollectorHashTable *, CollectorAdIndex>::iterator it;
+	for (it = m_indexes.begin(); it != m_indexes.end(); ++it) {
+		if (it->second.indexes(attr)) {
+			it->second.Rebuild(*it->first);
+		}
+	}
+}
+
+void CollectorEngine::
+reindexAd (ClassAd *ad)
+{
+	std::map<CollectorHashTable *, CollectorAdIndex>::iterator it;
+	for (it = m_indexes.begin(); it != m_indexes.end(); ++it) {
+		if (it->second.Update(ad)) {
+			break;
+		}
+	}
+}
+
+void CollectorEngine::
+indexAd (CollectorHashTable &table, ClassAd *ad)
+{
+	if ( ! m_indexes.empty()) {
+		std::map<CollectorHashTable *, CollectorAdIndex>::iterator it = m_indexes.find(&table);
+		if (it != m_indexes.end()) {
+			it->second.Insert(ad);
+		}
+	}
+}
+
+void CollectorEngine::
+unindexAd (CollectorHashTable &table, ClassAd *ad)
+{
+	if ( ! m_indexes.empty()) {
+		std::map<CollectorHashTable *, CollectorAdIndex>::iterator it = m_indexes.find(&table);
+		if (it != m_indexes.end()) {
+			it->second.Remove(ad);
+		}
+	}
+}
+
+void CollectorEngine::
+releaseAd (ClassAd *ad)
+{
+	if (m_pins.empty()) {
+		delete ad;
+	} else {
+		m_releasedAds.push_back(std::make_pair(m_pinSerial, ad));
+	}
+}
+
 CollectorHashTable *CollectorEngine::findOrCreateTable(MyString &type)
 {
 	CollectorHashTable *table=0;
@@ -367,6 +517,21 @@ collector_runtime_probe CollectorEngine_rucc_repeatAd_runtime;
 collector_runtime_probe CollectorEngine_rucc_other_runtime;
 
 
+// insert the authenticated user into the ad itself
+static void
+setAuthenticatedIdentity (ClassAd *clientAd, Sock *sock)
+{
+	const char* authn_user = sock->getFullyQualifiedUser();
+	if (authn_user) {
+		clientAd->Assign("AuthenticatedIdentity", authn_user);
+		clientAd->Assign("AuthenticationMethod", sock->getAuthenticationMethodUsed());
+	} else {
+		// remove it from the ad if it's not authenticated.
+		clientAd->Delete("AuthenticatedIdentity");
+		clientAd->Delete("AuthenticationMethod");
+	}
+}
+
 ClassAd *CollectorEngine::
 collect (int command, Sock *sock, const condor_sockaddr& from, int &insert)
 {
@@ -397,16 +562,7 @@ collect (int command, Sock *sock, const condor_sockaddr& from, int &insert)
 	double delta_time = rt.tick(rt_last);
 	CollectorEngine_ruc_getAd_runtime.Add(delta_time);
 
-	// insert the authenticated user into the ad itself
-	const char* authn_user = sock->getFullyQualifiedUser();
-	if (authn_user) {
-		clientAd->Assign("AuthenticatedIdentity", authn_user);
-		clientAd->Assign("AuthenticationMethod", sock->getAuthenticationMethodUsed());
-	} else {
-		// remove it from the ad if it's not authenticated.
-		clientAd->Delete("AuthenticatedIdentity");
-		clientAd->Delete("AuthenticationMethod");
-	}
+	setAuthenticatedIdentity(clientAd, sock);
 
 	CollectorEngine_ruc_authid_runtime.Add(rt.tick(rt_last));
 
@@ -428,6 +584,85 @@ collect (int command, Sock *sock, const condor_sockaddr& from, int &insert)
 	return rval;
 }
 
+// Collect the slots of a batched startd update: a base ad holding the
+// attributes all the slots share, the number of slots, and then each
+// slot's own public attributes and its private ad.  All of the slots
+// are stored before we go back to the event loop.
+int CollectorEngine::
+collectStartdAds (Sock *sock, const condor_sockaddr& from, std::vector<ClassAd *> &ads)
+{
+	ClassAd base;
+	int num_slots = 0;
+	int num_collected = 0;
+
+	sock->timeout(1);
+
+	if( !getClassAdEx(sock, base, m_get_ad_options) || !sock->code(num_slots) )
+	{
+		dprintf (D_ALWAYS,"Command %d on Sock not followed by base ClassAd (or timeout occured)\n",
+				 UPDATE_STARTD_ADS);
+		sock->end_of_message();
+		return -1;
+	}
+
+	for (int i = 0; i < num_slots; i++) {
+		ClassAd slotAd;
+		ClassAd *pvtAd = new ClassAd;
+		if( !getClassAdEx(sock, slotAd, m_get_ad_options) || !getClassAd(sock, *pvtAd) ) {
+			dprintf (D_ALWAYS,"Command %d: failed to read slot %d of %d\n",
+					 UPDATE_STARTD_ADS, i+1, num_slots);
+			delete pvtAd;
+			break;
+		}
+
+		ClassAd *clientAd = new ClassAd(base);
+		clientAd->Update(slotAd);
+		setAuthenticatedIdentity(clientAd, sock);
+
+		ClassAd *retVal = NULL;
+		AdNameHashKey hk;
+		HashString hashString;
+		int insert = -3;
+		if( ValidateClassAd(UPDATE_STARTD_AD, clientAd, sock) ) {
+#if defined(ADD_TARGET_SCOPING)
+			clientAd->AddTargetRefs( TargetJobAttrs );
+#endif
+			if (makeStartdAdHashKey (hk, clientAd)) {
+				hashString.Build( hk );
+				retVal = updateClassAd (StartdAds, "StartdAd     ", "Start",
+										clientAd, hk, hashString, insert, from );
+			} else {
+				dprintf (D_ALWAYS, "Could not make hashkey --- ignoring ad\n");
+			}
+		}
+		if( !retVal ) {
+			delete clientAd;
+			delete pvtAd;
+			continue;
+		}
+		m_startdBaseAds.Share(retVal);
+
+		int insPvt;
+		SetMyTypeName( *pvtAd, STARTD_ADTYPE );
+		pvtAd->CopyAttribute( ATTR_MY_ADDRESS, retVal );
+		pvtAd->CopyAttribute( ATTR_NAME, retVal );
+		(void) updateClassAd (StartdPrivateAds, "StartdPvtAd  ",
+							  "StartdPvt", pvtAd, hk, hashString, insPvt,
+							  from );
+
+		ads.push_back(retVal);
+		num_collected++;
+	}
+
+	if (!sock->end_of_message())
+	{
+		dprintf(D_FULLDEBUG,"Warning: Command %d; maybe shedding data on eom\n",
+				 UPDATE_STARTD_ADS);
+	}
+
+	return num_collected;
+}
+
 bool CollectorEngine::ValidateClassAd(int command,ClassAd *clientAd,Sock *sock)
 {
 
@@ -443,6 +678,7 @@ bool CollectorEngine::ValidateClassAd(int command,ClassAd *clientAd,Sock *sock)
 	  case MERGE_STARTD_AD:
 	  case UPDATE_STARTD_AD:
 	  case UPDATE_STARTD_AD_WITH_ACK:
+	  case UPDATE_STARTD_AD_DELTA:
 		  ipattr = ATTR_STARTD_IP_ADDR;
 		  break;
 	  case UPDATE_SCHEDD_AD:
@@ -577,6 +813,10 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 		retVal=updateClassAd (StartdAds, "StartdAd     ", "Start",
 							  clientAd, hk, hashString, insert, from );
 
+		if (retVal) {
+			m_startdBaseAds.Share(retVal);
+		}
+
 		if (last_updateClassAd_was_insert) { CollectorEngine_rucc_insertAd_runtime.Add(rt.tick(rt_last));
 		} else { CollectorEngine_rucc_updateAd_runtime.Add(rt.tick(rt_last)); }
 
@@ -654,6 +894,50 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 		}
 		break;
 
+	  case UPDATE_STARTD_AD_DELTA:
+#if defined(ADD_TARGET_SCOPING)
+		  clientAd->AddTargetRefs( TargetJobAttrs );
+#endif
+		if (!makeStartdAdHashKey (hk, clientAd))
+		{
+			dprintf (D_ALWAYS, "Could not make hashkey --- ignoring ad\n");
+			insert = -3;
+			retVal = 0;
+			break;
+		}
+		hashString.Build( hk );
+		retVal = applyStartdDelta (hk, hashString, clientAd, insert);
+		if (!retVal) {
+				// read past the private ad, so that a TCP connection
+				// is left ready for the startd's next update
+			if (sock) {
+				ClassAd ignoredPvtAd;
+				if( getClassAd(sock, ignoredPvtAd) ) {
+					insert = -4;
+				} else {
+					dprintf(D_FULLDEBUG,"\t(Could not get startd's private ad)\n");
+				}
+			}
+			break;
+		}
+
+			// the private ad is always sent whole
+		if (sock) {
+			pvtAd = new ClassAd;
+			if( !getClassAd(sock, *pvtAd) ) {
+				dprintf(D_FULLDEBUG,"\t(Could not get startd's private ad)\n");
+				delete pvtAd;
+				break;
+			}
+			SetMyTypeName( *pvtAd, STARTD_ADTYPE );
+			pvtAd->CopyAttribute( ATTR_MY_ADDRESS, retVal );
+			pvtAd->CopyAttribute( ATTR_NAME, retVal );
+			(void) updateClassAd (StartdPrivateAds, "StartdPvtAd  ",
+								  "StartdPvt", pvtAd, hk, hashString, insPvt,
+								  from );
+		}
+		break;
+
 	  case MERGE_STARTD_AD:
 #if defined(ADD_TARGET_SCOPING)
 		  clientAd->AddTargetRefs( TargetJobAttrs );
@@ -990,7 +1274,8 @@ int CollectorEngine::remove (AdTypes t_AddType, const ClassAd & c_query, bool *q
 				hk.sprint( hkString );
 				iRet = !table->remove(hk);
 				dprintf (D_ALWAYS,"\t\t**** Removed(%d) ad(s): \"%s\"\n", iRet, hkString.Value() );
-				delete pAd;
+				unindexAd(*table, pAd);
+				releaseAd(pAd);
 			}
 		}
 	}
@@ -1011,9 +1296,11 @@ int CollectorEngine::expire( AdTypes adType, const ClassAd & query, bool * query
 
             ClassAd * cAd = NULL;
             if( hTable->lookup( hKey, cAd ) != -1 ) {
+                unindexAd( * hTable, cAd );
                 cAd->Assign( ATTR_LAST_HEARD_FROM, 1 );
                 
                 if( CollectorDaemon::offline_plugin_.expire( * cAd ) == true ) {
+                    indexAd( * hTable, cAd );
                     return rVal;
                 }
                 
@@ -1028,7 +1315,7 @@ int CollectorEngine::expire( AdTypes adType, const ClassAd & query, bool * query
                 hKey.sprint( hkString );                
                 dprintf( D_ALWAYS, "\t\t**** Removed(%d) stale ad(s): \"%s\"\n", rVal, hkString.Value() );
 
-                delete cAd;
+                releaseAd(cAd);
             }
         }
     }
@@ -1044,6 +1331,10 @@ remove (AdTypes adType, AdNameHashKey &hk)
 	if (!LookupByAdType(adType, table, func)) {
 		return 0;
 	}
+	ClassAd *ad;
+	if (table->lookup(hk, ad) != -1) {
+		unindexAd(*table, ad);
+	}
 	return !table->remove(hk);
 }
 
@@ -1081,6 +1372,7 @@ updateClassAd (CollectorHashTable &hashTable,
 		buf.formatstr( "%s = %d", ATTR_LAST_HEARD_FROM, (int)now);
 		ad->Insert ( buf.Value() );
 	}
+	stampUpdateGeneration( ad );
 
 	// this time stamped ad is the new ad
 	new_ad = ad;
@@ -1110,6 +1402,8 @@ updateClassAd (CollectorHashTable &hashTable,
 			new_ad->Assign( ATTR_LAST_FORWARDED, (int)time(NULL) );
 		}
 
+		indexAd(hashTable, new_ad);
+
 		return new_ad;
 	}
 	else
@@ -1126,6 +1420,7 @@ updateClassAd (CollectorHashTable &hashTable,
 		if (hashTable.remove(hk) == -1) {
 			EXCEPT( "Error removing ad" );
 		}
+		unindexAd(hashTable, old_ad);
 		if (hashTable.insert(hk, new_ad) == -1) {
 			EXCEPT( "Error inserting ad" );
 		}
@@ -1159,7 +1454,8 @@ updateClassAd (CollectorHashTable &hashTable,
 
 		if (isSelfAd(old_ad)) { __self_ad__ = new_ad; }
 
-		delete old_ad;
+		indexAd(hashTable, new_ad);
+		releaseAd(old_ad);
 
 		insert = 0;
 		return new_ad;
@@ -1202,13 +1498,120 @@ mergeClassAd (CollectorHashTable &hashTable,
 		new_ad_copy.Delete(ATTR_TARGET_TYPE);
 
 		// Now, finally, merge the new ClassAd into the old one
+		unindexAd(hashTable, old_ad);
 		MergeClassAds(old_ad,&new_ad_copy,true);
+		stampUpdateGeneration(old_ad);
+		indexAd(hashTable, old_ad);
 	}
 	delete new_ad;
 	return old_ad;
 }
 
 
+// Merge a delta update from a startd into the ad we have for it, which
+// must have been built from the full update the delta was made against.
+// The delta carries every attribute the startd has sent since that full
+// update, so merging it gives the startd's current ad even if we missed
+// earlier deltas.
+// Returns NULL, leaving delta_ad for the caller to free, if we don't
+// have that ad, in which case we ask the startd for a full update.
+ClassAd * CollectorEngine::
+applyStartdDelta (AdNameHashKey &hk,
+				  const MyString &hashString,
+				  ClassAd *delta_ad,
+				  int &insert)
+{
+	ClassAd *old_ad = NULL;
+	int old_base = -1, new_base = -1;
+	int old_stime = -1, new_stime = -1;
+
+	insert = 0;
+
+	if ( StartdAds.lookup (hk, old_ad) == -1 ) {
+		dprintf (D_FULLDEBUG, "StartdAd: Ignoring delta update for ** \"%s\" "
+				 "because there is no ad to apply it to\n", hashString.Value() );
+		requestFullStartdUpdate( delta_ad, hashString );
+		return NULL;
+	}
+
+		// the delta must be against the full update we have stored
+	old_ad->LookupInteger( ATTR_DELTA_UPDATE_BASE, old_base );
+	delta_ad->LookupInteger( ATTR_DELTA_UPDATE_BASE, new_base );
+	old_ad->LookupInteger( ATTR_DAEMON_START_TIME, old_stime );
+	delta_ad->LookupInteger( ATTR_DAEMON_START_TIME, new_stime );
+	if ( old_base < 0 || old_base != new_base || old_stime != new_stime ) {
+		dprintf (D_FULLDEBUG, "StartdAd: Ignoring delta update for ** \"%s\" "
+				 "made against a full update we don't have (%d != %d)\n",
+				 hashString.Value(), new_base, old_base );
+		requestFullStartdUpdate( delta_ad, hashString );
+		return NULL;
+	}
+
+	dprintf (D_FULLDEBUG, "StartdAd     : Applying delta update (%d attributes) for ... \"%s\"\n",
+			 delta_ad->size(), hashString.Value() );
+
+	collectorStats->update( "Start", old_ad, delta_ad );
+
+	delta_ad->Assign( ATTR_LAST_HEARD_FROM, (int)time(NULL) );
+	stampUpdateGeneration( delta_ad );
+
+	std::string removed;
+	unindexAd( StartdAds, old_ad );
+	if ( delta_ad->LookupString( ATTR_DELTA_UPDATE_REMOVED_ATTRS, removed ) ) {
+		m_startdBaseAds.Unshare( old_ad );
+		StringTokenIterator attrs( removed );
+		const std::string *attr;
+		while ( (attr = attrs.next_string()) ) {
+			old_ad->Delete( *attr );
+		}
+		delta_ad->Delete( ATTR_DELTA_UPDATE_REMOVED_ATTRS );
+	}
+	MergeClassAds( old_ad, delta_ad, true );
+	indexAd( StartdAds, old_ad );
+
+	delete delta_ad;
+	return old_ad;
+}
+
+// Ask the startd that sent a delta we couldn't apply to send the slot's
+// next update in full.  Without this, an ad lost when we restart, or a
+// full update that never arrived, would stay missing or stale until the
+// startd's next scheduled full update.  A slot is asked at most once
+// every FULL_UPDATE_REQUEST_INTERVAL seconds.
+void CollectorEngine::
+requestFullStartdUpdate (ClassAd *delta_ad, const MyString &hashString)
+{
+	std::string name;
+	if ( !delta_ad->LookupString( ATTR_NAME, name ) ||
+		 !delta_ad->Lookup( ATTR_MY_ADDRESS ) ) {
+		return;
+	}
+
+	time_t now = time(NULL);
+	std::map<std::string, time_t>::iterator it =
+		m_fullUpdateRequests.find( hashString.Value() );
+	if ( it != m_fullUpdateRequests.end() &&
+		 now < it->second + FULL_UPDATE_REQUEST_INTERVAL ) {
+		return;
+	}
+	m_fullUpdateRequests[hashString.Value()] = now;
+
+	dprintf (D_FULLDEBUG, "StartdAd: Asking for a full update of \"%s\"\n",
+			 hashString.Value() );
+
+	classy_counted_ptr<Daemon> startd = new Daemon( delta_ad, DT_STARTD, NULL );
+	classy_counted_ptr<DCStringMsg> msg =
+		new DCStringMsg( SEND_FULL_STARTD_UPDATE, name.c_str() );
+	msg->setSuccessDebugLevel( D_FULLDEBUG );
+	msg->setTimeout( FULL_UPDATE_REQUEST_TIMEOUT );
+	if ( startd->hasUDPCommandPort() ) {
+		msg->setStreamType( Stream::safe_sock );
+	} else {
+		msg->setStreamType( Stream::reli_sock );
+	}
+	startd->sendMsg( msg.get() );
+}
+
 void
 CollectorEngine::
 housekeeper()
@@ -1227,6 +1630,24 @@ housekeeper()
 
 	dprintf (D_ALWAYS, "\tCleaning StartdAds ...\n");
 	cleanHashTable (StartdAds, now, makeStartdAdHashKey);
+		// ads held for pinned queries may still use base ads that
+		// no ad in the table does
+	std::vector<ClassAd *> held;
+	for (size_t i = 0; i < m_releasedAds.size(); i++) {
+		held.push_back(m_releasedAds[i].second);
+	}
+	m_startdBaseAds.Collect(StartdAds, held);
+
+		// forget the full updates asked for long enough ago that we
+		// would ask again anyway
+	std::map<std::string, time_t>::iterator req = m_fullUpdateRequests.begin();
+	while (req != m_fullUpdateRequests.end()) {
+		if (now >= req->second + FULL_UPDATE_REQUEST_INTERVAL) {
+			m_fullUpdateRequests.erase(req++);
+		} else {
+			++req;
+		}
+	}
 
 	dprintf (D_ALWAYS, "\tCleaning StartdPrivateAds ...\n");
 	cleanHashTable (StartdPrivateAds, now, makeStartdAdHashKey);
@@ -1288,6 +1709,12 @@ housekeeper()
 	dprintf (D_ALWAYS, "Housekeeper:  Done cleaning\n");
 }
 
+void CollectorEngine::
+stampUpdateGeneration (ClassAd *ad)
+{
+	ad->Assign( ATTR_COLLECTOR_UPDATE_GENERATION, ++m_updateGeneration );
+}
+
 void CollectorEngine::
 cleanHashTable (CollectorHashTable &hashTable, time_t now, HashFunc makeKey)
 {
@@ -1329,8 +1756,11 @@ cleanHashTable (CollectorHashTable &hashTable, time_t now, HashFunc makeKey)
 				   potentially mark the ad absent. if expire() returns false, then delete
 				   the ad as planned; if it return true, it was likely marked as absent,
 				   so then this ad should NOT be deleted. */
+				unindexAd(hashTable, ad);
 				if ( CollectorDaemon::offline_plugin_.expire( *ad ) == true ) {
 					// plugin say to not delete this ad, so continue
+					stampUpdateGeneration(ad);
+					indexAd(hashTable, ad);
 					continue;
 				} else {
 					dprintf (D_ALWAYS,"\t\t**** Removing stale ad: \"%s\"\n", hkString.Value() );
@@ -1340,7 +1770,8 @@ cleanHashTable (CollectorHashTable &hashTable, time_t now, HashFunc makeKey)
 			{
 				dprintf (D_ALWAYS, "\t\tError while removing ad\n");
 			}
-			delete ad;
+			unindexAd(hashTable, ad);
+			releaseAd(ad);
 		}
 	}
 }
@@ -1427,7 +1858,7 @@ CollectorEngine::LookupByAdType(AdTypes adType,
 }
 
 
-static void
+void CollectorEngine::
 purgeHashTable( CollectorHashTable &table )
 {
 	ClassAd* ad;
@@ -1437,7 +1868,8 @@ purgeHashTable( CollectorHashTable &table )
 		if( table.remove(hk) == -1 ) {
 			dprintf( D_ALWAYS, "\t\tError while removing ad\n" );
 		}		
-		delete ad;
+		unindexAd(table, ad);
+		releaseAd(ad);
 	}
 }
 
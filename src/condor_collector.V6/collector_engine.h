@@ -26,6 +26,11 @@
 #include "condor_collector.h"
 #include "collector_stats.h"
 #include "hashkey.h"
+#include "collector_base_ads.h"
+#include "collector_ad_index.h"
+#include <set>
+#include <map>
+#include <deque>
 
 class CollectorEngine : public Service
 {
@@ -45,6 +50,10 @@ class CollectorEngine : public Service
 	ClassAd *collect (int, Sock *, const condor_sockaddr&, int &);
 	ClassAd *collect (int, ClassAd *, const condor_sockaddr&, int &, Sock* = NULL);
 
+	// collect all the slot ads of an UPDATE_STARTD_ADS message,
+	// appending the stored ads to ads; returns -1 if the message is bad
+	int collectStartdAds (Sock *, const condor_sockaddr&, std::vector<ClassAd *> &ads);
+
 	// lookup classad in the specified table with the given hashkey
 	ClassAd *lookup (AdTypes, AdNameHashKey &);
 
@@ -72,6 +81,29 @@ class CollectorEngine : public Service
 	// walk specified hash table with the given visit procedure
 	int walkHashTable (AdTypes, int (*)(ClassAd *));
 
+	// Pin the ads currently in the tables, so that ads removed or
+	// replaced from now on are not freed until unpinAds() is called
+	// with the value returned.  Lets a query look at the ads it
+	// found in snapshotAds() over several trips through the event loop.
+	unsigned int pinAds();
+	void unpinAds(unsigned int pin);
+
+	// append the ads of the given type to ads
+	int snapshotAds (AdTypes, std::vector<ClassAd *> &ads);
+
+	// index the larger ad tables on the given attributes
+	void setQueryIndexAttributes(const std::vector<std::string> &attrs);
+
+	// if an index can narrow down which ads of the given type might
+	// match filter, append those ads to ads and return true
+	bool indexedAds (AdTypes, classad::ExprTree *filter, std::vector<ClassAd *> &ads);
+
+	// re-index the ads after attr was changed in place in some of them
+	void reindexAttribute(const char *attr);
+
+	// re-index an ad in one of the tables after it was changed in place
+	void reindexAd(ClassAd *ad);
+
 	// register the collector's own ad pointer, and check to see if a given ad is that ad.
 	// this is used to allow us to recognise the collector ad during iteration and automatically
 	// insert fresh stats into it when it is fetched.
@@ -84,6 +116,9 @@ class CollectorEngine : public Service
 		// returns true on success; false on failure (and sets error_desc)
 	bool setCollectorRequirements( char const *str, MyString &error_desc );
 
+	// store startd ads as differences from a shared base ad per machine
+	void setShareStartdAttributes(bool share) { m_startdBaseAds.setEnabled(share); }
+
   private:
 	typedef bool (*HashFunc) (AdNameHashKey &, ClassAd *);
 
@@ -125,6 +160,9 @@ class CollectorEngine : public Service
 	// table for "generic" ad types
 	GenericAdHashTable GenericAds;
 
+	// the base ads the StartdAds share attributes with
+	CollectorBaseAds m_startdBaseAds;
+
 	// for walking through the generic hash tables
 	static int (*genericTableScanFunction)(ClassAd *);
 	static int genericTableWalker(CollectorHashTable *cht);
@@ -137,10 +175,40 @@ class CollectorEngine : public Service
 	void  housekeeper ();
 	int  housekeeperTimerID;
 	void cleanHashTable (CollectorHashTable &, time_t, HashFunc);
+	void purgeHashTable (CollectorHashTable &);
+
+	// free an ad that has been taken out of its table, or hold on to
+	// it until no pinned query could be looking at it
+	void releaseAd (ClassAd *ad);
+
+	// keep the query indexes in step with the tables; unindexAd() must
+	// be called before an ad leaves its table or is changed in place
+	void indexAd (CollectorHashTable &table, ClassAd *ad);
+	void unindexAd (CollectorHashTable &table, ClassAd *ad);
+	std::map<CollectorHashTable *, CollectorAdIndex> m_indexes;
+
+	// Stamp an ad with the next update generation.  Every change the
+	// collector makes to a stored ad gets a new one, so that clients
+	// can tell whether an ad changed even within the same second.
+	void stampUpdateGeneration (ClassAd *ad);
+	long long m_updateGeneration;
+
+	unsigned int m_pinSerial;
+	std::multiset<unsigned int> m_pins;
+	std::deque< std::pair<unsigned int, ClassAd *> > m_releasedAds;
 	ClassAd* updateClassAd(CollectorHashTable&,const char*, const char *,
 						   ClassAd*,AdNameHashKey&, const MyString &, int &, 
 						   const condor_sockaddr& );
 
+	ClassAd * applyStartdDelta (AdNameHashKey &hk,
+								const MyString &hashString,
+								ClassAd *delta_ad,
+								int &insert);
+
+	// ask a startd for a full update of a slot, and when we last did
+	void requestFullStartdUpdate (ClassAd *delta_ad, const MyString &hashString);
+	std::map<std::string, time_t> m_fullUpdateRequests;
+
 	ClassAd * mergeClassAd (CollectorHashTable &hashTable,
 							const char *adType,
 							const char *label,
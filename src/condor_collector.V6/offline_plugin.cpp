@@ -359,7 +359,15 @@ OfflineCollectorPlugin::update (
 	/* if it is off-line then add it to the list; otherwise,
 	   remove it. */
 	if ( offline > 0 ) {
-		persistentStoreAd(key,ad);
+		if ( ad.GetChainedParentAd() ) {
+				/* the collector may keep only the attributes that
+				   differ from a shared base ad; store all of them */
+			ClassAd flat;
+			flat.CopyFromChain( ad );
+			persistentStoreAd(key,flat);
+		} else {
+			persistentStoreAd(key,ad);
+		}
 	} else {
 		persistentRemoveAd(key);
 	}
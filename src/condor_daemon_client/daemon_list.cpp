@@ -287,6 +287,36 @@ CollectorList::sendUpdates (int cmd, ClassAd * ad1, ClassAd* ad2, bool nonblocki
 	return success_count;
 }
 
+int
+CollectorList::sendUpdates (int cmd, std::vector<ClassAd*> &ads, bool nonblocking) {
+	int success_count = 0;
+
+	if ( ! adSeq) {
+		adSeq = new DCCollectorAdSequences();
+	}
+
+	// advance the sequence numbers of all the public ads
+	//
+	time_t now = time(NULL);
+	for (size_t i = 0; i < ads.size(); i += 2) {
+		DCCollectorAdSeq * seqgen = adSeq->getAdSeq(*ads[i]);
+		if (seqgen) { seqgen->advance(now); }
+	}
+
+	this->rewind();
+	DCCollector * daemon;
+	while (this->next(daemon)) {
+		dprintf( D_FULLDEBUG, 
+				 "Trying to update collector %s\n", 
+				 daemon->addr() );
+		if( daemon->sendUpdates(cmd, ads, *adSeq, nonblocking) ) {
+			success_count++;
+		} 
+	}
+
+	return success_count;
+}
+
 QueryResult
 CollectorList::query (CondorQuery & cQuery, bool (*callback)(void*, ClassAd *), void* pv, CondorError * errstack) {
 
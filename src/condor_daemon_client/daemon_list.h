@@ -26,6 +26,7 @@
 #include "simplelist.h"
 #include "condor_classad.h"
 #include "condor_query.h"
+#include <vector>
 
 
 class DCCollector;
@@ -110,6 +111,10 @@ class CollectorList : public DaemonList {
 		// return - number of successfull updates
 	int sendUpdates (int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking);
 
+		// Send the public and private ads of several startd slots in
+		// one update; ads holds each public ad followed by its private ad
+	int sendUpdates (int cmd, std::vector<ClassAd*> &ads, bool nonblocking);
+
 		// use this to detach the ad sequence counters before destroying the collector list
 		// we do this when we want to move the sequence counters to a new list
 	DCCollectorAdSequences * detachAdSequences() { DCCollectorAdSequences * p = adSeq; adSeq = NULL; return p; }
@@ -214,6 +214,77 @@ DCCollector::sendUpdate( int cmd, ClassAd* ad1, DCCollectorAdSequences& adSeq, C
 		ad2->CopyAttribute(ATTR_MY_ADDRESS,ad1);
 	}
 
+	return sendAds( cmd, ad1, ad2, NULL, nonblocking );
+}
+
+
+bool
+DCCollector::sendUpdates( int cmd, std::vector<ClassAd*> &ads, DCCollectorAdSequences& adSeq, bool nonblocking )
+{
+	if( ! _is_configured ) {
+			// nothing to do, treat it as success...
+		return true;
+	}
+
+	if(!use_nonblocking_update || !daemonCore) {
+		nonblocking = false;
+	}
+
+	for( size_t i = 0; i + 1 < ads.size(); i += 2 ) {
+		ClassAd *public_ad = ads[i];
+		ClassAd *private_ad = ads[i+1];
+		public_ad->Assign(ATTR_DAEMON_START_TIME, startTime);
+		private_ad->Assign(ATTR_DAEMON_START_TIME, startTime);
+		DCCollectorAdSeq* seqgen = adSeq.getAdSeq(*public_ad);
+		if (seqgen) {
+			long long seq = seqgen->getSequence();
+			public_ad->Assign(ATTR_UPDATE_SEQUENCE_NUMBER, seq);
+			private_ad->Assign(ATTR_UPDATE_SEQUENCE_NUMBER, seq);
+		}
+		private_ad->CopyAttribute(ATTR_MY_ADDRESS,public_ad);
+	}
+
+		// Pull the attributes that every public ad has the same value
+		// for into the base ad, and send only the rest of each.
+	ClassAd base;
+	if( ! ads.empty() ) {
+		for( ClassAd::iterator itr = ads[0]->begin(); itr != ads[0]->end(); itr++ ) {
+			bool shared = true;
+			for( size_t i = 2; shared && i < ads.size(); i += 2 ) {
+				ExprTree *tree = ads[i]->Lookup(itr->first);
+				shared = tree && tree->SameAs(itr->second);
+			}
+			if( shared ) {
+				ExprTree *tree = itr->second->Copy();
+				base.Insert(itr->first, tree);
+			}
+		}
+	}
+	std::vector<ClassAd*> slot_ads;
+	for( size_t i = 0; i + 1 < ads.size(); i += 2 ) {
+		ClassAd *slot_ad = new ClassAd;
+		for( ClassAd::iterator itr = ads[i]->begin(); itr != ads[i]->end(); itr++ ) {
+			if( ! base.Lookup(itr->first) ) {
+				ExprTree *tree = itr->second->Copy();
+				slot_ad->Insert(itr->first, tree);
+			}
+		}
+		slot_ads.push_back(slot_ad);
+		slot_ads.push_back(ads[i+1]);
+	}
+
+	bool success = sendAds( cmd, &base, NULL, &slot_ads, nonblocking );
+
+	for( size_t i = 0; i < slot_ads.size(); i += 2 ) {
+		delete slot_ads[i];
+	}
+	return success;
+}
+
+
+bool
+DCCollector::sendAds( int cmd, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads, bool nonblocking )
+{
 		// We never want to try sending an update to port 0.  If we're
 		// about to try that, and we're trying to talk to a local
 		// collector, we should try re-reading the address file and
@@ -261,15 +332,15 @@ DCCollector::sendUpdate( int cmd, ClassAd* ad1, DCCollectorAdSequences& adSeq, C
 	}
 
 	if( use_tcp ) {
-		return sendTCPUpdate( cmd, ad1, ad2, nonblocking );
+		return sendTCPUpdate( cmd, ad1, ad2, slot_ads, nonblocking );
 	}
-	return sendUDPUpdate( cmd, ad1, ad2, nonblocking );
+	return sendUDPUpdate( cmd, ad1, ad2, slot_ads, nonblocking );
 }
 
 
 
 bool
-DCCollector::finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd* ad2 )
+DCCollector::finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads )
 {
 	// This is a static function so that we can call it from a
 	// nonblocking startCommand() callback without worrying about
@@ -283,6 +354,25 @@ DCCollector::finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd*
 		}
 		return false;
 	}
+	if( slot_ads ) {
+		int num_slots = (int)slot_ads->size() / 2;
+		if( ! sock->code(num_slots) ) {
+			if(self) {
+				self->newError( CA_COMMUNICATION_ERROR,
+				                "Failed to send slot count to collector" );
+			}
+			return false;
+		}
+		for( size_t i = 0; i < slot_ads->size(); i++ ) {
+			if( ! putClassAd(sock, *(*slot_ads)[i]) ) {
+				if(self) {
+					self->newError( CA_COMMUNICATION_ERROR,
+					                "Failed to send slot ClassAd to collector" );
+				}
+				return false;
+			}
+		}
+	}
 	if( ad2 && ! putClassAd(sock, *ad2) ) {
 		if(self) {
 			self->newError( CA_COMMUNICATION_ERROR,
@@ -308,15 +398,24 @@ private:
 public:
 	ClassAd *ad1;
 	ClassAd *ad2;
+	std::vector<ClassAd*> *slot_ads;
 	DCCollector *dc_collector;
 
-	UpdateData(int ad_cmd, Stream::stream_type stype, ClassAd *cad1, ClassAd *cad2, DCCollector *dc_collect)
+	UpdateData(int ad_cmd, Stream::stream_type stype, ClassAd *cad1, ClassAd *cad2, std::vector<ClassAd*> *slot_cads, DCCollector *dc_collect)
 	  : cmd(ad_cmd),
 	    sock_type(stype),
 	    ad1(cad1 ? new ClassAd(*cad1) : NULL),
 	    ad2(cad2 ? new ClassAd(*cad2) : NULL),
+	    slot_ads(NULL),
 	    dc_collector(dc_collect)
 	{
+		if (slot_cads) {
+			slot_ads = new std::vector<ClassAd*>;
+			for (size_t i = 0; i < slot_cads->size(); i++) {
+				slot_ads->push_back(new ClassAd(*(*slot_cads)[i]));
+			}
+		}
+
 			// In case the collector object gets destructed before this
 			// update is finished, we need to register ourselves with
 			// the dc_collector object so that it can null out our
@@ -329,6 +428,12 @@ public:
 	~UpdateData() {
 		delete ad1;
 		delete ad2;
+		if (slot_ads) {
+			for (size_t i = 0; i < slot_ads->size(); i++) {
+				delete (*slot_ads)[i];
+			}
+			delete slot_ads;
+		}
 			// Remove ourselves from the dc_collector's list.
 		if(dc_collector) {
 			std::deque<UpdateData *>::iterator iter = std::find(dc_collector->pending_update_list.begin(), dc_collector->pending_update_list.end(), this);
@@ -366,7 +471,7 @@ public:
 			if(sock) who = sock->get_sinful_peer();
 			dprintf(D_ALWAYS,"Failed to start non-blocking update to %s.\n",who);
 		}
-		else if(sock && !DCCollector::finishUpdate(ud->dc_collector,sock,ud->ad1,ud->ad2)) {
+		else if(sock && !DCCollector::finishUpdate(ud->dc_collector,sock,ud->ad1,ud->ad2,ud->slot_ads)) {
 			char const *who = "unknown";
 			if(sock) who = sock->get_sinful_peer();
 			dprintf(D_ALWAYS,"Failed to send non-blocking update to %s.\n",who);
@@ -404,7 +509,7 @@ public:
 					// I don't think mixing TCP/UDP to the same collector is supported, so
 					// I believe this shortcut acceptable.
 				if (!dc_collector->update_rsock->put( ud->cmd ) ||
-					!DCCollector::finishUpdate(ud->dc_collector,dc_collector->update_rsock,ud->ad1,ud->ad2))
+					!DCCollector::finishUpdate(ud->dc_collector,dc_collector->update_rsock,ud->ad1,ud->ad2,ud->slot_ads))
 				{
 					char const *who = "unknown";
 					if(dc_collector->update_rsock) {
@@ -437,7 +542,7 @@ public:
 };
 
 bool
-DCCollector::sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking )
+DCCollector::sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads, bool nonblocking )
 {
 		// with UDP it's pretty straight forward.  We always want to
 		// use Daemon::startCommand() so we get all the security stuff
@@ -457,7 +562,7 @@ DCCollector::sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 	}
 
 	if(nonblocking) {
-		UpdateData *ud = new UpdateData(cmd, Sock::safe_sock, ad1, ad2, this);
+		UpdateData *ud = new UpdateData(cmd, Sock::safe_sock, ad1, ad2, slot_ads, this);
 		if (this->pending_update_list.size() == 1)
 		{
 			startCommand_nonblocking(cmd, Sock::safe_sock, 20, NULL, UpdateData::startUpdateCallback, ud, NULL, raw_protocol );
@@ -472,7 +577,7 @@ DCCollector::sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 		return false;
 	}
 
-	bool success = finishUpdate( this, ssock, ad1, ad2 );
+	bool success = finishUpdate( this, ssock, ad1, ad2, slot_ads );
 	delete ssock;
 
 	return success;
@@ -480,7 +585,7 @@ DCCollector::sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 
 
 bool
-DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking )
+DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads, bool nonblocking )
 {
 	dprintf( D_FULLDEBUG,
 			 "Attempting to send update via TCP to collector %s\n",
@@ -496,7 +601,7 @@ DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 			// update at the same time.  if the security API changes
 			// in the future, we'll be able to make this code a little
 			// more straight-forward...
-		return initiateTCPUpdate( cmd, ad1, ad2, nonblocking );
+		return initiateTCPUpdate( cmd, ad1, ad2, slot_ads, nonblocking );
 	}
 
 		// otherwise, we've already got our socket, it's connected,
@@ -509,7 +614,7 @@ DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 		// int, and since we do *NOT* want to use startCommand() again
 		// on a cached TCP socket, just code the int ourselves...
 	update_rsock->encode();
-	if (update_rsock->put(cmd) && finishUpdate(this, update_rsock, ad1, ad2)) {
+	if (update_rsock->put(cmd) && finishUpdate(this, update_rsock, ad1, ad2, slot_ads)) {
 		return true;
 	}
 	dprintf( D_FULLDEBUG, 
@@ -517,20 +622,20 @@ DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 			 "starting new connection\n" );
 	delete update_rsock;
 	update_rsock = NULL;
-	return initiateTCPUpdate( cmd, ad1, ad2, nonblocking );
+	return initiateTCPUpdate( cmd, ad1, ad2, slot_ads, nonblocking );
 }
 
 
 
 bool
-DCCollector::initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking )
+DCCollector::initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads, bool nonblocking )
 {
 	if( update_rsock ) {
 		delete update_rsock;
 		update_rsock = NULL;
 	}
 	if(nonblocking) {
-		UpdateData *ud = new UpdateData(cmd, Sock::reli_sock, ad1, ad2, this);
+		UpdateData *ud = new UpdateData(cmd, Sock::reli_sock, ad1, ad2, slot_ads, this);
 			// Note that UpdateData automatically adds itself to the pending_update_list.
 		if (this->pending_update_list.size() == 1)
 		{
@@ -546,7 +651,7 @@ DCCollector::initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblo
 		return false;
 	}
 	update_rsock = (ReliSock *)sock;
-	return finishUpdate( this, update_rsock, ad1, ad2 );
+	return finishUpdate( this, update_rsock, ad1, ad2, slot_ads );
 }
 
 
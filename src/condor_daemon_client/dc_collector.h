@@ -31,6 +31,7 @@
 
 #include <deque>
 #include <map>
+#include <vector>
 
 // This holds a single update ad sequence number
 //
@@ -95,6 +96,14 @@ public:
 		*/
 	bool sendUpdate( int cmd, ClassAd* ad1, DCCollectorAdSequences& seq, ClassAd* ad2, bool nonblocking );
 
+		/** Send the ads of several startd slots in one update.  ads
+			holds each slot's public ad followed by its private ad.
+			The attributes all the public ads have in common are sent
+			once, in a base ad, followed by the number of slots and
+			the rest of each slot's public ad and its private ad.
+		*/
+	bool sendUpdates( int cmd, std::vector<ClassAd*> &ads, DCCollectorAdSequences& seq, bool nonblocking );
+
 	void reconfig( void );
 
 	const char* updateDestination( void );
@@ -121,15 +130,16 @@ private:
 	std::deque<class UpdateData*> pending_update_list;
 	friend class UpdateData;
 
-	bool sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking );
-	bool sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking );
+	bool sendAds( int cmd, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads, bool nonblocking );
+	bool sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads, bool nonblocking );
+	bool sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads, bool nonblocking );
 
-	static bool finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd* ad2 );
+	static bool finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads );
 
 	void parseTCPInfo( void );
 	void initDestinationStrings( void );
 
-	bool initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking );
+	bool initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, std::vector<ClassAd*> *slot_ads, bool nonblocking );
 
 	char* update_destination;
 
@@ -473,6 +473,10 @@ DCStartd::activateClaim( ClassAd* job_ad, int starter_version,
 			 "successfully sent command, reply is: %d\n", reply ); 
 
 	if( reply == OK && claim_sock_ptr ) {
+			// The startd hands this socket to the starter, which
+			// starts with empty ClassAd name dictionaries, so start
+			// ours over too.
+		tmp->set_classad_state(NULL);
 		*claim_sock_ptr = (ReliSock*)tmp;
 	} else {
 			// in any other case, we're going to leak this ReliSock
@@ -67,6 +67,7 @@
 
 #include "../condor_procd/proc_family_io.h"
 class ProcFamilyInterface;
+class Selector;
 
 #if defined(WIN32)
 #include "pipe.WINDOWS.h"
@@ -416,6 +417,31 @@ class DaemonCore : public Service
     */
     int Cancel_Command (int command);
 
+	/** Mark a registered command's handler as safe to run on a thread
+		from the worker pool (THREAD_WORKER_POOL_SIZE) without the big
+		lock, in parallel with other such handlers and with DaemonCore
+		accepting connections and authenticating them.  While it runs,
+		the handler holds the daemon state lock shared (see
+		CondorThreads::lock_state_exclusive()), and DaemonCore holds it
+		exclusively around every other command, socket, pipe, timer,
+		signal and reaper handler, so the daemon's state will not change
+		under it.  In return the handler must only read that state: it
+		must not call into DaemonCore (Register_*, Cancel_*, GetDataPtr()
+		and friends), must not return KEEP_STREAM, and must use
+		CondorThreads::lock_state_readers() around anything it shares
+		with other such handlers, such as statistics or ClassAd caches
+		(use getClassAdNoCache()).  dprintf() and the handler's own
+		stream are safe.  A handler that waits on its client may let go
+		of the state lock meanwhile with unlock_state_shared(), as long
+		as it takes it back before returning and forgets any pointers
+		into the daemon's state.  Without a pool, or when called from within
+		another handler, the handler runs as usual.
+		@param command The command, already registered
+		@param thread_safe Whether its handler follows the rules above
+		@return false if the command is not registered
+	*/
+	bool Set_Command_Thread_Safe (int command, bool thread_safe = true);
+
     /** Gives the port of the DaemonCore
 		command socket of this process.
         @return The port number, or -1 on error */
@@ -1510,10 +1536,20 @@ class DaemonCore : public Service
 		   @param ad2 The secondary ClassAd to send. Usually NULL,
 		     except in the case of startds sending the "private" ad.
 		   @param nonblock Should the update use non-blocking communication.
+		   @param policy_ad The ad to evaluate DAEMON_SHUTDOWN in, if
+		     ad1 only holds part of the daemon's ad (a delta update).
 		   @return The number of successful updates that were sent.
 		*/
 	int sendUpdates(int cmd, ClassAd* ad1, ClassAd* ad2 = NULL,
-					bool nonblock = false);
+					bool nonblock = false, ClassAd* policy_ad = NULL);
+
+		/**
+		   As above, but send the public and private ads of several
+		   startd slots in one message.  ads holds each slot's
+		   public ad followed by its private ad.  DAEMON_SHUTDOWN is
+		   evaluated in the first public ad.
+		*/
+	int sendUpdates(int cmd, std::vector<ClassAd*> &ads, bool nonblock = false);
 
 	DCCollectorAdSequences & getUpdateAdSeq() { return m_collector_list->getAdSeq(); }
 
@@ -1825,6 +1861,7 @@ class DaemonCore : public Service
         void*           data_ptr;
         int             dprintf_flag;
 		int             wait_for_payload;
+		bool            thread_safe;
     };
 
     void                DumpCommandTable(int, const char* = NULL);
@@ -1873,6 +1910,8 @@ class DaemonCore : public Service
 		HandlerType		handler_type;
 		int				servicing_tid;	// tid servicing this socket
 		bool            is_command_sock;
+		unsigned int	selector_key;	// identifies this registration to the Selector
+		int				watched_fd;		// fd the epoll Selector watches for us, or -1
     };
     void              DumpSocketTable(int, const char* = NULL);
     int               maxSocket;  // number of socket handlers to start with
@@ -1880,6 +1919,19 @@ class DaemonCore : public Service
 	int				  nRegisteredSocks; // number of sockets registered, always < nSock
 	int               nPendingSockets; // number of sockets waiting on timers or any other callbacks
     ExtArray<SockEnt> *sockTable; // socket table; grows dynamically if needed
+		// keys 0 and 1 are taken: 0 means no key, and 1 is the async_pipe's
+	unsigned int      m_next_selector_key;
+	unsigned int      nextSelectorKey();
+		// With DAEMON_CORE_USE_EPOLL, the Selector in Driver(), which
+		// watches the fds of the registered sockets and pipes from one
+		// trip through the loop to the next; otherwise NULL.  Whatever
+		// changes whether an entry should be watched calls WatchSocket()
+		// or WatchPipe() to bring the Selector up to date.
+	Selector         *m_epoll_selector;
+	std::vector<int>  m_watched_socks;	// by fd: index into sockTable, or -1
+	std::vector<int>  m_watched_pipes;	// by fd: index into pipeTable, or -1
+	void              WatchSocket( int i, bool new_fd = false );
+	void              WatchPipe( int i );
   	struct soap		  *soap;
 
 		// number of file descriptors in use past which we should start
@@ -1918,6 +1970,8 @@ class DaemonCore : public Service
         bool            is_cpp;
 		bool			call_handler;
 		bool			in_handler;
+		unsigned int	selector_key;	// identifies this registration to the Selector
+		int				watched_fd;		// fd the epoll Selector watches for us, or -1
     };
     // void              DumpPipeTable(int, const char* = NULL);
     int               maxPipe;  // number of pipe handlers to start with
@@ -2145,6 +2199,10 @@ class DaemonCore : public Service
 	bool evalExpr( ClassAd* ad, const char* param_name,
 				   const char* attr_name, const char* message );
 
+		// Evaluate DAEMON_SHUTDOWN and DAEMON_SHUTDOWN_FAST in ad,
+		// and start shutting down if either is TRUE.
+	void evalShutdownExprs( ClassAd* ad );
+
 	CollectorList* m_collector_list;
 
 		/**
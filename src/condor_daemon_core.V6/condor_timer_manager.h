@@ -40,6 +40,9 @@
 #include <sys/time.h>
 #endif
 
+#include <vector>
+#include <map>
+
 const   int     STAR = -1;
 
 //-----------------------------------------------------------------------------
@@ -84,7 +87,8 @@ struct tagTimer {
     /** Not_Yet_Documented */ TimerHandler             handler;
     /** Not_Yet_Documented */ TimerHandlercpp          handlercpp;
     /** Not_Yet_Documented */ class Service*    service; 
-    /** Not_Yet_Documented */ struct tagTimer*  next;
+    /** Position in the timer heap */ int       heap_index;
+    /** Orders timers with the same when */ unsigned long long insert_seq;
     /** Not_Yet_Documented */ char*             event_descrip;
     /** Not_Yet_Documented */ void*             data_ptr;
     /** Not_Yet_Documented */ Timeslice *       timeslice;
@@ -247,19 +251,29 @@ class TimerManager
                   unsigned   period          =  0,
 				  const Timeslice *timeslice = NULL);
 
-	void RemoveTimer( Timer *timer, Timer *prev );
+	void RemoveTimer( Timer *timer );
 	void InsertTimer( Timer *new_timer );
 	void DeleteTimer( Timer *timer );
 
 	/*
 	  @param id The id of the timer to find
-	  @param prev If not NULL, this will be set to previous timer in list
 	  @return pointer to timer with specified id or NULL if not found
 	 */
-	Timer *GetTimer( int id, Timer **prev );
-
-    Timer*  timer_list;
-	Timer*  list_tail;
+	Timer *GetTimer( int id );
+
+	// The timers are kept in a binary heap ordered on when (and then
+	// on the order they were inserted, so that timers due at the same
+	// time take turns), so that inserting, resetting and cancelling a
+	// timer takes O(log n).  timer_heap[0] is the next timer to fire.
+	static bool TimerBefore( const Timer *a, const Timer *b );
+	void HeapUp( size_t pos );
+	void HeapDown( size_t pos );
+	void HeapSet( size_t pos, Timer *timer );
+	Timer *FirstTimer() { return timer_heap.empty() ? NULL : timer_heap[0]; }
+
+	std::vector<Timer*> timer_heap;
+	std::map<int, Timer*> timer_by_id;
+	unsigned long long insert_seq;
     int     timer_ids;
     Timer*  in_timeout;
     bool    did_reset;
@@ -118,6 +118,8 @@ CRITICAL_SECTION Big_fat_mutex; // coarse grained mutex for debugging purposes
 
 #include "systemd_manager.h"
 
+#include <algorithm>
+
 static const char* EMPTY_DESCRIP = "<NULL>";
 
 // special errno values that may be returned from Create_Process
@@ -323,8 +325,11 @@ DaemonCore::DaemonCore(int PidSize, int ComSize,int SigSize,
 	}
 	nSock = 0;
 	nPendingSockets = 0;
+	m_next_selector_key = 2;
+	m_epoll_selector = NULL;
 	SockEnt blankSockEnt;
 	memset(&blankSockEnt,'\0',sizeof(SockEnt));
+	blankSockEnt.watched_fd = -1;
 	sockTable->fill(blankSockEnt);
 
 #ifdef HAVE_EXT_GSOAP
@@ -352,6 +357,7 @@ DaemonCore::DaemonCore(int PidSize, int ComSize,int SigSize,
 	PipeEnt blankPipeEnt;
 	memset(&blankPipeEnt,'\0',sizeof(PipeEnt));
 	blankPipeEnt.index = -1;
+	blankPipeEnt.watched_fd = -1;
 	pipeTable->fill(blankPipeEnt);
 
 	pipeHandleTable = new ExtArray<PipeHandle>(maxPipe);
@@ -1055,6 +1061,7 @@ int DaemonCore::Register_Command(int command, const char* command_descrip,
 	comTable[i].data_ptr = NULL;
 	comTable[i].dprintf_flag = dprintf_flag;
 	comTable[i].wait_for_payload = wait_for_payload;
+	comTable[i].thread_safe = false;
 	free(comTable[i].command_descrip);
 	if ( command_descrip )
 		comTable[i].command_descrip = strdup(command_descrip);
@@ -1104,6 +1111,16 @@ int DaemonCore::Cancel_Command( int command )
 	return FALSE;
 }
 
+bool DaemonCore::Set_Command_Thread_Safe( int command, bool thread_safe )
+{
+	int index = 0;
+	if ( !CommandNumToTableIndex(command,&index) ) {
+		return false;
+	}
+	comTable[index].thread_safe = thread_safe;
+	return true;
+}
+
 int DaemonCore::InfoCommandPort()
 {
 	if ( initial_command_sock() == -1 ) {
@@ -1823,6 +1840,9 @@ int DaemonCore::Register_Socket(Stream *iosock, const char* iosock_descrip,
 	// Update curr_regdataptr for SetDataPtr()
 	curr_regdataptr = &((*sockTable)[i].data_ptr);
 
+	// Watch it afresh, since a re-registration may want other events
+	WatchSocket( i, true );
+
 	// Conditionally dump what our table looks like
 	DumpSocketTable(D_FULLDEBUG | D_DAEMONCORE);
 
@@ -1878,6 +1898,7 @@ int DaemonCore::Cancel_Socket( Stream* insock, void *prev_entry)
 				i,(*sockTable)[i].iosock_descrip, (*sockTable)[i].iosock );
 		// Remove entry; mark it is available for next add via iosock=NULL
 		(*sockTable)[i].iosock = NULL;
+		WatchSocket( i );
 		free( (*sockTable)[i].iosock_descrip );
 		(*sockTable)[i].iosock_descrip = NULL;
 		free( (*sockTable)[i].handler_descrip );
@@ -1887,6 +1908,9 @@ int DaemonCore::Cancel_Socket( Stream* insock, void *prev_entry)
 			((SockEnt*)prev_entry)->servicing_tid = (*sockTable)[i].servicing_tid;
 			(*sockTable)[i] = *(SockEnt*)prev_entry;
 			free( prev_entry );
+				// the saved entry's watch was replaced by ours
+			(*sockTable)[i].watched_fd = -1;
+			WatchSocket( i );
 		} else {
 			if ( i == nSock - 1 ) {
 				nSock--;
@@ -1897,6 +1921,7 @@ int DaemonCore::Cancel_Socket( Stream* insock, void *prev_entry)
 		dprintf(D_DAEMONCORE,"Cancel_Socket: deferred cancel socket %d <%s> %p\n",
 				i,(*sockTable)[i].iosock_descrip, (*sockTable)[i].iosock );
 		(*sockTable)[i].remove_asap = true;
+		WatchSocket( i );
 	}
 
 	if ( !prev_entry ) {
@@ -2202,6 +2227,8 @@ int DaemonCore::Register_Pipe(int pipe_end, const char* pipe_descrip,
 	// Update curr_regdataptr for SetDataPtr()
 	curr_regdataptr = &((*pipeTable)[i].data_ptr);
 
+	WatchPipe( i );
+
 #ifndef WIN32
 	// On Unix, pipe fds are given to select.  So
 	// if we are a worker thread, wake up select in the main thread
@@ -2275,6 +2302,7 @@ int DaemonCore::Cancel_Pipe( int pipe_end )
 
 	// Remove entry, move the last one in the list into this spot
 	(*pipeTable)[i].index = -1;
+	WatchPipe( i );
 	free( (*pipeTable)[i].pipe_descrip );
 	(*pipeTable)[i].pipe_descrip = NULL;
 	free( (*pipeTable)[i].handler_descrip );
@@ -2317,6 +2345,10 @@ int DaemonCore::Cancel_Pipe( int pipe_end )
 		(*pipeTable)[nPipe - 1].pipe_descrip = NULL;
 		(*pipeTable)[nPipe - 1].handler_descrip = NULL;
 		(*pipeTable)[nPipe - 1].pentry = NULL;
+		(*pipeTable)[nPipe - 1].watched_fd = -1;
+		if ( (*pipeTable)[i].watched_fd != -1 ) {
+			m_watched_pipes[(*pipeTable)[i].watched_fd] = i;
+		}
 	}
 	nPipe--;
 
@@ -3286,11 +3318,135 @@ DaemonCore::Do_Wake_up_select()
 	return fSuccess;
 }
 
+unsigned int
+DaemonCore::nextSelectorKey()
+{
+	unsigned int key = m_next_selector_key++;
+	if ( m_next_selector_key == 0 ) {
+		m_next_selector_key = 2;
+	}
+	return key;
+}
+
+	// Bring the epoll Selector's watch on entry i of the socket table
+	// up to date.  Pass new_fd if the socket may have a new descriptor
+	// under the same fd number, e.g. after a connect retry.
+void
+DaemonCore::WatchSocket( int i, bool new_fd )
+{
+	if ( ! m_epoll_selector ) {
+		return;
+	}
+
+	SockEnt &ent = (*sockTable)[i];
+	int fd = -1;
+	if ( ent.iosock && ent.servicing_tid == 0 && ! ent.remove_asap &&
+		 ! ent.is_reverse_connect_pending )
+	{
+		fd = ent.iosock->get_file_desc();
+	}
+	if ( fd == ent.watched_fd && ! new_fd ) {
+		return;
+	}
+
+	if ( ent.watched_fd != -1 ) {
+		m_epoll_selector->unwatch_fd( ent.watched_fd, ent.selector_key );
+		if ( m_watched_socks[ent.watched_fd] == i ) {
+			m_watched_socks[ent.watched_fd] = -1;
+		}
+		ent.watched_fd = -1;
+	}
+	if ( fd == -1 ) {
+		return;
+	}
+
+		// a new key each time, so the Selector doesn't trust a kernel
+		// registration left from a descriptor that has since been closed
+	ent.selector_key = nextSelectorKey();
+	if ( ent.is_connect_pending ) {
+			// see Driver() for why these two
+		m_epoll_selector->watch_fd( fd, Selector::IO_WRITE, ent.selector_key );
+		m_epoll_selector->watch_fd( fd, Selector::IO_EXCEPT, ent.selector_key );
+	} else {
+		switch( ent.handler_type ) {
+		case HANDLE_READ:
+			m_epoll_selector->watch_fd( fd, Selector::IO_READ, ent.selector_key );
+			break;
+		case HANDLE_WRITE:
+			m_epoll_selector->watch_fd( fd, Selector::IO_WRITE, ent.selector_key );
+			break;
+		case HANDLE_READ_WRITE:
+			m_epoll_selector->watch_fd( fd, Selector::IO_READ, ent.selector_key );
+			m_epoll_selector->watch_fd( fd, Selector::IO_WRITE, ent.selector_key );
+			break;
+		}
+	}
+	if ( (size_t)fd >= m_watched_socks.size() ) {
+		m_watched_socks.resize( fd + 1, -1 );
+	}
+	m_watched_socks[fd] = i;
+	ent.watched_fd = fd;
+}
+
+	// Bring the epoll Selector's watch on entry i of the pipe table
+	// up to date.
+void
+DaemonCore::WatchPipe( int i )
+{
+#if !defined(WIN32)
+	if ( ! m_epoll_selector ) {
+		return;
+	}
+
+	PipeEnt &ent = (*pipeTable)[i];
+	int fd = -1;
+	if ( ent.index != -1 ) {
+		fd = (*pipeHandleTable)[ent.index];
+	}
+	if ( fd == ent.watched_fd ) {
+		return;
+	}
+
+	if ( ent.watched_fd != -1 ) {
+		m_epoll_selector->unwatch_fd( ent.watched_fd, ent.selector_key );
+		if ( m_watched_pipes[ent.watched_fd] == i ) {
+			m_watched_pipes[ent.watched_fd] = -1;
+		}
+		ent.watched_fd = -1;
+	}
+	if ( fd == -1 ) {
+		return;
+	}
+
+	ent.selector_key = nextSelectorKey();
+	switch( ent.handler_type ) {
+	case HANDLE_READ:
+		m_epoll_selector->watch_fd( fd, Selector::IO_READ, ent.selector_key );
+		break;
+	case HANDLE_WRITE:
+		m_epoll_selector->watch_fd( fd, Selector::IO_WRITE, ent.selector_key );
+		break;
+	case HANDLE_READ_WRITE:
+		m_epoll_selector->watch_fd( fd, Selector::IO_READ, ent.selector_key );
+		m_epoll_selector->watch_fd( fd, Selector::IO_WRITE, ent.selector_key );
+		break;
+	}
+	if ( (size_t)fd >= m_watched_pipes.size() ) {
+		m_watched_pipes.resize( fd + 1, -1 );
+	}
+	m_watched_pipes[fd] = i;
+	ent.watched_fd = fd;
+#else
+	(void)i;
+#endif
+}
+
 // This function never returns. It is responsible for monitor signals and
 // incoming messages or requests and invoke corresponding handlers.
 void DaemonCore::Driver()
 {
 	Selector	selector;
+	Selector	recheck_selector;
 	int			i;
 	int			tmpErrno;
 	time_t		timeout;
@@ -3312,6 +3468,31 @@ void DaemonCore::Driver()
 	char asyncpipe_buf[10];
 #endif
 
+		// With epoll, the kernel remembers the descriptors from one
+		// trip through the loop to the next, so a daemon with many
+		// idle sockets doesn't pass them all to select() each time.
+		// Register_Socket(), Cancel_Socket() and friends keep the
+		// selector's watches up to date from here on, and we only look
+		// at the sockets and pipes it reports ready.
+	std::vector<int> ready_socks;
+	if ( param_boolean( "DAEMON_CORE_USE_EPOLL", false ) ) {
+		if ( selector.use_epoll() ) {
+			dprintf( D_FULLDEBUG, "DaemonCore: using epoll\n" );
+			m_epoll_selector = &selector;
+			for ( i = 0; i < nSock; i++ ) {
+				WatchSocket( i );
+			}
+			for ( i = 0; i < nPipe; i++ ) {
+				WatchPipe( i );
+			}
+#ifdef WIN32
+			selector.watch_fd( async_pipe[0].get_file_desc(), Selector::IO_READ, 1 );
+#else
+			selector.watch_fd( async_pipe[0], Selector::IO_READ, 1 );
+#endif
+		}
+	}
+
 	if ( param_boolean( "ENABLE_STDOUT_TESTING", false ) )
 	{
 		dprintf( D_ALWAYS, "Testing stdout & stderr\n" );
@@ -3360,6 +3541,15 @@ void DaemonCore::Driver()
 
 		// call signal handlers for any pending signals
 		sent_signal = FALSE;	// set to True inside Send_Signal()
+		bool signal_pending = false;
+		for (i=0;i<nSig && !signal_pending;i++) {
+			signal_pending = sigTable[i].is_pending && !sigTable[i].is_blocked;
+		}
+		if ( signal_pending ) {
+				// Waiting for the daemon state lock gives up the big
+				// lock, so take it before touching the signal table
+				// or curr_dataptr.
+			ExclusiveStateAccess state_access;
 			for (i=0;i<nSig;i++) {
 				if ( sigTable[i].handler || sigTable[i].handlercpp ) {
 					// found a valid entry; test if we should call handler
@@ -3391,6 +3581,7 @@ void DaemonCore::Driver()
 					}
 				}
 			}
+		}
 
 #ifndef WIN32
 		// clear the async_pipe_signal flag before we empty to the pipe
@@ -3446,7 +3637,9 @@ void DaemonCore::Driver()
 
 		// Setup what socket descriptors to select on.  We recompute this
 		// every time because 1) some timeout handler may have removed/added
-		// sockets, and 2) it ain't that expensive....
+		// sockets, and 2) it ain't that expensive....  In epoll mode
+		// the selector already has them, but the sockets' deadlines are
+		// set behind our back, so we still look for the soonest one.
 		selector.reset();
 		min_deadline = 0;
 		for (i = 0; i < nSock; i++) {
@@ -3468,6 +3661,9 @@ void DaemonCore::Driver()
 					// because that is all taken care of by CCBClient.
 					continue;
 				}
+				else if ( m_epoll_selector ) {
+					// already watched
+				}
 				else if ( (*sockTable)[i].is_connect_pending ) {
 						// we want to be woken when a non-blocking
 						// connect is ready to write.  when connect
@@ -3513,7 +3709,7 @@ void DaemonCore::Driver()
 #if !defined(WIN32)
 		// Add the registered pipe fds into the list of descriptors to
 		// select on.
-		for (i = 0; i < nPipe; i++) {
+		for (i = 0; i < nPipe && ! m_epoll_selector; i++) {
 			if ( (*pipeTable)[i].index != -1 ) {	// if a valid entry....
 				int pipefd = (*pipeHandleTable)[(*pipeTable)[i].index];
 				switch( (*pipeTable)[i].handler_type ) {
@@ -3540,9 +3736,13 @@ void DaemonCore::Driver()
 		if ( ! async_pipe[0].is_connected()) {
 			EXCEPT("DaemonCore:: async_pipe has been unexpectedly closed!");
 		} 
-		selector.add_fd( async_pipe[0].get_file_desc() , Selector::IO_READ );
+		if ( ! m_epoll_selector ) {
+			selector.add_fd( async_pipe[0].get_file_desc() , Selector::IO_READ );
+		}
 #else
-		selector.add_fd( async_pipe[0], Selector::IO_READ );
+		if ( ! m_epoll_selector ) {
+			selector.add_fd( async_pipe[0], Selector::IO_READ );
+		}
 #endif
 
 		// Let other threads run while we are waiting on select
@@ -3687,8 +3887,44 @@ void DaemonCore::Driver()
 				dprintf(D_ALWAYS,"Received a superuser command\n");
 			}
 
-			// scan through the socket table to find which ones select() set
-			for(i = 0; i < nSock; i++) {
+			// scan through the socket table to find which ones select() set.
+			// in epoll mode, look only at the ones the selector reported
+			// ready, and at the rest only if one of them may have timed out.
+			bool pipe_ready = false;
+			int num_socks = nSock;
+			if ( m_epoll_selector ) {
+				ready_socks.clear();
+				const std::vector<int> &ready_fds = selector.ready_fds();
+				for ( size_t r = 0; r < ready_fds.size(); r++ ) {
+					int fd = ready_fds[r];
+					if ( (size_t)fd < m_watched_socks.size() && m_watched_socks[fd] != -1 ) {
+						ready_socks.push_back( m_watched_socks[fd] );
+					}
+#if !defined(WIN32)
+					else if ( (size_t)fd < m_watched_pipes.size() && m_watched_pipes[fd] != -1 ) {
+						(*pipeTable)[m_watched_pipes[fd]].call_handler = true;
+						pipe_ready = true;
+					}
+#endif
+				}
+				if ( min_deadline && min_deadline < now ) {
+					for ( i = 0; i < nSock; i++ ) {
+						if ( (*sockTable)[i].iosock &&
+							 (*sockTable)[i].iosock->get_deadline() &&
+							 (*sockTable)[i].iosock->get_deadline() < now )
+						{
+							ready_socks.push_back( i );
+						}
+					}
+				}
+					// call the handlers in table order, as select() would
+				std::sort( ready_socks.begin(), ready_socks.end() );
+				ready_socks.erase( std::unique( ready_socks.begin(), ready_socks.end() ),
+								   ready_socks.end() );
+				num_socks = (int)ready_socks.size();
+			}
+			for(int n = 0; n < num_socks; n++) {
+				i = m_epoll_selector ? ready_socks[n] : n;
 				if ( (*sockTable)[i].iosock && 
 					 (*sockTable)[i].servicing_tid==0 &&
 					 (*sockTable)[i].remove_asap == false ) 
@@ -3728,6 +3964,10 @@ void DaemonCore::Driver()
 							      do_connect_finish() != CEDAR_EWOULDBLOCK)
 							{
 								(*sockTable)[i].call_handler = true;
+							} else {
+									// the connect may have been retried
+									// on a new fd
+								WatchSocket( i, true );
 							}
 						}
 					} else if ((*sockTable)[i].handler_type == HANDLE_READ || (*sockTable)[i].handler_type == HANDLE_READ_WRITE) {
@@ -3751,7 +3991,7 @@ void DaemonCore::Driver()
 			group_runtime = runtime;
 
 			// scan through the pipe table to find which ones select() set
-			for(i = 0; i < nPipe; i++) {
+			for(i = 0; i < nPipe && ! m_epoll_selector; i++) {
 				if ( (*pipeTable)[i].index != -1 ) {	// if a valid entry...
 					// figure out if we should call a handler.
 					(*pipeTable)[i].call_handler = false;
@@ -3775,13 +4015,21 @@ void DaemonCore::Driver()
 						(*pipeTable)[i].call_handler = true;
 					}
 #endif
+					if ( (*pipeTable)[i].call_handler ) {
+						pipe_ready = true;
+					}
 				}	// end of if valid pipe entry
 			}	// end of for loop through all pipe entries
 
 
 			// Now loop through all pipe entries, calling handlers if required.
+			// Waiting for the daemon state lock gives up the big lock, so
+			// take it before touching the pipe table or curr_dataptr.
+			if ( pipe_ready ) {
+				CondorThreads::lock_state_exclusive();
+			}
 			runtime = _condor_debug_get_time_double();
-			for(i = 0; i < nPipe; i++) {
+			for(i = 0; i < nPipe && pipe_ready; i++) {
 				if ( (*pipeTable)[i].index != -1 ) {	// if a valid entry...
 
 					if ( (*pipeTable)[i].call_handler ) {
@@ -3817,11 +4065,11 @@ void DaemonCore::Driver()
 #else
 							// UNIX
 							int pipefd = (*pipeHandleTable)[(*pipeTable)[i].index];
-							selector.reset();
-							selector.set_timeout( 0 );
-							selector.add_fd( pipefd, Selector::IO_READ );
-							selector.execute();
-							if ( selector.timed_out() ) {
+							recheck_selector.reset();
+							recheck_selector.set_timeout( 0 );
+							recheck_selector.add_fd( pipefd, Selector::IO_READ );
+							recheck_selector.execute();
+							if ( recheck_selector.timed_out() ) {
 								// nothing available, try the next entry...
 								continue;
 							}
@@ -3888,6 +4136,9 @@ void DaemonCore::Driver()
 					}	// if call_handler is True
 				}	// if valid entry in pipeTable
 			}	// for 0 thru nPipe checking if call_handler is true
+			if ( pipe_ready ) {
+				CondorThreads::unlock_state_exclusive();
+			}
 
 
 			runtime = _condor_debug_get_time_double();
@@ -3895,7 +4146,11 @@ void DaemonCore::Driver()
 			group_runtime = runtime;
 
 			// Now loop through all sock entries, calling handlers if required.
-			for(i = 0; i < nSock; i++) {
+			if ( ! m_epoll_selector ) {
+				num_socks = nSock;
+			}
+			for(int n = 0; n < num_socks; n++) {
+				i = m_epoll_selector ? ready_socks[n] : n;
 				if ( (*sockTable)[i].iosock ) {	// if a valid entry...
 
 					if ( (*sockTable)[i].call_handler ) {
@@ -3912,13 +4167,13 @@ void DaemonCore::Driver()
 							// read on the pipe could block?  to prevent this, we need
 							// to check one more time to make certain the pipe is ready
 							// for reading.
-							selector.reset();
-							selector.set_timeout( 0 );// set timeout for a poll
-							selector.add_fd( (*sockTable)[i].iosock->get_file_desc(),
+							recheck_selector.reset();
+							recheck_selector.set_timeout( 0 );// set timeout for a poll
+							recheck_selector.add_fd( (*sockTable)[i].iosock->get_file_desc(),
 											 Selector::IO_READ );
 
-							selector.execute();
-							if ( selector.timed_out() ) {
+							recheck_selector.execute();
+							if ( recheck_selector.timed_out() ) {
 								// nothing available, try the next entry...
 								continue;
 							}
@@ -4072,6 +4327,10 @@ DaemonCore::CallSocketHandler( int &i, bool default_to_HandleCommand )
 	    }
 	    CondorThreads::pool_add(DaemonCore::CallSocketHandler_worker_demarshall,args,
 								    pTid,(*sockTable)[i].handler_descrip);
+	    if ( set_service_tid ) {
+		    // stop watching it while a worker thread has it
+		    WatchSocket( i );
+	    }
 
     }
 }
@@ -4101,9 +4360,6 @@ DaemonCore::CallSocketHandler_worker( int i, bool default_to_HandleCommand, Stre
 		// request number and calls any registered command
 		// handler.
 
-		// Update curr_dataptr for GetDataPtr()
-	curr_dataptr = &( (*sockTable)[i].data_ptr);
-
 		// log a message
 	if ( (*sockTable)[i].handler || (*sockTable)[i].handlercpp )
 	{
@@ -4119,6 +4375,13 @@ DaemonCore::CallSocketHandler_worker( int i, bool default_to_HandleCommand, Stre
 			handler_start_time = _condor_debug_get_time_double();
 		}
 
+			// Waiting for the daemon state lock gives up the big
+			// lock, so take it before setting curr_dataptr.
+		CondorThreads::lock_state_exclusive();
+
+			// Update curr_dataptr for GetDataPtr()
+		curr_dataptr = &( (*sockTable)[i].data_ptr);
+
 	if ( (*sockTable)[i].handler ) {
 			// a C handler
 		result = (*( (*sockTable)[i].handler))( (*sockTable)[i].service, (*sockTable)[i].iosock);
@@ -4127,6 +4390,10 @@ DaemonCore::CallSocketHandler_worker( int i, bool default_to_HandleCommand, Stre
 		result = ((*sockTable)[i].service->*( (*sockTable)[i].handlercpp))((*sockTable)[i].iosock);
 		}
 
+			// Clear curr_dataptr
+		curr_dataptr = NULL;
+		CondorThreads::unlock_state_exclusive();
+
 		if (IsDebugLevel(D_COMMAND)) {
 			double handler_time = _condor_debug_get_time_double() - handler_start_time;
 			dprintf(D_COMMAND, "Return from Handler <%s> %.6fs\n", handlerName, handler_time);
@@ -4149,9 +4416,6 @@ DaemonCore::CallSocketHandler_worker( int i, bool default_to_HandleCommand, Stre
 		// Make sure we didn't leak our priv state
 	CheckPrivState();
 
-		// Clear curr_dataptr
-	curr_dataptr = NULL;
-
 		// Check result from socket handler, and if
 		// not KEEP_STREAM, then
 		// delete the socket and the socket handler.
@@ -4172,6 +4436,7 @@ DaemonCore::CallSocketHandler_worker( int i, bool default_to_HandleCommand, Stre
 		{
 				(*sockTable)[i].servicing_tid = 0;
 				// need to potentially add this sock to select
+				WatchSocket( i );
 				daemonCore->Wake_up_select();	
 		}
 	}
@@ -4276,14 +4541,17 @@ DaemonCore::CallUnregisteredCommandHandler(int req, Stream *stream)
 
 	handler_start_time = _condor_debug_get_time_double();
 
-	// call the handler function; first curr_dataptr for GetDataPtr()
-	curr_dataptr = &(m_unregisteredCommand.data_ptr);
-
 	int result = FALSE;
-	if ( m_unregisteredCommand.handlercpp )
+	if ( m_unregisteredCommand.handlercpp ) {
+		ExclusiveStateAccess state_access;
+
+		// call the handler function; first curr_dataptr for GetDataPtr()
+		curr_dataptr = &(m_unregisteredCommand.data_ptr);
+
 		result = (m_unregisteredCommand.service->*(m_unregisteredCommand.handlercpp))(req,stream);
 
-	curr_dataptr = NULL;
+		curr_dataptr = NULL;
+	}
 
 	double handler_time = _condor_debug_get_time_double() - handler_start_time;
 
@@ -4351,21 +4619,49 @@ DaemonCore::CallCommandHandler(int req,Stream *stream,bool delete_stream,bool ch
 			handler_start_time = _condor_debug_get_time_double();
 		}
 
-		// call the handler function; first curr_dataptr for GetDataPtr()
-		curr_dataptr = &(comTable[index].data_ptr);
+		if ( comTable[index].thread_safe && CondorThreads::get_tid() > 1 &&
+			 !CondorThreads::holds_state_exclusive() )
+		{
+				// Run the handler on this pool thread without the big
+				// lock; see Set_Command_Thread_Safe().  The table may
+				// change while we are out, so call through a copy.
+			CommandEnt ent = comTable[index];
+			bool old_parallel = CondorThreads::enable_parallel(true);
+			CondorThreads::start_thread_safe_block();
+			CondorThreads::lock_state_shared();
+
+			if ( ent.is_cpp ) {
+				if ( ent.handlercpp )
+					result = (ent.service->*(ent.handlercpp))(req,stream);
+			} else {
+				if ( ent.handler )
+					result = (*(ent.handler))(ent.service,req,stream);
+			}
 
-		if ( comTable[index].is_cpp ) {
-			// the handler is c++ and belongs to a 'Service' class
-			if ( comTable[index].handlercpp )
-				result = (comTable[index].service->*(comTable[index].handlercpp))(req,stream);
-		} else {
-			// the handler is in c (not c++), so pass a Service pointer
-			if ( comTable[index].handler )
-				result = (*(comTable[index].handler))(comTable[index].service,req,stream);
+			CondorThreads::unlock_state_shared();
+			CondorThreads::stop_thread_safe_block();
+			CondorThreads::enable_parallel(old_parallel);
+			ASSERT( result != KEEP_STREAM );
 		}
+		else {
+			ExclusiveStateAccess state_access;
 
-		// clear curr_dataptr
-		curr_dataptr = NULL;
+			// call the handler function; first curr_dataptr for GetDataPtr()
+			curr_dataptr = &(comTable[index].data_ptr);
+
+			if ( comTable[index].is_cpp ) {
+				// the handler is c++ and belongs to a 'Service' class
+				if ( comTable[index].handlercpp )
+					result = (comTable[index].service->*(comTable[index].handlercpp))(req,stream);
+			} else {
+				// the handler is in c (not c++), so pass a Service pointer
+				if ( comTable[index].handler )
+					result = (*(comTable[index].handler))(comTable[index].service,req,stream);
+			}
+
+			// clear curr_dataptr
+			curr_dataptr = NULL;
+		}
 
 		if (IsDebugLevel(D_COMMAND)) {
 			double handler_time = _condor_debug_get_time_double() - handler_start_time;
@@ -9517,6 +9813,10 @@ DaemonCore::CallReaper(int reaper_id, char const *whatexited, pid_t pid, int exi
 {
 	ReapEnt *reaper = NULL;
 
+		// Waiting for the daemon state lock gives up the big lock, so
+		// take it before looking up the reaper or setting curr_dataptr.
+	ExclusiveStateAccess state_access;
+
 	if( reaper_id > 0 ) {
 		for ( int i = 0; i < nReap; i++ ) {
 			if ( reapTable[i].num == reaper_id ) {
@@ -10760,14 +11060,42 @@ DaemonCore::getCollectorList() {
 
 
 int
-DaemonCore::sendUpdates( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblock )
+DaemonCore::sendUpdates( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblock,
+						 ClassAd* policy_ad )
 {
 	ASSERT(ad1);
 	ASSERT(m_collector_list);
 
+	if ( ! policy_ad) {
+		policy_ad = ad1;
+	}
+
 		// Now's our chance to evaluate the DAEMON_SHUTDOWN expressions.
+	evalShutdownExprs(policy_ad);
+
+		// Even if we just decided to shut ourselves down, we should
+		// still send the updates originally requested by the caller.
+	return m_collector_list->sendUpdates(cmd, ad1, ad2, nonblock);
+}
+
+
+int
+DaemonCore::sendUpdates( int cmd, std::vector<ClassAd*> &ads, bool nonblock )
+{
+	ASSERT( ! ads.empty());
+	ASSERT(m_collector_list);
+
+	evalShutdownExprs(ads[0]);
+
+	return m_collector_list->sendUpdates(cmd, ads, nonblock);
+}
+
+
+void
+DaemonCore::evalShutdownExprs( ClassAd* ad )
+{
 	if (!m_in_daemon_shutdown_fast &&
-		evalExpr(ad1, "DAEMON_SHUTDOWN_FAST", ATTR_DAEMON_SHUTDOWN_FAST,
+		evalExpr(ad, "DAEMON_SHUTDOWN_FAST", ATTR_DAEMON_SHUTDOWN_FAST,
 				 "starting fast shutdown"))	{
 			// Daemon wants to quickly shut itself down and not restart.
 		m_wants_restart = false;
@@ -10775,16 +11103,12 @@ DaemonCore::sendUpdates( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblock )
 		daemonCore->Send_Signal( daemonCore->getpid(), SIGQUIT );
 	}
 	else if (!m_in_daemon_shutdown &&
-			 evalExpr(ad1, "DAEMON_SHUTDOWN", ATTR_DAEMON_SHUTDOWN,
+			 evalExpr(ad, "DAEMON_SHUTDOWN", ATTR_DAEMON_SHUTDOWN,
 					  "starting graceful shutdown")) {
 		m_wants_restart = false;
 		m_in_daemon_shutdown = true;
 		daemonCore->Send_Signal( daemonCore->getpid(), SIGTERM );
 	}
-
-		// Even if we just decided to shut ourselves down, we should
-		// still send the updates originally requested by the caller.
-	return m_collector_list->sendUpdates(cmd, ad1, ad2, nonblock);
 }
 
 
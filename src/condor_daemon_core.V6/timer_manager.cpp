@@ -23,6 +23,8 @@
 #include "condor_common.h"
 #include "condor_debug.h"
 #include "condor_daemon_core.h"
+#include "condor_threads.h"
+#include <algorithm>
 
 static const char* DEFAULT_INDENT = "DaemonCore--> ";
 
@@ -60,8 +62,7 @@ TimerManager::TimerManager()
 	{
 		EXCEPT("TimerManager object exists!");
 	}
-	timer_list = NULL;
-	list_tail = NULL;
+	insert_seq = 0;
 	timer_ids = 0;
 	in_timeout = NULL;
 	_t = this; 
@@ -184,7 +185,7 @@ bool TimerManager::ResetTimerTimeslice(int id, Timeslice const &new_timeslice)
 
 bool TimerManager::GetTimerTimeslice(int id, Timeslice &timeslice)
 {
-	Timer *timer_ptr = GetTimer( id, NULL );
+	Timer *timer_ptr = GetTimer( id );
 	if( !timer_ptr || !timer_ptr->timeslice ) {
 		return false;
 	}
@@ -194,7 +195,7 @@ bool TimerManager::GetTimerTimeslice(int id, Timeslice &timeslice)
 
 time_t TimerManager::GetNextRuntime(int id)
 {
-	Timer *timer_ptr = GetTimer( id, NULL );
+	Timer *timer_ptr = GetTimer( id );
 	if (!timer_ptr) { return false; }
 
 	return timer_ptr->when;
@@ -204,21 +205,15 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 							 Timeslice const *new_timeslice)
 {
 	Timer*			timer_ptr;
-	Timer*			trail_ptr;
 
 	dprintf( D_DAEMONCORE,
 			 "In reset_timer(), id=%d, time=%d, period=%d\n",id,when,period);
-	if (timer_list == NULL) {
+	if (timer_heap.empty()) {
 		dprintf( D_DAEMONCORE, "Reseting Timer from empty list!\n");
 		return -1;
 	}
 
-	timer_ptr = timer_list;
-	trail_ptr = NULL;
-	while ( timer_ptr && timer_ptr->id != id ) {
-		trail_ptr = timer_ptr;
-		timer_ptr = timer_ptr->next;
-	}
+	timer_ptr = GetTimer( id );
 
 	if ( timer_ptr == NULL ) {
 		dprintf( D_ALWAYS, "Timer %d not found\n",id );
@@ -277,7 +272,7 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 	}
 	timer_ptr->period = period;
 
-	RemoveTimer( timer_ptr, trail_ptr );
+	RemoveTimer( timer_ptr );
 	InsertTimer( timer_ptr );
 
 	if ( in_timeout == timer_ptr ) {
@@ -292,27 +287,21 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 int TimerManager::CancelTimer(int id)
 {
 	Timer*		timer_ptr;
-	Timer*		trail_ptr;
 
 	dprintf( D_DAEMONCORE, "In cancel_timer(), id=%d\n",id);
-	if (timer_list == NULL) {
+	if (timer_heap.empty()) {
 		dprintf( D_DAEMONCORE, "Removing Timer from empty list!\n");
 		return -1;
 	}
 
-	timer_ptr = timer_list;
-	trail_ptr = NULL;
-	while ( timer_ptr && timer_ptr->id != id ) {
-		trail_ptr = timer_ptr;
-		timer_ptr = timer_ptr->next;
-	}
+	timer_ptr = GetTimer( id );
 
 	if ( timer_ptr == NULL ) {
 		dprintf( D_ALWAYS, "Timer %d not found\n",id );
 		return -1;
 	}
 
-	RemoveTimer( timer_ptr, trail_ptr );
+	RemoveTimer( timer_ptr );
 
 	if ( in_timeout == timer_ptr ) {
 		// We're inside the handler for this timer. Don't delete it,
@@ -328,21 +317,19 @@ int TimerManager::CancelTimer(int id)
 
 void TimerManager::CancelAllTimers()
 {
-	Timer		*timer_ptr;
+	std::vector<Timer*> timers;
 
-	while( timer_list != NULL ) {
-		timer_ptr = timer_list;
-		timer_list = timer_list->next;
-		if( in_timeout == timer_ptr ) {
+	timers.swap( timer_heap );
+	timer_by_id.clear();
+	for( size_t i = 0; i < timers.size(); i++ ) {
+		if( in_timeout == timers[i] ) {
 				// We get here if somebody calls exit from inside a timer.
 			did_cancel = true;
 		}
 		else {
-			DeleteTimer( timer_ptr );
+			DeleteTimer( timers[i] );
 		}
 	}
-	timer_list = NULL;
-	list_tail = NULL;
 }
 
 // Timeout() is called when a select() time out.  Returns number of seconds
@@ -360,10 +347,10 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 	if ( in_timeout != NULL ) {
 		dprintf(D_DAEMONCORE,"DaemonCore Timeout() called and in_timeout is non-NULL\n");
-		if ( timer_list == NULL ) {
+		if ( timer_heap.empty() ) {
 			result = 0;
 		} else {
-			result = (timer_list->when) - time(NULL);
+			result = (FirstTimer()->when) - time(NULL);
 		}
 		if ( result < 0 ) {
 			result = 0;
@@ -373,7 +360,7 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 		
 	dprintf( D_DAEMONCORE, "In DaemonCore Timeout()\n");
 
-	if (timer_list == NULL) {
+	if (timer_heap.empty()) {
 		dprintf( D_DAEMONCORE, "Empty timer list, nothing to do\n" );
 	}
 
@@ -384,18 +371,27 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 	// loop until all handlers that should have been called by now or before
 	// are invoked and renewed if periodic.  Remember that NewTimer and CancelTimer
-	// keep the timer_list happily sorted on "when" for us.  We use "now" as a 
+	// keep the timer heap ordered on "when" for us.  We use "now" as a 
 	// variable so that if some of these handler functions run for a long time,
 	// we do not sit in this loop forever.
 	// we make certain we do not call more than "max_fires" handlers in a 
 	// single timeout --- this ensures that timers don't starve out the rest
 	// of daemonCore if a timer handler resets itself to 0.
-	while( (timer_list != NULL) && (timer_list->when <= now ) && 
+	while( (!timer_heap.empty()) && (FirstTimer()->when <= now ) && 
 		   (num_fires++ < MAX_FIRES_PER_TIMEOUT)) 
 	{
 		// DumpTimerList(D_DAEMONCORE | D_FULLDEBUG);
 
-		in_timeout = timer_list;
+		// Waiting for the daemon state lock gives up the big lock, so
+		// take it before touching in_timeout and the other dispatch
+		// state, and look at the heap again once we have it.
+		CondorThreads::lock_state_exclusive();
+		if ( timer_heap.empty() || FirstTimer()->when > now ) {
+			CondorThreads::unlock_state_exclusive();
+			break;
+		}
+
+		in_timeout = FirstTimer();
 
 		// In some cases, resuming from a suspend can cause the system
 		// clock to become temporarily skewed, causing crazy things to 
@@ -489,12 +485,10 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 			// If a new timer was added at a time in the past
 			// (possible when resetting a timeslice timer), then
 			// it may have landed before the timer we just processed,
-			// meaning that we cannot assume prev==NULL in the call
-			// to RemoveTimer() below.
+			// so it need not be at the top of the heap any more.
 
-			Timer *prev = NULL;
-			ASSERT( GetTimer(in_timeout->id,&prev) == in_timeout );
-			RemoveTimer( in_timeout, prev );
+			ASSERT( GetTimer(in_timeout->id) == in_timeout );
+			RemoveTimer( in_timeout );
 
 			if ( in_timeout->period > 0 || in_timeout->timeslice ) {
 				in_timeout->period_started = time(NULL);
@@ -515,18 +509,19 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 				DeleteTimer( in_timeout );
 			}
 		}
+		CondorThreads::unlock_state_exclusive();
 	}  // end of while loop
 
 
 	// set result to number of seconds until next event.  get an update on the
 	// time from time() in case the handlers we called above took significant time.
-	if ( timer_list == NULL ) {
+	if ( timer_heap.empty() ) {
 		// we set result to be -1 so that we do not busy poll.
 		// a -1 return value will tell the DaemonCore:Driver to use select with
 		// no timeout.
 		result = -1;
 	} else {
-		result = (timer_list->when) - time(NULL);
+		result = (FirstTimer()->when) - time(NULL);
 		if (result < 0)
 			result = 0;
 	}
@@ -544,6 +539,7 @@ void TimerManager::DumpTimerList(int flag, const char* indent)
 {
 	Timer		*timer_ptr;
 	const char	*ptmp;
+	std::vector<Timer*> timers;
 
 	// we want to allow flag to be "D_FULLDEBUG | D_DAEMONCORE",
 	// and only have output if _both_ are specified by the user
@@ -559,8 +555,13 @@ void TimerManager::DumpTimerList(int flag, const char* indent)
 	dprintf(flag, "\n");
 	dprintf(flag, "%sTimers\n", indent);
 	dprintf(flag, "%s~~~~~~\n", indent);
-	for(timer_ptr = timer_list; timer_ptr != NULL; timer_ptr = timer_ptr->next)
+
+		// list the timers in the order they will fire
+	timers = timer_heap;
+	std::sort( timers.begin(), timers.end(), TimerBefore );
+	for( size_t i = 0; i < timers.size(); i++ )
 	{
+		timer_ptr = timers[i];
 		if ( timer_ptr->event_descrip )
 			ptmp = timer_ptr->event_descrip;
 		else
@@ -627,69 +628,93 @@ void TimerManager::Start()
 	}
 }
 
-void TimerManager::RemoveTimer( Timer *timer, Timer *prev )
+void TimerManager::RemoveTimer( Timer *timer )
 {
-	if ( timer == NULL || ( prev && prev->next != timer ) ||
-		 ( !prev && timer != timer_list ) ) {
+	if ( timer == NULL || timer->heap_index < 0 ||
+		 (size_t)timer->heap_index >= timer_heap.size() ||
+		 timer_heap[timer->heap_index] != timer ) {
 		EXCEPT( "Bad call to TimerManager::RemoveTimer()!" );
 	}
 
-	if ( timer == timer_list ) {
-		timer_list = timer_list->next;
-	}
-	if ( timer == list_tail ) {
-		list_tail = prev;
-	}
-	if ( prev ) {
-		prev->next = timer->next;
+	size_t pos = timer->heap_index;
+	Timer *last = timer_heap.back();
+	timer_heap.pop_back();
+	if ( last != timer ) {
+			// move the last timer into the hole, and then up or down
+			// to where it belongs
+		HeapSet( pos, last );
+		HeapUp( pos );
+		HeapDown( last->heap_index );
 	}
+	timer->heap_index = -1;
+	timer_by_id.erase( timer->id );
 }
 
 void TimerManager::InsertTimer( Timer *new_timer )
 {
-	if ( timer_list == NULL ) {
-		// list is empty, place ours in front
-		timer_list = new_timer;
-		list_tail = new_timer;
-		new_timer->next = NULL;
-			// since we have a new first timer, we must wake up select
-		daemonCore->Wake_up_select();
-	} else {
-		// list is not empty, so keep timer_list ordered from soonest to
-		// farthest (i.e. sorted on "when").
-		// Note: when doing the comparisons, we always use "<" instead
-		// of "<=" -- this makes certain we "round-robin" across 
+		// Note: timers with the same "when" are ordered by when they
+		// were inserted -- this makes certain we "round-robin" across
 		// timers that constantly reset themselves to zero.
-		if ( new_timer->when < timer_list->when ) {
-			// make the this new timer first in line
-			new_timer->next = timer_list;
-			timer_list = new_timer;
+	new_timer->insert_seq = insert_seq++;
+	timer_by_id[new_timer->id] = new_timer;
+
+	timer_heap.push_back( new_timer );
+	HeapSet( timer_heap.size() - 1, new_timer );
+	HeapUp( new_timer->heap_index );
+
+	if ( timer_heap[0] == new_timer ) {
 			// since we have a new first timer, we must wake up select
-			daemonCore->Wake_up_select();
-		} else if ( new_timer->when == TIME_T_NEVER ) {
-			// Our new timer goes to the very back of the list.
-			new_timer->next = NULL;
-			list_tail->next = new_timer;
-			list_tail = new_timer;
-		} else {
-			Timer* timer_ptr;
-			Timer* trail_ptr = NULL;
-			for (timer_ptr = timer_list; timer_ptr != NULL; 
-				 timer_ptr = timer_ptr->next ) 
-			{
-				if (new_timer->when < timer_ptr->when) {
-					break;
-				}
-				trail_ptr = timer_ptr;
-			}
-			ASSERT( trail_ptr );
-			new_timer->next = timer_ptr;
-			trail_ptr->next = new_timer;
-			if ( trail_ptr == list_tail ) {
-				list_tail = new_timer;
-			}
+		daemonCore->Wake_up_select();
+	}
+}
+
+bool TimerManager::TimerBefore( const Timer *a, const Timer *b )
+{
+	if ( a->when != b->when ) {
+		return a->when < b->when;
+	}
+	return a->insert_seq < b->insert_seq;
+}
+
+void TimerManager::HeapSet( size_t pos, Timer *timer )
+{
+	timer_heap[pos] = timer;
+	timer->heap_index = (int)pos;
+}
+
+void TimerManager::HeapUp( size_t pos )
+{
+	Timer *timer = timer_heap[pos];
+	while ( pos > 0 ) {
+		size_t parent = (pos - 1) / 2;
+		if ( !TimerBefore( timer, timer_heap[parent] ) ) {
+			break;
 		}
+		HeapSet( pos, timer_heap[parent] );
+		pos = parent;
 	}
+	HeapSet( pos, timer );
+}
+
+void TimerManager::HeapDown( size_t pos )
+{
+	Timer *timer = timer_heap[pos];
+	size_t size = timer_heap.size();
+	for (;;) {
+		size_t child = 2 * pos + 1;
+		if ( child >= size ) {
+			break;
+		}
+		if ( child + 1 < size && TimerBefore( timer_heap[child + 1], timer_heap[child] ) ) {
+			child++;
+		}
+		if ( !TimerBefore( timer_heap[child], timer ) ) {
+			break;
+		}
+		HeapSet( pos, timer_heap[child] );
+		pos = child;
+	}
+	HeapSet( pos, timer );
 }
 
 void TimerManager::DeleteTimer( Timer *timer )
@@ -714,18 +739,11 @@ void TimerManager::DeleteTimer( Timer *timer )
 	delete timer;
 }
 
-Timer *TimerManager::GetTimer( int id, Timer **prev )
+Timer *TimerManager::GetTimer( int id )
 {
-	Timer *timer_ptr = timer_list;
-	if( prev ) {
-		*prev = NULL;
-	}
-	while ( timer_ptr && timer_ptr->id != id ) {
-		if( prev ) {
-			*prev = timer_ptr;
-		}
-		timer_ptr = timer_ptr->next;
+	std::map<int, Timer*>::iterator it = timer_by_id.find( id );
+	if ( it == timer_by_id.end() ) {
+		return NULL;
 	}
-
-	return timer_ptr;
+	return it->second;
 }
@@ -76,6 +76,7 @@
 #define ATTR_CLAIM_STARTD  "ClaimStartd"
 #define ATTR_COD_CLAIMS  "CODClaims"
 #define ATTR_COLLECTOR_HOST  "CollectorHost"
+#define ATTR_COLLECTOR_UPDATE_GENERATION  "CollectorUpdateGeneration"
 #define ATTR_COMMAND  "Command"
 #define ATTR_COMPRESS_FILES  "CompressFiles"
 #define ATTR_REQUESTED_CAPACITY  "RequestedCapacity"
@@ -153,6 +154,8 @@
 #define ATTR_DEFERRAL_PREP_TIME  "DeferralPrepTime"
 #define ATTR_DEFERRAL_TIME  "DeferralTime"
 #define ATTR_DEFERRAL_WINDOW  "DeferralWindow"
+#define ATTR_DELTA_UPDATE_BASE  "DeltaUpdateBase"
+#define ATTR_DELTA_UPDATE_REMOVED_ATTRS  "DeltaUpdateRemovedAttrs"
 #define ATTR_DESTINATION  "Destination"
 #define ATTR_DISK  "Disk"
 #define ATTR_DISK_USAGE  "DiskUsage"
@@ -1043,6 +1046,8 @@ extern const char ATTR_SEC_AUTHENTICATED_USER [];
 #define ATTR_LAST_NEGOTIATION_CYCLE_MATCH_RATE_SUSTAINED  "LastNegotiationCycleMatchRateSustained"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PIES  "LastNegotiationCyclePies"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PIE_SPINS  "LastNegotiationCyclePieSpins"
+#define ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_OFFERS  "LastNegotiationCycleParallelMatchOffers"
+#define ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_TIME  "LastNegotiationCycleParallelMatchTime"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_DURATION  "LastNegotiationCyclePrefetchDuration"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_CPU_TIME  "LastNegotiationCyclePrefetchCpuTime"
 #define ATTR_LAST_NEGOTIATION_CYCLE_SCHEDDS_OUT_OF_TIME  "LastNegotiationCycleScheddsOutOfTime"
@@ -369,6 +369,9 @@ extern "C" {
 	// this function allows tests to set the actual backend data for a param value and returns the old value.
 	// make sure that live_value stays in scope until you put the old value back
 	const char * set_live_param_value(const char * name, const char * live_value);
+	// a counter that changes whenever the configuration does (reconfig,
+	// param_insert, set_live_param_value); used by param_cached<T>.
+	unsigned int param_config_generation();
 	bool find_user_file(MyString & filename, const char * basename, bool check_access);
 } // end extern "C"
 
@@ -159,6 +159,15 @@ const condor_mode_t NULL_FILE_PERMISSIONS = (condor_mode_t)0;
 	inline int MyObject::get(Stream &s) { s.decode(); return code(s); }
     </pre>
 */
+/** State that a protocol layered over a stream keeps for as long as
+	the connection lasts, such as the attribute names already sent in
+	binary ClassAds.  It is deleted when the stream is closed.
+*/
+class StreamConnectionState {
+public:
+	virtual ~StreamConnectionState() {}
+};
+
 class Stream: public ClassyCountedPtr {
 
 public:
@@ -576,6 +585,21 @@ public:
 	/// Set the peer's version.
 	void set_peer_version(CondorVersionInfo const *version);
 
+	/// State kept by the ClassAd wire protocol (see classad_oldnew.cpp)
+	/// for this connection, or NULL.
+	StreamConnectionState *get_classad_state() const { return m_classad_state; }
+
+	/// Replace the ClassAd wire protocol state; the stream takes
+	/// ownership of it.  NULL starts the protocol over.  The state is
+	/// not carried by serialize(), so a socket inherited by another
+	/// process starts with none.
+	void set_classad_state(StreamConnectionState *state) {
+		if( m_classad_state != state ) {
+			delete m_classad_state;
+			m_classad_state = state;
+		}
+	}
+
 	/** Get this stream's type.
         @return the type of this stream
     */
@@ -660,6 +684,7 @@ protected:
 	int decrypt_buf_len;
 	char *m_peer_description_str;
 	CondorVersionInfo *m_peer_version;
+	StreamConnectionState *m_classad_state;
 
 	time_t m_deadline_time;
 	static int timeout_multiplier;
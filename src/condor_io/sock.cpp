@@ -1864,6 +1864,9 @@ int Sock::close()
 	setFullyQualifiedUser(NULL);
 	setTriedAuthentication(false);
 
+	// and anything the ClassAd wire protocol learned about the peer
+	set_classad_state(NULL);
+
 	return TRUE;
 }
 
@@ -2296,6 +2299,10 @@ const char * Sock::serialize(const char *buf)
 
 	setTriedAuthentication(tried_authentication);
 
+		// ClassAd name dictionaries are not passed along; the peer
+		// must start its side over when it hands off the socket.
+	set_classad_state(NULL);
+
 	MyString str;
 	if ( ! in.deserialize_string(str, "*") || ! in.deserialize_sep("*")) {
 		EXCEPT("Failed to parse serialized socket FullyQualifiedUser at offset %d: '%s'",(int)in.offset(),buf);
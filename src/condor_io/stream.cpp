@@ -72,6 +72,7 @@ Stream :: Stream(stream_code c) :
 	decrypt_buf_len(0),
 	m_peer_description_str(NULL),
 	m_peer_version(NULL),
+	m_classad_state(NULL),
 	m_deadline_time(0),
 	ignore_timeout_multiplier(false)
 {
@@ -105,6 +106,7 @@ Stream :: ~Stream()
 	if( m_peer_version ) {
 		delete m_peer_version;
 	}
+	delete m_classad_state;
 }
 
 int 
@@ -0,0 +1,267 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_attributes.h"
+#include "condor_classad.h"
+#include "collector_ad_cache.h"
+
+CollectorAdCache::CollectorAdCache(AdTypes type, char const *label) :
+	m_type(type),
+	m_label(label),
+	m_last_full(0),
+	m_fetched(0),
+	m_removed(0)
+{
+}
+
+CollectorAdCache::~CollectorAdCache()
+{
+	Clear();
+}
+
+void
+CollectorAdCache::Clear()
+{
+	for (EntryMap::iterator it = m_ads.begin(); it != m_ads.end(); ++it) {
+		delete it->second.ad;
+	}
+	m_ads.clear();
+	m_listing.clear();
+	m_signature.clear();
+	m_last_full = 0;
+}
+
+	// The same key the negotiator uses for the claim id table.
+bool
+CollectorAdCache::AdKey(ClassAd *ad, std::string &key)
+{
+	std::string addr;
+	if (!ad->LookupString(ATTR_NAME, key)) {
+		return false;
+	}
+	ad->LookupString(ATTR_MY_ADDRESS, addr);
+	key += addr;
+	return true;
+}
+
+	// Returns false if the ad has neither stamp, i.e. they were
+	// projected out.
+bool
+CollectorAdCache::GetStamp(ClassAd *ad, Stamp &stamp)
+{
+	bool found = ad->LookupInteger(ATTR_LAST_HEARD_FROM, stamp.last_heard);
+	if (ad->LookupInteger(ATTR_COLLECTOR_UPDATE_GENERATION, stamp.generation)) {
+		found = true;
+	}
+	return found;
+}
+
+bool
+CollectorAdCache::listing_callback(void *pv, ClassAd *ad)
+{
+	CollectorAdCache *cache = (CollectorAdCache *)pv;
+	std::string key;
+
+	if (AdKey(ad, key)) {
+		GetStamp(ad, cache->m_listing[key]);
+	}
+	return true;	// we don't keep the ad
+}
+
+bool
+CollectorAdCache::fetch_callback(void *pv, ClassAd *ad)
+{
+	CollectorAdCache *cache = (CollectorAdCache *)pv;
+	cache->Store(ad);
+	return false;	// the cache owns it now
+}
+
+void
+CollectorAdCache::Store(ClassAd *ad)
+{
+	std::string key;
+	if (!AdKey(ad, key)) {
+		delete ad;
+		return;
+	}
+
+	Entry &entry = m_ads[key];
+	delete entry.ad;
+	entry.ad = ad;
+	entry.stamp = Stamp();
+	std::map<std::string, Stamp>::iterator found = m_listing.find(key);
+	if (!GetStamp(ad, entry.stamp) && found != m_listing.end()) {
+			// projected out; go by the listing
+		entry.stamp = found->second;
+	}
+		// what is left in the listing wasn't fetched
+	if (found != m_listing.end()) {
+		m_listing.erase(found);
+	}
+	m_fetched++;
+}
+
+bool
+CollectorAdCache::FetchAll(CollectorList *collectors, char const *constraint,
+						   char const *projection_expr, CondorError *errstack)
+{
+	CondorQuery query(m_type);
+	if (constraint && constraint[0]) {
+		query.addANDConstraint(constraint);
+	}
+	if (projection_expr && projection_expr[0]) {
+		query.setDesiredAttrsExpr(projection_expr);
+	}
+
+	Clear();
+	QueryResult result = collectors->query(query, fetch_callback, this, errstack);
+	if (result != Q_OK) {
+		dprintf(D_ALWAYS, "Couldn't fetch %s ads: %s\n", m_label.c_str(),
+				getStrQueryResult(result));
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+bool
+CollectorAdCache::Refresh(CollectorList *collectors, char const *constraint,
+						  char const *projection_expr, int full_interval,
+						  CondorError *errstack)
+{
+	std::string signature;
+	formatstr(signature, "%s\n%s", constraint ? constraint : "",
+			  projection_expr ? projection_expr : "");
+	time_t now = time(NULL);
+
+	m_fetched = 0;
+	m_removed = 0;
+
+	if (m_ads.empty() || signature != m_signature ||
+		now < m_last_full || now - m_last_full >= full_interval)
+	{
+		dprintf(D_ALWAYS, "  Fetching all %s ads ...\n", m_label.c_str());
+		if (!FetchAll(collectors, constraint, projection_expr, errstack)) {
+			return false;
+		}
+		m_signature = signature;
+		m_last_full = now;
+		return true;
+	}
+
+		// What is there now, and when was each heard from?
+	CondorQuery listing(m_type);
+	if (constraint && constraint[0]) {
+		listing.addANDConstraint(constraint);
+	}
+	listing.setDesiredAttrs(ATTR_NAME " " ATTR_MY_ADDRESS " " ATTR_LAST_HEARD_FROM " " ATTR_COLLECTOR_UPDATE_GENERATION);
+
+	m_listing.clear();
+	QueryResult result = collectors->query(listing, listing_callback, this, errstack);
+	if (result != Q_OK) {
+		dprintf(D_ALWAYS, "Couldn't fetch %s ad listing: %s\n", m_label.c_str(),
+				getStrQueryResult(result));
+		return false;
+	}
+
+		// Drop the ads that are gone, and find the oldest LastHeardFrom
+		// of the ones that are new or have been updated.
+	int changed = 0;
+	int since = INT_MAX;
+	for (EntryMap::iterator it = m_ads.begin(); it != m_ads.end(); ) {
+		std::map<std::string, Stamp>::iterator found = m_listing.find(it->first);
+		if (found == m_listing.end()) {
+			delete it->second.ad;
+			m_ads.erase(it++);
+			m_removed++;
+			continue;
+		}
+		if (found->second != it->second.stamp) {
+			changed++;
+			if (found->second.last_heard < since) {
+				since = found->second.last_heard;
+			}
+		}
+		++it;
+	}
+	for (std::map<std::string, Stamp>::iterator it = m_listing.begin();
+		 it != m_listing.end(); ++it)
+	{
+		if (m_ads.find(it->first) == m_ads.end()) {
+			changed++;
+			if (it->second.last_heard < since) {
+				since = it->second.last_heard;
+			}
+		}
+	}
+
+	if (changed) {
+		std::string delta_constraint;
+		if (constraint && constraint[0]) {
+			formatstr(delta_constraint, "(%s) && (%s >= %d)", constraint,
+					  ATTR_LAST_HEARD_FROM, since);
+		} else {
+			formatstr(delta_constraint, "%s >= %d", ATTR_LAST_HEARD_FROM, since);
+		}
+
+		CondorQuery delta(m_type);
+		delta.addANDConstraint(delta_constraint.c_str());
+		if (projection_expr && projection_expr[0]) {
+			delta.setDesiredAttrsExpr(projection_expr);
+		}
+		result = collectors->query(delta, fetch_callback, this, errstack);
+		if (result != Q_OK) {
+			dprintf(D_ALWAYS, "Couldn't fetch updated %s ads: %s\n", m_label.c_str(),
+					getStrQueryResult(result));
+				// some of what we have may be out of date now
+			Clear();
+			return false;
+		}
+
+			// An ad that was listed as changed but not fetched went
+			// away in between; don't keep the stale copy.
+		for (EntryMap::iterator it = m_ads.begin(); it != m_ads.end(); ) {
+			std::map<std::string, Stamp>::iterator found = m_listing.find(it->first);
+			if (found != m_listing.end() && found->second != it->second.stamp) {
+				delete it->second.ad;
+				m_ads.erase(it++);
+				m_removed++;
+				continue;
+			}
+			++it;
+		}
+	}
+	m_listing.clear();
+
+	dprintf(D_ALWAYS, "  %s ads: %d cached, %d fetched, %d removed\n",
+			m_label.c_str(), (int)m_ads.size(), m_fetched, m_removed);
+	return true;
+}
+
+void
+CollectorAdCache::CopyAds(ClassAdList &ads) const
+{
+	for (EntryMap::const_iterator it = m_ads.begin(); it != m_ads.end(); ++it) {
+		ClassAd *ad = new ClassAd();
+		ad->ChainToAd(it->second.ad);
+		ads.Insert(ad);
+	}
+}
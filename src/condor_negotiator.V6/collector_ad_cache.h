@@ -0,0 +1,107 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _COLLECTOR_AD_CACHE_H
+#define _COLLECTOR_AD_CACHE_H
+
+#include "condor_query.h"
+#include "daemon_list.h"
+#include <string>
+#include <map>
+
+/* CollectorAdCache keeps a resident copy of one type of startd ad
+ * (public or private) between negotiation cycles, so that each cycle
+ * only fetches the ads that changed instead of the whole pool.
+ *
+ * The collector stamps every ad with LastHeardFrom when it receives
+ * it, and with a CollectorUpdateGeneration that changes whenever it
+ * changes the ad, so that two updates in the same second can be told
+ * apart.  Each refresh first asks for just the name, address and
+ * stamps of every ad.  Ads that are gone are dropped, and ads that are
+ * new or have changed are fetched in full with a LastHeardFrom
+ * constraint.  Every so often, and whenever the constraint or
+ * projection changes, all of the ads are fetched again.
+ *
+ * The cycle doesn't get copies of the cached ads.  It gets empty ads
+ * chained to them, so that the changes it makes stay out of the cache.
+ */
+class CollectorAdCache {
+
+ public:
+	CollectorAdCache(AdTypes type, char const *label);
+	~CollectorAdCache();
+
+		// Bring the cache up to date.  constraint and projection_expr
+		// are applied to the full ads, as they would be to a query
+		// for all of them; either may be NULL.  full_interval is the
+		// number of seconds after which everything is fetched again.
+	bool Refresh(CollectorList *collectors, char const *constraint,
+				 char const *projection_expr, int full_interval,
+				 CondorError *errstack = NULL);
+
+		// Append an ad chained to each cached ad to the list.  The
+		// cached ads must outlive the chained ones, so don't Refresh()
+		// or Clear() the cache until they are gone; anything that
+		// keeps a copy of one longer must ChainCollapse() it.
+	void CopyAds(ClassAdList &ads) const;
+
+	void Clear();
+
+	int NumAds() const { return (int)m_ads.size(); }
+	int NumFetched() const { return m_fetched; }
+	int NumRemoved() const { return m_removed; }
+
+ private:
+
+		// When the collector last changed an ad.  Collectors before
+		// 8.7.4 don't send a generation, so it may be 0.
+	struct Stamp {
+		int last_heard;
+		long long generation;
+		Stamp() : last_heard(0), generation(0) {}
+		bool operator!=(const Stamp &other) const {
+			return last_heard != other.last_heard || generation != other.generation;
+		}
+	};
+	struct Entry {
+		ClassAd *ad;
+		Stamp stamp;
+	};
+	typedef std::map<std::string, Entry> EntryMap;
+
+	static bool AdKey(ClassAd *ad, std::string &key);
+	static bool GetStamp(ClassAd *ad, Stamp &stamp);
+	static bool listing_callback(void *pv, ClassAd *ad);
+	static bool fetch_callback(void *pv, ClassAd *ad);
+
+	bool FetchAll(CollectorList *collectors, char const *constraint,
+				  char const *projection_expr, CondorError *errstack);
+	void Store(ClassAd *ad);
+
+	AdTypes m_type;
+	std::string m_label;
+	EntryMap m_ads;
+	std::map<std::string, Stamp> m_listing;
+	std::string m_signature;	// constraint and projection of m_ads
+	time_t m_last_full;
+	int m_fetched;
+	int m_removed;
+};
+
+#endif
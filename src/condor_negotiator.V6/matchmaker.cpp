@@ -44,6 +44,8 @@
 #include "consumption_policy.h"
 #include "condor_classad.h"
 #include "subsystem_info.h"
+#include "utc_time.h"
+#include "param_cached.h"
 
 #include <vector>
 #include <string>
@@ -119,6 +121,10 @@ public:
     int pies;
     int pie_spins;
 
+    // offers evaluated by the parallel matchmaker, and its wall time
+    int par_match_offers;
+    double par_match_time;
+
     // set of unique active schedd, id by sinful strings:
     std::set<std::string> active_schedds;
 
@@ -156,6 +162,8 @@ NegotiationCycleStats::NegotiationCycleStats():
 	rejections(0),
     pies(0),
     pie_spins(0),
+    par_match_offers(0),
+    par_match_time(0.0),
     active_schedds(),
     active_submitters(),
     submitters_share_limit(),
@@ -214,7 +222,10 @@ bool ResourcesInUseByUser_classad_func( const char * /*name*/,
 		return true;
 	}
 
-	float usage = matchmaker_for_classad_func->getAccountant().GetWeightedResourcesUsed(user.c_str());
+		// offers may be evaluated on several threads at once
+	float usage;
+#pragma omp critical (negotiator_accountant)
+	usage = matchmaker_for_classad_func->getAccountant().GetWeightedResourcesUsed(user.c_str());
 
 	result.SetRealValue( usage );
 	return true;
@@ -251,7 +262,10 @@ bool ResourcesInUseByUsersGroup_classad_func( const char * /*name*/,
 	float group_quota = 0;
 	float group_usage = 0;
     string group_name;
-	if( !matchmaker_for_classad_func->getGroupInfoFromUserId(user.c_str(),group_name,group_quota,group_usage) ) {
+	bool found;
+#pragma omp critical (negotiator_accountant)
+	found = matchmaker_for_classad_func->getGroupInfoFromUserId(user.c_str(),group_name,group_quota,group_usage);
+	if( !found ) {
 		result.SetErrorValue();
 		return true;
 	}
@@ -365,6 +379,8 @@ Matchmaker::
 Matchmaker ()
    : strSlotConstraint(NULL)
    , SlotPoolsizeConstraint(NULL)
+   , residentStartdAds(STARTD_AD, "startd")
+   , residentStartdPvtAds(STARTD_PVT_AD, "startd private")
 {
 	char buf[64];
 
@@ -392,12 +408,15 @@ Matchmaker ()
 	stashedAds = new AdHash(1000, HashFunc);
 
 	MatchList = NULL;
-	cachedAutoCluster = -1;
-	cachedName = NULL;
-	cachedAddr = NULL;
+	matchListCacheBytes = 0;
+	matchListCacheMaxBytes = 0;
 
 	want_globaljobprio = false;
 	want_matchlist_caching = false;
+	want_compiled_requirements = false;
+	want_match_index = false;
+	want_incremental_ads = false;
+	incremental_ads_full_interval = 0;
 	PublishCrossSlotPrios = false;
 	ConsiderPreemption = true;
 	ConsiderEarlyPreemption = false;
@@ -434,9 +453,6 @@ Matchmaker ()
 	rejForSubmitterLimit = 0;
 	rejForConcurrencyLimit = 0;
 
-	cachedPrio = 0;
-	cachedOnlyForStartdRank = false;
-
 		// just assign default values
 	want_inform_startd = true;
 	preemption_req_unstable = true;
@@ -475,11 +491,8 @@ Matchmaker::
 	delete NegotiatorPreJobRank;
 	delete NegotiatorPostJobRank;
 	delete sockCache;
-	if (MatchList) {
-		delete MatchList;
-	}
-	if ( cachedName ) free(cachedName);
-	if ( cachedAddr ) free(cachedAddr);
+	DeleteMatchList();
+	clearParallelMatchSlots();
 
 	delete [] NegotiatorName;
 	if (publicAd) delete publicAd;
@@ -819,6 +832,15 @@ reinitialize ()
 
 	want_globaljobprio = param_boolean("USE_GLOBAL_JOB_PRIOS",false);
 	want_matchlist_caching = param_boolean("NEGOTIATOR_MATCHLIST_CACHING",true);
+	matchListCacheMaxBytes = (size_t)param_integer("NEGOTIATOR_MATCHLIST_CACHE_MAX_MB",64,0) * 1024 * 1024;
+	want_compiled_requirements = param_boolean("NEGOTIATOR_COMPILE_REQUIREMENTS",true);
+	want_match_index = param_boolean("NEGOTIATOR_MATCH_INDEX",true);
+	want_incremental_ads = param_boolean("NEGOTIATOR_INCREMENTAL_ADS",false);
+	incremental_ads_full_interval = param_integer("NEGOTIATOR_INCREMENTAL_ADS_FULL_INTERVAL",3600,0);
+	if ( !want_incremental_ads ) {
+		residentStartdAds.Clear();
+		residentStartdPvtAds.Clear();
+	}
 	PublishCrossSlotPrios = param_boolean("NEGOTIATOR_CROSS_SLOT_PRIOS", false);
 	ConsiderPreemption = param_boolean("NEGOTIATOR_CONSIDER_PREEMPTION",true);
 	ConsiderEarlyPreemption = param_boolean("NEGOTIATOR_CONSIDER_EARLY_PREEMPTION",false);
@@ -1530,6 +1552,12 @@ negotiationTime ()
 	// available during matchmaking
 	addRemoteUserPrios( startdAds );
 
+		// index the machine ads by the attributes jobs constrain, so
+		// the offer scan can skip machines that can't match
+	if ( want_match_index ) {
+		machineIndex.Build( startdAds );
+	}
+
     if (hgq_groups.size() <= 1) {
         // If there is only one group (the root group) we are in traditional non-HGQ mode.
         // It seems cleanest to take the traditional case separately for maximum backward-compatible behavior.
@@ -1903,6 +1931,9 @@ negotiationTime ()
 
     negotiation_cycle_stats[0]->end_time = completedLastCycleTime;
 
+    machineIndex.Clear();
+    DeleteMatchList();
+
     // Phase 2 is time to do "all of the above" since end of phase 1, less the time we spent in phase 3 and phase 4
     // (phase 3 and 4 occur inside of negotiateWithGroup(), which may be called in multiple places, inside looping)
     negotiation_cycle_stats[0]->duration_phase2 = completedLastCycleTime - start_time_phase2;
@@ -3467,35 +3498,65 @@ obtainAdsFromCollector (
     //
 	CondorQuery publicQuery(ANY_AD);
     publicQuery.addORConstraint("(MyType == \"Scheduler\") || (MyType == \"Submitter\")");
-    if (strSlotConstraint && strSlotConstraint[0]) {
-        MyString machine;
-        machine.formatstr("((MyType == \"Machine\") && (%s))", strSlotConstraint);
-        publicQuery.addORConstraint(machine.Value());
-    } else {
-        publicQuery.addORConstraint("(MyType == \"Machine\")");
-    }
+	if (!want_incremental_ads) {
+		if (strSlotConstraint && strSlotConstraint[0]) {
+			MyString machine;
+			machine.formatstr("((MyType == \"Machine\") && (%s))", strSlotConstraint);
+			publicQuery.addORConstraint(machine.Value());
+		} else {
+			publicQuery.addORConstraint("(MyType == \"Machine\")");
+		}
+	}
 
 	// If preemption is disabled, we only need a handful of attrs from claimed ads.
 	// Ask for that projection.
 
+	const char *projectionString = NULL;
 	if (!ConsiderPreemption) {
-		const char *projectionString =
-			"ifThenElse(State == \"Claimed\",\"Name State Activity StartdIpAddr AccountingGroup Owner RemoteUser Requirements SlotWeight ConcurrencyLimits\",\"\") ";
-		publicQuery.setDesiredAttrsExpr(projectionString);
+		if (want_incremental_ads) {
+				// the resident ads are keyed by Name and MyAddress, and
+				// refreshed by LastHeardFrom and CollectorUpdateGeneration
+			projectionString =
+				"ifThenElse(State == \"Claimed\",\"Name State Activity StartdIpAddr AccountingGroup Owner RemoteUser Requirements SlotWeight ConcurrencyLimits MyAddress LastHeardFrom CollectorUpdateGeneration\",\"\") ";
+		} else {
+			projectionString =
+				"ifThenElse(State == \"Claimed\",\"Name State Activity StartdIpAddr AccountingGroup Owner RemoteUser Requirements SlotWeight ConcurrencyLimits\",\"\") ";
+			publicQuery.setDesiredAttrsExpr(projectionString);
+		}
 
 		dprintf(D_ALWAYS, "Not considering preemption, therefore constraining idle machines with %s\n", projectionString);
 	}
 
-	dprintf(D_ALWAYS,"  Getting startd private ads ...\n");
 	ClassAdList startdPvtAdList;
-	result = collects->query (privateQuery, startdPvtAdList);
-	if( result!=Q_OK ) {
-		dprintf(D_ALWAYS, "Couldn't fetch ads: %s\n", getStrQueryResult(result));
-		return false;
+    CondorError errstack;
+	if (want_incremental_ads) {
+			// Only fetch the startd ads that changed since the last
+			// cycle, and hand the cycle copies of the resident ones.
+		dprintf(D_ALWAYS,"  Updating startd private ads ...\n");
+		if (!residentStartdPvtAds.Refresh(collects, NULL, NULL,
+										  incremental_ads_full_interval)) {
+			return false;
+		}
+		dprintf(D_ALWAYS,"  Updating startd ads ...\n");
+		if (!residentStartdAds.Refresh(collects, strSlotConstraint, projectionString,
+									   incremental_ads_full_interval, &errstack)) {
+			if (errstack.code()) {
+				dprintf(D_ALWAYS, "Couldn't fetch ads: %s\n", errstack.getFullText(false).c_str());
+			}
+			return false;
+		}
+		residentStartdPvtAds.CopyAds(startdPvtAdList);
+	} else {
+		dprintf(D_ALWAYS,"  Getting startd private ads ...\n");
+		result = collects->query (privateQuery, startdPvtAdList);
+		if( result!=Q_OK ) {
+			dprintf(D_ALWAYS, "Couldn't fetch ads: %s\n", getStrQueryResult(result));
+			return false;
+		}
 	}
 
-    CondorError errstack;
-	dprintf(D_ALWAYS, "  Getting Scheduler, Submitter and Machine ads ...\n");
+	dprintf(D_ALWAYS, "  Getting Scheduler, Submitter%s ads ...\n",
+			want_incremental_ads ? "" : " and Machine");
 	result = collects->query (publicQuery, allAds, &errstack);
 	if( result!=Q_OK ) {
 		dprintf(D_ALWAYS, "Couldn't fetch ads: %s\n", 
@@ -3503,6 +3564,9 @@ obtainAdsFromCollector (
            );
 		return false;
 	}
+	if (want_incremental_ads) {
+		residentStartdAds.CopyAds(allAds);
+	}
 
 	dprintf(D_ALWAYS, "  Sorting %d ads ...\n",allAds.MyLength());
 
@@ -3640,6 +3704,8 @@ obtainAdsFromCollector (
 					me->sequenceNum = newSequence;
 					me->remoteHost = strdup(remoteHost);
 					me->oldAd = new ClassAd(*ad); 
+						// resident ads are chained to the cache
+					me->oldAd->ChainCollapse();
 					stashedAds->insert(adID, me); 
 				} else {
 					/*
@@ -3782,6 +3848,16 @@ Matchmaker::OptimizeMachineAdForMatchmaking(ClassAd *ad)
 		// matchmaking (i.e. in the call to IsAMatch()), so
 		// optimize it accordingly.
 	std::string error_msg;
+	if( ad->GetChainedParentAd() && !ad->LookupIgnoreChain(ATTR_REQUIREMENTS) ) {
+			// A resident ad chained to the cache.  Optimizing replaces
+			// Requirements and saves the original as
+			// UnoptimizedRequirements, which only works in the ad itself.
+		ExprTree *requirements = ad->LookupExpr(ATTR_REQUIREMENTS);
+		if( requirements ) {
+			ExprTree *copy = requirements->Copy();
+			ad->Insert(ATTR_REQUIREMENTS, copy);
+		}
+	}
 	if( !classad::MatchClassAd::OptimizeRightAdForMatchmaking( ad, &error_msg ) ) {
 		MyString name;
 		ad->LookupString(ATTR_NAME,name);
@@ -4659,6 +4735,12 @@ negotiate(char const* groupName, char const *submitterName, const ClassAd *sched
                 remoteHost = NULL;
 			}
 
+			// the match will change the offer, so the machine index
+			// no longer describes it
+			machineIndex.Invalidate(offer);
+			// ... and entries for it in other cached match lists are stale
+			offerHandouts.hand_out(offer);
+
 			// 2e(ii).  perform the matchmaking protocol
 			result = matchmakingProtocol (request, offer, claimIds, sock, 
 					submitterName, scheddAddr.c_str());
@@ -4773,9 +4855,20 @@ EvalNegotiatorMatchRank(char const *expr_name,ExprTree *expr,
                         ClassAd &request,ClassAd *resource)
 {
 	classad::Value result;
+	bool evaluated = expr && EvalExprTree(expr,resource,&request,result);
+
+	return MatchRankValue(expr_name,expr,evaluated,result);
+}
+
+	// The rank given by the result of evaluating expr, or -FLT_MAX
+	// (and a complaint) if there isn't one.
+float Matchmaker::
+MatchRankValue(char const *expr_name,ExprTree *expr,
+               bool evaluated,classad::Value const &result)
+{
 	float rank = -(FLT_MAX);
 
-	if(expr && EvalExprTree(expr,resource,&request,result)) {
+	if(expr && evaluated) {
 		double val;
 		if( result.IsNumber(val) ) {
 			rank = (float)val;
@@ -4938,16 +5031,25 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 		// the top entry in our MatchList if we have one.  The 
 		// MatchList is essentially just a sorted cache of the machine
 		// ads that match jobs of this type (i.e. same autocluster).
+	MatchListKey matchListKey;
+	matchListKey.submitter = submitterName;
+	matchListKey.schedd = scheddAddr;
+	matchListKey.autocluster = requestAutoCluster;
+	matchListKey.prio = preemptPrio;
+	matchListKey.only_for_startdrank = only_for_startdrank;
+
+	MatchList = NULL;
+	if ( requestAutoCluster != -1 ) {
+		MatchList = findMatchList(matchListKey);
+	}
 	if ( MatchList &&
-		 cachedAutoCluster != -1 &&
-		 cachedAutoCluster == requestAutoCluster &&
-		 cachedPrio == preemptPrio &&
-		 cachedOnlyForStartdRank == only_for_startdrank &&
-		 strcmp(cachedName,submitterName)==0 &&
-		 strcmp(cachedAddr,scheddAddr)==0 &&
-		 MatchList->cache_still_valid(request,PreemptionReq,PreemptionRank,
+		 !MatchList->cache_still_valid(request,PreemptionReq,PreemptionRank,
 					preemption_req_unstable,preemption_rank_unstable) )
 	{
+		dropMatchList(matchListKey);
+		MatchList = NULL;
+	}
+	if ( MatchList ) {
 		// we can use cached information.  pop off the best
 		// candidate from our sorted list.
 		while( (cached_bestSoFar = MatchList->pop_candidate(candidateDslotClaims)) ) {
@@ -4976,6 +5078,18 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 			submitterName,
 			scheddAddr
 			);
+		if ( ! cached_bestSoFar && MatchList->stale_skipped() ) {
+				// The list ran out because offers in it were handed
+				// out to other requests since it was made, not because
+				// of this autocluster's own matches, so the offers
+				// that are left may still match; look again.
+			dprintf(D_FULLDEBUG,"Discarding cached MatchList with %d offers handed out elsewhere\n",
+				MatchList->stale_skipped());
+			dropMatchList(matchListKey);
+			MatchList = NULL;
+		}
+	}
+	if ( MatchList ) {
 		if ( ! cached_bestSoFar ) {
 				// if we don't have a candidate, fill in
 				// all the rejection reason counts.
@@ -4995,12 +5109,6 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 		return cached_bestSoFar;
 	}
 
-		// Delete our old MatchList, since we know that if we made it here
-		// we no longer are dealing with a job from the same autocluster.
-		// (someday we will store it in case we see another job with
-		// the same autocluster, but we aren't that smart yet...)
-	DeleteMatchList();
-
 		// Create a new MatchList cache if desired via config file,
 		// and the job ad contains autocluster info,
 		// and there are machines potentially available to consider.		
@@ -5008,12 +5116,7 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 		 requestAutoCluster != -1 &&	// job ad contains autocluster info
 		 startdAds.Length() > 0 )		// machines available
 	{
-		MatchList = new MatchListType( startdAds.Length() );
-		cachedAutoCluster = requestAutoCluster;
-		cachedPrio = preemptPrio;
-		cachedOnlyForStartdRank = only_for_startdrank;
-		cachedName = strdup(submitterName);
-		cachedAddr = strdup(scheddAddr);
+		MatchList = addMatchList( matchListKey, startdAds.Length() );
 	}
 
 
@@ -5025,27 +5128,62 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 	rejPreemptForRank = 0;
 	rejForSubmitterLimit = 0;
 
-	bool allow_pslot_preemption = param_boolean("ALLOW_PSLOT_PREEMPTION", false);
+		// these are looked up once per request, so don't parse them each time
+	static param_cached<bool> allow_pslot_preemption_knob("ALLOW_PSLOT_PREEMPTION", false);
+	static param_cached<int> num_threads_knob("NEGOTIATOR_NUM_THREADS", 1);
+
+	bool allow_pslot_preemption = allow_pslot_preemption_knob;
 	double allocatedWeight = 0.0;
 		// Set up for parallel matchmaking, if enabled
 	std::vector<compat_classad::ClassAd *> par_candidates;
-	std::vector<compat_classad::ClassAd *> par_matches;
+	std::vector<OfferEval> par_results;
+	size_t par_next = 0;
+
+		// Find the offers that could satisfy the job's Requirements,
+		// so the rest can be skipped without evaluating them.
+	bool use_match_index = want_match_index && machineIndex.Select(request);
+	if ( use_match_index ) {
+		dprintf(D_FULLDEBUG, "Match index: %d of %d offers are candidates\n",
+				machineIndex.NumCandidates(), machineIndex.NumMachines());
+	}
 
-	int num_threads =  param_integer("NEGOTIATOR_NUM_THREADS", 1);
+	int num_threads = num_threads_knob;
 	if (num_threads > 1) {
 		startdAds.Open();
 		par_candidates.reserve(startdAds.Length());
 		while ((candidate = startdAds.Next())) {
+			if ( use_match_index && !machineIndex.IsCandidate(candidate) ) {
+				continue;
+			}
+				// consumption policies rewrite the request for each
+				// offer, so those offers are evaluated in the scan
+			if ( cp_supports_policy(*candidate) ) {
+				continue;
+			}
 			par_candidates.push_back(candidate);
 		}
 		startdAds.Close();
-		ParallelIsAMatch(&request, par_candidates, par_matches, num_threads, false);
+
+		double par_start = UtcTime::getTimeDouble();
+		int par_matched = evalOffersInParallel(request, par_candidates, par_results, num_threads);
+		double par_time = UtcTime::getTimeDouble() - par_start;
+		negotiation_cycle_stats[0]->par_match_offers += par_candidates.size();
+		negotiation_cycle_stats[0]->par_match_time += par_time;
+		dprintf(D_FULLDEBUG, "Parallel matchmaking: %d of %d offers match (%.3fs, %d threads)\n",
+				par_matched, (int)par_candidates.size(), par_time, num_threads);
 	}
 
 	// scan the offer ads
 	startdAds.Open ();
 	while ((candidate = startdAds.Next ())) {
 
+			// par_candidates is in the same order as startdAds, so
+			// this offer's parallel result, if any, is the next one
+		const OfferEval *par_eval = NULL;
+		if ( par_next < par_candidates.size() && par_candidates[par_next] == candidate ) {
+			par_eval = &par_results[par_next++];
+		}
+
 		if( IsDebugVerbose(D_MACHINE) ) {
 			dprintf(D_MACHINE,"Testing whether the job matches with the following machine ad:\n");
 			dPrintAd(D_MACHINE, *candidate);
@@ -5079,12 +5217,14 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
         // requested via consumption policy must also be available from
         // the resource
 		bool is_a_match = false;
-		if (num_threads > 1) {
-			is_a_match = cp_sufficient && 
-				(par_matches.end() != 
-					std::find(par_matches.begin(), par_matches.end(), candidate));
+		if (par_eval) {
+			is_a_match = cp_sufficient && par_eval->is_a_match;
 		} else {
-			is_a_match = cp_sufficient && IsAMatch(&request, candidate);
+				// The job's Requirements are evaluated against every
+				// offer, so they are compiled once for the whole scan.
+			is_a_match = cp_sufficient &&
+				( !use_match_index || machineIndex.IsCandidate(candidate) ) &&
+				IsAMatch(&request, candidate, want_compiled_requirements);
 		}
 
         if (has_cp) {
@@ -5097,11 +5237,17 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 		if (!is_a_match && ConsiderPreemption) {
 			bool jobWantsMultiMatch = false;
 			request.LookupBool(ATTR_WANT_PSLOT_PREEMPTION, jobWantsMultiMatch);
-			if (param_boolean("ALLOW_PSLOT_PREEMPTION", false) && jobWantsMultiMatch) {
+			if (allow_pslot_preemption && jobWantsMultiMatch) {
 				is_a_match = pslotMultiMatch(&request, candidate, preemptPrio, candidateDslotClaims);
 				pslotRankMatch = is_a_match;
 			}
 		}
+			// the parallel results only describe a plain match, and
+			// only have the preemption results if the offer is claimed
+		if ( pslotRankMatch ) {
+			par_eval = NULL;
+		}
+		bool par_preempt = par_eval && par_eval->claimed;
 
 		int cluster_id=-1,proc_id=-1;
 		MyString machine_name;
@@ -5155,8 +5301,10 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 						machine_name.Value(), cluster_id, proc_id);
 				continue;
 			}
-			if ( !(EvalExprTree(rankCondStd, candidate, &request, result) && 
-				   result.IsBooleanValue(val) && val) ) {
+			bool startd_prefers = par_preempt ? par_eval->startd_prefers :
+				(EvalExprTree(rankCondStd, candidate, &request, result) &&
+				 result.IsBooleanValue(val) && val);
+			if ( !startd_prefers ) {
 					// offer does not strictly prefer this request.
 					// try the next offer since only_for_statdrank flag is set
 
@@ -5176,8 +5324,10 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 		//       tested above for the only condition we care about.
 		if ( (!remoteUser.empty()) &&
 			 (!only_for_startdrank) ) {
-			if( EvalExprTree(rankCondStd, candidate, &request, result) && 
-				result.IsBooleanValue(val) && val ) {
+			bool startd_prefers = par_preempt ? par_eval->startd_prefers :
+				(EvalExprTree(rankCondStd, candidate, &request, result) &&
+				 result.IsBooleanValue(val) && val);
+			if( startd_prefers ) {
 					// offer strictly prefers this request to the one
 					// currently being serviced; preempt for rank
 				candidatePreemptState = RANK_PREEMPTION;
@@ -5189,9 +5339,11 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 				candidatePreemptState = PRIO_PREEMPTION;
 					// (1) we need to make sure that PreemptionReq's hold (i.e.,
 					// if the PreemptionReq expression isn't true, dont preempt)
-				if (PreemptionReq && 
-					!(EvalExprTree(PreemptionReq,candidate,&request,result) &&
-					  result.IsBooleanValue(val) && val) ) {
+				bool preempt_req_ok = par_preempt ? par_eval->preempt_req_ok :
+					(!PreemptionReq ||
+					 (EvalExprTree(PreemptionReq,candidate,&request,result) &&
+					  result.IsBooleanValue(val) && val));
+				if ( !preempt_req_ok ) {
 					rejPreemptForPolicy++;
 					dprintf(D_MACHINE,
 							"PREEMPTION_REQUIREMENTS prevents job %d.%d from claiming %s.\n",
@@ -5201,8 +5353,10 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 					// (2) we need to make sure that the machine ranks the job
 					// at least as well as the one it is currently running 
 					// (i.e., rankCondPrioPreempt holds)
-				if(!(EvalExprTree(rankCondPrioPreempt,candidate,&request,result)&&
-					 result.IsBooleanValue(val) && val ) ) {
+				bool prio_preempt_ok = par_preempt ? par_eval->prio_preempt_ok :
+					(EvalExprTree(rankCondPrioPreempt,candidate,&request,result) &&
+					 result.IsBooleanValue(val) && val);
+				if( !prio_preempt_ok ) {
 						// machine doesn't like this job as much -- find another
 					rejPreemptForRank++;
 					dprintf(D_MACHINE,
@@ -5245,7 +5399,25 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 			}
 		}
 
-		calculateRanks(request, candidate, candidatePreemptState, candidateRankValue, candidatePreJobRankValue, candidatePostJobRankValue, candidatePreemptRankValue);
+		if ( par_eval && !m_staticRanks &&
+			 (candidatePreemptState == NO_PREEMPTION || par_preempt) )
+		{
+			candidateRankValue = par_eval->rank;
+			candidatePreJobRankValue = MatchRankValue(
+				"NEGOTIATOR_PRE_JOB_RANK", NegotiatorPreJobRank,
+				par_eval->pre_job_rank_ok, par_eval->pre_job_rank);
+			candidatePostJobRankValue = MatchRankValue(
+				"NEGOTIATOR_POST_JOB_RANK", NegotiatorPostJobRank,
+				par_eval->post_job_rank_ok, par_eval->post_job_rank);
+			candidatePreemptRankValue = -(FLT_MAX);
+			if ( candidatePreemptState != NO_PREEMPTION ) {
+				candidatePreemptRankValue = MatchRankValue(
+					"PREEMPTION_RANK", PreemptionRank,
+					par_eval->preempt_rank_ok, par_eval->preempt_rank);
+			}
+		} else {
+			calculateRanks(request, candidate, candidatePreemptState, candidateRankValue, candidatePreJobRankValue, candidatePostJobRankValue, candidatePreemptRankValue);
+		}
 
 		if ( MatchList ) {
 			MatchList->add_candidate(
@@ -5320,6 +5492,9 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 	}
 	startdAds.Close ();
 
+		// the compiled Requirements refer to the request ad
+	compat_classad::flushTheMatchAdCompiledExprs();
+
 	if ( MatchList ) {
 		MatchList->set_diagnostics(rejForNetwork, rejForNetworkShare, 
 		    rejForConcurrencyLimit,
@@ -5334,6 +5509,10 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, ClassAd
 		}
 		// Pop top candidate off the list to hand out as best match
 		bestSoFar = MatchList->pop_candidate(bestDslotClaims);
+			// give back the space reserved for offers that didn't match
+			// and make room for this list in the cache
+		MatchList->compact();
+		trimMatchListCache();
 	}
 
 	if(!bestSoFar)
@@ -6082,6 +6261,7 @@ reeval(ClassAd *ad)
 	if(oldAdEntry) {
 		delete(oldAdEntry->oldAd);
 		oldAdEntry->oldAd = new ClassAd(*ad);
+		oldAdEntry->oldAd->ChainCollapse();
 	}
 }
 
@@ -6090,7 +6270,7 @@ unsigned int Matchmaker::HashFunc(const MyString &Key) {
 }
 
 Matchmaker::MatchListType::
-MatchListType(int maxlen)
+MatchListType(int maxlen, const OfferHandouts *handouts)
 {
 	ASSERT(maxlen > 0);
 	AdListArray = new AdListEntry[maxlen];
@@ -6107,6 +6287,8 @@ MatchListType(int maxlen)
 	m_rejPreemptForRank = 0;
 	m_rejForSubmitterLimit = 0;
 	m_submitterLimit = 0.0f;
+	m_handouts = handouts;
+	m_staleSkipped = 0;
 }
 
 Matchmaker::MatchListType::
@@ -6146,9 +6328,11 @@ pop_candidate(string &dslot_claims)
 	ClassAd* candidate = NULL;
 
 	while ( adListHead < adListLen && !candidate ) {
-		candidate = AdListArray[adListHead].ad;
-		if ( candidate ) {
+		if ( usable(AdListArray[adListHead]) ) {
+			candidate = AdListArray[adListHead].ad;
 			dslot_claims = AdListArray[adListHead].DslotClaims;
+		} else if ( AdListArray[adListHead].ad ) {
+			m_staleSkipped++;
 		}
 		adListHead++;
 	}
@@ -6156,6 +6340,40 @@ pop_candidate(string &dslot_claims)
 	return candidate;
 }
 
+bool Matchmaker::MatchListType::
+usable(const AdListEntry &entry) const
+{
+	if ( !entry.ad ) {
+		return false;
+	}
+	return !m_handouts || !m_handouts->stale(entry.ad, entry.Serial);
+}
+
+void Matchmaker::MatchListType::
+compact()
+{
+	if ( adListLen == adListMaxLen || adListLen == 0 ) {
+		return;
+	}
+	AdListEntry *compacted = new AdListEntry[adListLen];
+	for ( int i = 0; i < adListLen; i++ ) {
+		compacted[i] = AdListArray[i];
+	}
+	delete [] AdListArray;
+	AdListArray = compacted;
+	adListMaxLen = adListLen;
+}
+
+size_t Matchmaker::MatchListType::
+memory_size() const
+{
+	size_t size = sizeof(MatchListType) + adListMaxLen * sizeof(AdListEntry);
+	for ( int i = 0; i < adListLen; i++ ) {
+		size += AdListArray[i].DslotClaims.Capacity();
+	}
+	return size;
+}
+
 // This method assumes the ad being inserted was just popped from the
 // top of the list. Specicifically, we assume there is room at the top
 // of the list for insertion, the list is sorted, and the ad being
@@ -6178,6 +6396,7 @@ insert_candidate(ClassAd * candidate,
 	new_entry.PreemptRankValue = candidatePreemptRankValue;
 	new_entry.PreemptStateValue = candidatePreemptState;
 	new_entry.DslotClaims.clear();
+	new_entry.Serial = m_handouts ? m_handouts->serial() : 0;
 
 		// Hand-rolled insertion sort; as the list was previously sorted,
 		// we know this will be O(n).
@@ -6212,7 +6431,9 @@ cache_still_valid(ClassAd &request, ExprTree *preemption_req, ExprTree *preempti
 		int temp_adListHead = adListHead;
 
 		while ( temp_adListHead < adListLen && !candidate ) {
-			candidate = AdListArray[temp_adListHead].ad;
+			if ( usable(AdListArray[temp_adListHead]) ) {
+				candidate = AdListArray[temp_adListHead].ad;
+			}
 			temp_adListHead++;
 		}
 
@@ -6322,6 +6543,7 @@ add_candidate(ClassAd * candidate,
 	AdListArray[adListLen].PreemptRankValue = candidatePreemptRankValue;
 	AdListArray[adListLen].PreemptStateValue = candidatePreemptState;
 	AdListArray[adListLen].DslotClaims = candidateDslotClaims;
+	AdListArray[adListLen].Serial = m_handouts ? m_handouts->serial() : 0;
 
     // This hack allows me to avoid mucking with the pseudo-que-like semantics of MatchListType, 
     // which ought to be replaced with something cleaner like std::deque<AdListEntry>
@@ -6335,18 +6557,101 @@ add_candidate(ClassAd * candidate,
 
 void Matchmaker::DeleteMatchList()
 {
-	if( MatchList ) {
-		delete MatchList;
+	for ( MatchListLRU::iterator it = matchListCache.begin();
+		  it != matchListCache.end(); ++it )
+	{
+		delete it->list;
+	}
+	matchListCache.clear();
+	matchListIndex.clear();
+	matchListCacheBytes = 0;
+	MatchList = NULL;
+	offerHandouts.clear();
+}
+
+bool Matchmaker::MatchListKey::
+operator<(const MatchListKey &other) const
+{
+	int cmp = submitter.compare(other.submitter);
+	if ( cmp ) return cmp < 0;
+	cmp = schedd.compare(other.schedd);
+	if ( cmp ) return cmp < 0;
+	if ( autocluster != other.autocluster ) return autocluster < other.autocluster;
+	if ( prio != other.prio ) return prio < other.prio;
+	return only_for_startdrank < other.only_for_startdrank;
+}
+
+bool Matchmaker::OfferHandouts::
+stale(ClassAd *offer, unsigned since) const
+{
+	std::map<ClassAd*, unsigned>::const_iterator it = m_handed_out.find(offer);
+	return it != m_handed_out.end() && it->second > since;
+}
+
+Matchmaker::MatchListType *Matchmaker::
+findMatchList(const MatchListKey &key)
+{
+	std::map<MatchListKey, MatchListLRU::iterator>::iterator it = matchListIndex.find(key);
+	if ( it == matchListIndex.end() ) {
+		return NULL;
+	}
+		// move it to the front
+	matchListCache.splice(matchListCache.begin(), matchListCache, it->second);
+	return it->second->list;
+}
+
+Matchmaker::MatchListType *Matchmaker::
+addMatchList(const MatchListKey &key, int maxlen)
+{
+	dropMatchList(key);
+
+	MatchListCacheEntry entry;
+	entry.key = key;
+	entry.list = new MatchListType(maxlen, &offerHandouts);
+	entry.bytes = entry.list->memory_size();
+	matchListCacheBytes += entry.bytes;
+	matchListCache.push_front(entry);
+	matchListIndex[key] = matchListCache.begin();
+	return entry.list;
+}
+
+void Matchmaker::
+dropMatchList(const MatchListKey &key)
+{
+	std::map<MatchListKey, MatchListLRU::iterator>::iterator it = matchListIndex.find(key);
+	if ( it == matchListIndex.end() ) {
+		return;
+	}
+	if ( MatchList == it->second->list ) {
 		MatchList = NULL;
 	}
-	cachedAutoCluster = -1;
-	if ( cachedName ) {
-		free(cachedName);
-		cachedName = NULL;
+	matchListCacheBytes -= it->second->bytes;
+	delete it->second->list;
+	matchListCache.erase(it->second);
+	matchListIndex.erase(it);
+}
+
+void Matchmaker::
+trimMatchListCache()
+{
+	if ( matchListCache.empty() ) {
+		return;
 	}
-	if ( cachedAddr ) {
-		free(cachedAddr);
-		cachedAddr = NULL;
+
+		// only the most recently used list, the one just filled in,
+		// has changed size since it was counted
+	MatchListCacheEntry &mru = matchListCache.front();
+	matchListCacheBytes -= mru.bytes;
+	mru.bytes = mru.list->memory_size();
+	matchListCacheBytes += mru.bytes;
+
+		// never drop the most recently used list; it may be MatchList
+	while ( matchListCacheBytes > matchListCacheMaxBytes && matchListCache.size() > 1 ) {
+		MatchListCacheEntry &lru = matchListCache.back();
+		dprintf(D_FULLDEBUG, "Discarding cached MatchList for autocluster %d of %s to stay within NEGOTIATOR_MATCHLIST_CACHE_MAX_MB\n",
+				lru.key.autocluster, lru.key.submitter.c_str());
+		MatchListKey key = lru.key;
+		dropMatchList(key);
 	}
 }
 
@@ -6808,6 +7113,8 @@ Matchmaker::publishNegotiationCycleStats( ClassAd *ad )
         ATTR_LAST_NEGOTIATION_CYCLE_REJECTIONS,
         ATTR_LAST_NEGOTIATION_CYCLE_PIES,
         ATTR_LAST_NEGOTIATION_CYCLE_PIE_SPINS,
+        ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_OFFERS,
+        ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_TIME,
         ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_DURATION,
         ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_CPU_TIME,
         ATTR_LAST_NEGOTIATION_CYCLE_CPU_TIME,
@@ -6862,6 +7169,8 @@ Matchmaker::publishNegotiationCycleStats( ClassAd *ad )
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_ACTIVE_SUBMITTER_COUNT, i, (int)s->active_submitters.size());
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PIES, i, s->pies );
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PIE_SPINS, i, s->pie_spins );
+		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_OFFERS, i, s->par_match_offers );
+		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_TIME, i, s->par_match_time );
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_DURATION, i, s->prefetch_duration );
 		// TODO Should we truncate these to integer values?
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_CPU_TIME, i, s->prefetch_cpu_time );
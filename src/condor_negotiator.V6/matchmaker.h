@@ -28,10 +28,13 @@
 #include "dc_collector.h"
 #include "condor_ver_info.h"
 #include "matchmaker_negotiate.h"
+#include "matchmaker_index.h"
+#include "collector_ad_cache.h"
 
 #include <vector>
 #include <string>
 #include <map>
+#include <list>
 #include <algorithm>
 
 /* FILESQL include */
@@ -196,6 +199,43 @@ class Matchmaker : public Service
 		typedef std::map<ClassAd *, JobRanks> RanksMapType;
 		RanksMapType ranksMap;
 
+			// What evaluating a request against one offer found, when
+			// the offers are evaluated in parallel (NEGOTIATOR_NUM_THREADS
+			// > 1).  The preemption results are only set for claimed
+			// offers; ranks are kept as values so that conversion
+			// errors are reported from the negotiator's own thread.
+		struct OfferEval {
+			bool is_a_match;
+			bool claimed;
+			bool startd_prefers;		// rankCondStd
+			bool preempt_req_ok;		// PREEMPTION_REQUIREMENTS
+			bool prio_preempt_ok;		// rankCondPrioPreempt
+			double rank;				// job's Rank of the offer
+			bool pre_job_rank_ok;
+			bool post_job_rank_ok;
+			bool preempt_rank_ok;
+			classad::Value pre_job_rank;
+			classad::Value post_job_rank;
+			classad::Value preempt_rank;
+		};
+
+			// Per-thread scratch ads for evalOffersInParallel()
+		struct ParallelMatchSlot;
+		std::vector<ParallelMatchSlot*> par_match_slots;
+
+		/** Evaluate the request against each offer, on num_threads
+			threads, filling in results[i] for offers[i].  Offers with
+			a consumption policy must not be passed here.
+			@return The number of offers that match.
+		*/
+		int evalOffersInParallel(ClassAd &request, std::vector<ClassAd*> &offers,
+								 std::vector<OfferEval> &results, int num_threads);
+		void evalOffer(ParallelMatchSlot &slot, ClassAd *offer, OfferEval &result);
+		void clearParallelMatchSlots();
+
+		static float MatchRankValue(char const *expr_name, ExprTree *expr,
+									bool evaluated, classad::Value const &result);
+
 		/** Negotiate w/ one schedd for one user, for one 'pie spin'.
             @param groupName name of group negotiating under (or NULL)
 			@param submitterName Name attribute from the submitter ad.
@@ -370,6 +410,13 @@ class Matchmaker : public Service
 		ExprTree *NegotiatorPostJobRank; // rank applied after job rank
 		bool want_globaljobprio;	// cached value of config knob USE_GLOBAL_JOB_PRIOS
 		bool want_matchlist_caching;	// should we cache matches per autocluster?
+		bool want_compiled_requirements; // compile job Requirements for the offer scan?
+		bool want_match_index;		// prefilter offers with machineIndex?
+		MachineAdIndex machineIndex;	// index of this cycle's startd ads
+		bool want_incremental_ads;	// keep startd ads between cycles?
+		int incremental_ads_full_interval;	// refetch all startd ads this often
+		CollectorAdCache residentStartdAds;
+		CollectorAdCache residentStartdPvtAds;
 		bool PublishCrossSlotPrios; // value of knob NEGOTIATOR_CROSS_SLOT_PRIOS, default of false
 		bool ConsiderPreemption; // if false, negotiation is faster (default=true)
 		bool ConsiderEarlyPreemption; // if false, do not preempt slots that still have retirement time
@@ -443,6 +490,7 @@ class Matchmaker : public Service
 				PreemptRankValue = -(FLT_MAX);
 				PreemptStateValue = (Matchmaker::PreemptState)-1;
 				ad = NULL;
+				Serial = 0;
 			}			  
 			double			RankValue;
 			double			PreJobRankValue;
@@ -451,7 +499,28 @@ class Matchmaker : public Service
 			PreemptState	PreemptStateValue;
 			MyString			DslotClaims;
 			ClassAd *ad;
+			unsigned		Serial;	// OfferHandouts::serial() when added
+		};
+
+		// The offers handed out so far in this negotiation cycle.
+		// Each is stamped with the value of a counter at the time, so
+		// a cached match list can tell that its entry for an offer
+		// was made before the offer was handed out (and is stale),
+		// while an entry made after (a partitionable slot returned to
+		// the list it was popped from) is not.
+		class OfferHandouts
+		{
+		public:
+			OfferHandouts() : m_serial(0) {}
+			unsigned serial() const { return m_serial; }
+			void hand_out(ClassAd *offer) { m_handed_out[offer] = ++m_serial; }
+			bool stale(ClassAd *offer, unsigned since) const;
+			void clear() { m_handed_out.clear(); }
+		private:
+			std::map<ClassAd*, unsigned> m_handed_out;
+			unsigned m_serial;
 		};
+		OfferHandouts offerHandouts;
 
 		void DeleteMatchList();
 
@@ -507,16 +576,26 @@ class Matchmaker : public Service
 			void sort();
 			int length() { return adListLen - adListHead; }
 
-			MatchListType(int maxlen);
+			MatchListType(int maxlen, const OfferHandouts *handouts);
 			~MatchListType();
 
 			void increment_rejForSubmitterLimit() { m_rejForSubmitterLimit++; }
 
+				// How many entries pop_candidate() has skipped because
+				// the offer was handed out after the entry was made.
+			int stale_skipped() const { return m_staleSkipped; }
+
+				// Give back the unused space at the end of the list,
+				// once all the candidates have been added.
+			void compact();
+			size_t memory_size() const;
+
 
 		private:
 			
 			// AdListEntry* peek_candidate();
 			static int sort_compare(const void*, const void*);
+			bool usable(const AdListEntry &entry) const;
 			AdListEntry* AdListArray;			
 			int adListMaxLen;	// max length of AdListArray
 			int adListLen;		// current length of AdListArray
@@ -531,15 +610,42 @@ class Matchmaker : public Service
 			int m_rejPreemptForRank;    //   - startd RANKs new job lower?
 			int m_rejForSubmitterLimit;     //  - not enough group quota?
 			float m_submitterLimit;
-			
+			const OfferHandouts *m_handouts;
+			int m_staleSkipped;
 			
 		};
+			// the match list for the request being matched, if any;
+			// it belongs to matchListCache
 		MatchListType* MatchList;
-		int cachedAutoCluster;
-		char* cachedName;
-		char* cachedAddr;
-		double cachedPrio;
-		bool cachedOnlyForStartdRank;
+
+			// Match lists are cached for every (submitter, schedd,
+			// autocluster, priority) negotiated in the cycle, not just
+			// the most recent, since submitters take turns.  The least
+			// recently used are discarded to stay within
+			// NEGOTIATOR_MATCHLIST_CACHE_MAX_MB.
+		struct MatchListKey {
+			std::string submitter;
+			std::string schedd;
+			int autocluster;
+			double prio;
+			bool only_for_startdrank;
+			bool operator<(const MatchListKey &other) const;
+		};
+		struct MatchListCacheEntry {
+			MatchListKey key;
+			MatchListType *list;
+			size_t bytes;	// list->memory_size() when last counted
+		};
+		typedef std::list<MatchListCacheEntry> MatchListLRU;
+		MatchListLRU matchListCache;		// most recently used first
+		std::map<MatchListKey, MatchListLRU::iterator> matchListIndex;
+		size_t matchListCacheBytes;			// sum of the entries' bytes
+		size_t matchListCacheMaxBytes;
+
+		MatchListType *findMatchList(const MatchListKey &key);
+		MatchListType *addMatchList(const MatchListKey &key, int maxlen);
+		void dropMatchList(const MatchListKey &key);
+		void trimMatchListCache();
 
         // set at startup/restart/reinit
         GroupEntry* hgq_root_group;
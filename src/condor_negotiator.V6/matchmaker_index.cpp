@@ -0,0 +1,591 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_attributes.h"
+#include "condor_classad.h"
+#include "consumption_policy.h"
+#include "matchmaker_index.h"
+
+	// Don't index more than this many attributes in one cycle; an
+	// attribute is only indexed because some job constrained it, so
+	// this is a limit on pathological pools, not on ordinary ones.
+static const size_t MAX_INDEXED_ATTRS = 64;
+
+	// How deep to follow job attribute references when deciding
+	// whether a job expression depends on the machine.
+static const int MAX_JOB_VALUE_DEPTH = 8;
+
+	// Group ids in AttrIndex::group_of for machines not in a group.
+static const int GROUP_MISSING = -1;
+static const int GROUP_UNINDEXED = -2;
+
+static unsigned int
+ptr_hash_fn(ClassAd* const &index)
+{
+	intptr_t i = (intptr_t)index;
+
+	return (unsigned int)(i ^ (i >> 32));
+}
+
+	// Names that mean something other than a machine attribute when
+	// they appear unscoped in a job's Requirements, because they are
+	// special to the evaluator or are attributes of the match ad.
+static bool
+is_reserved_name(const std::string &name)
+{
+	static const char * const reserved[] = {
+		"other", "target", "my", "ad", "toplevel", "root", "self", "parent",
+		"CurrentTime", "symmetricMatch", "leftMatchesRight",
+		"rightMatchesLeft", "leftRankValue", "rightRankValue",
+		"lCtx", "rCtx", "left", "right", NULL
+	};
+	for (int i = 0; reserved[i]; i++) {
+		if (strcasecmp(name.c_str(), reserved[i]) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+	// Functions whose result depends only on their arguments.
+static bool
+is_pure_function(const std::string &name)
+{
+	static const char * const pure[] = {
+		"ifThenElse", "isUndefined", "isError", "isString", "isInteger",
+		"isReal", "isBoolean", "int", "real", "string", "floor", "ceiling",
+		"round", "pow", "quantize", "strcat", "toLower", "toUpper",
+		"size", "substr", NULL
+	};
+	for (int i = 0; pure[i]; i++) {
+		if (strcasecmp(name.c_str(), pure[i]) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static classad::ExprTree *
+strip_parens(classad::ExprTree *tree)
+{
+	while (tree && tree->GetKind() == classad::ExprTree::OP_NODE) {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+		if (op != classad::Operation::PARENTHESES_OP) {
+			break;
+		}
+		tree = t1;
+	}
+	return tree;
+}
+
+
+MachineAdIndex::MachineAdIndex() :
+	m_machine_ids(ptr_hash_fn),
+	m_select_stamp(0),
+	m_select_valid(false),
+	m_num_candidates(0)
+{
+}
+
+MachineAdIndex::~MachineAdIndex()
+{
+	Clear();
+}
+
+void
+MachineAdIndex::Clear()
+{
+	for (AttrIndexMap::iterator it = m_attrs.begin(); it != m_attrs.end(); ++it) {
+		delete it->second;
+	}
+	m_attrs.clear();
+	m_machines.clear();
+	m_machine_ids.clear();
+	m_always.clear();
+	m_selected.clear();
+	m_select_stamp = 0;
+	m_select_valid = false;
+	m_num_candidates = 0;
+}
+
+void
+MachineAdIndex::Build(ClassAdListDoesNotDeleteAds &startdAds)
+{
+	ClassAd *ad;
+
+	Clear();
+
+	m_machines.reserve(startdAds.Length());
+	startdAds.Open();
+	while ((ad = startdAds.Next())) {
+		int id = (int)m_machines.size();
+		if (m_machine_ids.insert(ad, id) != 0) {
+			continue;
+		}
+		m_machines.push_back(ad);
+			// The negotiator rewrites the job's RequestXxx attributes
+			// for each machine with a consumption policy, so the
+			// job's Requirements can't be judged ahead of time.
+		m_always.push_back(cp_supports_policy(*ad) ? 1 : 0);
+	}
+	startdAds.Close();
+
+	m_selected.assign(m_machines.size(), 0);
+}
+
+void
+MachineAdIndex::Invalidate(ClassAd *machine)
+{
+	int id;
+	if (m_machine_ids.lookup(machine, id) == 0) {
+		m_always[id] = 1;
+	}
+}
+
+MachineAdIndex::AttrIndex *
+MachineAdIndex::GetAttrIndex(const std::string &attr)
+{
+	AttrIndexMap::iterator it = m_attrs.find(attr);
+	if (it != m_attrs.end()) {
+		return it->second;
+	}
+	if (m_attrs.size() >= MAX_INDEXED_ATTRS) {
+		return NULL;
+	}
+
+	AttrIndex *index = new AttrIndex;
+	std::map<std::string, int> group_ids;
+	classad::ClassAdUnParser unparser;
+	std::string key;
+
+	index->group_of.resize(m_machines.size(), GROUP_MISSING);
+	for (size_t i = 0; i < m_machines.size(); i++) {
+		classad::ExprTree *tree = m_machines[i]->Lookup(attr);
+		if (!tree) {
+			index->missing.push_back((int)i);
+			continue;
+		}
+		if (tree->GetKind() != classad::ExprTree::LITERAL_NODE) {
+			index->group_of[i] = GROUP_UNINDEXED;
+			index->unindexed.push_back((int)i);
+			continue;
+		}
+
+		classad::Value val;
+		((classad::Literal*)tree)->GetValue(val);
+
+			// Group machines whose values print the same; those
+			// behave the same in every comparison.
+		key.clear();
+		unparser.Unparse(key, val);
+		std::map<std::string, int>::iterator git = group_ids.find(key);
+		int group;
+		if (git == group_ids.end()) {
+			group = (int)index->groups.size();
+			group_ids[key] = group;
+			index->groups.push_back(ValueGroup());
+			index->groups.back().value.CopyFrom(val);
+		} else {
+			group = git->second;
+		}
+		index->group_of[i] = group;
+		index->groups[group].machines.push_back((int)i);
+	}
+
+	m_attrs[attr] = index;
+
+	dprintf(D_FULLDEBUG, "MachineAdIndex: indexed %s: %d values, %d missing, %d not literal\n",
+			attr.c_str(), (int)index->groups.size(), (int)index->missing.size(),
+			(int)index->unindexed.size());
+
+	return index;
+}
+
+bool
+MachineAdIndex::IsMachineAttr(ClassAd &request, classad::ExprTree *tree, std::string &attr)
+{
+	if (!tree || tree->GetKind() != classad::ExprTree::ATTRREF_NODE) {
+		return false;
+	}
+
+	classad::ExprTree *scope = NULL;
+	bool absolute = false;
+	((classad::AttributeReference*)tree)->GetComponents(scope, attr, absolute);
+	if (absolute || is_reserved_name(attr)) {
+		return false;
+	}
+
+	if (scope) {
+			// Only TARGET.x, if the job doesn't redefine TARGET, or
+			// .RIGHT.x, which is what optimizing the job ad for
+			// matchmaking turns TARGET.x into.
+		std::string scope_name;
+		classad::ExprTree *inner = NULL;
+		if (scope->GetKind() != classad::ExprTree::ATTRREF_NODE) {
+			return false;
+		}
+		((classad::AttributeReference*)scope)->GetComponents(inner, scope_name, absolute);
+		if (inner) {
+			return false;
+		}
+		if (absolute) {
+			return strcasecmp(scope_name.c_str(), "right") == 0;
+		}
+		return strcasecmp(scope_name.c_str(), "target") == 0 &&
+			request.Lookup("target") == NULL;
+	}
+
+		// An unscoped name that the job doesn't have is looked up
+		// in the machine.
+	return request.Lookup(attr) == NULL;
+}
+
+bool
+MachineAdIndex::IsJobValue(ClassAd &request, classad::ExprTree *tree, int depth)
+{
+	if (!tree) {
+		return true;
+	}
+	if (depth > MAX_JOB_VALUE_DEPTH) {
+		return false;
+	}
+
+	switch (tree->GetKind()) {
+	case classad::ExprTree::LITERAL_NODE:
+		return true;
+
+	case classad::ExprTree::ATTRREF_NODE: {
+		classad::ExprTree *scope = NULL;
+		std::string attr;
+		bool absolute = false;
+		((classad::AttributeReference*)tree)->GetComponents(scope, attr, absolute);
+		if (absolute || is_reserved_name(attr)) {
+			return false;
+		}
+		if (scope) {
+				// Only MY.x
+			std::string scope_name;
+			classad::ExprTree *inner = NULL;
+			if (scope->GetKind() != classad::ExprTree::ATTRREF_NODE) {
+				return false;
+			}
+			((classad::AttributeReference*)scope)->GetComponents(inner, scope_name, absolute);
+			if (inner || absolute || strcasecmp(scope_name.c_str(), "my") != 0 ||
+				request.Lookup("my") != NULL)
+			{
+				return false;
+			}
+		}
+		classad::ExprTree *expr = request.Lookup(attr);
+		if (!expr) {
+			return false;
+		}
+		return IsJobValue(request, expr, depth + 1);
+	}
+
+	case classad::ExprTree::OP_NODE: {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+		return IsJobValue(request, t1, depth + 1) &&
+			IsJobValue(request, t2, depth + 1) &&
+			IsJobValue(request, t3, depth + 1);
+	}
+
+	case classad::ExprTree::FN_CALL_NODE: {
+		std::string name;
+		std::vector<classad::ExprTree*> args;
+		((classad::FunctionCall*)tree)->GetComponents(name, args);
+		if (!is_pure_function(name)) {
+			return false;
+		}
+		for (size_t i = 0; i < args.size(); i++) {
+			if (!IsJobValue(request, args[i], depth + 1)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+bool
+MachineAdIndex::GetPredicate(ClassAd &request, classad::ExprTree *conjunct, Predicate &pred)
+{
+	conjunct = strip_parens(conjunct);
+	if (!conjunct) {
+		return false;
+	}
+
+		// A bare machine attribute must be true
+	if (IsMachineAttr(request, conjunct, pred.attr)) {
+		pred.op = classad::Operation::__NO_OP__;
+		pred.value_on_left = false;
+		return true;
+	}
+
+	if (conjunct->GetKind() != classad::ExprTree::OP_NODE) {
+		return false;
+	}
+
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((classad::Operation*)conjunct)->GetComponents(op, t1, t2, t3);
+	switch (op) {
+	case classad::Operation::LESS_THAN_OP:
+	case classad::Operation::LESS_OR_EQUAL_OP:
+	case classad::Operation::NOT_EQUAL_OP:
+	case classad::Operation::EQUAL_OP:
+	case classad::Operation::GREATER_OR_EQUAL_OP:
+	case classad::Operation::GREATER_THAN_OP:
+	case classad::Operation::META_EQUAL_OP:
+	case classad::Operation::META_NOT_EQUAL_OP:
+		break;
+	default:
+		return false;
+	}
+
+	t1 = strip_parens(t1);
+	t2 = strip_parens(t2);
+	classad::ExprTree *job_side;
+	if (IsMachineAttr(request, t1, pred.attr)) {
+		job_side = t2;
+		pred.value_on_left = false;
+	} else if (IsMachineAttr(request, t2, pred.attr)) {
+		job_side = t1;
+		pred.value_on_left = true;
+	} else {
+		return false;
+	}
+	if (!IsJobValue(request, job_side, 0)) {
+		return false;
+	}
+
+	if (!request.EvaluateExpr(job_side, pred.value)) {
+		return false;
+	}
+	switch (pred.value.GetType()) {
+	case classad::Value::UNDEFINED_VALUE:
+	case classad::Value::ERROR_VALUE:
+	case classad::Value::BOOLEAN_VALUE:
+	case classad::Value::INTEGER_VALUE:
+	case classad::Value::REAL_VALUE:
+	case classad::Value::STRING_VALUE:
+		break;
+	default:
+		return false;
+	}
+
+	pred.op = op;
+	return true;
+}
+
+bool
+MachineAdIndex::GetPredicates(ClassAd &request, std::vector<Predicate> &preds)
+{
+	classad::ExprTree *reqs = request.Lookup(ATTR_REQUIREMENTS);
+	if (!reqs) {
+		return false;
+	}
+
+		// Walk the left spine of (a && b) && c, looking at the right
+		// operand of each && and finally at the leftmost one.
+	classad::ExprTree *tree = strip_parens(reqs);
+	while (tree) {
+		classad::ExprTree *conjunct = tree;
+		tree = NULL;
+		if (conjunct->GetKind() == classad::ExprTree::OP_NODE) {
+			classad::Operation::OpKind op;
+			classad::ExprTree *t1, *t2, *t3;
+			((classad::Operation*)conjunct)->GetComponents(op, t1, t2, t3);
+			if (op == classad::Operation::LOGICAL_AND_OP) {
+				conjunct = t2;
+				tree = strip_parens(t1);
+			}
+		}
+
+		Predicate pred;
+		if (GetPredicate(request, conjunct, pred)) {
+			preds.push_back(pred);
+		}
+	}
+
+	return !preds.empty();
+}
+
+bool
+MachineAdIndex::Satisfies(const Predicate &pred, const classad::Value &machine_val) const
+{
+	classad::Value result;
+	classad::Value truth;
+	classad::Value conj;
+	bool b = false;
+
+	if (pred.op == classad::Operation::__NO_OP__) {
+		result.CopyFrom(machine_val);
+	} else if (pred.value_on_left) {
+		classad::Value lhs, rhs;
+		lhs.CopyFrom(pred.value);
+		rhs.CopyFrom(machine_val);
+		classad::Operation::Operate(pred.op, lhs, rhs, result);
+	} else {
+		classad::Value lhs, rhs;
+		lhs.CopyFrom(machine_val);
+		rhs.CopyFrom(pred.value);
+		classad::Operation::Operate(pred.op, lhs, rhs, result);
+	}
+
+		// The conjunct passes if (conjunct && true) is true, which
+		// is how && would treat it in the Requirements.
+	truth.SetBooleanValue(true);
+	classad::Operation::Operate(classad::Operation::LOGICAL_AND_OP, result, truth, conj);
+	return conj.IsBooleanValue(b) && b;
+}
+
+void
+MachineAdIndex::EvalGroups(const Predicate &pred, const AttrIndex &index,
+						   std::vector<char> &pass, bool &pass_missing, int &count) const
+{
+	classad::Value undef;
+	undef.SetUndefinedValue();
+
+	pass.assign(index.groups.size(), 0);
+	count = (int)index.unindexed.size();
+	for (size_t g = 0; g < index.groups.size(); g++) {
+		if (Satisfies(pred, index.groups[g].value)) {
+			pass[g] = 1;
+			count += (int)index.groups[g].machines.size();
+		}
+	}
+	pass_missing = Satisfies(pred, undef);
+	if (pass_missing) {
+		count += (int)index.missing.size();
+	}
+}
+
+bool
+MachineAdIndex::Select(ClassAd &request)
+{
+	m_select_valid = false;
+	m_num_candidates = 0;
+
+	if (m_machines.empty()) {
+		return false;
+	}
+
+	std::vector<Predicate> preds;
+	if (!GetPredicates(request, preds)) {
+		return false;
+	}
+
+	std::vector<const AttrIndex*> indexes;
+	std::vector< std::vector<char> > passes;
+	std::vector<char> passes_missing;
+	int driver = -1;
+	int driver_count = 0;
+
+	for (size_t p = 0; p < preds.size(); p++) {
+		AttrIndex *index = GetAttrIndex(preds[p].attr);
+		if (!index) {
+			continue;
+		}
+		std::vector<char> pass;
+		bool pass_missing = false;
+		int count = 0;
+		EvalGroups(preds[p], *index, pass, pass_missing, count);
+
+		if (driver < 0 || count < driver_count) {
+			driver = (int)indexes.size();
+			driver_count = count;
+		}
+		indexes.push_back(index);
+		passes.push_back(pass);
+		passes_missing.push_back(pass_missing ? 1 : 0);
+	}
+	if (driver < 0) {
+		return false;
+	}
+
+	if (++m_select_stamp == 0) {
+		m_selected.assign(m_machines.size(), 0);
+		m_select_stamp = 1;
+	}
+
+		// Machines that pass the most selective predicate are checked
+		// against the others.
+	const AttrIndex &dindex = *indexes[driver];
+	std::vector<int> from_driver;
+	from_driver.reserve(driver_count);
+	for (size_t g = 0; g < dindex.groups.size(); g++) {
+		if (passes[driver][g]) {
+			from_driver.insert(from_driver.end(), dindex.groups[g].machines.begin(),
+							   dindex.groups[g].machines.end());
+		}
+	}
+	from_driver.insert(from_driver.end(), dindex.unindexed.begin(), dindex.unindexed.end());
+	if (passes_missing[driver]) {
+		from_driver.insert(from_driver.end(), dindex.missing.begin(), dindex.missing.end());
+	}
+
+	m_num_candidates = 0;
+	for (size_t i = 0; i < from_driver.size(); i++) {
+		int id = from_driver[i];
+		bool ok = true;
+		for (size_t p = 0; ok && p < indexes.size(); p++) {
+			if ((int)p == driver) {
+				continue;
+			}
+			int group = indexes[p]->group_of[id];
+			if (group == GROUP_MISSING) {
+				ok = passes_missing[p] != 0;
+			} else if (group != GROUP_UNINDEXED) {
+				ok = passes[p][group] != 0;
+			}
+		}
+		if (ok) {
+			m_selected[id] = m_select_stamp;
+			m_num_candidates++;
+		}
+	}
+
+	m_select_valid = true;
+	return true;
+}
+
+bool
+MachineAdIndex::IsCandidate(ClassAd *machine) const
+{
+	if (!m_select_valid) {
+		return true;
+	}
+
+	int id;
+	if (m_machine_ids.lookup(machine, id) != 0) {
+			// not in the index, so we know nothing about it
+		return true;
+	}
+	return m_always[id] || m_selected[id] == m_select_stamp;
+}
@@ -0,0 +1,122 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _MATCHMAKER_INDEX_H
+#define _MATCHMAKER_INDEX_H
+
+#include "HashTable.h"
+#include <vector>
+#include <string>
+#include <map>
+
+/* MachineAdIndex is a prefilter for matchmaking.  The top-level
+ * conjuncts of a job's Requirements that compare a machine attribute
+ * with a value that depends only on the job (TARGET.Memory >= 1024,
+ * OpSys == "LINUX", TARGET.HasDocker) are checked against an index of
+ * the machine ads, and only the machines that pass all of them are
+ * candidates for the full match.  A machine that is not a candidate
+ * cannot match the job, so skipping it never changes the result of
+ * matchmaking; machines the index can't reason about are always
+ * candidates.
+ *
+ * An attribute is indexed the first time a job constrains it, by
+ * grouping the machines by the (literal) value of the attribute.  The
+ * index is only valid for the ads it was built from: a machine ad that
+ * is modified after Build() must be passed to Invalidate().
+ */
+class MachineAdIndex {
+
+ public:
+	MachineAdIndex();
+	~MachineAdIndex();
+
+		// Index the given machine ads, discarding any previous index.
+	void Build(ClassAdListDoesNotDeleteAds &startdAds);
+
+		// Discard the index.  Every machine is a candidate afterwards.
+	void Clear();
+
+		// The machine ad has been modified, so it is a candidate for
+		// every job from now on.
+	void Invalidate(ClassAd *machine);
+
+		// Select the candidate machines for the given job.  Returns
+		// false if nothing in the job's Requirements could be used,
+		// in which case every machine is a candidate.
+	bool Select(ClassAd &request);
+
+		// Is the machine a candidate for the job last passed to Select()?
+	bool IsCandidate(ClassAd *machine) const;
+
+		// Number of candidates found by the last successful Select(),
+		// not counting machines that are candidates for every job.
+	int NumCandidates() const { return m_num_candidates; }
+
+	int NumMachines() const { return (int)m_machines.size(); }
+
+ private:
+
+		// The machine side of a conjunct: the conjunct is satisfied
+		// when (value op machine attribute) or (machine attribute op
+		// value) is true, or when the machine attribute itself is
+		// true if op is __NO_OP__.
+	struct Predicate {
+		std::string attr;
+		classad::Operation::OpKind op;
+		classad::Value value;
+		bool value_on_left;
+	};
+
+	struct ValueGroup {
+		classad::Value value;
+		std::vector<int> machines;
+	};
+
+		// Index of one attribute.  Machines that don't have the
+		// attribute are in the missing list; machines where it isn't
+		// a literal are in the unindexed list.
+	struct AttrIndex {
+		std::vector<int> group_of;		// per machine, -1 if not in a group
+		std::vector<ValueGroup> groups;
+		std::vector<int> missing;
+		std::vector<int> unindexed;
+	};
+
+	typedef std::map<std::string, AttrIndex*, classad::CaseIgnLTStr> AttrIndexMap;
+
+	AttrIndex *GetAttrIndex(const std::string &attr);
+	bool GetPredicates(ClassAd &request, std::vector<Predicate> &preds);
+	bool GetPredicate(ClassAd &request, classad::ExprTree *conjunct, Predicate &pred);
+	bool IsMachineAttr(ClassAd &request, classad::ExprTree *tree, std::string &attr);
+	bool IsJobValue(ClassAd &request, classad::ExprTree *tree, int depth);
+	bool Satisfies(const Predicate &pred, const classad::Value &machine_val) const;
+	void EvalGroups(const Predicate &pred, const AttrIndex &index,
+					std::vector<char> &pass, bool &pass_missing, int &count) const;
+
+	std::vector<ClassAd*> m_machines;
+	HashTable<ClassAd*,int> m_machine_ids;
+	std::vector<char> m_always;			// candidate for every job
+	AttrIndexMap m_attrs;
+	std::vector<unsigned int> m_selected;
+	unsigned int m_select_stamp;
+	bool m_select_valid;
+	int m_num_candidates;
+};
+
+#endif
@@ -0,0 +1,243 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_attributes.h"
+#include "condor_classad.h"
+#include "matchmaker.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Evaluating offers in parallel.
+ *
+ * Everything matchmakingAlgorithm() needs to know about an offer that
+ * comes only from evaluating expressions -- whether it matches, the
+ * job's Rank of it, the negotiator ranks, and the startd rank and
+ * PREEMPTION_REQUIREMENTS conditions -- is computed here for all the
+ * offers at once.  The rest (accountant priorities, submitter and
+ * concurrency limits, picking the best) stays in the serial scan,
+ * which consumes these results in order, so the outcome is the same
+ * as evaluating serially.
+ *
+ * Each thread has its own copies of the request and its own match ads,
+ * since making a match sets the parent scope of both ads.  An offer is
+ * only ever in one thread's match ad at a time.  The negotiator's own
+ * expressions are shared by all threads; evaluating them through
+ * ClassAd::EvaluateExpr() doesn't modify them.
+ */
+
+struct Matchmaker::ParallelMatchSlot {
+	classad::MatchClassAd job_match;	// LEFT is the request, RIGHT the offer
+	classad::MatchClassAd offer_match;	// LEFT is the offer, RIGHT the request
+	ClassAd job_left;
+	ClassAd job_right;
+};
+
+	// Like EvalExprTree(expr, offer, request) && result is true, with
+	// offer already in a match ad with request.
+static bool
+eval_offer_cond(ExprTree *expr, ClassAd *offer)
+{
+	classad::Value result;
+	bool val = false;
+
+	if (!expr) {
+		return false;
+	}
+	return offer->EvaluateExpr(expr, result) && result.IsBooleanValue(val) && val;
+}
+
+	// Like ClassAd::EvalFloat(name, target, value), with my and target
+	// already in a match ad.
+static bool
+eval_float_attr(ClassAd *my, ClassAd *target, char const *name, double &value)
+{
+	classad::Value val;
+	double doubleVal;
+	long long intVal;
+	bool boolVal;
+
+	ClassAd *ad = NULL;
+	if (my->Lookup(name)) {
+		ad = my;
+	} else if (target->Lookup(name)) {
+		ad = target;
+	}
+	if (!ad || !ad->EvaluateAttr(name, val)) {
+		return false;
+	}
+	if (val.IsRealValue(doubleVal)) {
+		value = doubleVal;
+		return true;
+	}
+	if (val.IsIntegerValue(intVal)) {
+		value = intVal;
+		return true;
+	}
+	if (val.IsBooleanValue(boolVal)) {
+		value = boolVal;
+		return true;
+	}
+	return false;
+}
+
+void
+Matchmaker::evalOffer(ParallelMatchSlot &slot, ClassAd *offer, OfferEval &result)
+{
+	bool set_alternate = !compat_classad::ClassAd::m_strictEvaluation;
+
+	result.is_a_match = false;
+	result.claimed = false;
+	result.startd_prefers = false;
+	result.preempt_req_ok = false;
+	result.prio_preempt_ok = false;
+	result.rank = 0.0;
+	result.pre_job_rank_ok = false;
+	result.post_job_rank_ok = false;
+	result.preempt_rank_ok = false;
+
+		// as IsAMatch(&request, offer) and request.EvalFloat(ATTR_RANK, offer)
+	slot.job_match.ReplaceRightAd(offer);
+	if (set_alternate) {
+		slot.job_left.alternateScope = offer;
+		offer->alternateScope = &slot.job_left;
+	}
+	result.is_a_match = slot.job_match.symmetricMatch();
+	if (result.is_a_match) {
+		if (!eval_float_attr(&slot.job_left, offer, ATTR_RANK, result.rank)) {
+			result.rank = 0.0;
+		}
+	}
+	slot.job_match.RemoveRightAd();
+	slot.job_left.alternateScope = NULL;
+	offer->alternateScope = NULL;
+
+	if (!result.is_a_match) {
+		return;
+	}
+
+	std::string remoteUser;
+	if (ConsiderPreemption) {
+		if (!offer->LookupString(ATTR_PREEMPTING_ACCOUNTING_GROUP, remoteUser)) {
+			if (!offer->LookupString(ATTR_PREEMPTING_USER, remoteUser)) {
+				if (!offer->LookupString(ATTR_ACCOUNTING_GROUP, remoteUser)) {
+					offer->LookupString(ATTR_REMOTE_USER, remoteUser);
+				}
+			}
+		}
+	}
+	result.claimed = !remoteUser.empty();
+
+		// as EvalExprTree(expr, offer, &request)
+	slot.offer_match.ReplaceLeftAd(offer);
+	if (set_alternate) {
+		offer->alternateScope = &slot.job_right;
+		slot.job_right.alternateScope = offer;
+	}
+	if (!m_staticRanks) {
+		if (NegotiatorPreJobRank) {
+			result.pre_job_rank_ok = offer->EvaluateExpr(NegotiatorPreJobRank, result.pre_job_rank);
+		}
+		if (NegotiatorPostJobRank) {
+			result.post_job_rank_ok = offer->EvaluateExpr(NegotiatorPostJobRank, result.post_job_rank);
+		}
+	}
+	if (result.claimed) {
+		result.startd_prefers = eval_offer_cond(rankCondStd, offer);
+		result.preempt_req_ok = !PreemptionReq || eval_offer_cond(PreemptionReq, offer);
+		result.prio_preempt_ok = eval_offer_cond(rankCondPrioPreempt, offer);
+		if (PreemptionRank && !m_staticRanks) {
+			result.preempt_rank_ok = offer->EvaluateExpr(PreemptionRank, result.preempt_rank);
+		}
+	}
+	slot.offer_match.RemoveLeftAd();
+	offer->alternateScope = NULL;
+	slot.job_right.alternateScope = NULL;
+}
+
+int
+Matchmaker::evalOffersInParallel(ClassAd &request, std::vector<ClassAd*> &offers,
+								 std::vector<OfferEval> &results, int num_threads)
+{
+	int count = (int)offers.size();
+
+	results.resize(offers.size());
+	if (count == 0) {
+		return 0;
+	}
+	if (num_threads > count) {
+		num_threads = count;
+	}
+
+	while ((int)par_match_slots.size() < num_threads) {
+		par_match_slots.push_back(new ParallelMatchSlot);
+	}
+	for (int i = 0; i < num_threads; i++) {
+		ParallelMatchSlot *slot = par_match_slots[i];
+		slot->job_left.CopyFrom(request);
+		slot->job_right.CopyFrom(request);
+		slot->job_match.ReplaceLeftAd(&slot->job_left);
+		slot->job_match.SetCompiledEval(want_compiled_requirements, false);
+		slot->offer_match.ReplaceRightAd(&slot->job_right);
+	}
+
+#ifdef _OPENMP
+	omp_set_num_threads(num_threads);
+#endif
+
+#pragma omp parallel
+	{
+#ifdef _OPENMP
+		ParallelMatchSlot *slot = par_match_slots[omp_get_thread_num()];
+#else
+		ParallelMatchSlot *slot = par_match_slots[0];
+#endif
+#pragma omp for schedule(dynamic, 16)
+		for (int i = 0; i < count; i++) {
+			evalOffer(*slot, offers[i], results[i]);
+		}
+	}
+
+	for (int i = 0; i < num_threads; i++) {
+		ParallelMatchSlot *slot = par_match_slots[i];
+		slot->job_match.RemoveLeftAd();
+		slot->offer_match.RemoveRightAd();
+			// the compiled programs refer to this request's copy
+		slot->job_match.FlushCompiledExprs();
+	}
+
+	int matches = 0;
+	for (int i = 0; i < count; i++) {
+		if (results[i].is_a_match) {
+			matches++;
+		}
+	}
+	return matches;
+}
+
+void
+Matchmaker::clearParallelMatchSlots()
+{
+	for (size_t i = 0; i < par_match_slots.size(); i++) {
+		delete par_match_slots[i];
+	}
+	par_match_slots.clear();
+}
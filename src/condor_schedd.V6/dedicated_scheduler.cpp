@@ -38,6 +38,7 @@
 #include "scheduler.h"
 #include "condor_debug.h"
 #include "condor_config.h"
+#include "param_cached.h"
 #include "condor_query.h"
 #include "condor_adtypes.h"
 #include "condor_state.h"
@@ -166,7 +167,8 @@ bool satisfies(ClassAd* job, ClassAd* candidate) {
     MyString resource_state;
     candidate->LookupString(ATTR_STATE, resource_state);
     resource_state.lower_case();
-    if ((resource_state == "claimed") && param_boolean("CLAIM_RECYCLING_CONSIDER_LIMITS", true)) {
+    static param_cached<bool> consider_limits("CLAIM_RECYCLING_CONSIDER_LIMITS", true);
+    if ((resource_state == "claimed") && consider_limits) {
         dprintf(D_FULLDEBUG, "Entering ded-schedd concurrency limit check...\n");
         MyString jobLimits, resourceLimits;
 		job->LookupString(ATTR_CONCURRENCY_LIMITS, jobLimits);
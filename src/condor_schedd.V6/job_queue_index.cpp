@@ -0,0 +1,335 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_attributes.h"
+#include "compat_classad_util.h"
+#include "stl_string_utils.h"
+#include "string_list.h"
+#include "qmgmt.h"
+#include "job_queue_index.h"
+#include <algorithm>
+#include <iterator>
+
+// the per-job value key of a job that doesn't have the attribute, or whose
+// value is undefined, and of a job whose value we can't index.
+static const char NO_VALUE[] = "";
+static const char UNINDEXED_VALUE[] = "?";
+
+// Make the key a value is indexed under: "s" and the string in lower case,
+// since == on strings ignores case, or "n" and the number, so that 2 and
+// 2.0 share a key.  Undefined gets NO_VALUE, as a missing attribute does,
+// since =?= can't tell them apart.  Returns false for values we don't index,
+// error among them.
+static bool
+make_value_key(const classad::Value & val, std::string & key)
+{
+	std::string str;
+	long long ival;
+	double rval;
+	switch (val.GetType()) {
+	case classad::Value::UNDEFINED_VALUE:
+		key = NO_VALUE;
+		return true;
+	case classad::Value::STRING_VALUE:
+		val.IsStringValue(str);
+		lower_case(str);
+		key = "s";
+		key += str;
+		return true;
+	case classad::Value::INTEGER_VALUE:
+		val.IsIntegerValue(ival);
+		formatstr(key, "n%lld", ival);
+		return true;
+	case classad::Value::REAL_VALUE:
+		val.IsRealValue(rval);
+		if (rval == floor(rval) && fabs(rval) < 1e15) {
+			formatstr(key, "n%lld", (long long)rval);
+		} else {
+			formatstr(key, "n%.17g", rval);
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+JobQueueIndex::JobQueueIndex()
+{
+	SetAttributes("");
+}
+
+bool
+JobQueueIndex::SetAttributes(const char * extra)
+{
+	std::vector<std::string> attrs;
+	attrs.push_back(ATTR_OWNER);
+	attrs.push_back(ATTR_JOB_STATUS);
+
+	StringList list(extra);
+	list.rewind();
+	const char * attr;
+	while ((attr = list.next())) {
+		bool dup = strcasecmp(attr, ATTR_CLUSTER_ID) == 0;
+		for (size_t ix = 0; ix < attrs.size() && ! dup; ++ix) {
+			dup = strcasecmp(attrs[ix].c_str(), attr) == 0;
+		}
+		if ( ! dup) { attrs.push_back(attr); }
+	}
+
+	bool changed = attrs.size() != indexes.size();
+	for (size_t ix = 0; ix < attrs.size() && ! changed; ++ix) {
+		changed = strcasecmp(attrs[ix].c_str(), indexes[ix].attr.c_str()) != 0;
+	}
+	if ( ! changed) {
+		return false;
+	}
+
+	Clear();
+	indexes.clear();
+	indexes.resize(attrs.size());
+	for (size_t ix = 0; ix < attrs.size(); ++ix) {
+		indexes[ix].attr = attrs[ix];
+	}
+	return true;
+}
+
+bool
+JobQueueIndex::IsIndexed(const char * attr) const
+{
+	return FindIndex(attr) != NULL;
+}
+
+const JobQueueIndex::AttrIndex *
+JobQueueIndex::FindIndex(const char * attr) const
+{
+	for (size_t ix = 0; ix < indexes.size(); ++ix) {
+		if (strcasecmp(indexes[ix].attr.c_str(), attr) == 0) {
+			return &indexes[ix];
+		}
+	}
+	return NULL;
+}
+
+void
+JobQueueIndex::AddJob(JobQueueJob * job)
+{
+	if (job && job->IsJob()) {
+		AddJob(job->jid, *job);
+	}
+}
+
+void
+JobQueueIndex::AddJob(const JOB_ID_KEY & jid, classad::ClassAd & ad)
+{
+	if (jobs.find(jid) != jobs.end()) {
+		RemoveJob(jid);
+	}
+
+	std::vector<std::string> & keys = jobs[jid];
+	keys.resize(indexes.size());
+	for (size_t ix = 0; ix < indexes.size(); ++ix) {
+		AttrIndex & index = indexes[ix];
+		classad::ExprTree * tree = ad.Lookup(index.attr);
+		classad::Value val;
+		if ( ! tree) {
+			keys[ix] = NO_VALUE;
+			index.missing.insert(jid);
+		} else if ( ! ExprTreeIsLiteral(tree, val) || ! make_value_key(val, keys[ix])) {
+			keys[ix] = UNINDEXED_VALUE;
+			index.unindexed.insert(jid);
+		} else if (keys[ix].empty()) {
+			index.missing.insert(jid);
+		} else {
+			index.values[keys[ix]].insert(jid);
+		}
+	}
+	clusters[jid.cluster].insert(jid);
+}
+
+void
+JobQueueIndex::UpdateJob(JobQueueJob * job)
+{
+	if (job && jobs.find(job->jid) != jobs.end()) {
+		RemoveJob(job->jid);
+		AddJob(job);
+	}
+}
+
+void
+JobQueueIndex::RemoveJob(const JOB_ID_KEY & jid)
+{
+	std::map<JOB_ID_KEY, std::vector<std::string> >::iterator found = jobs.find(jid);
+	if (found == jobs.end()) {
+		return;
+	}
+	const std::vector<std::string> & keys = found->second;
+	for (size_t ix = 0; ix < keys.size() && ix < indexes.size(); ++ix) {
+		AttrIndex & index = indexes[ix];
+		if (keys[ix] == UNINDEXED_VALUE) {
+			index.unindexed.erase(jid);
+		} else if (keys[ix].empty()) {
+			index.missing.erase(jid);
+		} else {
+			std::map<std::string, JobSet>::iterator value = index.values.find(keys[ix]);
+			if (value != index.values.end()) {
+				value->second.erase(jid);
+				if (value->second.empty()) { index.values.erase(value); }
+			}
+		}
+	}
+	std::map<int, JobSet>::iterator cluster = clusters.find(jid.cluster);
+	if (cluster != clusters.end()) {
+		cluster->second.erase(jid);
+		if (cluster->second.empty()) { clusters.erase(cluster); }
+	}
+	jobs.erase(found);
+}
+
+void
+JobQueueIndex::Clear()
+{
+	for (size_t ix = 0; ix < indexes.size(); ++ix) {
+		indexes[ix].values.clear();
+		indexes[ix].missing.clear();
+		indexes[ix].unindexed.clear();
+	}
+	jobs.clear();
+	clusters.clear();
+}
+
+void
+JobQueueIndex::GetClusterProcs(int cluster, std::vector<JOB_ID_KEY> & procs) const
+{
+	procs.clear();
+	std::map<int, JobSet>::const_iterator found = clusters.find(cluster);
+	if (found != clusters.end()) {
+		procs.assign(found->second.begin(), found->second.end());
+	}
+}
+
+bool
+JobQueueIndex::GetCandidates(classad::ExprTree * constraint, std::vector<JOB_ID_KEY> & candidates) const
+{
+	JobSet narrowed;
+	if ( ! constraint || ! Narrow(constraint, narrowed)) {
+		return false;
+	}
+	candidates.assign(narrowed.begin(), narrowed.end());
+	return true;
+}
+
+// Find the jobs for which expr could be true, looking through && and ||
+// for comparisons of indexed attributes to literals.  Returns false if
+// any job could match.
+bool
+JobQueueIndex::Narrow(classad::ExprTree * expr, JobSet & candidates) const
+{
+	expr = SkipExprParens(expr);
+	if ( ! expr || expr->GetKind() != classad::ExprTree::OP_NODE) {
+		return false;
+	}
+
+	classad::Operation::OpKind op;
+	classad::ExprTree *left, *right, *third;
+	((classad::Operation*)expr)->GetComponents(op, left, right, third);
+
+	if (op == classad::Operation::LOGICAL_AND_OP) {
+		JobSet lset, rset;
+		bool lnarrowed = Narrow(left, lset);
+		bool rnarrowed = Narrow(right, rset);
+		if (lnarrowed && rnarrowed) {
+			std::set_intersection(lset.begin(), lset.end(), rset.begin(), rset.end(),
+				std::inserter(candidates, candidates.end()));
+		} else if (lnarrowed) {
+			candidates.swap(lset);
+		} else if (rnarrowed) {
+			candidates.swap(rset);
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	if (op == classad::Operation::LOGICAL_OR_OP) {
+		JobSet rset;
+		if ( ! Narrow(left, candidates) || ! Narrow(right, rset)) {
+			return false;
+		}
+		candidates.insert(rset.begin(), rset.end());
+		return true;
+	}
+
+	if (op == classad::Operation::EQUAL_OP || op == classad::Operation::META_EQUAL_OP) {
+		std::string attr;
+		classad::Value val;
+		if (ExprTreeIsAttrRef(SkipExprParens(right), attr)) {
+			std::swap(left, right);
+		}
+		if ( ! ExprTreeIsAttrRef(SkipExprParens(left), attr) || ! ExprTreeIsLiteral(right, val)) {
+			return false;
+		}
+		return Lookup(attr, val, op == classad::Operation::META_EQUAL_OP, candidates);
+	}
+
+	return false;
+}
+
+// Find the jobs for which attr == val, or attr =?= val if is_identical,
+// could be true.
+bool
+JobQueueIndex::Lookup(const std::string & attr, const classad::Value & val, bool is_identical, JobSet & candidates) const
+{
+	std::string key;
+	if ( ! make_value_key(val, key)) {
+		return false;
+	}
+
+	if (strcasecmp(attr.c_str(), ATTR_CLUSTER_ID) == 0) {
+		long long cluster;
+		if (key.empty() || key[0] != 'n' || sscanf(key.c_str()+1, "%lld", &cluster) != 1) {
+			return true; // no proc has a ClusterId like that
+		}
+		std::map<int, JobSet>::const_iterator found = clusters.find((int)cluster);
+		if (found != clusters.end() && found->first == cluster) {
+			candidates.insert(found->second.begin(), found->second.end());
+		}
+		return true;
+	}
+
+	const AttrIndex * index = FindIndex(attr.c_str());
+	if ( ! index) {
+		return false;
+	}
+	if (key.empty()) {
+			// nothing is == undefined, but a missing attribute =?= undefined
+		if ( ! is_identical) {
+			return true;
+		}
+		candidates.insert(index->missing.begin(), index->missing.end());
+	} else {
+		std::map<std::string, JobSet>::const_iterator found = index->values.find(key);
+		if (found != index->values.end()) {
+			candidates.insert(found->second.begin(), found->second.end());
+		}
+	}
+	candidates.insert(index->unindexed.begin(), index->unindexed.end());
+	return true;
+}
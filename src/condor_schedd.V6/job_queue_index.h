@@ -0,0 +1,90 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _JOB_QUEUE_INDEX_H
+#define _JOB_QUEUE_INDEX_H
+
+#include "proc.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class JobQueueJob;
+namespace classad { class ClassAd; class ExprTree; class Value; }
+
+// Secondary indexes on the job queue, so that constraints such as
+// Owner == "alice" or ClusterId == 12 || ClusterId == 13 can be answered
+// without looking at every job.  Procs are indexed by cluster, and by the
+// value of each indexed attribute (Owner and JobStatus, plus the ones in
+// SCHEDD_JOB_QUEUE_INDEX_ATTRS) when that value is a literal string or
+// number.  A job whose value is anything else is a candidate for every
+// lookup on that attribute, so lookups return a superset of the jobs that
+// can match, and callers must still evaluate the constraint.  Jobs without
+// the attribute are tracked too, for Attr =?= UNDEFINED.
+//
+// The schedd adds jobs as they are loaded or committed, updates them when
+// a transaction sets an indexed attribute, and removes them when the job
+// object is deleted; see Scheduler::indexAJob().
+class JobQueueIndex {
+public:
+	JobQueueIndex();
+
+		// Set the extra attributes to index from a list.  Returns true
+		// if the set of indexed attributes changed, in which case the
+		// index has been cleared and all jobs must be added again.
+	bool SetAttributes(const char * extra_attrs);
+	bool IsIndexed(const char * attr) const;
+
+	void AddJob(JobQueueJob * job);
+	void AddJob(const JOB_ID_KEY & jid, classad::ClassAd & ad);
+		// Index a job again after an indexed attribute changed.
+		// Jobs that haven't been added yet are left alone.
+	void UpdateJob(JobQueueJob * job);
+	void RemoveJob(const JOB_ID_KEY & jid);
+	void Clear();
+	size_t NumJobs() const { return jobs.size(); }
+
+		// Get the procs in a cluster, in order.
+	void GetClusterProcs(int cluster, std::vector<JOB_ID_KEY> & procs) const;
+
+		// Get the jobs for which the constraint could be true, in order.
+		// Returns false if the indexes don't narrow down which jobs
+		// can match, in which case the caller should look at them all.
+	bool GetCandidates(classad::ExprTree * constraint, std::vector<JOB_ID_KEY> & candidates) const;
+
+private:
+	typedef std::set<JOB_ID_KEY> JobSet;
+	struct AttrIndex {
+		std::string attr;
+		std::map<std::string, JobSet> values; // jobs by value key
+		JobSet missing;                        // jobs without the attribute, or where it is undefined
+		JobSet unindexed;                      // jobs with a value we can't index
+	};
+
+	bool Narrow(classad::ExprTree * expr, JobSet & candidates) const;
+	bool Lookup(const std::string & attr, const classad::Value & val, bool is_identical, JobSet & candidates) const;
+	const AttrIndex * FindIndex(const char * attr) const;
+
+	std::vector<AttrIndex> indexes;
+	std::map<JOB_ID_KEY, std::vector<std::string> > jobs; // value key of each job in each index
+	std::map<int, JobSet> clusters;                  // procs by cluster
+};
+
+#endif
@@ -37,6 +37,7 @@
 #include "spooled_job_files.h"
 #include "scheduler.h"	// for shadow_rec definition
 #include "dedicated_scheduler.h"
+#include "runnable_jobs.h"
 #include "condor_email.h"
 #include "condor_universe.h"
 #include "globus_utils.h"
@@ -57,6 +58,8 @@
 #include "nullfile.h"
 #include "condor_url.h"
 #include "classad/classadCache.h"
+#include "param_cached.h"
+#include "condor_threads.h"
 #include <param_info.h>
 
 #if defined(HAVE_DLOPEN) || defined(WIN32)
@@ -151,10 +154,6 @@ extern char *Name;
 extern Scheduler scheduler;
 extern DedicatedScheduler dedicated_scheduler;
 
-extern "C" {
-	int	prio_compar(prio_rec*, prio_rec*);
-}
-
 extern  void    cleanup_ckpt_files(int, int, const char*);
 extern	bool	service_this_universe(int, ClassAd *);
 extern	bool	jobExternallyManaged(ClassAd * ad);
@@ -240,6 +239,15 @@ static int dirty_notice_interval = 0;
 static void PeriodicDirtyAttributeNotification();
 static void ScheduleJobQueueLogFlush();
 
+// group commit: client commits are acknowledged once the background
+// sync of the job queue log covers them
+static bool want_group_commit = false;
+static bool want_binary_snapshots = false;
+static int job_queue_load_threads = 1;	// threads that check jobs loaded at startup, 0 for one per core
+static int group_commit_pipe = -1;	// notified by the sync thread
+static bool group_commit_client = false;	// committing for a client that can wait
+static unsigned long pending_commit_ticket = 0;
+
 bool qmgmt_all_users_trusted = false;
 static char	**super_users = NULL;
 static int	num_super_users = 0;
@@ -266,6 +274,39 @@ GetJobQueueIteratorEnd()
 	return JobQueue->GetIteratorEnd();
 }
 
+// Get the ids of the jobs (and cluster ads if asked) in the queue, for
+// queries answered on a pool thread, which look the jobs up again as they
+// go.  Iterators register themselves with the hash table, so readers take
+// turns doing this.
+void
+GetJobQueueKeys(std::vector<JobQueueKey> &keys, bool include_clusters)
+{
+	HashTable<JobQueueKey,JobQueueJob*> *table = JobQueue->Table();
+	CondorThreads::lock_state_readers();
+	keys.reserve(table->getNumElements());
+	HashIterator<JobQueueKey,JobQueueJob*> end = table->end();
+	for (HashIterator<JobQueueKey,JobQueueJob*> it = table->begin(); !(it == end); it.advance()) {
+		JobQueueKey key = (*it).first;
+		if (key.cluster <= 0) continue; // the header ad
+		if (key.proc < 0 && ! include_clusters) continue;
+		keys.push_back(key);
+	}
+	CondorThreads::unlock_state_readers();
+}
+
+// Get the ids of the jobs that could match the constraint from the job
+// queue index, in order.  Returns false if the index doesn't narrow down
+// which jobs can match, in which case the caller should use all of them.
+// Cluster ads aren't indexed, so this always fails if they are wanted.
+bool
+GetJobQueueIndexedKeys(classad::ExprTree * constraint, std::vector<JobQueueKey> &keys, bool include_clusters)
+{
+	if (include_clusters || ! constraint) {
+		return false;
+	}
+	return scheduler.jobIndex().GetCandidates(constraint, keys);
+}
+
 static inline
 void
 DeadIdToStr(int cluster, int proc, char *buf)
@@ -322,6 +363,9 @@ ConstructClassAdLogTableEntry<JobQueueJob*>::Delete(ClassAd* &ad) const
 			// in which case the actual destruction would be delayed until the transaction commit. i.e. here...
 			IncrementLiveJobCounter(scheduler.liveJobCounts, job->Universe(), job->Status(), -1);
 			if (job->ownerinfo) { IncrementLiveJobCounter(job->ownerinfo->live, job->Universe(), job->Status(), -1); }
+
+			// remove jobid from any indexes
+			scheduler.removeJobFromIndexes(job->jid);
 		}
 	}
 	delete job;
@@ -895,6 +939,12 @@ InitQmgmt()
 
 	flush_job_queue_log_delay = param_integer("SCHEDD_JOB_QUEUE_LOG_FLUSH_DELAY",5,0);
 	dirty_notice_interval = param_integer("SCHEDD_JOB_QUEUE_NOTIFY_UPDATES",30,0);
+	want_group_commit = param_boolean("SCHEDD_JOB_QUEUE_GROUP_COMMIT", false);
+	want_binary_snapshots = param_boolean("SCHEDD_JOB_QUEUE_BINARY_SNAPSHOT", false);
+	job_queue_load_threads = param_integer("SCHEDD_JOB_QUEUE_LOAD_THREADS", 1, 0);
+	if (JobQueue) {
+		JobQueue->SetBinarySnapshots(want_binary_snapshots);
+	}
 }
 
 void
@@ -1172,6 +1222,287 @@ void JobQueueJob::PopulateFromAd()
 #endif
 }
 
+	// A job ad loaded from the job queue log, and what CheckLoadedJob()
+	// found out about it.
+struct LoadedJob {
+	JobQueueJob *ad;
+	JobQueueJob *clusterad;
+	JobQueueKey key;
+	std::string remove_reason;	// if not empty, the job is bad and must be removed
+	std::string owner;
+	std::string messages;		// D_FULLDEBUG notes about attributes that were fixed
+	int proc;
+	int job_status;
+	int hold_code;
+	bool has_owner;
+	bool has_status;
+	bool is_cron;
+	bool dirty;					// the ad was changed and must be written out
+
+	LoadedJob() : ad(NULL), clusterad(NULL), proc(-1), job_status(0), hold_code(-1)
+		, has_owner(false), has_status(false), is_cron(false), dirty(false) {}
+};
+
+	// Check and fix up a job ad loaded from the job queue log.
+	// This runs on the threads of CheckLoadedJobs(), so apart from the
+	// job's own ad and LoadedJob it may only read the cluster ad.  The
+	// Assign and Delete calls on the job ad also add to and free entries
+	// of the process-wide ClassAd expression cache, which takes its own
+	// lock for that.  It can't dprintf, so anything to log goes into the
+	// LoadedJob, and so does anything that changes schedd state.
+static void
+CheckLoadedJob(LoadedJob &job, const char *correct_scheduler)
+{
+	JobQueueJob *ad = job.ad;
+	JOB_ID_KEY_BUF job_id(job.key);
+	int cluster, universe;
+	std::string user, correct_user, attr_scheduler, buffer;
+
+		// link all proc ads to their cluster ad, if there is one
+	if (job.clusterad) {
+		ad->ChainToAd(job.clusterad);
+	}
+
+	if (!ad->LookupString(ATTR_OWNER, job.owner)) {
+		formatstr(job.remove_reason, "has no %s attribute", ATTR_OWNER);
+		return;
+	}
+	job.has_owner = true;
+
+	if (!ad->LookupInteger(ATTR_CLUSTER_ID, cluster)) {
+		formatstr(job.remove_reason, "has no %s attribute", ATTR_CLUSTER_ID);
+		return;
+	}
+
+	if (cluster != job.key.cluster) {
+		formatstr(job.remove_reason, "has invalid cluster number %d", cluster);
+		return;
+	}
+
+	if (!ad->LookupInteger(ATTR_PROC_ID, job.proc)) {
+		formatstr(job.remove_reason, "has no %s attribute", ATTR_PROC_ID);
+		return;
+	}
+
+	if( !ad->LookupInteger( ATTR_JOB_UNIVERSE, universe ) ) {
+		formatstr(job.remove_reason, "has no %s attribute", ATTR_JOB_UNIVERSE);
+		return;
+	}
+
+	if( universe <= CONDOR_UNIVERSE_MIN ||
+		universe >= CONDOR_UNIVERSE_MAX ) {
+		formatstr(job.remove_reason, "has invalid %s = %d", ATTR_JOB_UNIVERSE, universe);
+		return;
+	}
+
+		// Update fields in the newly created JobObject
+	ad->autocluster_id = -1;
+	ad->Delete(ATTR_AUTO_CLUSTER_ID);
+	ad->SetUniverse(universe);
+	if (job.clusterad) {
+		ad->SetCluster(job.clusterad);
+	}
+	ad->PopulateFromAd();
+
+	if (ad->LookupInteger(ATTR_JOB_STATUS, job.job_status)) {
+		ad->SetStatus(job.job_status);
+		job.has_status = true;
+	}
+
+		// Figure out what ATTR_USER *should* be for this job
+	int nice_user = 0;
+	ad->LookupInteger( ATTR_NICE_USER, nice_user );
+	formatstr( correct_user, "%s%s@%s",
+			 (nice_user) ? "nice-user." : "", job.owner.c_str(),
+			 scheduler.uidDomain() );
+
+	if (!ad->LookupString(ATTR_USER, user)) {
+		formatstr_cat( job.messages,
+				"Job %s has no %s attribute.  Inserting one now...\n",
+				job_id.c_str(), ATTR_USER);
+		ad->Assign( ATTR_USER, correct_user );
+		job.dirty = true;
+	} else if( user != correct_user ) {
+			// ATTR_USER exists but is wrong, so insert the right value
+		formatstr_cat( job.messages,
+				 "Job %s has stale %s attribute.  "
+				 "Inserting correct value now...\n",
+				 job_id.c_str(), ATTR_USER );
+		ad->Assign( ATTR_USER, correct_user );
+		job.dirty = true;
+	}
+
+		// Make sure ATTR_SCHEDULER is correct.
+		// XXX TODO: Need a better way than hard-coded
+		// universe check to decide if a job is "dedicated"
+	if( universe == CONDOR_UNIVERSE_MPI ||
+		universe == CONDOR_UNIVERSE_PARALLEL ) {
+		if( !ad->LookupString(ATTR_SCHEDULER, attr_scheduler) ) {
+			formatstr_cat( job.messages, "Job %s has no %s attribute.  "
+					 "Inserting one now...\n", job_id.c_str(),
+					 ATTR_SCHEDULER );
+			ad->Assign( ATTR_SCHEDULER, correct_scheduler );
+			job.dirty = true;
+		} else if( attr_scheduler != correct_scheduler ) {
+				// ATTR_SCHEDULER exists but is wrong, so insert the
+				// right value
+			formatstr_cat( job.messages,
+					 "Job %s has stale %s attribute.  "
+					 "Inserting correct value now...\n",
+					 job_id.c_str(), ATTR_SCHEDULER );
+			ad->Assign( ATTR_SCHEDULER, correct_scheduler );
+			job.dirty = true;
+		}
+	}
+
+		//
+		// CronTab Special Handling Code
+		// If this ad contains any of the attributes used
+		// by the crontab feature, then we will tell the
+		// schedd that this job needs to have runtimes calculated
+		//
+	job.is_cron = ad->LookupString( ATTR_CRON_MINUTES, buffer ) ||
+		 ad->LookupString( ATTR_CRON_HOURS, buffer ) ||
+		 ad->LookupString( ATTR_CRON_DAYS_OF_MONTH, buffer ) ||
+		 ad->LookupString( ATTR_CRON_MONTHS, buffer ) ||
+		 ad->LookupString( ATTR_CRON_DAYS_OF_WEEK, buffer );
+
+		// the ad has already been checked for the attributes that
+		// would make this dprintf
+	ConvertOldJobAdAttrs( ad, true );
+
+	ad->LookupInteger(ATTR_HOLD_REASON_CODE, job.hold_code);
+
+		// make file transfer status attributes sane in case
+		// we died while in the middle of transferring
+	int transferring_input = false;
+	int transferring_output = false;
+	int transfer_queued = false;
+	if( ad->LookupInteger(ATTR_TRANSFERRING_INPUT,transferring_input) ) {
+		if( job.job_status == RUNNING ) {
+			if( transferring_input ) {
+				ad->Assign(ATTR_TRANSFERRING_INPUT,false);
+				job.dirty = true;
+			}
+		}
+		else {
+			ad->Delete(ATTR_TRANSFERRING_INPUT);
+			job.dirty = true;
+		}
+	}
+	if( ad->LookupInteger(ATTR_TRANSFERRING_OUTPUT,transferring_output) ) {
+		if( job.job_status == RUNNING ) {
+			if( transferring_output ) {
+				ad->Assign(ATTR_TRANSFERRING_OUTPUT,false);
+				job.dirty = true;
+			}
+		}
+		else {
+			ad->Delete(ATTR_TRANSFERRING_OUTPUT);
+			job.dirty = true;
+		}
+	}
+	if( ad->LookupInteger(ATTR_TRANSFER_QUEUED,transfer_queued) ) {
+		if( job.job_status == RUNNING ) {
+			if( transfer_queued ) {
+				ad->Assign(ATTR_TRANSFER_QUEUED,false);
+				job.dirty = true;
+			}
+		}
+		else {
+			ad->Delete(ATTR_TRANSFER_QUEUED);
+			job.dirty = true;
+		}
+	}
+	// AsyncXfer: Delete in-job output transfer attributes
+	if( ad->LookupInteger(ATTR_JOB_TRANSFERRING_OUTPUT,transferring_output) ) {
+		ad->Delete(ATTR_JOB_TRANSFERRING_OUTPUT);
+		job.dirty = true;
+	}
+	if( ad->LookupInteger(ATTR_JOB_TRANSFERRING_OUTPUT_TIME,transferring_output) ) {
+		ad->Delete(ATTR_JOB_TRANSFERRING_OUTPUT_TIME);
+		job.dirty = true;
+	}
+}
+
+#if defined(HAVE_PTHREADS) && !defined(WIN32)
+struct LoadedJobWork {
+	std::vector<LoadedJob> *jobs;
+	const char *correct_scheduler;
+	pthread_mutex_t mutex;
+	size_t next;	// index of the next job to hand out
+};
+
+static void *
+CheckLoadedJobsThread(void *arg)
+{
+	LoadedJobWork *work = (LoadedJobWork *)arg;
+	const size_t chunk = 64;
+	for (;;) {
+		pthread_mutex_lock(&work->mutex);
+		size_t begin = work->next;
+		if (begin < work->jobs->size()) {
+			work->next += chunk;
+		}
+		pthread_mutex_unlock(&work->mutex);
+
+		size_t end = MIN(begin + chunk, work->jobs->size());
+		if (begin >= end) {
+			break;
+		}
+		for (size_t ix = begin; ix < end; ++ix) {
+			CheckLoadedJob((*work->jobs)[ix], work->correct_scheduler);
+		}
+	}
+	return NULL;
+}
+#endif
+
+	// Run CheckLoadedJob() on all of the jobs, on up to
+	// SCHEDD_JOB_QUEUE_LOAD_THREADS threads.
+	// Returns the number of threads that did the work.
+static int
+CheckLoadedJobs(std::vector<LoadedJob> &jobs, const char *correct_scheduler)
+{
+#if defined(HAVE_PTHREADS) && !defined(WIN32)
+	int num_threads = job_queue_load_threads;
+	if (num_threads <= 0) {
+		num_threads = param_integer("DETECTED_CORES", 1, 1);
+	}
+		// a thread isn't worth starting for less than a few chunks of jobs
+	num_threads = MIN(num_threads, (int)(jobs.size() / 256) + 1);
+
+	if (num_threads > 1) {
+		LoadedJobWork work;
+		work.jobs = &jobs;
+		work.correct_scheduler = correct_scheduler;
+		work.next = 0;
+		pthread_mutex_init(&work.mutex, NULL);
+
+		std::vector<pthread_t> threads;
+		for (int i = 1; i < num_threads; ++i) {
+			pthread_t thread;
+			if (pthread_create(&thread, NULL, CheckLoadedJobsThread, &work) != 0) {
+				dprintf(D_ALWAYS, "Failed to start a thread to check the job queue, errno = %d\n", errno);
+				break;
+			}
+			threads.push_back(thread);
+		}
+		CheckLoadedJobsThread(&work);
+		for (size_t ix = 0; ix < threads.size(); ++ix) {
+			pthread_join(threads[ix], NULL);
+		}
+		pthread_mutex_destroy(&work.mutex);
+		return (int)threads.size() + 1;
+	}
+#endif
+
+	for (size_t ix = 0; ix < jobs.size(); ++ix) {
+		CheckLoadedJob(jobs[ix], correct_scheduler);
+	}
+	return 1;
+}
+
 void
 InitJobQueue(const char *job_queue_name,int max_historical_logs)
 {
@@ -1188,6 +1519,8 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 	CheckSpoolVersion(spool.Value(),SPOOL_MIN_VERSION_SCHEDD_SUPPORTS,SPOOL_CUR_VERSION_SCHEDD_SUPPORTS,spool_min_version,spool_cur_version);
 
 	JobQueue = new JobQueueType(new ConstructClassAdLogTableEntry<JobQueuePayload>(),job_queue_name,max_historical_logs);
+		// takes effect at the next rotation of the log
+	JobQueue->SetBinarySnapshots(want_binary_snapshots);
 	ClusterSizeHashTable = new ClusterSizeHashTable_t(37,compute_clustersize_hash);
 	TotalJobsCount = 0;
 
@@ -1196,17 +1529,12 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 	JobQueueJob *ad = NULL;
 	JobQueueJob *clusterad = NULL;
 	JobQueueKey key;
-	int 	cluster_num, cluster, proc, universe;
+	int 	cluster_num;
 	int		stored_cluster_num;
 	bool	CreatedAd = false;
 	JobQueueKey cluster_key;
 	MyString	owner;
-	MyString	user;
-	MyString	correct_user;
-	MyString	buf;
-	MyString	attr_scheduler;
 	MyString	correct_scheduler;
-	MyString buffer;
 
 	if (!JobQueue->Lookup(HeaderKey, ad)) {
 		// we failed to find header ad, so create one
@@ -1235,6 +1563,11 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 	correct_scheduler.formatstr( "DedicatedScheduler@%s", Name );
 
 	next_cluster_num = cluster_initial_val;
+
+		// The header and cluster ads are handled here.  The job ads are
+		// collected and checked in parallel by CheckLoadedJobs(), then
+		// the results are merged serially, in table order.
+	std::vector<LoadedJob> jobs;
 	JobQueue->StartIterateAllClassAds();
 	while (JobQueue->Iterate(key,ad)) {
 		ad->jid = key; // make sure that job object has correct jobid.
@@ -1251,239 +1584,91 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 			continue;  // done with cluster & header ads
 		}
 
-		cluster_num = key.cluster;
-
-		// this brace isn't needed anymore, it's here to avoid re-indenting all of the code below.
-		{
-			JOB_ID_KEY_BUF job_id(key);
+		LoadedJob job;
+		job.ad = ad;
+		job.key = key;
+		IdToKey(key.cluster,-1,cluster_key);
+		if ( ! JobQueue->Lookup(cluster_key,clusterad)) {
+			clusterad = NULL;
+		}
+		job.clusterad = clusterad;
+		jobs.push_back(job);
+	}
 
-			// find highest cluster, set next_cluster_num to one increment higher
-			if (cluster_num >= next_cluster_num) {
-				next_cluster_num = cluster_num + cluster_increment_val;
-			}
+	Stopwatch check_time;
+	check_time.start();
+	int check_threads = CheckLoadedJobs(jobs, correct_scheduler.Value());
+	dprintf(D_ALWAYS, "Checked %d jobs from the job queue log in %.3f seconds using %d thread(s)\n",
+			(int)jobs.size(), check_time.stop() / 1000.0, check_threads);
 
-			// link all proc ads to their cluster ad, if there is one
-			IdToKey(cluster_num,-1,cluster_key);
-			if ( JobQueue->Lookup(cluster_key,clusterad) ) {
-				ad->ChainToAd(clusterad);
-			}
+	for (size_t ix = 0; ix < jobs.size(); ++ix) {
+		LoadedJob &job = jobs[ix];
+		JOB_ID_KEY_BUF job_id(job.key);
+		ad = job.ad;
+		clusterad = job.clusterad;
+		cluster_num = job.key.cluster;
 
-			if (!ad->LookupString(ATTR_OWNER, owner)) {
-				dprintf(D_ALWAYS,
-						"Job %s has no %s attribute.  Removing....\n",
-						job_id.c_str(), ATTR_OWNER);
-				JobQueue->DestroyClassAd(job_id.c_str());
-				continue;
-			}
+			// find highest cluster, set next_cluster_num to one increment higher
+		if (cluster_num >= next_cluster_num) {
+			next_cluster_num = cluster_num + cluster_increment_val;
+		}
 
+		if (job.has_owner) {
 				// initialize our list of job owners
+			owner = job.owner.c_str();
 			AddOwnerHistory( owner );
 			ad->ownerinfo = const_cast<OwnerInfo*>(scheduler.insert_owner_const(owner.c_str()));
-			clusterad->ownerinfo = ad->ownerinfo;
-
-			if (!ad->LookupInteger(ATTR_CLUSTER_ID, cluster)) {
-				dprintf(D_ALWAYS,
-						"Job %s has no %s attribute.  Removing....\n",
-						job_id.c_str(), ATTR_CLUSTER_ID);
-				JobQueue->DestroyClassAd(job_id.c_str());
-				continue;
-			}
-
-			if (cluster != cluster_num) {
-				dprintf(D_ALWAYS,
-						"Job %s has invalid cluster number %d.  Removing...\n",
-						job_id.c_str(), cluster);
-				JobQueue->DestroyClassAd(job_id.c_str());
-				continue;
-			}
-
-			if (!ad->LookupInteger(ATTR_PROC_ID, proc)) {
-				dprintf(D_ALWAYS,
-						"Job %s has no %s attribute.  Removing....\n",
-						job_id.c_str(), ATTR_PROC_ID);
-				JobQueue->DestroyClassAd(job_id.c_str());
-				continue;
-			}
-
-			if( !ad->LookupInteger( ATTR_JOB_UNIVERSE, universe ) ) {
-				dprintf( D_ALWAYS,
-						 "Job %s has no %s attribute.  Removing....\n",
-						 job_id.c_str(), ATTR_JOB_UNIVERSE );
-				JobQueue->DestroyClassAd( job_id.c_str() );
-				continue;
-			}
-
-			if( universe <= CONDOR_UNIVERSE_MIN ||
-				universe >= CONDOR_UNIVERSE_MAX ) {
-				dprintf( D_ALWAYS,
-						 "Job %s has invalid %s = %d.  Removing....\n",
-						 job_id.c_str(), ATTR_JOB_UNIVERSE, universe );
-				JobQueue->DestroyClassAd( job_id.c_str() );
-				continue;
-			}
-
-				// Update fields in the newly created JobObject
-			ad->autocluster_id = -1;
-			ad->Delete(ATTR_AUTO_CLUSTER_ID);
-			ad->SetUniverse(universe);
-			JobQueueJob *clusterad = NULL;
-			if (JobQueue->Lookup(JOB_ID_KEY(key.cluster,-1), clusterad)) {
-				ad->SetCluster(clusterad);
-				clusterad->autocluster_id = -1;
-			}
-			ad->PopulateFromAd();
-
-			int job_status = 0;
-			if (ad->LookupInteger(ATTR_JOB_STATUS, job_status)) {
-				ad->SetStatus(job_status);
-				IncrementLiveJobCounter(scheduler.liveJobCounts, ad->Universe(), ad->Status(), 1);
-				if (ad->ownerinfo) { IncrementLiveJobCounter(ad->ownerinfo->live, ad->Universe(), ad->Status(), 1); }
-			}
-
-				// Figure out what ATTR_USER *should* be for this job
-			int nice_user = 0;
-			ad->LookupInteger( ATTR_NICE_USER, nice_user );
-			correct_user.formatstr( "%s%s@%s",
-					 (nice_user) ? "nice-user." : "", owner.Value(),
-					 scheduler.uidDomain() );
-
-			if (!ad->LookupString(ATTR_USER, user)) {
-				dprintf( D_FULLDEBUG,
-						"Job %s has no %s attribute.  Inserting one now...\n",
-						job_id.c_str(), ATTR_USER);
-				ad->Assign( ATTR_USER, correct_user.Value() );
-				JobQueueDirty = true;
-			} else {
-					// ATTR_USER exists, make sure it's correct, and
-					// if not, insert the new value now.
-				if( user != correct_user ) {
-						// They're different, so insert the right value
-					dprintf( D_FULLDEBUG,
-							 "Job %s has stale %s attribute.  "
-							 "Inserting correct value now...\n",
-							 job_id.c_str(), ATTR_USER );
-					ad->Assign( ATTR_USER, correct_user.Value() );
-					JobQueueDirty = true;
-				}
+			if (clusterad) {
+				clusterad->ownerinfo = ad->ownerinfo;
 			}
+		}
 
-				// Make sure ATTR_SCHEDULER is correct.
-				// XXX TODO: Need a better way than hard-coded
-				// universe check to decide if a job is "dedicated"
-			if( universe == CONDOR_UNIVERSE_MPI ||
-				universe == CONDOR_UNIVERSE_PARALLEL ) {
-				if( !ad->LookupString(ATTR_SCHEDULER, attr_scheduler) ) { 
-					dprintf( D_FULLDEBUG, "Job %s has no %s attribute.  "
-							 "Inserting one now...\n", job_id.c_str(),
-							 ATTR_SCHEDULER );
-					ad->Assign( ATTR_SCHEDULER, correct_scheduler.Value() );
-					JobQueueDirty = true;
-				} else {
+		if ( ! job.remove_reason.empty()) {
+			dprintf(D_ALWAYS, "Job %s %s.  Removing....\n",
+					job_id.c_str(), job.remove_reason.c_str());
+			JobQueue->DestroyClassAd(job_id.c_str());
+			continue;
+		}
 
-						// ATTR_SCHEDULER exists, make sure it's correct,
-						// and if not, insert the new value now.
-					if( attr_scheduler != correct_scheduler ) {
-							// They're different, so insert the right
-							// value 
-						dprintf( D_FULLDEBUG,
-								 "Job %s has stale %s attribute.  "
-								 "Inserting correct value now...\n",
-								 job_id.c_str(), ATTR_SCHEDULER );
-						ad->Assign( ATTR_SCHEDULER, correct_scheduler );
-						JobQueueDirty = true;
-					}
-				}
-			}
-			
-				//
-				// CronTab Special Handling Code
-				// If this ad contains any of the attributes used 
-				// by the crontab feature, then we will tell the 
-				// schedd that this job needs to have runtimes calculated
-				// 
-			if ( ad->LookupString( ATTR_CRON_MINUTES, buffer ) ||
-				 ad->LookupString( ATTR_CRON_HOURS, buffer ) ||
-				 ad->LookupString( ATTR_CRON_DAYS_OF_MONTH, buffer ) ||
-				 ad->LookupString( ATTR_CRON_MONTHS, buffer ) ||
-				 ad->LookupString( ATTR_CRON_DAYS_OF_WEEK, buffer ) ) {
-				scheduler.addCronTabClassAd( ad );
-			}
+		if (clusterad) {
+			clusterad->autocluster_id = -1;
+		}
+		if (job.has_status) {
+			IncrementLiveJobCounter(scheduler.liveJobCounts, ad->Universe(), ad->Status(), 1);
+			if (ad->ownerinfo) { IncrementLiveJobCounter(ad->ownerinfo->live, ad->Universe(), ad->Status(), 1); }
+		}
+		if ( ! job.messages.empty()) {
+			dprintf(D_FULLDEBUG, "%s", job.messages.c_str());
+		}
+		if (job.dirty) {
+			JobQueueDirty = true;
+		}
 
-			ConvertOldJobAdAttrs( ad, true );
-
-				// Add the job to various runtime indexes for quick lookups
-				//
-			scheduler.indexAJob(ad, true);
-
-				// If input files are going to be spooled, rewrite
-				// the paths in the job ad to point at our spool area.
-				// If the schedd crashes between committing a new job
-				// submission and rewriting the job ad for spooling,
-				// we need to redo the rewriting here.
-			int hold_code = -1;
-			ad->LookupInteger(ATTR_HOLD_REASON_CODE, hold_code);
-			if ( job_status == HELD && hold_code == CONDOR_HOLD_CODE_SpoolingInput ) {
-				if ( rewriteSpooledJobAd( ad, cluster, proc, true ) ) {
-					JobQueueDirty = true;
-				}
-			}
+		if (job.is_cron) {
+			scheduler.addCronTabClassAd( ad );
+		}
 
-				// make file transfer status attributes sane in case
-				// we died while in the middle of transferring
-			int transferring_input = false;
-			int transferring_output = false;
-			int transfer_queued = false;
-			if( ad->LookupInteger(ATTR_TRANSFERRING_INPUT,transferring_input) ) {
-				if( job_status == RUNNING ) {
-					if( transferring_input ) {
-						ad->Assign(ATTR_TRANSFERRING_INPUT,false);
-						JobQueueDirty = true;
-					}
-				}
-				else {
-					ad->Delete(ATTR_TRANSFERRING_INPUT);
-					JobQueueDirty = true;
-				}
-			}
-			if( ad->LookupInteger(ATTR_TRANSFERRING_OUTPUT,transferring_output) ) {
-				if( job_status == RUNNING ) {
-					if( transferring_output ) {
-						ad->Assign(ATTR_TRANSFERRING_OUTPUT,false);
-						JobQueueDirty = true;
-					}
-				}
-				else {
-					ad->Delete(ATTR_TRANSFERRING_OUTPUT);
-					JobQueueDirty = true;
-				}
-			}
-			if( ad->LookupInteger(ATTR_TRANSFER_QUEUED,transfer_queued) ) {
-				if( job_status == RUNNING ) {
-					if( transfer_queued ) {
-						ad->Assign(ATTR_TRANSFER_QUEUED,false);
-						JobQueueDirty = true;
-					}
-				}
-				else {
-					ad->Delete(ATTR_TRANSFER_QUEUED);
-					JobQueueDirty = true;
-				}
-			}
-			// AsyncXfer: Delete in-job output transfer attributes
-			if( ad->LookupInteger(ATTR_JOB_TRANSFERRING_OUTPUT,transferring_output) ) {
-				ad->Delete(ATTR_JOB_TRANSFERRING_OUTPUT);
-				JobQueueDirty = true;
-			}
-			if( ad->LookupInteger(ATTR_JOB_TRANSFERRING_OUTPUT_TIME,transferring_output) ) {
-				ad->Delete(ATTR_JOB_TRANSFERRING_OUTPUT_TIME);
+			// Add the job to various runtime indexes for quick lookups
+			//
+		scheduler.indexAJob(ad, true);
+
+			// If input files are going to be spooled, rewrite
+			// the paths in the job ad to point at our spool area.
+			// If the schedd crashes between committing a new job
+			// submission and rewriting the job ad for spooling,
+			// we need to redo the rewriting here.
+		if ( job.job_status == HELD && job.hold_code == CONDOR_HOLD_CODE_SpoolingInput ) {
+			if ( rewriteSpooledJobAd( ad, cluster_num, job.proc, true ) ) {
 				JobQueueDirty = true;
 			}
+		}
 
 			// count up number of procs in cluster, update ClusterSizeHashTable
-			int num_procs = IncrementClusterSize(cluster_num);
+		int num_procs = IncrementClusterSize(cluster_num);
+		if (clusterad) {
 			clusterad->SetNumProcs(num_procs);
 		}
-	} // WHILE
+	}
 
     // We defined a candidate next_cluster_num above, as (current-max-clust) + (increment).
     // If the candidate exceeds the configured max, then wrap it.  Default maximum is zero,
@@ -2032,40 +2217,180 @@ unsetQSock()
 }
 
 
+// A client connection whose commit is waiting for the job queue log
+// to be synced.  JobQueueSyncedHandler() sends the commit reply once
+// it is, and resume() then carries on with the client's next request.
+class QmgmtDeferredCommit : public Service {
+public:
+	QmgmtDeferredCommit(QmgmtPeer *p, ReliSock *s, unsigned long t)
+		: peer(p), sock(s), ticket(t) {}
+	~QmgmtDeferredCommit() { delete peer; }
+	int resume(Stream *);
+
+	QmgmtPeer *peer;
+	ReliSock *sock;
+	unsigned long ticket;
+};
+
+static std::list<QmgmtDeferredCommit *> deferred_commits;
+
+static int serve_q_requests();
+
+static void
+restoreQmgmtConnection(QmgmtPeer *peer)
+{
+	bool all_good = setQmgmtConnectionInfo(peer);
+
+		// as in handle_q, purge any stale connection and try again.
+	if ( !all_good ) {
+		unsetQSock();
+		all_good = setQmgmtConnectionInfo(peer);
+	}
+	if ( !all_good ) {
+		EXCEPT("Unable to restore a deferred qmgmt connection!!");
+	}
+}
+
 int
-handle_q(Service *, int, Stream *sock)
+QmgmtDeferredCommit::resume(Stream *)
 {
-	int	rval;
-	bool all_good;
+	ReliSock *rsock = sock;
+	restoreQmgmtConnection(peer);
+	peer = NULL;
+	delete this;
 
-	all_good = setQSock((ReliSock*)sock);
+	int rval = serve_q_requests();
+	if (rval == KEEP_STREAM) {
+			// waiting on another commit, so stop watching the
+			// socket until the reply has been sent
+		daemonCore->Cancel_Socket(rsock);
+	}
+	return rval;
+}
 
-		// if setQSock failed, unset it to purge any old/stale
-		// connection that was never cleaned up, and try again.
-	if ( !all_good ) {
+static int
+JobQueueSyncedHandler(Service *, int pipe_end)
+{
+	char buf[64];
+	while (daemonCore->Read_Pipe(pipe_end, buf, sizeof(buf)) > 0) {
+		// one pass below answers for all of the syncs
+	}
+
+	std::list<QmgmtDeferredCommit *>::iterator it = deferred_commits.begin();
+	while (it != deferred_commits.end()) {
+		QmgmtDeferredCommit *dc = *it;
+		if ( ! JobQueue->IsDurable(dc->ticket)) {
+			++it;
+			continue;
+		}
+		it = deferred_commits.erase(it);
+
+			// only successful commits are deferred
+		int rval = 0;
+		ReliSock *sock = dc->sock;
+		sock->encode();
+		if ( sock->code(rval) && sock->end_of_message() &&
+			 daemonCore->Register_Socket(sock, "Qmgmt Client",
+				(SocketHandlercpp)&QmgmtDeferredCommit::resume,
+				"QmgmtDeferredCommit::resume", dc, ALLOW) >= 0 )
+		{
+			continue;
+		}
+
+		dprintf(D_ALWAYS, "QMGR failed to send commit reply to %s\n",
+				sock->peer_description());
+			// close the connection the way serve_q_requests() does
+			// when a client goes away
+		restoreQmgmtConnection(dc->peer);
+		dc->peer = NULL;
 		unsetQSock();
-		all_good = setQSock((ReliSock*)sock);
+		AbortTransactionAndRecomputeClusters();
+		delete dc;
+		delete sock;
 	}
-	if (!all_good && sock) {
-		// should never happen
-		EXCEPT("handle_q: Unable to setQSock!!");
+	return 0;
+}
+
+static bool
+InitGroupCommit()
+{
+	int pipe_ends[2];
+	int notify_fd = -1;
+
+	if ( ! daemonCore->Create_Pipe(pipe_ends, true, false, true, true)) {
+		dprintf(D_ALWAYS, "Failed to create the job queue sync pipe, group commit disabled\n");
+		return false;
 	}
-	ASSERT(Q_SOCK);
+	if ( ! daemonCore->Get_Pipe_FD(pipe_ends[1], &notify_fd) ||
+		 ! JobQueue->EnableGroupCommit(notify_fd))
+	{
+		dprintf(D_ALWAYS, "Group commit of the job queue is not supported here\n");
+		daemonCore->Close_Pipe(pipe_ends[0]);
+		daemonCore->Close_Pipe(pipe_ends[1]);
+		return false;
+	}
+	daemonCore->Register_Pipe(pipe_ends[0], "Job Queue Sync Pipe",
+		(PipeHandler)JobQueueSyncedHandler, "JobQueueSyncedHandler");
+	group_commit_pipe = pipe_ends[0];
+	dprintf(D_FULLDEBUG, "Job queue group commit enabled\n");
+	return true;
+}
 
-	BeginTransaction();
+int
+CommitClientTransaction(SetAttributeFlags_t flags, CondorError *errorStack)
+{
+	if ( want_group_commit && group_commit_pipe < 0 && ! InitGroupCommit()) {
+		want_group_commit = false;
+	}
+	pending_commit_ticket = 0;
+	group_commit_client = want_group_commit && group_commit_pipe >= 0 && Q_SOCK;
+	int rval = CommitTransaction(flags, errorStack);
+	group_commit_client = false;
+	if (rval < 0) {
+		pending_commit_ticket = 0;
+	}
+	return rval;
+}
+
+bool
+CommitReplyDeferred()
+{
+	return pending_commit_ticket != 0;
+}
 
+	// Serve requests on the connection in Q_SOCK until the client closes
+	// it, or until a commit has to wait for the job queue log to be synced,
+	// in which case the connection is stashed and KEEP_STREAM is returned.
+static int
+serve_q_requests()
+{
+	int	rval;
 	bool may_fork = false;
 	ForkStatus fork_status = FORK_FAILED;
 	do {
 		/* Probably should wrap a timer around this */
 		rval = do_Q_request( Q_SOCK->getReliSock(), may_fork );
 
+		if( pending_commit_ticket ) {
+			ASSERT( fork_status != FORK_CHILD );
+			ReliSock *sock = Q_SOCK->getReliSock();
+			unsigned long ticket = pending_commit_ticket;
+			pending_commit_ticket = 0;
+			QmgmtPeer *peer = getQmgmtConnectionInfo();
+			deferred_commits.push_back(new QmgmtDeferredCommit(peer, sock, ticket));
+			return KEEP_STREAM;
+		}
+
 		if( may_fork && fork_status == FORK_FAILED ) {
 			fork_status = schedd_forker.NewJob();
 
 			if( fork_status == FORK_PARENT ) {
 				break;
 			}
+			if( fork_status == FORK_CHILD ) {
+					// the sync thread does not come along into the child
+				want_group_commit = false;
+			}
 		}
 	} while(rval >= 0);
 
@@ -2091,6 +2416,30 @@ handle_q(Service *, int, Stream *sock)
 	return 0;
 }
 
+int
+handle_q(Service *, int, Stream *sock)
+{
+	bool all_good;
+
+	all_good = setQSock((ReliSock*)sock);
+
+		// if setQSock failed, unset it to purge any old/stale
+		// connection that was never cleaned up, and try again.
+	if ( !all_good ) {
+		unsetQSock();
+		all_good = setQSock((ReliSock*)sock);
+	}
+	if (!all_good && sock) {
+		// should never happen
+		EXCEPT("handle_q: Unable to setQSock!!");
+	}
+	ASSERT(Q_SOCK);
+
+	BeginTransaction();
+
+	return serve_q_requests();
+}
+
 int GetMyProxyPassword (int, int, char **);
 
 int get_myproxy_password_handler(Service * /*service*/, int /*i*/, Stream *socket) {
@@ -2654,9 +3003,6 @@ int DestroyProc(int cluster_id, int proc_id)
 		CommitTransaction(NONDURABLE);
 	}
 
-		// remove jobid from any indexes
-	scheduler.removeJobFromIndexes(key);
-
 		// remove any match (startd) ad stored w/ this job
 	RemoveMatchedAd(cluster_id,proc_id);
 
@@ -2847,6 +3193,23 @@ SetAttributeByConstraint(const char *constraint_str, const char *attr_name,
 		constraint.set(compat_classad::RemoveExplicitTargetRefs(tree));
 	}
 
+	// if the job queue index can tell us which jobs might match, look at just those.
+	std::vector<JobQueueKey> candidates;
+	if (GetJobQueueIndexedKeys(constraint.Expr(), candidates, false)) {
+		for (size_t ix = 0; ix < candidates.size(); ++ix) {
+			key = candidates[ix];
+			JobQueueJob * job = NULL;
+			if ( ! JobQueue->Lookup(key, job)) continue;
+			if (EvalBool(job, constraint.Expr())) {
+				match_count += 1;
+				if (SetAttribute(key.cluster, key.proc, attr_name, attr_value, flags) < 0) {
+					had_error = 1;
+					terrno = errno;
+				}
+			}
+		}
+	} else {
+
 	// loop through the job queue, setting attribute on jobs that match
 	JobQueue->StartIterateAllClassAds();
 	while(JobQueue->IterateAllClassAds(ad,key)) {
@@ -2863,6 +3226,7 @@ SetAttributeByConstraint(const char *constraint_str, const char *attr_name,
 			}
 			FreeJobAd(ad);	// a no-op on the server side
 		}
+	}
 	}
 
 		// If we couldn't find any jobs that matched the constraint,
@@ -2913,6 +3277,12 @@ enum {
 	idATTR_JOB_MATERIALIZE_PAUSED,
 	idATTR_HOLD_REASON,
 	idATTR_HOLD_REASON_CODE,
+	idATTR_CURRENT_HOSTS,
+	idATTR_MAX_HOSTS,
+	idATTR_PRE_JOB_PRIO1,
+	idATTR_PRE_JOB_PRIO2,
+	idATTR_POST_JOB_PRIO1,
+	idATTR_POST_JOB_PRIO2,
 };
 
 enum {
@@ -2927,7 +3297,11 @@ enum {
 	catNewMaterialize = 0x0080,  // attributes that control the job factory
 	catMaterializeState = 0x0100, // change in state of job factory
 	catSpoolingHold = 0x0200,    // hold reason was set to CONDOR_HOLD_CODE_SpoolingInput
+	catJobIndex     = 0x0400,    // attribute is in the job queue index, see SCHEDD_JOB_QUEUE_INDEX_ATTRS
+	catRunnable     = 0x0800,    // decides whether and where a job is in its owner's list of runnable jobs
 	catCallbackTrigger = 0x1000, // indicates that a callback should happen on commit of this attribute
+	catPolicy       = 0x2000,    // periodic policy expressions depend on this attribute, see Scheduler::PeriodicExprHandler
+	catJobCounts    = 0x4000,    // the job must be counted again, see Scheduler::count_jobs
 	catCallbackNow = 0x20000,    // indicates that a callback should happen when setAttribute is called
 };
 
@@ -2946,25 +3320,31 @@ typedef struct attr_ident_pair {
 // NOTE: !!!
 #define FILL(attr,cat) { attr, id##attr, cat }
 static const ATTR_IDENT_PAIR aSpecialSetAttrs[] = {
-	FILL(ATTR_ACCOUNTING_GROUP,   catDirtyPrioRec | catSubmitterIdent),
+	FILL(ATTR_ACCOUNTING_GROUP,   catDirtyPrioRec | catSubmitterIdent | catRunnable | catCallbackTrigger),
 	FILL(ATTR_CLUSTER_ID,         catJobId),
 	FILL(ATTR_CRON_DAYS_OF_MONTH, catCron),
 	FILL(ATTR_CRON_DAYS_OF_WEEK,  catCron),
 	FILL(ATTR_CRON_HOURS,         catCron),
 	FILL(ATTR_CRON_MINUTES,       catCron),
 	FILL(ATTR_CRON_MONTHS,        catCron),
+	FILL(ATTR_CURRENT_HOSTS,      catRunnable | catCallbackTrigger),
 	FILL(ATTR_HOLD_REASON,        0), // used to detect submit of jobs with the magic 'hold for spooling' hold code
 	FILL(ATTR_HOLD_REASON_CODE,   0), // used to detect submit of jobs with the magic 'hold for spooling' hold code
 	FILL(ATTR_JOB_MATERIALIZE_DIGEST_FILE, catNewMaterialize | catCallbackTrigger),
 	FILL(ATTR_JOB_MATERIALIZE_ITEMS_FILE, catNewMaterialize | catCallbackTrigger),
 	FILL(ATTR_JOB_MATERIALIZE_LIMIT, catMaterializeState | catCallbackTrigger),
 	FILL(ATTR_JOB_MATERIALIZE_PAUSED, catMaterializeState | catCallbackTrigger),
-	FILL(ATTR_JOB_PRIO,           catDirtyPrioRec),
+	FILL(ATTR_JOB_PRIO,           catDirtyPrioRec | catRunnable | catCallbackTrigger),
 	FILL(ATTR_JOB_STATUS,         catStatus | catCallbackTrigger),
 	FILL(ATTR_JOB_UNIVERSE,       catJobObj),
-	FILL(ATTR_NICE_USER,          catSubmitterIdent),
+	FILL(ATTR_MAX_HOSTS,          catRunnable | catCallbackTrigger),
+	FILL(ATTR_NICE_USER,          catSubmitterIdent | catRunnable | catCallbackTrigger),
 	FILL(ATTR_NUM_JOB_RECONNECTS, 0),
 	FILL(ATTR_OWNER,              0),
+	FILL(ATTR_POST_JOB_PRIO1,     catRunnable | catCallbackTrigger),
+	FILL(ATTR_POST_JOB_PRIO2,     catRunnable | catCallbackTrigger),
+	FILL(ATTR_PRE_JOB_PRIO1,      catRunnable | catCallbackTrigger),
+	FILL(ATTR_PRE_JOB_PRIO2,      catRunnable | catCallbackTrigger),
 	FILL(ATTR_PROC_ID,            catJobId),
 	FILL(ATTR_RANK,               catTargetScope),
 	FILL(ATTR_REQUIREMENTS,       catTargetScope),
@@ -3188,6 +3568,15 @@ SetAttribute(int cluster_id, int proc_id, const char *attr_name,
 
 	int attr_category;
 	int attr_id = IsSpecialSetAttribute(attr_name, &attr_category);
+	if (scheduler.jobIndex().IsIndexed(attr_name)) {
+		attr_category |= catJobIndex | catCallbackTrigger;
+	}
+	if (scheduler.policyDependsOn(attr_name)) {
+		attr_category |= catPolicy | catCallbackTrigger;
+	}
+	if (scheduler.incrementalJobCounts()) {
+		attr_category |= catJobCounts | catCallbackTrigger;
+	}
 
 	// A few special attributes have additional access checks
 	// but for most, we have already decided whether or not we can change this attribute
@@ -3588,7 +3977,7 @@ SetAttribute(int cluster_id, int proc_id, const char *attr_name,
 
 	if (attr_category & catCallbackTrigger) {
 		// remember what callbacks to call when the transaction is committed.
-		int triggers = JobQueue->SetTransactionTriggers(attr_category & 0xFFF);
+		int triggers = JobQueue->SetTransactionTriggers(attr_category & ~(catCallbackTrigger | catCallbackNow));
 		if (0 == triggers) { // not inside a transaction, triggers will not be recorded... so promote it to trigger NOW
 			attr_category |= catCallbackNow;
 		}
@@ -3712,6 +4101,82 @@ void DoSetAttributeCallbacks(const std::set<std::string> &jobids, int triggers)
 		}
 	}
 
+	// an indexed attribute changed, re-index the job, or all of the jobs in the cluster
+	// if it was the cluster ad.  new jobs are indexed later in CommitTransaction.
+	if (triggers & catJobIndex) {
+		std::vector<JOB_ID_KEY> procs;
+		for (auto it = jobids.begin(); it != jobids.end(); ++it) {
+			if ( ! job_id.set(it->c_str()) || job_id.cluster <= 0) continue; // ignore the '0.0' ad
+			if (job_id.proc >= 0) {
+				procs.assign(1, job_id);
+			} else {
+				scheduler.jobIndex().GetClusterProcs(job_id.cluster, procs);
+			}
+			for (size_t ix = 0; ix < procs.size(); ++ix) {
+				JobQueueJob * job = NULL;
+				if (JobQueue->Lookup(procs[ix], job)) {
+					scheduler.jobIndex().UpdateJob(job);
+				}
+			}
+		}
+	}
+
+	// the job's runnability or priority may have changed, move it in (or out of)
+	// its owner's list of runnable jobs.  changes to a cluster ad move all of its jobs.
+	if (triggers & (catStatus | catRunnable)) {
+		std::vector<JOB_ID_KEY> procs;
+		for (auto it = jobids.begin(); it != jobids.end(); ++it) {
+			if ( ! job_id.set(it->c_str()) || job_id.cluster <= 0) continue; // ignore the '0.0' ad
+			if (job_id.proc >= 0) {
+				procs.assign(1, job_id);
+			} else if (triggers & catRunnable) {
+				scheduler.jobIndex().GetClusterProcs(job_id.cluster, procs);
+			} else {
+				continue;
+			}
+			for (size_t ix = 0; ix < procs.size(); ++ix) {
+				JobQueueJob * job = NULL;
+				if (JobQueue->Lookup(procs[ix], job)) {
+					UpdateRunnableJob(job);
+				}
+			}
+		}
+	}
+
+	// an attribute that periodic policy depends on changed, evaluate the policy
+	// of the job, or of all of the jobs in the cluster, at the next PeriodicExprHandler
+	if (triggers & catPolicy) {
+		std::vector<JOB_ID_KEY> procs;
+		for (auto it = jobids.begin(); it != jobids.end(); ++it) {
+			if ( ! job_id.set(it->c_str()) || job_id.cluster <= 0) continue; // ignore the '0.0' ad
+			if (job_id.proc >= 0) {
+				procs.assign(1, job_id);
+			} else {
+				scheduler.jobIndex().GetClusterProcs(job_id.cluster, procs);
+			}
+			for (size_t ix = 0; ix < procs.size(); ++ix) {
+				scheduler.policyJobChanged(procs[ix]);
+			}
+		}
+	}
+
+	// any change to a job may change how it is counted, count the job, or all
+	// of the jobs in the cluster, again at the next count_jobs
+	if (triggers & catJobCounts) {
+		std::vector<JOB_ID_KEY> procs;
+		for (auto it = jobids.begin(); it != jobids.end(); ++it) {
+			if ( ! job_id.set(it->c_str()) || job_id.cluster <= 0) continue; // ignore the '0.0' ad
+			if (job_id.proc >= 0) {
+				procs.assign(1, job_id);
+			} else {
+				scheduler.jobIndex().GetClusterProcs(job_id.cluster, procs);
+			}
+			for (size_t ix = 0; ix < procs.size(); ++ix) {
+				scheduler.jobCountsChanged(procs[ix]);
+			}
+		}
+	}
+
 	// note, catNewMaterialize trigger handling for new cluster
 	// is done elsewhere because it needs to happen later than where this function is called.
 	if (scheduler.getAllowLateMaterialize()) {
@@ -4325,6 +4790,10 @@ CommitTransaction(SetAttributeFlags_t flags /* = 0 */,
 		JobQueue->CommitNondurableTransaction();
 		ScheduleJobQueueLogFlush();
 	}
+	else if ( group_commit_client ) {
+		group_commit_client = false;
+		pending_commit_ticket = JobQueue->CommitGroupTransaction();
+	}
 	else {
 		JobQueue->CommitTransaction();
 	}
@@ -4425,15 +4894,15 @@ CommitTransaction(SetAttributeFlags_t flags /* = 0 */,
 					// convert any old attributes for backwards compatbility
 				ConvertOldJobAdAttrs(procad, false);
 
-					// Add the job to various runtime indexes for quick lookups
-				scheduler.indexAJob(procad, false);
-
 					// make sure the job objd and cluster object are populated
 				procad->jid = job_id;
 				procad->SetCluster(clusterad);
 				procad->PopulateFromAd();
 				procad->ownerinfo = ownerinfo;
 
+					// Add the job to various runtime indexes for quick lookups
+				scheduler.indexAJob(procad, false);
+
 				PostCommitJobFactoryProc(clusterad, procad);
 
 					// If input files are going to be spooled, rewrite
@@ -4836,6 +5305,25 @@ DeleteAttribute(int cluster_id, int proc_id, const char *attr_name)
 
 	JobQueue->DeleteAttribute(key.c_str(), attr_name);
 
+	int triggers = 0;
+	if (scheduler.jobIndex().IsIndexed(attr_name)) {
+		triggers |= catJobIndex;
+	}
+	if (scheduler.policyDependsOn(attr_name)) {
+		triggers |= catPolicy;
+	}
+	if (scheduler.incrementalJobCounts()) {
+		triggers |= catJobCounts;
+	}
+	if (triggers) {
+		// re-index, re-evaluate policy or recount on commit, or now if we are not in a transaction
+		if (0 == JobQueue->SetTransactionTriggers(triggers)) {
+			std::set<std::string> keys;
+			keys.insert(key.c_str());
+			DoSetAttributeCallbacks(keys, triggers);
+		}
+	}
+
 	JobQueueDirty = true;
 
 	return 1;
@@ -5738,6 +6226,30 @@ GetNextJob(int initScan)
 }
 
 
+// When the job queue index can narrow a GetNextJobByConstraint walk, these
+// hold the candidate jobs and how far the walk has got through them.
+static bool indexed_walk = false;
+static size_t indexed_walk_pos = 0;
+static std::vector<JobQueueKey> indexed_walk_keys;
+
+static bool
+StartIndexedWalk(const char *constraint)
+{
+	indexed_walk = false;
+	indexed_walk_pos = 0;
+	indexed_walk_keys.clear();
+	if ( ! constraint || ! constraint[0]) {
+		return false;
+	}
+	ExprTree *tree = NULL;
+	if (0 != ParseClassAdRvalExpr(constraint, tree)) {
+		return false;
+	}
+	ConstraintHolder holder(tree);
+	indexed_walk = GetJobQueueIndexedKeys(holder.Expr(), indexed_walk_keys, false);
+	return indexed_walk;
+}
+
 JobQueueJob *
 GetNextJobByConstraint(const char *constraint, int initScan)
 {
@@ -5745,7 +6257,19 @@ GetNextJobByConstraint(const char *constraint, int initScan)
 	JobQueueKey key;
 
 	if (initScan) {
-		JobQueue->StartIterateAllClassAds();
+		if ( ! StartIndexedWalk(constraint)) {
+			JobQueue->StartIterateAllClassAds();
+		}
+	}
+
+	if (indexed_walk) {
+		while (indexed_walk_pos < indexed_walk_keys.size()) {
+			key = indexed_walk_keys[indexed_walk_pos++];
+			if (JobQueue->Lookup(key, ad) && EvalBool(ad, constraint)) {
+				return ad;
+			}
+		}
+		return NULL;
 	}
 
 	while(JobQueue->Iterate(key,ad)) {
@@ -5816,12 +6340,19 @@ GetNextJobByCluster(int c, int initScan)
 
 	JobQueueJob	*ad;
 
+		// the procs of a cluster come from the index, so walk them first,
+		// and then the cluster ad itself.
+	static std::vector<JobQueueKey> procs;
+	static size_t pos = 0;
 	if (initScan) {
-		JobQueue->StartIterateAllClassAds();
+		scheduler.jobIndex().GetClusterProcs(c, procs);
+		pos = 0;
 	}
 
-	while(JobQueue->Iterate(key,ad)) {
-		if ( c == key.cluster ) {
+	while (pos <= procs.size()) {
+		key = (pos < procs.size()) ? procs[pos] : JobQueueKey(c, -1);
+		++pos;
+		if (key.cluster == c && JobQueue->Lookup(key, ad)) {
 			return ad;
 		}
 	}
@@ -6032,28 +6563,60 @@ int    last_autocluster_type=0;
 int    last_autocluster_classad_cache_hit=0;
 stats_entry_abs<int> SCGetAutoClusterType;
 
+// Fill in a prio_rec for a job, except for the auto_cluster_id.  Returns
+// false if the job doesn't belong in the PrioRec array because it is not
+// runnable, in which case only cur_hosts is set.
+static bool
+make_prio_rec(JobQueueJob *job, const JOB_ID_KEY & jid, prio_rec & rec, int & cur_hosts)
+{
+	int universe = 0;
+	job->LookupInteger(ATTR_JOB_UNIVERSE, universe);
+	ASSERT(universe == job->Universe());
+
+	if ( ! GetJobPrioRec(job, jid, rec, cur_hosts)) {
+		return false;
+	}
+	return service_this_universe(universe, job);
+}
+
+// The runnable jobs of each owner in priority order, kept up to date as jobs
+// are committed, change and leave the queue, so that FindRunnableJob can pick
+// a job to reuse a claim for without rebuilding and sorting the PrioRec array.
+// The lists are also rebuilt from scratch whenever the PrioRec array is.
+static RunnableJobLists RunnableJobs;
+
+void
+RemoveRunnableJob(const JOB_ID_KEY & jid)
+{
+	RunnableJobs.Remove(jid);
+}
+
+// Put a job in the right place in its owner's list of runnable jobs, or take
+// it out if it is no longer runnable.
+void
+UpdateRunnableJob(JobQueueJob *job)
+{
+	if ( ! job || ! job->IsJob() || ! job->Universe()) {
+		return; // not populated yet, it will be added when it is
+	}
+	prio_rec rec;
+	int cur_hosts = 0;
+	if (make_prio_rec(job, job->jid, rec, cur_hosts)) {
+		RunnableJobs.Insert(rec);
+	} else {
+		RemoveRunnableJob(job->jid);
+	}
+}
+
 // Returns cur_hosts so that another function in the scheduler can
 // update JobsRunning and keep the scheduler and queue manager
 // seperate. 
 int get_job_prio(JobQueueJob *job, const JOB_ID_KEY & jid, void *)
 {
-    int     job_prio, 
-            pre_job_prio1, 
-            pre_job_prio2, 
-            post_job_prio1, 
-            post_job_prio2;
-    int     job_status;
-    int     q_date;
-    char    owner[100];
-    int     cur_hosts;
-    int     max_hosts;
-    int     niceUser;
-    int     universe;
+	int     cur_hosts = 0;
 
 	ASSERT(job);
 
-	owner[0] = 0;
-
 		// We must call getAutoClusterid() in get_job_prio!!!  We CANNOT
 		// return from this function before we call getAutoClusterid(), so call
 		// it early on (before any returns) right now.  The reason for this is
@@ -6081,80 +6644,17 @@ int get_job_prio(JobQueueJob *job, const JOB_ID_KEY & jid, void *)
 	SCGetAutoClusterType = last_autocluster_type;
 	GetAutoCluster_cchit_runtime += last_autocluster_classad_cache_hit;
 
-	job->LookupInteger(ATTR_JOB_UNIVERSE, universe);
-	ASSERT(universe == job->Universe());
-
-	job->LookupInteger(ATTR_JOB_STATUS, job_status);
-    if (job->LookupInteger(ATTR_CURRENT_HOSTS, cur_hosts) == 0) {
-        cur_hosts = ((job_status == SUSPENDED || job_status == RUNNING || job_status == TRANSFERRING_OUTPUT) ? 1 : 0);
-    }
-    if (job->LookupInteger(ATTR_MAX_HOSTS, max_hosts) == 0) {
-        max_hosts = ((job_status == IDLE) ? 1 : 0);
-    }
-	// Figure out if we should contine and put this job into the PrioRec array
-	// or not.
-    // No longer judge whether or not a job can run by looking at its status.
-    // Rather look at if it has all the hosts that it wanted.
-    if (cur_hosts>=max_hosts || job_status==HELD || 
-			job_status==REMOVED || job_status==COMPLETED ||
-			!service_this_universe(universe,job)) 
-	{
-        return cur_hosts;
-	}
-
 	// --- Insert this job into the PrioRec array ---
-
-       // If pre/post prios are not defined as forced attributes, set them to INT_MIN
-	// to flag priocompare routine to not use them.
-	 
-    if (!job->LookupInteger(ATTR_PRE_JOB_PRIO1, pre_job_prio1)) {
-         pre_job_prio1 = INT_MIN;
-    }
-    if (!job->LookupInteger(ATTR_PRE_JOB_PRIO2, pre_job_prio2)) {
-         pre_job_prio2 = INT_MIN;
-    } 
-    if (!job->LookupInteger(ATTR_POST_JOB_PRIO1, post_job_prio1)) {
-         post_job_prio1 = INT_MIN;
-    }	 
-    if (!job->LookupInteger(ATTR_POST_JOB_PRIO2, post_job_prio2)) {
-         post_job_prio2 = INT_MIN;
-    }
-
-    job->LookupInteger(ATTR_JOB_PRIO, job_prio);
-    job->LookupInteger(ATTR_Q_DATE, q_date);
-
-	char * powner = owner;
-	int cremain = sizeof(owner);
-	if( job->LookupInteger( ATTR_NICE_USER, niceUser ) && niceUser ) {
-		strcpy(powner,NiceUserName);
-		strcat(powner,".");
-		int cch = strlen(powner);
-		powner += cch;
-		cremain -= cch;
-	}
-		// Note, we should use this method instead of just looking up
-		// ATTR_USER directly, since that includes UidDomain, which we
-		// don't want for this purpose...
-	job->LookupString(ATTR_ACCOUNTING_GROUP, powner, cremain);  // TODDCORE
-	if (*powner == '\0') {
-		job->LookupString(ATTR_OWNER, powner, cremain);
-	}
-
-    PrioRec[N_PrioRecs].id             = jid;
-    PrioRec[N_PrioRecs].job_prio       = job_prio;
-    PrioRec[N_PrioRecs].pre_job_prio1  = pre_job_prio1;
-    PrioRec[N_PrioRecs].pre_job_prio2  = pre_job_prio2;
-    PrioRec[N_PrioRecs].post_job_prio1 = post_job_prio1;
-    PrioRec[N_PrioRecs].post_job_prio2 = post_job_prio2;
-    PrioRec[N_PrioRecs].status         = job_status;
-    PrioRec[N_PrioRecs].qdate          = q_date;
+	prio_rec & rec = PrioRec[N_PrioRecs];
+	if ( ! make_prio_rec(job, jid, rec, cur_hosts)) {
+		return cur_hosts;
+	}
 	if ( auto_id == -1 ) {
-		PrioRec[N_PrioRecs].auto_cluster_id = jid.cluster;
+		rec.auto_cluster_id = jid.cluster;
 	} else {
-		PrioRec[N_PrioRecs].auto_cluster_id = auto_id;
+		rec.auto_cluster_id = auto_id;
 	}
-
-	strcpy(PrioRec[N_PrioRecs].owner,owner);
+	RunnableJobs.Insert(rec);
 
     N_PrioRecs += 1;
 	if ( N_PrioRecs == MAX_PRIO_REC ) {
@@ -6511,6 +7011,7 @@ static void DoBuildPrioRecArray() {
 	BuildPrioRec_mark_runtime += rt.tick(now);
 
 	N_PrioRecs = 0;
+	RunnableJobs.Clear();
 	WalkJobQueue(get_job_prio);
 	BuildPrioRec_walk_runtime += rt.tick(now);
 
@@ -6545,10 +7046,8 @@ static void DoBuildPrioRecArray() {
  * Returns:
  *   true if the array was rebuilt; false otherwise
  */
-bool BuildPrioRecArray(bool no_match_found /*default false*/) {
-
-		// caller expects PrioRecAutoClusterRejected to be instantiated
-		// (and cleared)
+// Make sure PrioRecAutoClusterRejected exists and is empty.
+static void ResetPrioRecAutoClusterRejected() {
 	int hash_size = TotalJobsCount/4+1000;
 	if( PrioRecAutoClusterRejected &&
 	    PrioRecAutoClusterRejected->getTableSize() < 0.8*hash_size )
@@ -6563,6 +7062,13 @@ bool BuildPrioRecArray(bool no_match_found /*default false*/) {
 	else {
 		PrioRecAutoClusterRejected->clear();
 	}
+}
+
+bool BuildPrioRecArray(bool no_match_found /*default false*/) {
+
+		// caller expects PrioRecAutoClusterRejected to be instantiated
+		// (and cleared)
+	ResetPrioRecAutoClusterRejected();
 
 	if( !PrioRecArrayIsDirty ) {
 		dprintf(D_FULLDEBUG,
@@ -6604,6 +7110,139 @@ bool BuildPrioRecArray(bool no_match_found /*default false*/) {
 	return true;
 }
 
+/*
+ * Check whether a runnable job can use the claimed resource described by
+ * my_match_ad.  If it can't, and no other job in the same autocluster
+ * could either, remember the autocluster in PrioRecAutoClusterRejected.
+ */
+static bool
+RunnableJobMatches(ClassAd *ad, int auto_cluster_id, ClassAd *my_match_ad)
+{
+		// Now check if the job and the claimed resource match.
+		// NOTE : we must do this AFTER we ensure the job is still runnable, which
+		// is why the caller invokes Runnable() first.
+	if ( ! IsAMatch( ad, my_match_ad ) ) {
+			// Job and machine do not match.
+			// Assume that none of the other jobs in this auto-cluster will match.
+			// THIS IS A DANGEROUS ASSUMPTION - what if this job is no longer
+			// part of this autocluster?  TODO perhaps we should verify this
+			// job is still part of this autocluster here.
+		PrioRecAutoClusterRejected->insert( auto_cluster_id, 1 );
+		return false;
+	}
+
+		// Make sure that the startd ranks this job >= the
+		// rank of the job that initially claimed it.
+		// We stashed that rank in the startd ad when
+		// the match was created.
+		// (As of 6.9.0, the startd does not reject reuse
+		// of the claim with lower RANK, but future versions
+		// very well may.)
+
+	float current_startd_rank;
+	if( my_match_ad &&
+		my_match_ad->LookupFloat(ATTR_CURRENT_RANK, current_startd_rank) )
+	{
+		float new_startd_rank = 0;
+		if( my_match_ad->EvalFloat(ATTR_RANK, ad, new_startd_rank) )
+		{
+			if( new_startd_rank < current_startd_rank ) {
+				return false;
+			}
+		}
+	}
+
+		// If Concurrency Limits are in play it is
+		// important not to reuse a claim from one job
+		// that has one set of limits for a job that
+		// has a different set. This is because the
+		// Accountant is keeping track of limits based
+		// on the matches that are being handed out.
+		//
+		// A future optimization here may be to allow
+		// jobs with a subset of the limits given to
+		// the current match to reuse it.
+
+	static param_cached<bool> consider_limits("CLAIM_RECYCLING_CONSIDER_LIMITS", true);
+	MyString jobLimits, recordedLimits;
+	if (consider_limits) {
+		ad->LookupString(ATTR_CONCURRENCY_LIMITS, jobLimits);
+		my_match_ad->LookupString(ATTR_MATCHED_CONCURRENCY_LIMITS,
+								  recordedLimits);
+		jobLimits.lower_case();
+		recordedLimits.lower_case();
+
+		if (jobLimits == recordedLimits) {
+			dprintf(D_FULLDEBUG,
+					"ConcurrencyLimits match, can reuse claim\n");
+		} else {
+			dprintf(D_FULLDEBUG,
+					"ConcurrencyLimits do not match, cannot "
+					"reuse claim\n");
+			PrioRecAutoClusterRejected->
+				insert(auto_cluster_id, 1);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Find the highest priority job of the given owner that matches with
+ * my_match_ad, from the owner's list of runnable jobs, so that reusing a
+ * claim doesn't wait for the PrioRec array to be rebuilt.
+ */
+static void
+FindRunnableJobForOwner(PROC_ID & jobid, ClassAd* my_match_ad, const char * owner)
+{
+	const RunnableJobLists::JobList * jobs = RunnableJobs.OwnerJobs(owner);
+	if ( ! jobs) {
+		return;
+	}
+	RunnableJobLists::JobList::const_iterator it = jobs->begin();
+	while (it != jobs->end()) {
+		PROC_ID id = it->id;
+		++it;
+
+		JobQueueJob *ad = GetJobAd( id.cluster, id.proc );
+		if (!ad) {
+				// This ad must have been deleted, we'll hear about that.
+			continue;
+		}
+
+			// the job's current autocluster, or its cluster if it hasn't been given one.
+		int auto_cluster_id = (ad->autocluster_id > 0) ? ad->autocluster_id : id.cluster;
+		int junk; // don't care about the value
+		if ( PrioRecAutoClusterRejected->lookup( auto_cluster_id, junk ) == 0 ) {
+				// We have already failed to match a job from this same
+				// autocluster with this machine.  Skip it.
+			continue;
+		}
+
+		if ( ! Runnable(&id)) {
+				// Something we don't track has made this job unrunnable,
+				// take it out of the list until it changes again.
+			RunnableJobs.Remove(id);
+			if ( ! RunnableJobs.OwnerJobs(owner)) {
+				break; // that was the owner's last job
+			}
+			continue;
+		}
+		if (scheduler.AlreadyMatched(&id)) {
+				// It will leave the list when it starts running.
+			continue;
+		}
+
+		if ( ! RunnableJobMatches(ad, auto_cluster_id, my_match_ad)) {
+			continue;
+		}
+
+		jobid = id; // success!
+		return;
+	}
+}
+
 /*
  * Find the job with the highest priority that matches with
  * my_match_ad (which is a startd ad).  If user is NULL, get a job for
@@ -6638,6 +7277,14 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 		owner.setChar(at_sign_pos,'\0');
 	}
 
+		// Jobs for a single owner come from that owner's list of
+		// runnable jobs, which is always up to date.
+	if ( ! match_any_user) {
+		ResetPrioRecAutoClusterRejected();
+		FindRunnableJobForOwner(jobid, my_match_ad, owner.Value());
+		return;
+	}
+
 	bool rebuilt_prio_rec_array = BuildPrioRecArray();
 
 		// Iterate through the most recently constructed list of
@@ -6652,11 +7299,6 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 				continue;
 			}
 
-			if ( !match_any_user && strcmp(PrioRec[i].owner,owner.Value()) != 0 ) {
-					// Owner doesn't match.
-				continue;
-			}
-
 			ad = GetJobAd( PrioRec[i].id.cluster, PrioRec[i].id.proc );
 			if (!ad) {
 					// This ad must have been deleted since we last built
@@ -6697,73 +7339,11 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 				continue;
 			}
 
-				// Now check if the job and the claimed resource match.
-				// NOTE : we must do this AFTER we ensure the job is still runnable, which
-				// is why we invoke Runnable() above first.
-			if ( ! IsAMatch( ad, my_match_ad ) ) {
-					// Job and machine do not match.
-					// Assume that none of the other jobs in this auto-cluster will match.
-					// THIS IS A DANGEROUS ASSUMPTION - what if this job is no longer
-					// part of this autocluster?  TODO perhaps we should verify this
-					// job is still part of this autocluster here.
-				PrioRecAutoClusterRejected->insert( PrioRec[i].auto_cluster_id, 1 );
+			if ( ! RunnableJobMatches(ad, PrioRec[i].auto_cluster_id, my_match_ad)) {
 					// Move along to the next job in the prio rec array
 				continue;
 			}
 
-				// Make sure that the startd ranks this job >= the
-				// rank of the job that initially claimed it.
-				// We stashed that rank in the startd ad when
-				// the match was created.
-				// (As of 6.9.0, the startd does not reject reuse
-				// of the claim with lower RANK, but future versions
-				// very well may.)
-
-			float current_startd_rank;
-			if( my_match_ad &&
-				my_match_ad->LookupFloat(ATTR_CURRENT_RANK, current_startd_rank) )
-			{
-				float new_startd_rank = 0;
-				if( my_match_ad->EvalFloat(ATTR_RANK, ad, new_startd_rank) )
-				{
-					if( new_startd_rank < current_startd_rank ) {
-						continue;
-					}
-				}
-			}
-
-				// If Concurrency Limits are in play it is
-				// important not to reuse a claim from one job
-				// that has one set of limits for a job that
-				// has a different set. This is because the
-				// Accountant is keeping track of limits based
-				// on the matches that are being handed out.
-				//
-				// A future optimization here may be to allow
-				// jobs with a subset of the limits given to
-				// the current match to reuse it.
-
-			MyString jobLimits, recordedLimits;
-			if (param_boolean("CLAIM_RECYCLING_CONSIDER_LIMITS", true)) {
-				ad->LookupString(ATTR_CONCURRENCY_LIMITS, jobLimits);
-				my_match_ad->LookupString(ATTR_MATCHED_CONCURRENCY_LIMITS,
-										  recordedLimits);
-				jobLimits.lower_case();
-				recordedLimits.lower_case();
-
-				if (jobLimits == recordedLimits) {
-					dprintf(D_FULLDEBUG,
-							"ConcurrencyLimits match, can reuse claim\n");
-				} else {
-					dprintf(D_FULLDEBUG,
-							"ConcurrencyLimits do not match, cannot "
-							"reuse claim\n");
-					PrioRecAutoClusterRejected->
-						insert(PrioRec[i].auto_cluster_id, 1);
-					continue;
-				}
-			}
-
 			jobid = PrioRec[i].id; // success!
 			return;
 
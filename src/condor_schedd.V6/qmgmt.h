@@ -330,6 +330,8 @@ typedef ClassAdLog<JOB_ID_KEY, const char*,JobQueueJob*> JobQueueLogType;
 #define JOB_QUEUE_ITERATOR_OPT_INCLUDE_CLUSTERS     0x0001
 JobQueueLogType::filter_iterator GetJobQueueIterator(const classad::ExprTree &requirements, int timeslice_ms);
 JobQueueLogType::filter_iterator GetJobQueueIteratorEnd();
+void GetJobQueueKeys(std::vector<JobQueueKey> &keys, bool include_clusters);
+bool GetJobQueueIndexedKeys(classad::ExprTree * constraint, std::vector<JobQueueKey> &keys, bool include_clusters);
 
 
 class schedd_runtime_probe;
@@ -357,6 +359,12 @@ bool Reschedule();
 int get_myproxy_password_handler(Service *, int, Stream *sock);
 
 QmgmtPeer* getQmgmtConnectionInfo();
+
+	// Commit a client's transaction.  If CommitReplyDeferred() is then
+	// true, the reply is sent for us once the job queue log is synced.
+int CommitClientTransaction(SetAttributeFlags_t flags, CondorError *errorStack);
+bool CommitReplyDeferred();
+
 bool OwnerCheck(int,int);
 
 
@@ -367,6 +375,8 @@ extern HashTable<int,int> *PrioRecAutoClusterRejected;
 extern int grow_prio_recs(int);
 
 extern void	FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad, char const * user);
+extern void	UpdateRunnableJob(JobQueueJob *job);
+extern void	RemoveRunnableJob(const JOB_ID_KEY &jid);
 extern int Runnable(PROC_ID*);
 extern int Runnable(ClassAd*);
 
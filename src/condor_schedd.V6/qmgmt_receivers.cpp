@@ -602,10 +602,15 @@ do_Q_request(ReliSock *syscall_sock,bool &may_fork)
 
 		CondorError errstack;
 		errno = 0;
-		rval = CommitTransaction( flags, & errstack );
+		rval = CommitClientTransaction( flags, & errstack );
 		terrno = errno;
 		dprintf( D_SYSCALLS, "\tflags = %d, rval = %d, errno = %d\n", flags, rval, terrno );
 
+		if( CommitReplyDeferred() ) {
+				// the reply is sent once the job queue log is synced
+			return 0;
+		}
+
 		syscall_sock->encode();
 		assert( syscall_sock->code(rval) );
 		if( rval < 0 ) {
@@ -0,0 +1,228 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_attributes.h"
+#include "proc.h"
+#include "runnable_jobs.h"
+
+bool
+GetJobPrioRec(ClassAd *job, const JOB_ID_KEY & jid, prio_rec & rec, int & cur_hosts)
+{
+    int     job_prio, 
+            pre_job_prio1, 
+            pre_job_prio2, 
+            post_job_prio1, 
+            post_job_prio2;
+    int     job_status;
+    int     q_date;
+    char    owner[100];
+    int     max_hosts;
+    int     niceUser;
+
+	owner[0] = 0;
+
+	job->LookupInteger(ATTR_JOB_STATUS, job_status);
+    if (job->LookupInteger(ATTR_CURRENT_HOSTS, cur_hosts) == 0) {
+        cur_hosts = ((job_status == SUSPENDED || job_status == RUNNING || job_status == TRANSFERRING_OUTPUT) ? 1 : 0);
+    }
+    if (job->LookupInteger(ATTR_MAX_HOSTS, max_hosts) == 0) {
+        max_hosts = ((job_status == IDLE) ? 1 : 0);
+    }
+	// Figure out if we should contine and put this job into the PrioRec array
+	// or not.
+    // No longer judge whether or not a job can run by looking at its status.
+    // Rather look at if it has all the hosts that it wanted.
+    if (cur_hosts>=max_hosts || job_status==HELD || 
+			job_status==REMOVED || job_status==COMPLETED) 
+	{
+        return false;
+	}
+
+       // If pre/post prios are not defined as forced attributes, set them to INT_MIN
+	// to flag priocompare routine to not use them.
+	 
+    if (!job->LookupInteger(ATTR_PRE_JOB_PRIO1, pre_job_prio1)) {
+         pre_job_prio1 = INT_MIN;
+    }
+    if (!job->LookupInteger(ATTR_PRE_JOB_PRIO2, pre_job_prio2)) {
+         pre_job_prio2 = INT_MIN;
+    } 
+    if (!job->LookupInteger(ATTR_POST_JOB_PRIO1, post_job_prio1)) {
+         post_job_prio1 = INT_MIN;
+    }	 
+    if (!job->LookupInteger(ATTR_POST_JOB_PRIO2, post_job_prio2)) {
+         post_job_prio2 = INT_MIN;
+    }
+
+    job_prio = 0;
+    job->LookupInteger(ATTR_JOB_PRIO, job_prio);
+    q_date = 0;
+    job->LookupInteger(ATTR_Q_DATE, q_date);
+
+	char * powner = owner;
+	int cremain = sizeof(owner);
+	if( job->LookupInteger( ATTR_NICE_USER, niceUser ) && niceUser ) {
+		strcpy(powner,NiceUserName);
+		strcat(powner,".");
+		int cch = strlen(powner);
+		powner += cch;
+		cremain -= cch;
+	}
+		// Note, we should use this method instead of just looking up
+		// ATTR_USER directly, since that includes UidDomain, which we
+		// don't want for this purpose...
+	job->LookupString(ATTR_ACCOUNTING_GROUP, powner, cremain);  // TODDCORE
+	if (*powner == '\0') {
+		job->LookupString(ATTR_OWNER, powner, cremain);
+	}
+
+    rec.id             = jid;
+    rec.job_prio       = job_prio;
+    rec.pre_job_prio1  = pre_job_prio1;
+    rec.pre_job_prio2  = pre_job_prio2;
+    rec.post_job_prio1 = post_job_prio1;
+    rec.post_job_prio2 = post_job_prio2;
+    rec.status         = job_status;
+    rec.qdate          = q_date;
+	strcpy(rec.owner,owner);
+
+	return true;
+}
+
+extern "C" {
+int
+prio_compar(prio_rec* a, prio_rec* b)
+{
+	 /* compare submitted job preprio's: higher values have more priority */
+	 /* Typically used to prioritize entire DAG jobs over other DAG jobs */
+	 if (a->pre_job_prio1 > INT_MIN && b->pre_job_prio1 > INT_MIN ) { 
+	      if( a->pre_job_prio1 < b->pre_job_prio1 ) {
+		  return 1;
+              }
+	      if( a->pre_job_prio1 > b->pre_job_prio1 ) {
+		  return -1;
+	      }
+	 }
+		 
+	 if( a->pre_job_prio2 > INT_MIN && b->pre_job_prio2 > INT_MIN ) {
+	      if( a->pre_job_prio2 < b->pre_job_prio2 ) {
+		  return 1;
+	      }
+	      if( a->pre_job_prio2 > b->pre_job_prio2 ) {
+		  return -1;
+	      }
+	 }
+	 
+	 /* compare job priorities: higher values have more priority */
+	 if( a->job_prio < b->job_prio ) {
+		  return 1;
+	 }
+	 if( a->job_prio > b->job_prio ) {
+		  return -1;
+	 }
+	 
+	 /* compare submitted job postprio's: higher values have more priority */
+	 /* Typically used to prioritize entire DAG jobs over other DAG jobs */
+	 if( a->post_job_prio1 > INT_MIN && b->post_job_prio1 > INT_MIN ) {
+	      if( a->post_job_prio1 < b->post_job_prio1 ) {
+		  return 1;
+	      }
+	      if( a->post_job_prio1 > b->post_job_prio1 ) {
+		  return -1;
+	      }
+	 }
+	 
+	 if( a->post_job_prio2 > INT_MIN && b->post_job_prio2 > INT_MIN ) {
+	      if( a->post_job_prio2 < b->post_job_prio2 ) {
+		  return 1;
+	      }
+	      if( a->post_job_prio2 > b->post_job_prio2 ) {
+		  return -1;
+	      }
+	 }
+	      
+	 /* here,updown priority and job_priority are both equal */
+
+	 /* check for job submit times */
+	 if( a->qdate < b->qdate ) {
+		  return -1;
+	 }
+	 if( a->qdate > b->qdate ) {
+		  return 1;
+	 }
+
+	 /* go in order of cluster id */
+	if ( a->id.cluster < b->id.cluster )
+		return -1;
+	if ( a->id.cluster > b->id.cluster )
+		return 1;
+
+	/* finally, go in order of the proc id */
+	if ( a->id.proc < b->id.proc )
+		return -1;
+	if ( a->id.proc > b->id.proc )
+		return 1;
+
+	/* give up! very unlikely we'd ever get here */
+	return 0;
+}
+} // end of extern
+
+void
+RunnableJobLists::Insert(const prio_rec & rec)
+{
+	Remove(rec.id);
+	RunnableJobKey key(rec);
+	JobsByOwner::iterator owner = owners.insert(JobsByOwner::value_type(rec.owner, JobList())).first;
+	owner->second.insert(key);
+	jobs.insert(std::make_pair(JOB_ID_KEY(rec.id), Entry(owner, key)));
+}
+
+void
+RunnableJobLists::Remove(const JOB_ID_KEY & jid)
+{
+	std::map<JOB_ID_KEY, Entry>::iterator found = jobs.find(jid);
+	if (found == jobs.end()) {
+		return;
+	}
+	JobsByOwner::iterator owner = found->second.owner;
+	owner->second.erase(found->second.key);
+	if (owner->second.empty()) {
+		owners.erase(owner);
+	}
+	jobs.erase(found);
+}
+
+void
+RunnableJobLists::Clear()
+{
+	jobs.clear();
+	owners.clear();
+}
+
+const RunnableJobLists::JobList *
+RunnableJobLists::OwnerJobs(const char * owner) const
+{
+	JobsByOwner::const_iterator found = owners.find(owner);
+	if (found == owners.end()) {
+		return NULL;
+	}
+	return &found->second;
+}
@@ -0,0 +1,101 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _RUNNABLE_JOBS_H
+#define _RUNNABLE_JOBS_H
+
+#include "condor_classad.h"
+#include "proc.h"
+#include "prio_rec.h"
+#include <map>
+#include <set>
+#include <string>
+
+extern "C" {
+	int prio_compar(prio_rec*, prio_rec*);
+}
+
+// Fill in a prio_rec for a job, except for the auto_cluster_id.  Returns
+// false if the job is not runnable because it has all the hosts it wants or
+// is held, removed or completed, in which case only cur_hosts is set.
+// Whether the schedd services the job's universe is left to the caller.
+bool GetJobPrioRec(ClassAd *job, const JOB_ID_KEY & jid, prio_rec & rec, int & cur_hosts);
+
+// A job's place in its owner's list of runnable jobs is decided by the same
+// fields as prio_compar, but an unset pre or post priority always sorts after
+// a set one so that the order is well defined; prio_compar skips those
+// comparisons.
+struct RunnableJobKey {
+	int pre_job_prio1, pre_job_prio2, job_prio, post_job_prio1, post_job_prio2;
+	int qdate;
+	JOB_ID_KEY id;
+
+	RunnableJobKey(const prio_rec & rec)
+		: pre_job_prio1(rec.pre_job_prio1), pre_job_prio2(rec.pre_job_prio2)
+		, job_prio(rec.job_prio)
+		, post_job_prio1(rec.post_job_prio1), post_job_prio2(rec.post_job_prio2)
+		, qdate(rec.qdate), id(rec.id)
+	{}
+	bool operator<(const RunnableJobKey & rhs) const {
+		// higher priorities first, then older jobs, then lower job ids.
+		if (pre_job_prio1 != rhs.pre_job_prio1) return pre_job_prio1 > rhs.pre_job_prio1;
+		if (pre_job_prio2 != rhs.pre_job_prio2) return pre_job_prio2 > rhs.pre_job_prio2;
+		if (job_prio != rhs.job_prio) return job_prio > rhs.job_prio;
+		if (post_job_prio1 != rhs.post_job_prio1) return post_job_prio1 > rhs.post_job_prio1;
+		if (post_job_prio2 != rhs.post_job_prio2) return post_job_prio2 > rhs.post_job_prio2;
+		if (qdate != rhs.qdate) return qdate < rhs.qdate;
+		return id < rhs.id;
+	}
+};
+
+// The runnable jobs of each owner in priority order, so that the schedd can
+// pick a job to reuse a claim for without rebuilding and sorting the PrioRec
+// array.  The schedd keeps the lists up to date as jobs are committed, change
+// and leave the queue, and rebuilds them whenever it rebuilds the PrioRec
+// array, which catches jobs whose runnability changed for reasons it doesn't
+// track; see UpdateRunnableJob() in qmgmt.cpp.
+class RunnableJobLists {
+public:
+	typedef std::set<RunnableJobKey> JobList;
+
+		// Put the job in its owner's list, moving it if it is already
+		// in a list.
+	void Insert(const prio_rec & rec);
+	void Remove(const JOB_ID_KEY & jid);
+	void Clear();
+
+		// The owner's runnable jobs, highest priority first, or NULL if
+		// the owner has none.  Removing the owner's last job deletes the
+		// list.
+	const JobList * OwnerJobs(const char * owner) const;
+	bool Contains(const JOB_ID_KEY & jid) const { return jobs.find(jid) != jobs.end(); }
+	size_t NumJobs() const { return jobs.size(); }
+
+private:
+	typedef std::map<std::string, JobList> JobsByOwner;
+	struct Entry {
+		JobsByOwner::iterator owner;
+		RunnableJobKey key;
+		Entry(JobsByOwner::iterator o, const RunnableJobKey & k) : owner(o), key(k) {}
+	};
+	JobsByOwner owners;
+	std::map<JOB_ID_KEY, Entry> jobs;
+};
+
+#endif
@@ -89,6 +89,8 @@
 #include "filename_tools.h"
 #include "ipv6_hostname.h"
 #include "globus_utils.h"
+#include "condor_threads.h"
+#include "selector.h"
 #if defined(HAVE_DLOPEN)
 #include "ScheddPlugin.h"
 #include "ClassAdLogPlugin.h"
@@ -122,7 +124,6 @@ extern "C"
 	int FileExists(const char *, const char *);
 	int getdtablesize();
 */
-	int prio_compar(prio_rec*, prio_rec*);
 }
 
 extern char* Spool;
@@ -169,6 +170,7 @@ void mark_job_stopped(PROC_ID*);
 void mark_job_running(PROC_ID*);
 void mark_serial_job_running( PROC_ID *job_id );
 int fixAttrUser(JobQueueJob *job, const JOB_ID_KEY & /*jid*/, void *);
+static int index_a_job(JobQueueJob *job, const JOB_ID_KEY & /*jid*/, void *);
 shadow_rec * find_shadow_rec(PROC_ID*);
 bool service_this_universe(int, ClassAd*);
 bool jobIsSandboxed( ClassAd* ad );
@@ -177,6 +179,9 @@ bool jobCleanupNeedsThread( int cluster, int proc );
 bool jobExternallyManaged(ClassAd * ad);
 bool jobManagedDone(ClassAd * ad);
 int  count_a_job( JobQueueJob *job, const JOB_ID_KEY& jid, void* user);
+bool get_job_counts(JobQueueJob * job, JobCountsEntry & entry);
+void count_a_job_extras(JobQueueJob * job);
+static int recount_a_job(JobQueueJob *job, const JOB_ID_KEY & /*jid*/, void *);
 void mark_jobs_idle();
 void load_job_factories();
 static void WriteCompletionVisa(ClassAd* ad);
@@ -188,6 +193,8 @@ schedd_runtime_probe WalkJobQ_clear_autocluster_id_runtime;
 schedd_runtime_probe WalkJobQ_find_idle_local_jobs_runtime;
 schedd_runtime_probe WalkJobQ_fixAttrUser_runtime;
 schedd_runtime_probe WalkJobQ_updateSchedDInterval_runtime;
+schedd_runtime_probe WalkJobQ_index_a_job_runtime;
+schedd_runtime_probe WalkJobQ_recount_a_job_runtime;
 
 int	WallClockCkptInterval = 0;
 int STARTD_CONTACT_TIMEOUT = 45;  // how long to potentially block
@@ -598,6 +605,8 @@ Scheduler::Scheduler() :
 	slotWeightOfJob(0),
 	slotWeightGuessAd(0),
 	m_use_slot_weights(false),
+	m_threaded_queries(false),
+	m_only_my_jobs(true),
 	m_local_startd_pid(-1),
 	m_history_helper_count(0),
 	m_matchPasswordEnabled(false)
@@ -678,6 +687,11 @@ Scheduler::Scheduler() :
 	timeoutid = -1;
 	startjobsid = -1;
 	periodicid = -1;
+	PeriodicExprFullSweepInterval = 0;
+	m_policy_last_full_sweep = 0;
+	m_incremental_job_counts = true;
+	m_check_job_counts = false;
+	m_job_counts_valid = false;
 
 #ifdef HAVE_EXT_POSTGRESQL
 	quill_enabled = FALSE;
@@ -1238,6 +1252,7 @@ Scheduler::count_jobs()
 		SubmitterData & SubDat = it->second;
 		SubDat.num.clear_job_counters();	// clear the jobs counters 
 		SubDat.PrioSet.clear();
+		SubDat.FlockedHere.clear();
 	}
 
 	GridJobOwners.clear();
@@ -1246,9 +1261,28 @@ Scheduler::count_jobs()
 		// job cluster ids, since we're about to re-create it.
 	dedicated_scheduler.clearDedicatedClusters();
 
-		// inserts/finds an entry in Owners for each job
-		// updates SubmitterCounters: Hits, JobsIdle, WeightedJobsIdle & JobsHeld
-	WalkJobQueue(count_a_job);
+	if (m_incremental_job_counts) {
+			// count the jobs that changed since last time, then copy the
+			// live counts into the Owners and Submitters.  only the jobs
+			// that count_a_job_extras needs to see are looked at.
+		updateJobCounts();
+		if (m_check_job_counts) {
+			WalkJobQueue(count_a_job);
+			checkJobCounts();
+		} else {
+			publishJobCounts(current_time);
+				// completing a no-op job changes the queue, so work from a copy
+			std::vector<JOB_ID_KEY> walk(m_job_counts_walk.begin(), m_job_counts_walk.end());
+			for (std::vector<JOB_ID_KEY>::const_iterator it = walk.begin(); it != walk.end(); ++it) {
+				JobQueueJob * job = GetJobAd(it->cluster, it->proc);
+				if (job) { count_a_job_extras(job); }
+			}
+		}
+	} else {
+			// inserts/finds an entry in Owners for each job
+			// updates SubmitterCounters: Hits, JobsIdle, WeightedJobsIdle & JobsHeld
+		WalkJobQueue(count_a_job);
+	}
 
 	if( dedicated_scheduler.hasDedicatedClusters() ) {
 			// We found some dedicated clusters to service.  Wake up
@@ -1278,6 +1312,11 @@ Scheduler::count_jobs()
 		} else {				// in remote pool, so add to Flocked count
 			SubDat->num.JobsFlocked++;
 			JobsFlocked++;
+			if (rec->shadowRec && rec->pool) {
+				std::pair<int,int> & here = SubDat->FlockedHere[rec->pool];
+				here.first += 1;
+				here.second += calcSlotWeight(rec);
+			}
 		}
 	}
 
@@ -1423,6 +1462,7 @@ Scheduler::count_jobs()
 	// actively delete expired statistics atributes.
 	OtherPoolStats.UnpublishDisabled(*cad);
 	OtherPoolStats.RemoveDisabled();
+	stats.ExpireJobQueryClients(*cad, now);
 
 	// As of 8.3.6. we don't show Owner stats in schedd ad.  we put them into the Submitter ads now.
 	// but since the stats themselves are in the OtherPoolStats collection, we need to temporarily
@@ -1552,29 +1592,23 @@ Scheduler::count_jobs()
 			if( ! (flock_col && flock_neg) ) { 
 				continue;
 			}
-			// Re-calculate JobsFlockedHere for each flock location
+			// Set JobsFlockedHere for each flock location from the counts
+			// made while walking the matches above.
 			// Then when we call fill_submitter_ad with a flock_level != 0
 			// it will publish JobsFlockedHere for that site as JobsRunning
 			// and (JobsRunning + JobsFlocked) - JobsFlockedHere as JobsFlocked
 			// i.e. the JobsFlocked count for flocked pools is a count of
 			// 'jobs running elsewhere' including jobs running in the schedd's local pool.
+			const char * flock_pool = flock_neg->pool();
 			for (SubmitterDataMap::iterator it = Submitters.begin(); it != Submitters.end(); ++it) {
 				SubmitterData & SubDat = it->second;
 				SubDat.num.JobsFlockedHere = 0;
 				SubDat.num.WeightedJobsFlockedHere = 0;
-			}
-			matches->startIterations();
-			match_rec *mRec;
-			while(matches->iterate(mRec) == 1) {
-				char *at_sign = strchr(mRec->user, '@');
-				if (at_sign) *at_sign = '\0';
-				SubmitterData * SubDat = insert_submitter(mRec->user);
-				if (at_sign) *at_sign = '@';
-				if (mRec->shadowRec && mRec->pool &&
-					!strcmp(mRec->pool, flock_neg->pool())) {
-					SubDat->num.JobsFlockedHere++;
-
-					SubDat->num.WeightedJobsFlockedHere += calcSlotWeight(mRec);
+				if ( ! flock_pool) continue;
+				std::map<std::string, std::pair<int,int> >::const_iterator here = SubDat.FlockedHere.find(flock_pool);
+				if (here != SubDat.FlockedHere.end()) {
+					SubDat.num.JobsFlockedHere = here->second.first;
+					SubDat.num.WeightedJobsFlockedHere = here->second.second;
 				}
 			}
 
@@ -2076,10 +2110,9 @@ void LiveJobCounters::publish(ClassAd & ad, const char * prefix)
 	ad.InsertAttr(attrjoin(buf,prefix,"SchedulerHeld"), (long long)SchedulerJobsHeld);
 }
 
-static bool
-sendDone(Stream *stream, bool send_job_counts, LiveJobCounters* query_counts, const char * myname, LiveJobCounters* my_counts)
+static void
+makeDoneAd(ClassAd &ad, bool send_job_counts, LiveJobCounters* query_counts, const char * myname, LiveJobCounters* my_counts)
 {
-	ClassAd ad;
 	ad.Assign(ATTR_OWNER, 0);
 	ad.Assign(ATTR_ERROR_CODE, 0);
 
@@ -2090,7 +2123,11 @@ sendDone(Stream *stream, bool send_job_counts, LiveJobCounters* query_counts, co
 		if (my_counts) { my_counts->publish(ad, "My"); }
 	}
 	if (myname) { ad.Assign("MyName", myname); }
+}
 
+static bool
+sendDoneAd(Stream *stream, ClassAd &ad)
+{
 	stream->encode();
 	if (!putClassAd(stream, ad) || !stream->end_of_message())
 	{
@@ -2100,6 +2137,14 @@ sendDone(Stream *stream, bool send_job_counts, LiveJobCounters* query_counts, co
 	return true;
 }
 
+static bool
+sendDone(Stream *stream, bool send_job_counts, LiveJobCounters* query_counts, const char * myname, LiveJobCounters* my_counts)
+{
+	ClassAd ad;
+	makeDoneAd(ad, send_job_counts, query_counts, myname, my_counts);
+	return sendDoneAd(stream, ad);
+}
+
 void IncrementLiveJobCounter(LiveJobCounters & num, int universe, int status, int increment /*, JobQueueJob * job*/)
 {
 	if (status == TRANSFERRING_OUTPUT) status = RUNNING;
@@ -2135,28 +2180,144 @@ struct QueryJobAdsContinuation : Service {
 	LiveJobCounters query_job_counts;
 	LiveJobCounters my_job_counts;
 	std::string my_name;
+	std::string client; // for the per-client statistics
 	JobQueueLogType::filter_iterator it;
+	std::vector<JOB_ID_KEY> keys; // jobs that might match, when the job queue index can tell us
+	size_t next_key;
+	bool use_keys;
+	_condor_runtime rt;
+	int timeslice;
 	int match_limit;
 	int match_count;
 	bool summary_only;
 	bool unfinished_eom;
 	bool registered_socket;
+	bool forked;
+	bool threaded;
 
 	QueryJobAdsContinuation(classad_shared_ptr<classad::ExprTree> requirements_, int limit, int timeslice_ms=0, int iter_opts=0);
+	~QueryJobAdsContinuation();
 	int finish(Stream *);
+	int finish_shared(Stream *);
 };
 
 QueryJobAdsContinuation::QueryJobAdsContinuation(classad_shared_ptr<classad::ExprTree> requirements_, int limit, int timeslice_ms, int iter_opts)
 	: requirements(requirements_),
 	  it(GetJobQueueIterator(*requirements, timeslice_ms)),
+	  next_key(0),
+	  use_keys(false),
+	  timeslice(timeslice_ms),
 	  match_limit(limit),
 	  match_count(0),
 	  summary_only(false),
 	  unfinished_eom(false),
-	  registered_socket(false)
+	  registered_socket(false),
+	  forked(false),
+	  threaded(false)
 {
 	it.set_options(iter_opts);
 	my_job_counts.clear_counters();
+	use_keys = GetJobQueueIndexedKeys(requirements.get(), keys, (iter_opts & JOB_QUEUE_ITERATOR_OPT_INCLUDE_CLUSTERS) != 0);
+}
+
+QueryJobAdsContinuation::~QueryJobAdsContinuation()
+{
+	scheduler.stats.CountJobQuery(client.c_str(), forked, threaded,
+		summary_only ? 0 : match_count, rt.elapsed_runtime());
+}
+
+// The iterator of a continuation answering a query on a pool thread
+// registers itself with the job queue, and its destructor counts the
+// query in the statistics, so readers take turns creating and deleting them.
+static QueryJobAdsContinuation *
+new_continuation_shared(classad_shared_ptr<classad::ExprTree> requirements, int limit, int timeslice_ms, int iter_opts)
+{
+	CondorThreads::lock_state_readers();
+	QueryJobAdsContinuation *continuation = new QueryJobAdsContinuation(requirements, limit, timeslice_ms, iter_opts);
+	continuation->threaded = true;
+	CondorThreads::unlock_state_readers();
+	return continuation;
+}
+
+static void
+delete_continuation_shared(QueryJobAdsContinuation *continuation)
+{
+	CondorThreads::lock_state_readers();
+	delete continuation;
+	CondorThreads::unlock_state_readers();
+}
+
+static bool
+job_matches_query(classad::ExprTree &requirements, JobQueueJob *job)
+{
+	const classad::ClassAd *old_scope = requirements.GetParentScope();
+	requirements.SetParentScope(job);
+	classad::Value result;
+	bool matches = false;
+	int retval = requirements.Evaluate(result);
+	requirements.SetParentScope(old_scope);
+	if ( ! retval) {
+		dprintf(D_FULLDEBUG, "Unable to evaluate ad.\n");
+		return false;
+	}
+	int ival;
+	if (result.IsBooleanValue(matches)) { return matches; }
+	if (result.IsIntegerValue(ival)) { return ival != 0; }
+	return false;
+}
+
+// Let go of the state lock while we wait for the client to read what we
+// have sent it, so the schedd can get on with things meanwhile.  Returns
+// false if the client goes away or stops reading.
+static bool
+wait_for_client_shared(ReliSock *sock, bool has_backlog, bool &unfinished_eom)
+{
+	bool ok = true;
+	CondorThreads::unlock_state_shared();
+	if (has_backlog || unfinished_eom) {
+		Selector selector;
+		selector.add_fd(sock->get_file_desc(), Selector::IO_WRITE);
+		selector.set_timeout(sock->get_timeout_raw() > 0 ? sock->get_timeout_raw() : 20);
+		do {
+			selector.execute();
+			if (selector.timed_out() || selector.failed()) {
+				ok = false;
+				break;
+			}
+			if (unfinished_eom) {
+				int retval = sock->finish_end_of_message();
+				if (sock->clear_backlog_flag()) {
+					continue;
+				} else if (retval != 1) {
+					ok = false;
+					break;
+				}
+				unfinished_eom = false;
+			}
+		} while (unfinished_eom);
+	}
+	CondorThreads::lock_state_shared();
+	return ok;
+}
+
+// The error and done messages that end a query on a pool thread are
+// blocking sends, so let go of the state lock while we make them.
+static bool
+send_job_error_shared(Stream *stream, int errorCode, std::string errorString)
+{
+	CondorThreads::unlock_state_shared();
+	bool rval = sendJobErrorAd(stream, errorCode, errorString);
+	CondorThreads::lock_state_shared();
+	return rval;
+}
+
+static bool
+send_done_shared(Stream *stream, ClassAd &ad)
+{
+	CondorThreads::unlock_state_shared();
+	bool rval = sendDoneAd(stream, ad);
+	CondorThreads::lock_state_shared();
+	return rval;
 }
 
 int
@@ -2165,8 +2326,10 @@ QueryJobAdsContinuation::finish(Stream *stream) {
 	JobQueueLogType::filter_iterator end = GetJobQueueIteratorEnd();
 	if (match_limit >= 0 && (match_count >= match_limit)) {
 		it = end;
+		next_key = keys.size();
 	}
 	bool has_backlog = false;
+	double slice_begin = _condor_debug_get_time_double();
 
 	if (unfinished_eom) {
 		int retval = sock->finish_end_of_message();
@@ -2179,8 +2342,23 @@ QueryJobAdsContinuation::finish(Stream *stream) {
 			return sendJobErrorAd(sock, 5, "Failed to write EOM to wire");
 		}
 	}
-	while ((it != end) && !has_backlog) {
-		JobQueueJob * job = *it++;
+	while ((use_keys ? next_key < keys.size() : it != end) && !has_backlog) {
+		JobQueueJob * job = NULL;
+		if (use_keys) {
+				// only the jobs the index says might match, so we
+				// check the requirements and the timeslice ourselves.
+			if (timeslice > 0 && (_condor_debug_get_time_double() - slice_begin) * 1000 > timeslice) {
+				has_backlog = true;
+				break;
+			}
+			const JOB_ID_KEY & key = keys[next_key++];
+			job = GetJobAd(key.cluster, key.proc);
+			if ( ! job || ! job_matches_query(*requirements, job)) {
+				continue;
+			}
+		} else {
+			job = *it++;
+		}
 		if (!job) {
 			// Return to DC in case if our time ran out.
 			has_backlog = true;
@@ -2212,6 +2390,7 @@ QueryJobAdsContinuation::finish(Stream *stream) {
 		}
 		if (match_limit >= 0 && (match_count >= match_limit)) {
 			it = end;
+			next_key = keys.size();
 		}
 	}
 	if (has_backlog && !registered_socket) {
@@ -2235,13 +2414,103 @@ QueryJobAdsContinuation::finish(Stream *stream) {
 	return KEEP_STREAM;
 }
 
+// Answer the query on a thread from the pool; see SCHEDD_THREADED_QUERIES.
+// We work from a snapshot of the ids of the jobs in the queue and look each
+// job up again as we send it, so that we can let go of the state lock
+// whenever the client falls behind or our timeslice runs out.  The schedd
+// is never held up by a slow client, but each batch of ads is only
+// consistent within itself, and jobs that leave the queue while we wait
+// are not sent.  If the job queue index narrowed the query, the snapshot
+// is just the jobs it says might match.
+int
+QueryJobAdsContinuation::finish_shared(Stream *stream) {
+	ReliSock *sock = static_cast<ReliSock*>(stream);
+	if ( ! use_keys) {
+		GetJobQueueKeys(keys, (it.get_options() & JOB_QUEUE_ITERATOR_OPT_INCLUDE_CLUSTERS) != 0);
+	}
+
+	double slice_begin = _condor_debug_get_time_double();
+	for (size_t ix = 0; ix < keys.size(); ++ix) {
+		if (match_limit >= 0 && (match_count >= match_limit)) {
+			break;
+		}
+		JobQueueJob * job = GetJobAd(keys[ix].cluster, keys[ix].proc);
+		if ( ! job || ! job_matches_query(*requirements, job)) {
+			continue;
+		}
+		IncrementLiveJobCounter(query_job_counts, job->Universe(), job->Status(), 1);
+		int retval = 1;
+		if ( ! summary_only) {
+			retval = putClassAd(sock, *job,
+					PUT_CLASSAD_NON_BLOCKING | PUT_CLASSAD_NO_PRIVATE,
+					projection.empty() ? NULL : &projection);
+		}
+		match_count++;
+		if (!retval) {
+			delete_continuation_shared(this);
+			return send_job_error_shared(sock, 4, "Failed to write ClassAd to wire");
+		}
+		bool has_backlog = (retval == 2);
+		sock->end_of_message_nonblocking();
+		if (sock->clear_backlog_flag()) {
+			unfinished_eom = true;
+		}
+		if (has_backlog || unfinished_eom ||
+			(_condor_debug_get_time_double() - slice_begin) * 1000 > timeslice)
+		{
+			if ( ! wait_for_client_shared(sock, has_backlog, unfinished_eom)) {
+				delete_continuation_shared(this);
+				return send_job_error_shared(sock, 5, "Failed to write EOM to wire");
+			}
+			slice_begin = _condor_debug_get_time_double();
+		}
+	}
+
+	const char * me = NULL;
+	LiveJobCounters * mine = NULL;
+	if ( ! my_name.empty()) { me = my_name.c_str(); mine = &my_job_counts; }
+	ClassAd done_ad;
+	makeDoneAd(done_ad, true, &query_job_counts, me, mine);
+	delete_continuation_shared(this);
+	return send_done_shared(sock, done_ad);
+}
+
+static void
+set_threaded_query_commands(bool thread_safe)
+{
+	daemonCore->Set_Command_Thread_Safe(QUERY_JOB_ADS, thread_safe);
+	daemonCore->Set_Command_Thread_Safe(QUERY_JOB_ADS_WITH_AUTH, thread_safe);
+}
+
+// the name a client is counted under in the per-client query statistics
+static std::string
+query_client_name(Stream *stream)
+{
+	Sock *sock = static_cast<Sock*>(stream);
+	const char * user = sock->isAuthenticated() ? sock->getFullyQualifiedUser() : NULL;
+	return (user && user[0]) ? user : sock->peer_ip_str();
+}
+
 int Scheduler::command_query_job_ads(int cmd, Stream* stream)
 {
 	ClassAd queryAd;
 
+	// queries are answered on a pool thread when that is turned on, and
+	// DaemonCore is not calling us as an ordinary command handler.
+	bool threaded = m_threaded_queries && ! CondorThreads::holds_state_exclusive();
+
 	stream->decode();
 	stream->timeout(15);
-	if( !getClassAd(stream, queryAd) || !stream->end_of_message()) {
+	bool get_ok;
+	if (threaded) {
+		// don't hold the state lock while we wait on the client
+		CondorThreads::unlock_state_shared();
+		get_ok = getClassAdEx(stream, queryAd, GET_CLASSAD_NO_CACHE) && stream->end_of_message();
+		CondorThreads::lock_state_shared();
+	} else {
+		get_ok = getClassAd(stream, queryAd) && stream->end_of_message();
+	}
+	if( !get_ok ) {
 		dprintf( D_ALWAYS, "Failed to receive query on TCP: aborting\n" );
 		return FALSE;
 	}
@@ -2262,7 +2531,7 @@ int Scheduler::command_query_job_ads(int cmd, Stream* stream)
 	classad::ExprTree *my_jobs_expr = NULL;
 	std::string my_jobs_name; // set only once we have decided to do an only-my-jobs query
 	bool was_my_jobs = false;
-	if (param_boolean("CONDOR_Q_ONLY_MY_JOBS", true)) {
+	if (m_only_my_jobs) {
 		my_jobs_expr = queryAd.Lookup("MyJobs");
 		was_my_jobs = my_jobs_expr != NULL;
 	}
@@ -2350,7 +2619,10 @@ int Scheduler::command_query_job_ads(int cmd, Stream* stream)
 		classad::Value val; val.SetBooleanValue(true);
 		requirements = classad::Literal::MakeLiteral(val);
 	}
-	if ( ! requirements) return sendJobErrorAd(stream, 1, "Failed to create requirements expression");
+	if ( ! requirements) {
+		if (threaded) return send_job_error_shared(stream, 1, "Failed to create requirements expression");
+		return sendJobErrorAd(stream, 1, "Failed to create requirements expression");
+	}
 	if (IsDebugCatAndVerbosity(dpf_level)) {
 		dprintf(dpf_level, "QUERY_JOB_ADS %d effective requirements: %s\n", was_my_jobs, ExprTreeToString(requirements));
 	}
@@ -2367,9 +2639,23 @@ int Scheduler::command_query_job_ads(int cmd, Stream* stream)
 		iter_options |= JOB_QUEUE_ITERATOR_OPT_INCLUDE_CLUSTERS;
 	}
 
-	QueryJobAdsContinuation *continuation = new QueryJobAdsContinuation(requirements_ptr, resultLimit, 1000, iter_options);
+	QueryJobAdsContinuation *continuation;
+	if (threaded) {
+		// the schedd waits for us to let go of the state lock, so do that often.
+		continuation = new_continuation_shared(requirements_ptr, resultLimit, 100, iter_options);
+	} else {
+		continuation = new QueryJobAdsContinuation(requirements_ptr, resultLimit, 1000, iter_options);
+	}
+	continuation->client = query_client_name(stream);
 	int proj_err = mergeProjectionFromQueryAd(queryAd, ATTR_PROJECTION, continuation->projection, true);
 	if (proj_err < 0) {
+		if (threaded) {
+			delete_continuation_shared(continuation);
+			if (proj_err == -1) {
+				return send_job_error_shared(stream, 2, "Unable to evaluate projection list");
+			}
+			return send_job_error_shared(stream, 3, "Unable to convert projection list to string list");
+		}
 		delete continuation;
 		if (proj_err == -1) {
 			return sendJobErrorAd(stream, 2, "Unable to evaluate projection list");
@@ -2388,11 +2674,16 @@ int Scheduler::command_query_job_ads(int cmd, Stream* stream)
 		continuation->summary_only = true;
 	}
 
+	if (threaded) {
+		return continuation->finish_shared(stream);
+	}
+
 	ForkStatus fork_status = schedd_forker.NewJob();
 	if (fork_status == FORK_PARENT)
 	{ // Successfully forked a child - as far as the schedd cares, this worked.
 	  // Throw away the socket and move on.
 		// need to delete the parent's copy of the continuation object
+		continuation->forked = true;
 		delete continuation;
 		return true;
 	}
@@ -2465,6 +2756,9 @@ struct QueryAggregatesContinuation : Service {
 	bool unfinished_eom;
 	bool registered_socket;
 	ClassAd * curr_ad;
+	std::string client; // for the per-client statistics
+	_condor_runtime rt;
+	int ads_sent;
 
 	QueryAggregatesContinuation(void * aggregator_, int timeslice_ms=0);
 	~QueryAggregatesContinuation();
@@ -2477,6 +2771,7 @@ QueryAggregatesContinuation::QueryAggregatesContinuation(void * aggregator_, int
 	, unfinished_eom(false)
 	, registered_socket(false)
 	, curr_ad(NULL)
+	, ads_sent(0)
 {
 	curr_ad = GetNextJobAggregate(aggregator, true);
 }
@@ -2488,6 +2783,7 @@ QueryAggregatesContinuation::~QueryAggregatesContinuation()
 		ReleaseAggregation(aggregator);
 		aggregator = NULL;
 	}
+	scheduler.stats.CountJobQuery(client.c_str(), false, false, ads_sent, rt.elapsed_runtime());
 }
 
 
@@ -2524,6 +2820,7 @@ QueryAggregatesContinuation::finish(Stream *stream) {
 			delete this;
 			return sendJobErrorAd(sock, 4, "Failed to write ClassAd to wire");
 		}
+		ads_sent++;
 		retval = sock->end_of_message_nonblocking();
 		if (sock->clear_backlog_flag()) {
 			dprintf(D_FULLDEBUG, "QueryAggregatesContinuation: Socket EOM will block.\n");
@@ -2577,6 +2874,11 @@ int Scheduler::command_query_job_aggregates(ClassAd &queryAd, Stream* stream)
 		returnJobidLimit = -1;
 	}
 
+	if (m_threaded_queries && ! CondorThreads::holds_state_exclusive()) {
+		return query_job_aggregates_shared(use_def_autocluster, projection.c_str(), resultLimit, returnJobidLimit, constraint, stream);
+	}
+
+	_condor_runtime rt;
 	void *aggregation = BeginJobAggregation(use_def_autocluster, projection.c_str(), resultLimit, returnJobidLimit, constraint);
 	if ( ! aggregation) {
 		return -1;
@@ -2588,12 +2890,14 @@ int Scheduler::command_query_job_aggregates(ClassAd &queryAd, Stream* stream)
 	  // Throw away the socket and move on.
 		// need to free the parent's copy of the aggregation object
 		ReleaseAggregation(aggregation);
+		stats.CountJobQuery(query_client_name(stream).c_str(), true, false, 0, rt.elapsed_runtime());
 		return true;
 	}
 	else // either didn't fork. or I'm in the forked child. 
 	{
 		ComputeJobAggregation(aggregation);
 		QueryAggregatesContinuation *continuation = new QueryAggregatesContinuation(aggregation, 1000);
+		continuation->client = query_client_name(stream);
 		if (fork_status == FORK_CHILD) // Respond to the query from the child.
 		{
 			int retval;
@@ -2611,6 +2915,55 @@ int Scheduler::command_query_job_aggregates(ClassAd &queryAd, Stream* stream)
 }
 
 
+// Answer an aggregate query on a thread from the pool.  Aggregation walks
+// the job queue with its one cursor, so readers take turns computing them,
+// and we send copies of the results after letting go of the state lock.
+int Scheduler::query_job_aggregates_shared(bool use_def_autocluster, const char * projection, int result_limit, int return_jobid_limit, classad::ExprTree *constraint, Stream* stream)
+{
+	_condor_runtime rt;
+	std::vector<ClassAd*> results;
+
+	CondorThreads::lock_state_readers();
+	void *aggregation = BeginJobAggregation(use_def_autocluster, projection, result_limit, return_jobid_limit, constraint);
+	bool aggregated = aggregation != NULL;
+	if (aggregated) {
+		ComputeJobAggregation(aggregation);
+		for (ClassAd *ad = GetNextJobAggregate(aggregation, true); ad; ad = GetNextJobAggregate(aggregation, false)) {
+			results.push_back(new ClassAd(*ad));
+			ReleaseAggregationAd(aggregation, ad);
+		}
+		ReleaseAggregation(aggregation);
+	}
+	CondorThreads::unlock_state_readers();
+	if ( ! aggregated) {
+		return -1;
+	}
+
+	CondorThreads::unlock_state_shared();
+	int rval = TRUE;
+	size_t ix = 0;
+	stream->encode();
+	for (ix = 0; ix < results.size(); ++ix) {
+		if ( ! putClassAd(stream, *results[ix], PUT_CLASSAD_NO_PRIVATE) || ! stream->end_of_message()) {
+			rval = sendJobErrorAd(stream, 4, "Failed to write ClassAd to wire");
+			break;
+		}
+	}
+	if (ix == results.size()) {
+		rval = sendDone(stream, false, NULL, NULL, NULL);
+	}
+	for (size_t jx = 0; jx < results.size(); ++jx) {
+		delete results[jx];
+	}
+	CondorThreads::lock_state_shared();
+
+	CondorThreads::lock_state_readers();
+	stats.CountJobQuery(query_client_name(stream).c_str(), false, true, (int)ix, rt.elapsed_runtime());
+	CondorThreads::unlock_state_readers();
+	return rval;
+}
+
+
 int 
 clear_autocluster_id(JobQueueJob *job, const JOB_ID_KEY & /*jid*/, void *)
 {
@@ -2731,59 +3084,61 @@ int Scheduler::guessJobSlotWeight(JobQueueJob * job)
 	return job_weight;
 }
 
-int
-count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
+void
+JobCounts::add(const JobCounts & other, int sign)
 {
-	int		status;
-#if 1  // cache ownerdata pointer in job object
-#else
-	int		niceUser;
-	MyString owner_buf;
-	char const*	owner;
-	MyString domain;
-#endif
-	int		cur_hosts;
-	int		max_hosts;
-	int		universe;
-
-		// we may get passed a NULL job ad if, for instance, the job ad was
-		// removed via condor_rm -f when some function didn't expect it.
-		// So check for it here before continuing onward...
-	if ( job == NULL ) {  
-		return 0;
-	}
+	JobsCounted += sign * other.JobsCounted;
+	JobsRunning += sign * other.JobsRunning;
+	JobsIdle += sign * other.JobsIdle;
+	JobsHeld += sign * other.JobsHeld;
+	JobsRemoved += sign * other.JobsRemoved;
+	UserJobsIdle += sign * other.UserJobsIdle;
+	UserJobsHeld += sign * other.UserJobsHeld;
+	WeightedJobsIdle += sign * other.WeightedJobsIdle;
+	SchedulerJobsRunning += sign * other.SchedulerJobsRunning;
+	SchedulerJobsIdle += sign * other.SchedulerJobsIdle;
+	LocalJobsRunning += sign * other.LocalJobsRunning;
+	LocalJobsIdle += sign * other.LocalJobsIdle;
+}
+
+// Hits also counts matchrecs, which aren't jobs. (hits is sort of a reference count)
+static void
+add_job_counts(RealOwnerCounters & counts, const JobCounts & num)
+{
+	counts.Hits += num.JobsCounted;
+	counts.JobsCounted += num.JobsCounted;
+	counts.JobsIdle += num.UserJobsIdle;
+	counts.JobsHeld += num.UserJobsHeld;
+	counts.SchedulerJobsRunning += num.SchedulerJobsRunning;
+	counts.SchedulerJobsIdle += num.SchedulerJobsIdle;
+	counts.LocalJobsRunning += num.LocalJobsRunning;
+	counts.LocalJobsIdle += num.LocalJobsIdle;
+}
 
+static void
+add_job_counts(SubmitterCounters & counts, const JobCounts & num)
+{
+	counts.Hits += num.JobsCounted;
+	counts.JobsCounted += num.JobsCounted;
+	counts.JobsIdle += num.UserJobsIdle;
+	counts.WeightedJobsIdle += num.WeightedJobsIdle;
+	counts.JobsHeld += num.UserJobsHeld;
+	counts.SchedulerJobsRunning += num.SchedulerJobsRunning;
+	counts.SchedulerJobsIdle += num.SchedulerJobsIdle;
+	counts.LocalJobsRunning += num.LocalJobsRunning;
+	counts.LocalJobsIdle += num.LocalJobsIdle;
+}
+
+// Look up the job attributes that decide how a job is counted.
+// Returns false if the job has no JobStatus.
+static bool
+get_job_count_attrs(JobQueueJob * job, int & status, int & cur_hosts, int & max_hosts, int & universe)
+{
 	if (job->LookupInteger(ATTR_JOB_STATUS, status) == 0) {
 		dprintf(D_ALWAYS, "Job has no %s attribute.  Ignoring...\n",
 				ATTR_JOB_STATUS);
-		return 0;
-	}
-
-	int noop = 0;
-	job->LookupBool(ATTR_JOB_NOOP, noop);
-	if (noop && status != COMPLETED) {
-		int cluster = 0;
-		int proc = 0;
-		int noop_status = 0;
-		int temp = 0;
-		PROC_ID job_id;
-		if(job->LookupInteger(ATTR_JOB_NOOP_EXIT_SIGNAL, temp) != 0) {
-			noop_status = generate_exit_signal(temp);
-		}	
-		if(job->LookupInteger(ATTR_JOB_NOOP_EXIT_CODE, temp) != 0) {
-			noop_status = generate_exit_code(temp);
-		}	
-		job->LookupInteger(ATTR_CLUSTER_ID, cluster);
-		job->LookupInteger(ATTR_PROC_ID, proc);
-		dprintf(D_FULLDEBUG, "Job %d.%d is a no-op with status %d\n",
-				cluster,proc,noop_status);
-		job_id.cluster = cluster;
-		job_id.proc = proc;
-		set_job_status(cluster, proc, COMPLETED);
-		scheduler.WriteTerminateToUserLog( job_id, noop_status );
-		return 0;
+		return false;
 	}
-
 	if (job->LookupInteger(ATTR_CURRENT_HOSTS, cur_hosts) == 0) {
 		cur_hosts = ((status == RUNNING || status == TRANSFERRING_OUTPUT) ? 1 : 0);
 	}
@@ -2793,94 +3148,86 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 	if (job->LookupInteger(ATTR_JOB_UNIVERSE, universe) == 0) {
 		universe = CONDOR_UNIVERSE_STANDARD;
 	}
+	return true;
+}
+
+static bool
+job_is_noop(JobQueueJob * job, int status)
+{
+	int noop = 0;
+	job->LookupBool(ATTR_JOB_NOOP, noop);
+	return noop && status != COMPLETED;
+}
+
+/*
+Work out what a job adds to the job counts of the schedd, and of its
+owner and submitter.  Returns false if the job isn't counted, in which
+case entry.NeedsWalk may still be set for a no-op job.
+*/
+bool
+get_job_counts(JobQueueJob * job, JobCountsEntry & entry)
+{
+	entry.owner.clear();
+	entry.submitter.clear();
+	entry.num.clear();
+	entry.JobPrio = 0;
+	entry.HasPrio = false;
+	entry.NeedsWalk = false;
+
+	int status, cur_hosts, max_hosts, universe;
+	if ( ! get_job_count_attrs(job, status, cur_hosts, max_hosts, universe)) {
+		return false;
+	}
+	if (job_is_noop(job, status)) {
+		entry.NeedsWalk = true; // count_a_job_extras will complete it
+		return false;
+	}
 
 	int request_cpus = 0;
-    if (job->LookupInteger(ATTR_REQUEST_CPUS, request_cpus) == 0) {
+	if (job->LookupInteger(ATTR_REQUEST_CPUS, request_cpus) == 0) {
 		request_cpus = 1;
 	}
-	
 		// Just in case it is set funny
 	if (request_cpus < 1) {
 		request_cpus = 1;
 	}
-	
 
-	// because we set job->ownerdata to NULL above, this will refresh
-	// the job->ownerdata pointer. we do this in case the accounting group
-	// or niceness has been queue-edited or otherwise changed.
+	// we do this in case the accounting group or niceness has been
+	// queue-edited or otherwise changed.
 	SubmitterData * SubData = NULL;
 	OwnerInfo * OwnInfo = scheduler.get_submitter_and_owner(job, SubData);
 	if ( ! OwnInfo) {
 		dprintf(D_ALWAYS, "Job has no %s attribute.  Ignoring...\n", ATTR_OWNER);
-		return 0;
+		return false;
 	}
+	entry.owner = OwnInfo->name;
+	entry.submitter = SubData->name;
 
-	// increment our count of the number of job ads in the queue
-	scheduler.JobsTotalAds++;
-
-    time_t now = time(NULL);
-    OwnInfo->LastHitTime = now;
-    SubData->LastHitTime = now;
-
-    ScheddOtherStats * other_stats = NULL;
-    if (scheduler.OtherPoolStats.AnyEnabled()) {
-        other_stats = scheduler.OtherPoolStats.Matches(*job, now);
-    }
-    #define OTHER for (ScheddOtherStats * po = other_stats; po; po = po->next) (po->stats)
-
-    if (status == IDLE || status == RUNNING || status == TRANSFERRING_OUTPUT) {
-        /*
-         * Not all universes track CurrentHosts and MaxHosts; if there's no information,
-         * simply increment Running or Idle by 1.
-         */
-        if ((status == RUNNING || status == TRANSFERRING_OUTPUT) && !cur_hosts)
-        {
-                scheduler.JobsRunning += 1;
-        }
-        else if ((status == IDLE) && !max_hosts)
-        {
-                scheduler.JobsIdle += 1;
-        }
-        else
-        {
-                scheduler.JobsRunning += cur_hosts;
-                scheduler.JobsIdle += (max_hosts - cur_hosts);
-        }
-
-            // if job is not idle, then update statistics for running jobs
-        if (status == RUNNING || status == TRANSFERRING_OUTPUT) {
-            scheduler.stats.JobsRunning += 1;
-            OTHER.JobsRunning += 1;
-
-            int job_image_size = 0;
-            job->LookupInteger("ImageSize_RAW", job_image_size);
-            scheduler.stats.JobsRunningSizes += (int64_t)job_image_size * 1024;
-            OTHER.JobsRunningSizes += (int64_t)job_image_size * 1024;
-
-            int job_start_date = 0;
-            int job_running_time = 0;
-            if (job->LookupInteger(ATTR_JOB_START_DATE, job_start_date))
-                job_running_time = (now - job_start_date);
-            scheduler.stats.JobsRunningRuntimes += job_running_time;
-            OTHER.JobsRunningRuntimes += job_running_time;
-        }
-    } else if (status == HELD) {
-        scheduler.JobsHeld++;
-    } else if (status == REMOVED) {
-        scheduler.JobsRemoved++;
-    }
-    #undef OTHER
-
-	// update per-submitter and per-owner counters
-	SubmitterCounters * Counters = &SubData->num;
-	RealOwnerCounters * OwnerCounts = &OwnInfo->num;
+	JobCounts & num = entry.num;
+	num.JobsCounted = 1;
 
-	// Hits also counts matchrecs, which aren't jobs. (hits is sort of a reference count)
-	Counters->Hits += 1;
-	Counters->JobsCounted += 1;
-	
-	OwnerCounts->Hits += 1;
-	OwnerCounts->JobsCounted += 1;
+	if (status == IDLE || status == RUNNING || status == TRANSFERRING_OUTPUT) {
+		/*
+		 * Not all universes track CurrentHosts and MaxHosts; if there's no information,
+		 * simply increment Running or Idle by 1.
+		 */
+		if ((status == RUNNING || status == TRANSFERRING_OUTPUT) && !cur_hosts) {
+			num.JobsRunning = 1;
+		} else if ((status == IDLE) && !max_hosts) {
+			num.JobsIdle = 1;
+		} else {
+			num.JobsRunning = cur_hosts;
+			num.JobsIdle = (max_hosts - cur_hosts);
+		}
+			// the statistics for running jobs are computed by count_a_job_extras
+		if (status == RUNNING || status == TRANSFERRING_OUTPUT) {
+			entry.NeedsWalk = true;
+		}
+	} else if (status == HELD) {
+		num.JobsHeld = 1;
+	} else if (status == REMOVED) {
+		num.JobsRemoved = 1;
+	}
 
 	if ( (universe != CONDOR_UNIVERSE_GRID) &&	// handle Globus below...
 		 (!service_this_universe(universe,job))  )
@@ -2891,24 +3238,150 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 		{
 			// Count REMOVED or HELD jobs that are in the process of being
 			// killed. cur_hosts tells us which these are.
-			scheduler.SchedUniverseJobsRunning += cur_hosts;
-			scheduler.SchedUniverseJobsIdle += (max_hosts - cur_hosts);
-			OwnerCounts->SchedulerJobsRunning += cur_hosts;
-			OwnerCounts->SchedulerJobsIdle += (max_hosts - cur_hosts);
-			Counters->SchedulerJobsRunning += cur_hosts;
-			Counters->SchedulerJobsIdle += (max_hosts - cur_hosts);
+			num.SchedulerJobsRunning = cur_hosts;
+			num.SchedulerJobsIdle = (max_hosts - cur_hosts);
 		}
 		if (universe == CONDOR_UNIVERSE_LOCAL)
 		{
 			// Count REMOVED or HELD jobs that are in the process of being
 			// killed. cur_hosts tells us which these are.
-			scheduler.LocalUniverseJobsRunning += cur_hosts;
-			scheduler.LocalUniverseJobsIdle += (max_hosts - cur_hosts);
-			OwnerCounts->LocalJobsRunning += cur_hosts;
-			OwnerCounts->LocalJobsIdle += (max_hosts - cur_hosts);
-			Counters->LocalJobsRunning += cur_hosts;
-			Counters->LocalJobsIdle += (max_hosts - cur_hosts);
+			num.LocalJobsRunning = cur_hosts;
+			num.LocalJobsIdle = (max_hosts - cur_hosts);
+		}
+			// idle MPI and parallel jobs are handed to the dedicated
+			// scheduler by count_a_job_extras
+		int sendToDS = 0;
+		job->LookupBool("WantParallelScheduling", sendToDS);
+		if( (sendToDS || universe == CONDOR_UNIVERSE_MPI ||
+			 universe == CONDOR_UNIVERSE_PARALLEL) && status == IDLE &&
+			 max_hosts > cur_hosts && job->jid.proc == 0 ) {
+			entry.NeedsWalk = true;
+		}
+
+		// bailout now, since all the crud below is only for jobs
+		// which the schedd needs to service
+		return true;
+	}
+
+	if ( universe == CONDOR_UNIVERSE_GRID ) {
+			// grid jobs are counted by owner for the gridmanager
+			// by count_a_job_extras
+		entry.NeedsWalk = true;
+		if ( ! service_this_universe(universe,job)) {
+			return true;
+		}
+	}
+
+	if (status == IDLE || status == RUNNING || status == TRANSFERRING_OUTPUT) {
+
+			// Update Owner array PrioSet iff knob USE_GLOBAL_JOB_PRIOS is true
+			// and iff job is looking for more matches (max-hosts - cur_hosts)
+		if ( param_boolean("USE_GLOBAL_JOB_PRIOS",false) &&
+			 ((max_hosts - cur_hosts) > 0) )
+		{
+			if ( job->LookupInteger(ATTR_JOB_PRIO,entry.JobPrio) ) {
+				entry.HasPrio = true;
+			}
+		}
+			// Update Owners array JobsIdle
+		num.UserJobsIdle = (max_hosts - cur_hosts);
+
+			// If we're biasing by slot weight, and the job is idle, and everything parsed...
+		if (scheduler.m_use_slot_weights && (max_hosts > cur_hosts)) {
+				// if we're biasing idle jobs by SCHEDD_SLOT_WEIGHT, eval that here
+			int job_weight = request_cpus;
+			if (scheduler.slotWeightOfJob) {
+				classad::Value value;
+				int rval = EvalExprTree(scheduler.slotWeightOfJob, job, NULL, value);
+				if ( ! rval || ! value.IsNumber(job_weight)) {
+					job_weight = request_cpus; // fall back if slot weight doesn't evaluate
+				}
+			} else {
+				job_weight = scheduler.guessJobSlotWeight(job);
+			}
+			num.WeightedJobsIdle = job_weight * (max_hosts - cur_hosts);
+		} else {
+			// here: either max_hosts == cur_hosts || !scheduler.m_use_slot_weights
+			num.WeightedJobsIdle = request_cpus * (max_hosts - cur_hosts);
 		}
+
+			// Don't update scheduler.Owners[name].JobsRunning here.
+			// We do it in Scheduler::count_jobs().
+
+	} else if (status == HELD) {
+		num.UserJobsHeld = 1;
+	}
+
+	return true;
+}
+
+/*
+The part of counting a job that can't be kept up to date as the job
+changes: completing no-op jobs, statistics of running jobs, handing idle
+parallel jobs to the dedicated scheduler, and counting grid jobs by owner.
+Only called for jobs that get_job_counts() set NeedsWalk for.
+*/
+void
+count_a_job_extras(JobQueueJob * job)
+{
+	int status, cur_hosts, max_hosts, universe;
+	if ( ! get_job_count_attrs(job, status, cur_hosts, max_hosts, universe)) {
+		return;
+	}
+
+	if (job_is_noop(job, status)) {
+		int cluster = 0;
+		int proc = 0;
+		int noop_status = 0;
+		int temp = 0;
+		PROC_ID job_id;
+		if(job->LookupInteger(ATTR_JOB_NOOP_EXIT_SIGNAL, temp) != 0) {
+			noop_status = generate_exit_signal(temp);
+		}	
+		if(job->LookupInteger(ATTR_JOB_NOOP_EXIT_CODE, temp) != 0) {
+			noop_status = generate_exit_code(temp);
+		}	
+		job->LookupInteger(ATTR_CLUSTER_ID, cluster);
+		job->LookupInteger(ATTR_PROC_ID, proc);
+		dprintf(D_FULLDEBUG, "Job %d.%d is a no-op with status %d\n",
+				cluster,proc,noop_status);
+		job_id.cluster = cluster;
+		job_id.proc = proc;
+		set_job_status(cluster, proc, COMPLETED);
+		scheduler.WriteTerminateToUserLog( job_id, noop_status );
+		return;
+	}
+
+	time_t now = time(NULL);
+
+		// if job is not idle, then update statistics for running jobs
+	if (status == RUNNING || status == TRANSFERRING_OUTPUT) {
+		ScheddOtherStats * other_stats = NULL;
+		if (scheduler.OtherPoolStats.AnyEnabled()) {
+			other_stats = scheduler.OtherPoolStats.Matches(*job, now);
+		}
+		#define OTHER for (ScheddOtherStats * po = other_stats; po; po = po->next) (po->stats)
+
+		scheduler.stats.JobsRunning += 1;
+		OTHER.JobsRunning += 1;
+
+		int job_image_size = 0;
+		job->LookupInteger("ImageSize_RAW", job_image_size);
+		scheduler.stats.JobsRunningSizes += (int64_t)job_image_size * 1024;
+		OTHER.JobsRunningSizes += (int64_t)job_image_size * 1024;
+
+		int job_start_date = 0;
+		int job_running_time = 0;
+		if (job->LookupInteger(ATTR_JOB_START_DATE, job_start_date))
+			job_running_time = (now - job_start_date);
+		scheduler.stats.JobsRunningRuntimes += job_running_time;
+		OTHER.JobsRunningRuntimes += job_running_time;
+		#undef OTHER
+	}
+
+	if ( (universe != CONDOR_UNIVERSE_GRID) &&	// handle Globus below...
+		 (!service_this_universe(universe,job))  )
+	{
 			// We want to record the cluster id of all idle MPI and parallel
 		    // jobs
 
@@ -2928,17 +3401,13 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 				}
 			}
 		}
-
-		// bailout now, since all the crud below is only for jobs
-		// which the schedd needs to service
-		return 0;
-	} 
+		return;
+	}
 
 	if ( universe == CONDOR_UNIVERSE_GRID ) {
 		// for Globus, count jobs in UNSUBMITTED state by owner.
 		// later we make certain there is a grid manager daemon
 		// per owner.
-		int real_status = status;
 		bool want_service = service_this_universe(universe,job);
 		bool job_managed = jobExternallyManaged(job);
 		bool job_managed_done = jobManagedDone(job);
@@ -2987,60 +3456,290 @@ count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
 			ASSERT(gridcounts);
 			gridcounts->UnmanagedGridJobs++;
 		}
-			// If we do not need to do matchmaking on this job (i.e.
-			// service this globus universe job), than we can bailout now.
-		if (!want_service) {
-			return 0;
-		}
-		status = real_status;	// set status back for below logic...
 	}
+}
 
-	if (status == IDLE || status == RUNNING || status == TRANSFERRING_OUTPUT) {
+int
+count_a_job(JobQueueJob* job, const JOB_ID_KEY& /*jid*/, void*)
+{
+		// we may get passed a NULL job ad if, for instance, the job ad was
+		// removed via condor_rm -f when some function didn't expect it.
+		// So check for it here before continuing onward...
+	if ( job == NULL ) {  
+		return 0;
+	}
 
-			// Update Owner array PrioSet iff knob USE_GLOBAL_JOB_PRIOS is true
-			// and iff job is looking for more matches (max-hosts - cur_hosts)
-		if ( param_boolean("USE_GLOBAL_JOB_PRIOS",false) &&
-			 ((max_hosts - cur_hosts) > 0) )
-		{
-			int job_prio;
-			if ( job->LookupInteger(ATTR_JOB_PRIO,job_prio) ) {
-				SubData->PrioSet.insert( job_prio );
-			}
+	JobCountsEntry entry;
+	if (get_job_counts(job, entry)) {
+		SubmitterData * SubData = NULL;
+		OwnerInfo * OwnInfo = scheduler.get_submitter_and_owner(job, SubData);
+		time_t now = time(NULL);
+		OwnInfo->LastHitTime = now;
+		SubData->LastHitTime = now;
+
+		scheduler.addJobCountsToTotals(entry.num);
+		add_job_counts(OwnInfo->num, entry.num);
+		add_job_counts(SubData->num, entry.num);
+		if (entry.HasPrio) {
+			SubData->PrioSet.insert(entry.JobPrio);
 		}
-			// Update Owners array JobsIdle
-		OwnerCounts->JobsIdle += (max_hosts - cur_hosts);
-		Counters->JobsIdle += (max_hosts - cur_hosts);
+	}
+	if (entry.NeedsWalk) {
+		count_a_job_extras(job);
+	}
+	return 0;
+}
 
+void
+Scheduler::addJobCountsToTotals(const JobCounts & num)
+{
+	JobsTotalAds += num.JobsCounted;
+	JobsRunning += num.JobsRunning;
+	JobsIdle += num.JobsIdle;
+	JobsHeld += num.JobsHeld;
+	JobsRemoved += num.JobsRemoved;
+	SchedUniverseJobsRunning += num.SchedulerJobsRunning;
+	SchedUniverseJobsIdle += num.SchedulerJobsIdle;
+	LocalUniverseJobsRunning += num.LocalJobsRunning;
+	LocalUniverseJobsIdle += num.LocalJobsIdle;
+}
+
+// add (sign = 1) or take back (sign = -1) what a job adds to the live job counts
+void
+Scheduler::addJobCounts(const JobCountsEntry & entry, int sign)
+{
+	if ( ! entry.num.JobsCounted) {
+		return;
+	}
+	m_job_counts_total.add(entry.num, sign);
 
-			// If we're biasing by slot weight, and the job is idle, and everything parsed...
-		if (scheduler.m_use_slot_weights && (max_hosts > cur_hosts)) {
-				// if we're biasing idle jobs by SCHEDD_SLOT_WEIGHT, eval that here
-			int job_weight = request_cpus;
-			if (scheduler.slotWeightOfJob) {
-				classad::Value value;
-				int rval = EvalExprTree(scheduler.slotWeightOfJob, job, NULL, value);
-				if ( ! rval || ! value.IsNumber(job_weight)) {
-					job_weight = request_cpus; // fall back if slot weight doesn't evaluate
-				}
-			} else {
-				job_weight = scheduler.guessJobSlotWeight(job);
-			}
-			Counters->WeightedJobsIdle += job_weight * (max_hosts - cur_hosts);
+	JobCounts & owner = m_owner_job_counts[entry.owner];
+	owner.add(entry.num, sign);
+	if ( ! owner.JobsCounted) { m_owner_job_counts.erase(entry.owner); }
+
+	JobCounts & submitter = m_submitter_job_counts[entry.submitter];
+	submitter.add(entry.num, sign);
+	if ( ! submitter.JobsCounted) { m_submitter_job_counts.erase(entry.submitter); }
+
+	if (entry.HasPrio) {
+		std::map<int,int> & prios = m_submitter_job_prios[entry.submitter];
+		int & count = prios[entry.JobPrio];
+		count += sign;
+		if (count <= 0) { prios.erase(entry.JobPrio); }
+		if (prios.empty()) { m_submitter_job_prios.erase(entry.submitter); }
+	}
+}
+
+/*
+Remember that a job should be counted again at the next count_jobs.
+*/
+void
+Scheduler::jobCountsChanged( const JOB_ID_KEY & job_id )
+{
+	if (m_incremental_job_counts && m_job_counts_valid && job_id.cluster > 0 && job_id.proc >= 0) {
+		m_job_counts_dirty.insert(job_id);
+	}
+}
+
+/*
+Take a job that is leaving the queue out of the live job counts.
+*/
+void
+Scheduler::jobCountsRemoved( const JOB_ID_KEY & job_id )
+{
+	std::map<JOB_ID_KEY, JobCountsEntry>::iterator found = m_job_counts.find(job_id);
+	if (found != m_job_counts.end()) {
+		addJobCounts(found->second, -1);
+		m_job_counts.erase(found);
+	}
+	m_job_counts_dirty.erase(job_id);
+	m_job_counts_walk.erase(job_id);
+}
+
+/*
+Count a job again, replacing what it added to the live job counts before.
+*/
+void
+Scheduler::recountJob( JobQueueJob * job )
+{
+	JobCountsEntry & entry = m_job_counts[job->jid];
+	addJobCounts(entry, -1);
+	bool counted = get_job_counts(job, entry);
+	if ( ! counted && ! entry.NeedsWalk) {
+		m_job_counts.erase(job->jid);
+		m_job_counts_walk.erase(job->jid);
+		return;
+	}
+	addJobCounts(entry, 1);
+	if (entry.NeedsWalk) {
+		m_job_counts_walk.insert(job->jid);
+	} else {
+		m_job_counts_walk.erase(job->jid);
+	}
+}
+
+static int
+recount_a_job( JobQueueJob *job, const JOB_ID_KEY& /*id*/, void* /*user*/ )
+{
+	if (job && job->IsJob()) {
+		scheduler.recountJob(job);
+	}
+	return 0;
+}
+
+/*
+Bring the live job counts up to date by counting the jobs that changed
+since the last time, or every job the first time and after a reconfig.
+*/
+void
+Scheduler::updateJobCounts()
+{
+	if ( ! m_job_counts_valid) {
+		m_job_counts.clear();
+		m_job_counts_dirty.clear();
+		m_job_counts_walk.clear();
+		m_job_counts_total.clear();
+		m_owner_job_counts.clear();
+		m_submitter_job_counts.clear();
+		m_submitter_job_prios.clear();
+		WalkJobQueue(recount_a_job);
+		m_job_counts_valid = true;
+		return;
+	}
+
+		// counting a job doesn't change it, but work from a copy anyway
+	std::set<JOB_ID_KEY> dirty;
+	dirty.swap(m_job_counts_dirty);
+	for (std::set<JOB_ID_KEY>::const_iterator it = dirty.begin(); it != dirty.end(); ++it) {
+		JobQueueJob * job = GetJobAd(it->cluster, it->proc);
+		if (job) {
+			recountJob(job);
 		} else {
-			// here: either max_hosts == cur_hosts || !scheduler.m_use_slot_weights
-			Counters->WeightedJobsIdle += request_cpus * (max_hosts - cur_hosts);
+			jobCountsRemoved(*it);
 		}
+	}
+}
 
-			// Don't update scheduler.Owners[name].JobsRunning here.
-			// We do it in Scheduler::count_jobs().
+/*
+Copy the live job counts into the schedd totals and the owner and
+submitter records, which count_jobs has just cleared.
+*/
+void
+Scheduler::publishJobCounts(time_t now)
+{
+	addJobCountsToTotals(m_job_counts_total);
 
-	} else if (status == HELD) {
-		OwnerCounts->JobsHeld++;
-		Counters->JobsHeld++;
+	for (std::map<std::string, JobCounts>::const_iterator it = m_owner_job_counts.begin(); it != m_owner_job_counts.end(); ++it) {
+		if (it->first.empty()) continue;
+		OwnerInfo * owner = insert_ownerinfo(it->first.c_str());
+		owner->LastHitTime = now;
+		add_job_counts(owner->num, it->second);
+	}
+	for (std::map<std::string, JobCounts>::const_iterator it = m_submitter_job_counts.begin(); it != m_submitter_job_counts.end(); ++it) {
+		if (it->first.empty()) continue;
+		SubmitterData * submitter = insert_submitter(it->first.c_str());
+		submitter->LastHitTime = now;
+		add_job_counts(submitter->num, it->second);
 	}
+	for (std::map<std::string, std::map<int,int> >::const_iterator it = m_submitter_job_prios.begin(); it != m_submitter_job_prios.end(); ++it) {
+		if (it->first.empty()) continue;
+		SubmitterData * submitter = insert_submitter(it->first.c_str());
+		for (std::map<int,int>::const_iterator prio = it->second.begin(); prio != it->second.end(); ++prio) {
+			submitter->PrioSet.insert(prio->first);
+		}
+	}
+}
 
-	return 0;
+#define CHECK_JOB_COUNT(who, what, live, walked) \
+	if ((live) != (walked)) { \
+		dprintf(D_ALWAYS, "ERROR: live job count %s of %s is %d, but walking the job queue counted %d\n", what, who, (int)(live), (int)(walked)); \
+		++mismatches; \
+	}
+
+/*
+Compare the live job counts with the ones count_a_job just computed by
+walking the job queue.  If they differ, log the differences and count
+every job again at the next count_jobs.
+*/
+void
+Scheduler::checkJobCounts()
+{
+	int mismatches = 0;
+	const JobCounts & total = m_job_counts_total;
+	CHECK_JOB_COUNT("the schedd", ATTR_TOTAL_JOB_ADS, total.JobsCounted, JobsTotalAds);
+	CHECK_JOB_COUNT("the schedd", ATTR_TOTAL_RUNNING_JOBS, total.JobsRunning, JobsRunning);
+	CHECK_JOB_COUNT("the schedd", ATTR_TOTAL_IDLE_JOBS, total.JobsIdle, JobsIdle);
+	CHECK_JOB_COUNT("the schedd", ATTR_TOTAL_HELD_JOBS, total.JobsHeld, JobsHeld);
+	CHECK_JOB_COUNT("the schedd", ATTR_TOTAL_REMOVED_JOBS, total.JobsRemoved, JobsRemoved);
+	CHECK_JOB_COUNT("the schedd", ATTR_TOTAL_SCHEDULER_RUNNING_JOBS, total.SchedulerJobsRunning, SchedUniverseJobsRunning);
+	CHECK_JOB_COUNT("the schedd", ATTR_TOTAL_SCHEDULER_IDLE_JOBS, total.SchedulerJobsIdle, SchedUniverseJobsIdle);
+	CHECK_JOB_COUNT("the schedd", ATTR_TOTAL_LOCAL_RUNNING_JOBS, total.LocalJobsRunning, LocalUniverseJobsRunning);
+	CHECK_JOB_COUNT("the schedd", ATTR_TOTAL_LOCAL_IDLE_JOBS, total.LocalJobsIdle, LocalUniverseJobsIdle);
+
+	JobCounts none;
+	for (OwnerInfoMap::const_iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
+		const RealOwnerCounters & walked = it->second.num;
+		std::map<std::string, JobCounts>::const_iterator found = m_owner_job_counts.find(it->first);
+		const JobCounts & live = (found != m_owner_job_counts.end()) ? found->second : none;
+		std::string who("owner "); who += it->first;
+		CHECK_JOB_COUNT(who.c_str(), "JobsCounted", live.JobsCounted, walked.JobsCounted);
+		CHECK_JOB_COUNT(who.c_str(), "JobsIdle", live.UserJobsIdle, walked.JobsIdle);
+		CHECK_JOB_COUNT(who.c_str(), "JobsHeld", live.UserJobsHeld, walked.JobsHeld);
+		CHECK_JOB_COUNT(who.c_str(), "SchedulerJobsRunning", live.SchedulerJobsRunning, walked.SchedulerJobsRunning);
+		CHECK_JOB_COUNT(who.c_str(), "SchedulerJobsIdle", live.SchedulerJobsIdle, walked.SchedulerJobsIdle);
+		CHECK_JOB_COUNT(who.c_str(), "LocalJobsRunning", live.LocalJobsRunning, walked.LocalJobsRunning);
+		CHECK_JOB_COUNT(who.c_str(), "LocalJobsIdle", live.LocalJobsIdle, walked.LocalJobsIdle);
+	}
+	for (std::map<std::string, JobCounts>::const_iterator it = m_owner_job_counts.begin(); it != m_owner_job_counts.end(); ++it) {
+		if (OwnersInfo.find(it->first) == OwnersInfo.end()) {
+			std::string who("owner "); who += it->first;
+			CHECK_JOB_COUNT(who.c_str(), "JobsCounted", it->second.JobsCounted, 0);
+		}
+	}
+
+	for (SubmitterDataMap::const_iterator it = Submitters.begin(); it != Submitters.end(); ++it) {
+		const SubmitterCounters & walked = it->second.num;
+		std::map<std::string, JobCounts>::const_iterator found = m_submitter_job_counts.find(it->first);
+		const JobCounts & live = (found != m_submitter_job_counts.end()) ? found->second : none;
+		std::string who("submitter "); who += it->first;
+		CHECK_JOB_COUNT(who.c_str(), "JobsCounted", live.JobsCounted, walked.JobsCounted);
+		CHECK_JOB_COUNT(who.c_str(), ATTR_IDLE_JOBS, live.UserJobsIdle, walked.JobsIdle);
+		CHECK_JOB_COUNT(who.c_str(), ATTR_WEIGHTED_IDLE_JOBS, live.WeightedJobsIdle, walked.WeightedJobsIdle);
+		CHECK_JOB_COUNT(who.c_str(), ATTR_HELD_JOBS, live.UserJobsHeld, walked.JobsHeld);
+		CHECK_JOB_COUNT(who.c_str(), ATTR_RUNNING_SCHEDULER_JOBS, live.SchedulerJobsRunning, walked.SchedulerJobsRunning);
+		CHECK_JOB_COUNT(who.c_str(), ATTR_IDLE_SCHEDULER_JOBS, live.SchedulerJobsIdle, walked.SchedulerJobsIdle);
+		CHECK_JOB_COUNT(who.c_str(), "LocalJobsRunning", live.LocalJobsRunning, walked.LocalJobsRunning);
+		CHECK_JOB_COUNT(who.c_str(), "LocalJobsIdle", live.LocalJobsIdle, walked.LocalJobsIdle);
+
+		std::set<int> prios;
+		std::map<std::string, std::map<int,int> >::const_iterator live_prios = m_submitter_job_prios.find(it->first);
+		if (live_prios != m_submitter_job_prios.end()) {
+			for (std::map<int,int>::const_iterator prio = live_prios->second.begin(); prio != live_prios->second.end(); ++prio) {
+				prios.insert(prio->first);
+			}
+		}
+		CHECK_JOB_COUNT(who.c_str(), "number of job priorities", prios.size(), it->second.PrioSet.size());
+		if (prios.size() == it->second.PrioSet.size() && ! std::equal(prios.begin(), prios.end(), it->second.PrioSet.begin())) {
+			dprintf(D_ALWAYS, "ERROR: live job priorities of %s differ from the ones counted by walking the job queue\n", who.c_str());
+			++mismatches;
+		}
+	}
+	for (std::map<std::string, JobCounts>::const_iterator it = m_submitter_job_counts.begin(); it != m_submitter_job_counts.end(); ++it) {
+		if (Submitters.find(it->first) == Submitters.end()) {
+			std::string who("submitter "); who += it->first;
+			CHECK_JOB_COUNT(who.c_str(), "JobsCounted", it->second.JobsCounted, 0);
+		}
+	}
+
+	if (mismatches) {
+		dprintf(D_ALWAYS, "Found %d differences between the live job counts and the job queue, "
+			"all jobs will be counted again.\n", mismatches);
+		m_job_counts_valid = false;
+	} else {
+		dprintf(D_FULLDEBUG, "Live job counts agree with the job queue.\n");
+	}
 }
+#undef CHECK_JOB_COUNT
 
 bool
 service_this_universe(int universe, ClassAd* job)
@@ -3667,7 +4366,11 @@ PeriodicExprEval(JobQueueJob *jobad, const JOB_ID_KEY & /*jid*/, void *)
 #endif
 {
 	int status=-1;
-	if(!ResponsibleForPeriodicExprs(jobad, status)) return 1;
+	if(!ResponsibleForPeriodicExprs(jobad, status)) {
+			// evaluate again when something changes that might make us responsible
+		scheduler.policyJobEvaluated(jobad->jid, NULL, false);
+		return 1;
+	}
 
 	int cluster = jobad->jid.cluster;
 	int proc = jobad->jid.proc;
@@ -3682,6 +4385,13 @@ PeriodicExprEval(JobQueueJob *jobad, const JOB_ID_KEY & /*jid*/, void *)
 #ifdef USE_NON_MUTATING_USERPOLICY
 	UserPolicy & policy = *(UserPolicy*)pvUser;
 
+		// remember what the policy depends on, so that we know when
+		// it needs to be evaluated again.
+	classad::References policy_attrs;
+	time_t next_change = 0;
+	bool time_dependent = policy.PeriodicDependencies(*jobad, policy_attrs, next_change);
+	scheduler.policyJobEvaluated(jobad->jid, &policy_attrs, time_dependent, next_change);
+
 	policy.ResetTriggers();
 	int action = policy.AnalyzePolicy(*jobad, PERIODIC_ONLY);
 #else
@@ -3737,9 +4447,57 @@ PeriodicExprEval(JobQueueJob *jobad, const JOB_ID_KEY & /*jid*/, void *)
 	return 1;
 }
 
+// the attributes that decide whether the schedd evaluates a job's periodic
+// policy at all, see ResponsibleForPeriodicExprs()
+static void
+reset_policy_attrs( classad::References & attrs )
+{
+	attrs.clear();
+	attrs.insert(ATTR_JOB_STATUS);
+	attrs.insert(ATTR_HOLD_REASON_CODE);
+	attrs.insert(ATTR_JOB_MANAGED);
+	attrs.insert(ATTR_JOB_UNIVERSE);
+}
+
+/*
+Remember that a job should have its periodic policy evaluated
+at the next PeriodicExprHandler.
+*/
+void
+Scheduler::policyJobChanged( const JOB_ID_KEY & job_id )
+{
+	if (job_id.cluster > 0 && job_id.proc >= 0) {
+		m_policy_dirty_jobs.insert(job_id);
+	}
+}
+
+/*
+Record what the periodic policy of a job depends on after evaluating it.
+Jobs whose policy depends on the time are evaluated at the first
+PeriodicExprHandler at or after next_change, or at every one if
+next_change is 0, the others only when an attribute in attrs changes.
+*/
+void
+Scheduler::policyJobEvaluated( const JOB_ID_KEY & job_id, const classad::References * attrs, bool time_dependent, time_t next_change )
+{
+	if (attrs) {
+		m_policy_attrs.insert(attrs->begin(), attrs->end());
+	}
+	if (time_dependent) {
+		m_policy_timed_jobs[job_id] = next_change;
+	} else {
+		m_policy_timed_jobs.erase(job_id);
+	}
+}
+
 /*
-For all of the jobs in the queue, evaluate the 
-periodic user policy expressions.
+Evaluate the periodic user policy expressions of the jobs
+that need it: those whose policy depends on the time and
+may have changed by now, and those for which an attribute
+the policy depends on changed.
+Every PERIODIC_EXPR_FULL_SWEEP_INTERVAL seconds, evaluate
+them for all of the jobs in the queue, to catch changes
+that didn't go through SetAttribute.
 */
 
 void
@@ -3751,13 +4509,46 @@ Scheduler::PeriodicExprHandler( void )
 #ifdef USE_NON_MUTATING_USERPOLICY
 	policy.Init();
 #endif
-	WalkJobQueue2(PeriodicExprEval, &policy);
+
+	time_t now = time(NULL);
+	bool full_sweep = PeriodicExprFullSweepInterval <= 0 ||
+		m_policy_last_full_sweep + PeriodicExprFullSweepInterval <= now;
+#ifndef USE_NON_MUTATING_USERPOLICY
+	full_sweep = true; // we don't know what the policy depends on
+#endif
+	size_t num_jobs = 0;
+	if (full_sweep) {
+		m_policy_last_full_sweep = now;
+		reset_policy_attrs(m_policy_attrs);
+		m_policy_dirty_jobs.clear();
+		m_policy_timed_jobs.clear();
+		WalkJobQueue2(PeriodicExprEval, &policy);
+		num_jobs = m_job_index.NumJobs();
+	} else {
+			// evaluating a job may change it, or remove it from the
+			// queue, so work from a copy of the list
+		std::set<JOB_ID_KEY> jobs;
+		jobs.swap(m_policy_dirty_jobs);
+		for (std::map<JOB_ID_KEY, time_t>::const_iterator it = m_policy_timed_jobs.begin(); it != m_policy_timed_jobs.end(); ++it) {
+			if (it->second <= now) {
+				jobs.insert(it->first);
+			}
+		}
+		for (std::set<JOB_ID_KEY>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+			JobQueueJob * job = GetJobAd(it->cluster, it->proc);
+			if (job) {
+				PeriodicExprEval(job, *it, &policy);
+				++num_jobs;
+			}
+		}
+	}
 
 	PeriodicExprInterval.setFinishTimeNow();
 
 	unsigned int time_to_next_run = PeriodicExprInterval.getTimeToNextRun();
-	dprintf(D_FULLDEBUG,"Evaluated periodic expressions in %.3fs, "
+	dprintf(D_FULLDEBUG,"Evaluated periodic expressions %s(%d jobs) in %.3fs, "
 			"scheduling next run in %us\n",
+			full_sweep ? "of all jobs " : "", (int)num_jobs,
 			PeriodicExprInterval.getLastDuration(),
 			time_to_next_run);
 	daemonCore->Reset_Timer( periodicid, time_to_next_run );
@@ -10617,6 +11408,9 @@ Scheduler::delete_shadow_rec( shadow_rec *rec )
 				 cluster, proc );
 	}
 
+		// the schedd may now be responsible for the job's periodic policy
+	policyJobChanged(rec->job_id);
+
 	BeginTransaction();
 
 	int job_status = IDLE;
@@ -12511,6 +13305,34 @@ Scheduler::Init()
 	AllowLateMaterialize = param_boolean("SCHEDD_ALLOW_LATE_MATERIALIZE", false);
 	MaxMaterializedJobsPerCluster = param_integer("MAX_MATERIALIZED_JOBS_PER_CLUSTER", MaxMaterializedJobsPerCluster);
 
+		// condor_q can be answered on threads from the pool
+		// (THREAD_WORKER_POOL_SIZE) rather than by forked children.
+	m_threaded_queries = CondorThreads::pool_size() > 0 &&
+		param_boolean("SCHEDD_THREADED_QUERIES", false);
+	set_threaded_query_commands(m_threaded_queries);
+	m_only_my_jobs = param_boolean("CONDOR_Q_ONLY_MY_JOBS", true);
+
+		// Owner and JobStatus are always indexed, this adds to them.
+		// If the set changes on reconfig, index the queue again.
+	auto_free_ptr index_attrs(param("SCHEDD_JOB_QUEUE_INDEX_ATTRS"));
+	if (m_job_index.SetAttributes(index_attrs) && ! first_time_in_init) {
+		WalkJobQueue(index_a_job);
+		dprintf(D_ALWAYS, "Indexed %d jobs by %s\n", (int)m_job_index.NumJobs(), index_attrs ? index_attrs.ptr() : "Owner and JobStatus");
+	}
+
+		// Keep the job counts up to date as jobs change, rather than walking
+		// the job queue in count_jobs.  The settings that decide how a job is
+		// counted (slot weights, USE_GLOBAL_JOB_PRIOS...) may have changed,
+		// so every job is counted again at the next count_jobs.
+	m_incremental_job_counts = param_boolean("SCHEDD_INCREMENTAL_JOB_COUNTS", true);
+	m_check_job_counts = param_boolean("SCHEDD_CHECK_JOB_COUNTS", false);
+	m_job_counts_valid = false;
+	if ( ! m_incremental_job_counts) {
+		m_job_counts.clear();
+		m_job_counts_dirty.clear();
+		m_job_counts_walk.clear();
+	}
+
 		// Limit number of simultaenous connection attempts to startds.
 		// This avoids the schedd getting so busy authenticating with
 		// startds that it can't keep up with shadows.
@@ -12783,6 +13605,11 @@ Scheduler::Init()
 
 	PeriodicExprInterval.setTimeslice( param_double("PERIODIC_EXPR_TIMESLICE", 0.01,0,1) );
 
+	PeriodicExprFullSweepInterval = param_integer("PERIODIC_EXPR_FULL_SWEEP_INTERVAL", 1200, 0);
+		// the system periodic expressions may have changed, so evaluate
+		// the policy of every job at the next PeriodicExprHandler
+	m_policy_last_full_sweep = 0;
+
 	RequestClaimTimeout = param_integer("REQUEST_CLAIM_TIMEOUT",60*30);
 
 #ifdef HAVE_EXT_POSTGRESQL
@@ -13294,6 +14121,7 @@ Scheduler::Register()
 	daemonCore->Register_CommandWithPayload(QUERY_JOB_ADS_WITH_AUTH, "QUERY_JOB_ADS_WITH_AUTH",
 				(CommandHandlercpp)&Scheduler::command_query_job_ads,
 				"command_query_job_ads", this, READ, D_FULLDEBUG, true /*force authentication*/);
+	set_threaded_query_commands(m_threaded_queries);
 
 	// Note: The QMGMT READ/WRITE commands have the same command handler.
 	// This is ok, because authorization to do write operations is verified
@@ -13462,85 +14290,6 @@ Scheduler::RegisterTimers()
 }
 
 
-extern "C" {
-int
-prio_compar(prio_rec* a, prio_rec* b)
-{
-	 /* compare submitted job preprio's: higher values have more priority */
-	 /* Typically used to prioritize entire DAG jobs over other DAG jobs */
-	 if (a->pre_job_prio1 > INT_MIN && b->pre_job_prio1 > INT_MIN ) { 
-	      if( a->pre_job_prio1 < b->pre_job_prio1 ) {
-		  return 1;
-              }
-	      if( a->pre_job_prio1 > b->pre_job_prio1 ) {
-		  return -1;
-	      }
-	 }
-		 
-	 if( a->pre_job_prio2 > INT_MIN && b->pre_job_prio2 > INT_MIN ) {
-	      if( a->pre_job_prio2 < b->pre_job_prio2 ) {
-		  return 1;
-	      }
-	      if( a->pre_job_prio2 > b->pre_job_prio2 ) {
-		  return -1;
-	      }
-	 }
-	 
-	 /* compare job priorities: higher values have more priority */
-	 if( a->job_prio < b->job_prio ) {
-		  return 1;
-	 }
-	 if( a->job_prio > b->job_prio ) {
-		  return -1;
-	 }
-	 
-	 /* compare submitted job postprio's: higher values have more priority */
-	 /* Typically used to prioritize entire DAG jobs over other DAG jobs */
-	 if( a->post_job_prio1 > INT_MIN && b->post_job_prio1 > INT_MIN ) {
-	      if( a->post_job_prio1 < b->post_job_prio1 ) {
-		  return 1;
-	      }
-	      if( a->post_job_prio1 > b->post_job_prio1 ) {
-		  return -1;
-	      }
-	 }
-	 
-	 if( a->post_job_prio2 > INT_MIN && b->post_job_prio2 > INT_MIN ) {
-	      if( a->post_job_prio2 < b->post_job_prio2 ) {
-		  return 1;
-	      }
-	      if( a->post_job_prio2 > b->post_job_prio2 ) {
-		  return -1;
-	      }
-	 }
-	      
-	 /* here,updown priority and job_priority are both equal */
-
-	 /* check for job submit times */
-	 if( a->qdate < b->qdate ) {
-		  return -1;
-	 }
-	 if( a->qdate > b->qdate ) {
-		  return 1;
-	 }
-
-	 /* go in order of cluster id */
-	if ( a->id.cluster < b->id.cluster )
-		return -1;
-	if ( a->id.cluster > b->id.cluster )
-		return 1;
-
-	/* finally, go in order of the proc id */
-	if ( a->id.proc < b->id.proc )
-		return -1;
-	if ( a->id.proc > b->id.proc )
-		return 1;
-
-	/* give up! very unlikely we'd ever get here */
-	return 0;
-}
-} // end of extern
-
 
 void Scheduler::reconfig() {
 	/***********************************
@@ -15725,12 +16474,16 @@ Scheduler::claimLocalStartd()
 /**
  * Adds a job to various job indexes, called on startup and when new jobs are committed to the queue.
  * 
- * @param jobAd - the new job to be added to the cronTabs table
+ * @param jobAd - the new job to be added to the indexes
  * @param loading_job_queue - true if this function is called when reloading the job queue
  **/
 void
-Scheduler::indexAJob( JobQueueJob * /*jobAd*/, bool /*loading_job_queue*/ )
+Scheduler::indexAJob( JobQueueJob * jobAd, bool /*loading_job_queue*/ )
 {
+	m_job_index.AddJob(jobAd);
+	UpdateRunnableJob(jobAd);
+	policyJobChanged(jobAd->jid);
+	jobCountsChanged(jobAd->jid);
 #if 0 // enable this code to keep an index of LocalJobIds
 	int univ = jobAd->Universe();
 	if (univ == CONDOR_UNIVERSE_LOCAL || univ == CONDOR_UNIVERSE_SCHEDULER) {
@@ -15742,16 +16495,28 @@ Scheduler::indexAJob( JobQueueJob * /*jobAd*/, bool /*loading_job_queue*/ )
 /**
  * Removes a job from various job indexes, called when the job object is deleted
  * 
- * @param jobAd - the new job to be added to the cronTabs table
+ * @param job_id - the job to be removed from the indexes
  **/
 void
-Scheduler::removeJobFromIndexes( const JOB_ID_KEY& /*job_id*/ )
+Scheduler::removeJobFromIndexes( const JOB_ID_KEY& job_id )
 {
+	m_job_index.RemoveJob(job_id);
+	RemoveRunnableJob(job_id);
+	m_policy_dirty_jobs.erase(job_id);
+	m_policy_timed_jobs.erase(job_id);
+	jobCountsRemoved(job_id);
 #if 0 // enable this code to keep an index of LocalJobIds
 	LocalJobIds.erase(job_id);
 #endif
 }
 
+static int
+index_a_job( JobQueueJob *job, const JOB_ID_KEY& /*id*/, void* /*user*/ )
+{
+	scheduler.indexAJob(job, true);
+	return 0;
+}
+
 /**
  * Adds a job to our list of CronTab jobs
  * We will check to see if the job has already been added and
@@ -188,6 +188,11 @@ void ScheddStatistics::InitMain()
    SCHEDD_STATS_ADD_RECENT(Pool, Autoclusters,         IF_BASICPUB);
    SCHEDD_STATS_ADD_RECENT(Pool, ResourceRequestsSent,      IF_BASICPUB);
 
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueries,                IF_BASICPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueriesForked,          IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueriesThreaded,        IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueryAdsSent,           IF_VERBOSEPUB);
+
    SCHEDD_STATS_ADD_RECENT(Pool, ShadowsStarted,            IF_BASICPUB);
    SCHEDD_STATS_ADD_RECENT(Pool, ShadowsRecycled,           IF_VERBOSEPUB);
    SCHEDD_STATS_ADD_RECENT(Pool, ShadowsReconnections,      IF_VERBOSEPUB);
@@ -302,6 +307,81 @@ void ScheddStatistics::Publish(ClassAd & ad, int flags) const
    Pool.Publish(ad, flags);
 }
 
+// only this many clients get probes of their own, so that a flood of
+// one-time clients can't bloat the schedd ad.
+static const size_t MAX_JOB_QUERY_CLIENTS = 100;
+
+// count a query for job ads from the given client (the authenticated user,
+// or else the peer address).  runtime is the time the schedd spent on the
+// query, which for forked queries is just the time it took to fork.
+// queries answered on pool threads call this under lock_state_readers().
+//
+void ScheddStatistics::CountJobQuery(const char * client, bool forked, bool threaded, int ads_sent, double runtime)
+{
+   JobQueries += 1;
+   if (forked) JobQueriesForked += 1;
+   if (threaded) JobQueriesThreaded += 1;
+   JobQueryAdsSent += ads_sent;
+
+   MyString prefix("Client_");
+   prefix += (client && client[0]) ? client : "unknown";
+   prefix += "_";
+   cleanStringForUseAsAttr(prefix, '_');
+
+   std::map<std::string, time_t>::iterator found = JobQueryClients.find(prefix.Value());
+   if (found == JobQueryClients.end()) {
+      if (JobQueryClients.size() >= MAX_JOB_QUERY_CLIENTS)
+         return;
+      found = JobQueryClients.insert(std::make_pair(std::string(prefix.Value()), (time_t)0)).first;
+   }
+   found->second = time(NULL);
+
+   int cMax = this->RecentWindowMax / this->RecentWindowQuantum;
+   std::string attr(found->first); attr += "JobQueries";
+   stats_recent_counter_timer * queries = Pool.GetProbe<stats_recent_counter_timer>(attr.c_str());
+   if ( ! queries) {
+      queries = Pool.NewProbe<stats_recent_counter_timer>(attr.c_str(), attr.c_str(),
+                   IF_VERBOSEPUB | stats_recent_counter_timer::PubDefault);
+      queries->SetRecentMax(cMax);
+   }
+   queries->Add(runtime);
+
+   attr = found->first; attr += "JobQueryAdsSent";
+   stats_entry_recent<int> * ads = Pool.GetProbe< stats_entry_recent<int> >(attr.c_str());
+   if ( ! ads) {
+      ads = Pool.NewProbe< stats_entry_recent<int> >(attr.c_str(), attr.c_str(),
+                   IF_VERBOSEPUB | stats_entry_recent<int>::PubValueAndRecent);
+      ads->SetRecentMax(cMax);
+   }
+   *ads += ads_sent;
+}
+
+// because the schedd ad is persistent, we have to actively delete the
+// attributes of the clients we stop keeping statistics for.
+//
+void ScheddStatistics::ExpireJobQueryClients(ClassAd & ad, time_t now)
+{
+   std::map<std::string, time_t>::iterator it = JobQueryClients.begin();
+   while (it != JobQueryClients.end()) {
+      if (now - it->second < this->RecentWindowMax) {
+         ++it;
+         continue;
+      }
+
+      std::string attr(it->first); attr += "JobQueries";
+      stats_recent_counter_timer * queries = Pool.GetProbe<stats_recent_counter_timer>(attr.c_str());
+      if (queries) { queries->Unpublish(ad, attr.c_str()); }
+      Pool.RemoveProbe(attr.c_str());
+
+      attr = it->first; attr += "JobQueryAdsSent";
+      stats_entry_recent<int> * ads = Pool.GetProbe< stats_entry_recent<int> >(attr.c_str());
+      if (ads) { ads->Unpublish(ad, attr.c_str()); }
+      Pool.RemoveProbe(attr.c_str());
+
+      JobQueryClients.erase(it++);
+   }
+}
+
 #if 0  // obsolete
 void ScheddStatistics::Unpublish(ClassAd & ad) const
 {
@@ -106,6 +106,13 @@ typedef struct ScheddStatistics : public ScheddJobCounters {
    stats_entry_recent<int> Autoclusters;   // number of active autoclusters
    stats_entry_recent<int> ResourceRequestsSent;   // number of resource requests
 
+   // queries for job ads (condor_q), and how they were answered.
+   // each client also gets probes of its own, see CountJobQuery()
+   stats_entry_recent<int> JobQueries;
+   stats_entry_recent<int> JobQueriesForked;    // answered by a forked child
+   stats_entry_recent<int> JobQueriesThreaded;  // answered on a thread from the pool
+   stats_entry_recent<int> JobQueryAdsSent;     // ads sent for queries that weren't forked
+
    // These track how successful the schedd was at reconnecting to
    // running jobs after the last restart.
    // How many reconnect attempts failed.
@@ -138,6 +145,7 @@ typedef struct ScheddStatistics : public ScheddJobCounters {
    int    RecentWindowQuantum;
    int    PublishFlags;
    int    AdvanceAtLastTick;
+   std::map<std::string, time_t> JobQueryClients; // attribute prefix of each client's probes, and when it last queried
 
    StatisticsPool          Pool;          // pool of statistics probes and Publish attrib names
 
@@ -152,6 +160,8 @@ typedef struct ScheddStatistics : public ScheddJobCounters {
    void Publish(ClassAd & ad, int flags) const;
    void Publish(ClassAd & ad, const char * config) const;
    //void Unpublish(ClassAd & ad) const;
+   void CountJobQuery(const char * client, bool forked, bool threaded, int ads_sent, double runtime);
+   void ExpireJobQueryClients(ClassAd & ad, time_t now); // remove probes of clients that haven't queried within the window
 
    } ScheddStatistics;
 
@@ -61,6 +61,7 @@
 #include "schedd_stats.h"
 #include "condor_holdcodes.h"
 #include "job_transforms.h"
+#include "job_queue_index.h"
 
 extern  int         STARTD_CONTACT_TIMEOUT;
 const	int			NEGOTIATOR_CONTACT_TIMEOUT = 30;
@@ -203,6 +204,7 @@ struct SubmitterData {
   bool isOwnerName; // the name of this submitter record is the same as the name of an owner record.
   bool absentUpdateSent;
   std::set<int> PrioSet; // Set of job priorities, used for JobPrioArray attr
+  std::map<std::string, std::pair<int,int> > FlockedHere; // jobs and weighted jobs running in each flocked pool, by negotiator pool name
   SubmitterData() : LastHitTime(0), FlockLevel(0), OldFlockLevel(0), NegotiationTimestamp(0)
       , lastUpdateTime(0), isOwnerName(false), absentUpdateSent(false)  { }
 };
@@ -258,6 +260,41 @@ struct OwnerInfo {
 
 typedef std::map<std::string, OwnerInfo> OwnerInfoMap;
 
+// Job counts that are kept up to date as jobs change, so that count_jobs doesn't
+// have to walk the job queue.  Used for what a single job adds to the counts, and
+// for the totals of the schedd, of each owner, and of each submitter.
+//
+struct JobCounts {
+  int JobsCounted;
+  int JobsRunning;          // schedd totals of all universes
+  int JobsIdle;
+  int JobsHeld;
+  int JobsRemoved;
+  int UserJobsIdle;         // owner and submitter counts of jobs the schedd services
+  int UserJobsHeld;
+  int WeightedJobsIdle;     // submitter counts only
+  int SchedulerJobsRunning;
+  int SchedulerJobsIdle;
+  int LocalJobsRunning;
+  int LocalJobsIdle;
+  void clear() { memset(this, 0, sizeof(*this)); }
+  void add(const JobCounts & other, int sign);
+  JobCounts() { clear(); }
+};
+
+// What a job adds to the job counts, remembered so that it can be taken back
+// out when the job changes or leaves the queue.  see get_job_counts()
+//
+struct JobCountsEntry {
+  std::string owner;        // the OwnerInfo and SubmitterData the job is counted in
+  std::string submitter;
+  JobCounts num;
+  int JobPrio;              // goes into the submitter's PrioSet when HasPrio
+  bool HasPrio;
+  bool NeedsWalk;           // count_jobs must still look at the job, see count_a_job_extras()
+  JobCountsEntry() : JobPrio(0), HasPrio(false), NeedsWalk(false) {}
+};
+
 
 class match_rec: public ClaimIdParser
 {
@@ -473,6 +510,8 @@ class Scheduler : public Service
 	JobTransforms	jobTransforms;
 	friend	int		NewProc(int cluster_id);
 	friend	int		count_a_job(JobQueueJob*, const JOB_ID_KEY&, void* );
+	friend	bool	get_job_counts(JobQueueJob*, JobCountsEntry&);
+	friend	void	count_a_job_extras(JobQueueJob*);
 //	friend	void	job_prio(ClassAd *);
 	friend  int		find_idle_local_jobs(JobQueueJob *, const JOB_ID_KEY&, void*);
 	friend	int		updateSchedDInterval(JobQueueJob*, const JOB_ID_KEY&, void* );
@@ -494,6 +533,16 @@ class Scheduler : public Service
 	void			addCronTabClusterId( int );
 	void			indexAJob(JobQueueJob* job, bool loading_job_queue=false);
 	void			removeJobFromIndexes(const JOB_ID_KEY& job_id);
+	JobQueueIndex &	jobIndex() { return m_job_index; }
+		// for event driven evaluation of periodic policy, see PeriodicExprHandler()
+	bool			policyDependsOn(const char * attr) const { return m_policy_attrs.count(attr) > 0; }
+	void			policyJobChanged(const JOB_ID_KEY & job_id);
+	void			policyJobEvaluated(const JOB_ID_KEY & job_id, const classad::References * attrs, bool time_dependent, time_t next_change = 0);
+		// for incremental job counts, see count_jobs()
+	bool			incrementalJobCounts() const { return m_incremental_job_counts; }
+	void			jobCountsChanged(const JOB_ID_KEY & job_id);
+	void			jobCountsRemoved(const JOB_ID_KEY & job_id);
+	void			recountJob(JobQueueJob * job);
 	int				RecycleShadow(int cmd, Stream *stream);
 	void			finishRecycleShadow(shadow_rec *srec);
 
@@ -729,6 +778,11 @@ private:
 	Timeslice       SchedDInterval;
 	Timeslice       PeriodicExprInterval;
 	int             periodicid;
+	int             PeriodicExprFullSweepInterval;
+	time_t          m_policy_last_full_sweep;
+	classad::References m_policy_attrs;          // attributes that periodic policy depends on
+	std::set<JOB_ID_KEY> m_policy_dirty_jobs;    // jobs to evaluate at the next PeriodicExprHandler
+	std::map<JOB_ID_KEY, time_t> m_policy_timed_jobs; // jobs whose periodic policy depends on time, and when it can next change (0 for any time)
 	int				QueueCleanInterval;
 	int             RequestClaimTimeout;
 	int				JobStartDelay;
@@ -765,6 +819,23 @@ private:
 	int				LocalUniverseJobsIdle;
 	int				LocalUniverseJobsRunning;
 
+		// job counts kept up to date as jobs change, see count_jobs()
+	bool			m_incremental_job_counts;     // SCHEDD_INCREMENTAL_JOB_COUNTS
+	bool			m_check_job_counts;           // SCHEDD_CHECK_JOB_COUNTS, compare them to a walk of the job queue
+	bool			m_job_counts_valid;           // false until all jobs have been counted
+	std::map<JOB_ID_KEY, JobCountsEntry> m_job_counts; // what each job adds to the counts
+	std::set<JOB_ID_KEY> m_job_counts_dirty;      // jobs to count again at the next count_jobs
+	std::set<JOB_ID_KEY> m_job_counts_walk;       // jobs count_jobs must still look at
+	JobCounts		m_job_counts_total;
+	std::map<std::string, JobCounts> m_owner_job_counts;
+	std::map<std::string, JobCounts> m_submitter_job_counts;
+	std::map<std::string, std::map<int,int> > m_submitter_job_prios; // number of idle jobs of each priority
+	void			addJobCounts(const JobCountsEntry & entry, int sign);
+	void			addJobCountsToTotals(const JobCounts & num);
+	void			updateJobCounts();
+	void			publishJobCounts(time_t now);
+	void			checkJobCounts();
+
 	char*			LocalUnivExecuteDir;
 	int				BadCluster;
 	int				BadProc;
@@ -843,6 +914,9 @@ private:
 	ExprTree* slotWeightOfJob;
 	ClassAd * slotWeightGuessAd;
 	bool			m_use_slot_weights;
+	bool			m_threaded_queries; // answer condor_q on pool threads, see SCHEDD_THREADED_QUERIES
+	bool			m_only_my_jobs;     // CONDOR_Q_ONLY_MY_JOBS
+	JobQueueIndex	m_job_index;        // secondary indexes on the job queue, see SCHEDD_JOB_QUEUE_INDEX_ATTRS
 
 	// utility functions
 	int			count_jobs();
@@ -854,6 +928,7 @@ private:
 	int			history_helper_reaper(int, int);
 	int			command_query_job_ads(int, Stream* stream);
 	int			command_query_job_aggregates(ClassAd & query, Stream* stream);
+	int			query_job_aggregates_shared(bool use_def_autocluster, const char * projection, int result_limit, int return_jobid_limit, classad::ExprTree *constraint, Stream* stream);
 	void   			check_claim_request_timeouts( void );
 	OwnerInfo     * find_ownerinfo(const char*);
 	OwnerInfo     * insert_ownerinfo(const char*);
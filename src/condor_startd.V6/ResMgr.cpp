@@ -38,6 +38,7 @@ ResMgr::ResMgr() : extras_classad( NULL )
 	totals_classad = NULL;
 	config_classad = NULL;
 	up_tid = -1;
+	batch_update_tid = -1;
 	poll_tid = -1;
 	m_cred_sweep_tid = -1;
 
@@ -1060,18 +1061,77 @@ ResMgr::final_update( void )
 
 int
 ResMgr::send_update( int cmd, ClassAd* public_ad, ClassAd* private_ad,
-					 bool nonblock )
+					 bool nonblock, ClassAd* policy_ad )
 {
 		// Increment the resmgr's count of updates.
 	num_updates++;
 		// Actually do the updates, and return the # of updates sent.
-	int res = daemonCore->sendUpdates(cmd, public_ad, private_ad, nonblock);
+	int res = daemonCore->sendUpdates(cmd, public_ad, private_ad, nonblock, policy_ad);
 
+	initial_update_sent();
+
+	return res;
+}
+
+
+void
+ResMgr::queue_batched_update( void )
+{
+	if( batch_update_tid != -1 ) {
+		return;
+	}
+		// Wait three seconds, as Resource::update() does, so that
+		// the slots that change together are sent together.
+	batch_update_tid = daemonCore->Register_Timer( 3,
+						(TimerHandlercpp)&ResMgr::send_batched_update,
+						"send_batched_update",
+						this );
+	if( batch_update_tid < 0 ) {
+		batch_update_tid = -1;
+	}
+}
+
+
+void
+ResMgr::send_batched_update( void )
+{
+	std::vector<ClassAd*> ads;
+
+	batch_update_tid = -1;
+
+	for( int i = 0; i < nresources; i++ ) {
+		resources[i]->publish_for_batch( ads );
+	}
+	if( ads.empty() ) {
+		return;
+	}
+
+	num_updates += (int)ads.size() / 2;
+	int rval = daemonCore->sendUpdates( UPDATE_STARTD_ADS, ads, true );
+	if( rval ) {
+		dprintf( D_FULLDEBUG, "Sent update of %d slot(s) to %d collector(s)\n",
+				 (int)ads.size() / 2, rval );
+	} else {
+		dprintf( D_ALWAYS, "Error sending update of %d slot(s) to collector(s)\n",
+				 (int)ads.size() / 2 );
+	}
+
+	for( size_t i = 0; i < ads.size(); i++ ) {
+		delete ads[i];
+	}
+
+	initial_update_sent();
+}
+
+
+void
+ResMgr::initial_update_sent( void )
+{
 	static bool first_time = true;
 	if (first_time) {
 		first_time = false;
 		dprintf( D_ALWAYS, "Initial update sent to collector(s)\n");
-		if ( ! param_boolean("STARTD_SEND_READY_AFTER_FIRST_UPDATE", true)) return res;
+		if ( ! param_boolean("STARTD_SEND_READY_AFTER_FIRST_UPDATE", true)) return;
 
 		// send a DC_SET_READY message to the master to indicate the STARTD is ready to go
 		std::string master_sinful(daemonCore->InfoCommandSinfulString(-2));
@@ -1086,8 +1146,6 @@ ResMgr::send_update( int cmd, ClassAd* public_ad, ClassAd* private_ad,
 			dmn->sendMsg(msg.get());
 		}
 	}
-
-	return res;
 }
 
 
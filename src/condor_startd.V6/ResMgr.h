@@ -143,7 +143,10 @@ public:
 	int		num_real_cpus( void ) { return m_attr->num_real_cpus(); }
 	int		numSlots( void ) { return nresources; }
 
-	int		send_update( int, ClassAd*, ClassAd*, bool nonblocking );
+	int		send_update( int, ClassAd*, ClassAd*, bool nonblocking,
+						 ClassAd *policy_ad = NULL );
+	void	queue_batched_update( void );
+	void	send_batched_update( void );
 	void	final_update( void );
 	
 		// Evaluate the state of all resources.
@@ -309,6 +312,8 @@ public:
 	void calculateAffinityMask(Resource *rip);
 private:
 
+	void	initial_update_sent( void );
+
 	Resource**	resources;		// Array of pointers to Resource objects
 	int			nresources;		// Size of the array
 
@@ -317,6 +322,7 @@ private:
 
 	int		num_updates;
 	int		up_tid;		// DaemonCore timer id for update timer
+	int		batch_update_tid;	// DaemonCore timer id for batched update
 	int		poll_tid;	// DaemonCore timer id for polling timer
 	int		m_cred_sweep_tid;	// DaemonCore timer id for polling timer
 	time_t	startTime;		// Time that we started
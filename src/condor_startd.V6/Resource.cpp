@@ -331,6 +331,11 @@ Resource::Resource( CpuAttributes* cap, int rid, bool multiple_slots, Resource*
 
 	update_tid = -1;
 
+	r_delta_base_ad = NULL;
+	r_delta_base_id = 0;
+	r_delta_updates = 0;
+	r_batch_update_pending = false;
+
 		// Set ckpt filename for avail stats here, since this object
 		// knows the resource id, and we need to use a different ckpt
 		// file for each resource.
@@ -384,6 +389,9 @@ Resource::~Resource()
 		update_tid = -1;
 	}
 
+	delete r_delta_base_ad;
+	r_delta_base_ad = NULL;
+
 #if HAVE_JOB_HOOKS
 	if (m_next_fetch_work_tid != -1) {
 		if (daemonCore->Cancel_Timer(m_next_fetch_work_tid) < 0 ) {
@@ -1263,6 +1271,14 @@ Resource::update( void )
 	if (r_no_collector_updates)
 		return;
 
+		// If we send the slots together, let the ResMgr send this one
+		// with the others that changed.
+	if( param_boolean( "STARTD_BATCH_COLLECTOR_UPDATES", false ) ) {
+		r_batch_update_pending = true;
+		resmgr->queue_batched_update();
+		return;
+	}
+
 	// If we haven't already queued an update, queue one.  Wait three
 	// seconds before sending an update to allow the startd's state
 	// to quiesce; we'll implicitly coalesce the updates.
@@ -1304,9 +1320,16 @@ Resource::do_update( void )
 #endif
 #endif
 
-		// Send class ads to collector(s)
-	rval = resmgr->send_update( UPDATE_STARTD_AD, &public_ad,
-								&private_ad, true );
+		// Send class ads to collector(s), only the changes to the
+		// public ad if we can
+	ClassAd delta_ad;
+	if ( make_delta_update( public_ad, delta_ad ) ) {
+		rval = resmgr->send_update( UPDATE_STARTD_AD_DELTA, &delta_ad,
+									&private_ad, true, &public_ad );
+	} else {
+		rval = resmgr->send_update( UPDATE_STARTD_AD, &public_ad,
+									&private_ad, true );
+	}
 	if( rval ) {
 		dprintf( D_FULLDEBUG, "Sent update to %d collector(s)\n", rval );
 	} else {
@@ -1318,6 +1341,123 @@ Resource::do_update( void )
 	update_tid = -1;
 }
 
+// Fill in delta_ad with the attributes of public_ad that changed since
+// our last full update, and return true if that is what we should send.
+// Deltas are made against the last full update rather than the last
+// delta, so the collector gets a correct ad from any delta it receives,
+// even if earlier ones were lost.  The collector merges each delta into
+// the ad it has, not into the base, so once an attribute has been sent
+// in a delta it goes in every later one, even if it is back to its base
+// value, and is listed as removed if it is gone.  Every
+// STARTD_DELTA_UPDATE_INTERVAL updates, or when the delta would be
+// large, we send a full update instead and make it the new base.
+bool
+Resource::make_delta_update( ClassAd &public_ad, ClassAd &delta_ad )
+{
+	int interval = param_integer( "STARTD_DELTA_UPDATE_INTERVAL", 0, 0 );
+	if( interval <= 0 ) {
+		delete r_delta_base_ad;
+		r_delta_base_ad = NULL;
+		return false;
+	}
+
+	if( r_delta_base_ad && r_delta_updates < interval ) {
+		int removed = 0;
+		std::string removed_attrs;
+		for( ClassAd::iterator itr = public_ad.begin(); itr != public_ad.end(); itr++ ) {
+			ExprTree *base_tree = r_delta_base_ad->Lookup( itr->first );
+			if( !base_tree || !base_tree->SameAs( itr->second ) ||
+				r_delta_attrs.count( itr->first ) ) {
+				ExprTree *tree = itr->second->Copy();
+				delta_ad.Insert( itr->first, tree );
+			}
+		}
+		for( ClassAd::iterator itr = r_delta_base_ad->begin(); itr != r_delta_base_ad->end(); itr++ ) {
+			if( !public_ad.Lookup( itr->first ) ) {
+				if( removed++ ) { removed_attrs += ","; }
+				removed_attrs += itr->first;
+			}
+		}
+		for( classad::References::iterator itr = r_delta_attrs.begin(); itr != r_delta_attrs.end(); itr++ ) {
+			if( !public_ad.Lookup( *itr ) && !r_delta_base_ad->Lookup( *itr ) ) {
+				if( removed++ ) { removed_attrs += ","; }
+				removed_attrs += *itr;
+			}
+		}
+
+		if( (delta_ad.size() + removed) * 2 < public_ad.size() ) {
+				// the collector needs these to find and check the ad to update
+			const char *key_attrs[] = {
+				ATTR_MY_TYPE, ATTR_TARGET_TYPE, ATTR_NAME, ATTR_MACHINE,
+				ATTR_SLOT_ID, ATTR_MY_ADDRESS, ATTR_STARTD_IP_ADDR,
+				ATTR_DAEMON_START_TIME
+			};
+			for( size_t i = 0; i < sizeof(key_attrs)/sizeof(key_attrs[0]); i++ ) {
+				delta_ad.CopyAttribute( key_attrs[i], &public_ad );
+			}
+			for( ClassAd::iterator itr = delta_ad.begin(); itr != delta_ad.end(); itr++ ) {
+				r_delta_attrs.insert( itr->first );
+			}
+			delta_ad.Assign( ATTR_DELTA_UPDATE_BASE, r_delta_base_id );
+			if( removed ) {
+				delta_ad.Assign( ATTR_DELTA_UPDATE_REMOVED_ATTRS, removed_attrs );
+			}
+			r_delta_updates++;
+			return true;
+		}
+		delta_ad.Clear();
+	}
+
+		// send a full update, and make it the new base
+	r_delta_base_id++;
+	r_delta_updates = 0;
+	r_delta_attrs.clear();
+	delete r_delta_base_ad;
+	r_delta_base_ad = new ClassAd( public_ad );
+	public_ad.Assign( ATTR_DELTA_UPDATE_BASE, r_delta_base_id );
+	return false;
+}
+
+// If this slot is waiting for a batched update, publish it and append
+// its public and private ads to ads.
+void
+Resource::publish_for_batch( std::vector<ClassAd*> &ads )
+{
+	if( ! r_batch_update_pending ) {
+		return;
+	}
+	r_batch_update_pending = false;
+
+	ClassAd *public_ad = new ClassAd;
+	ClassAd *private_ad = new ClassAd;
+	publish_for_update( public_ad, private_ad );
+
+#if defined(WANT_CONTRIB) && defined(WITH_MANAGEMENT)
+#if defined(HAVE_DLOPEN) || defined(WIN32)
+	StartdPluginManager::Update(public_ad, private_ad);
+#endif
+#endif
+
+		// this full update replaces the collector's ad, so a delta
+		// update would have nothing to be applied to
+	delete r_delta_base_ad;
+	r_delta_base_ad = NULL;
+
+	ads.push_back( public_ad );
+	ads.push_back( private_ad );
+}
+
+// The collector couldn't apply one of our deltas, most likely because
+// it restarted or lost our last full update, so drop the base and send
+// the whole ad.
+void
+Resource::full_update( void )
+{
+	delete r_delta_base_ad;
+	r_delta_base_ad = NULL;
+	update();
+}
+
 void
 Resource::publish_for_update ( ClassAd *public_ad ,ClassAd *private_ad )
 {
@@ -1415,6 +1555,11 @@ Resource::update_with_ack( void )
     /* get the public and private ads */
     publish_for_update( &public_ad, &private_ad );
 
+    /* this full update replaces the collector's ad, so the next
+       regular update must be a full one too */
+    delete r_delta_base_ad;
+    r_delta_base_ad = NULL;
+
     if ( !putClassAd ( socket, public_ad ) ) {
 
         dprintf (
@@ -218,6 +218,9 @@ public:
 	void		do_update( void );			// Actually update the CM
     int     update_with_ack( void );    // Actually update the CM and wait for an ACK
     void    publish_for_update ( ClassAd *public_ad ,ClassAd *private_ad );
+	bool	make_delta_update( ClassAd &public_ad, ClassAd &delta_ad );
+	void	full_update( void );	// Schedule a full (not delta) update
+	void	publish_for_batch( std::vector<ClassAd*> &ads );
 	void	final_update( void );		// Send a final update to the CM
 									    // with Requirements = False.
 
@@ -354,6 +357,18 @@ private:
 
 	int			update_tid;	// DaemonCore timer id for update delay
 
+		// The last full update sent to the collector, which delta
+		// updates are made against, how many deltas we've sent since
+		// then, and every attribute any of those deltas carried.
+	ClassAd*	r_delta_base_ad;
+	int			r_delta_base_id;
+	int			r_delta_updates;
+	classad::References r_delta_attrs;
+
+		// true if this slot is waiting for the ResMgr to send a
+		// batched update of all the slots that changed
+	bool		r_batch_update_pending;
+
 	int		r_cpu_busy;
 	time_t	r_cpu_busy_start_time;
 	time_t	r_last_compute_condor_load;
@@ -687,6 +687,12 @@ command_name_handler( Service*, int cmd, Stream* stream )
 			return FALSE;
 		}
 		break;
+	case SEND_FULL_STARTD_UPDATE:
+		rip->dprintf( D_FULLDEBUG,
+					  "Collector asked for a full update\n" );
+		rip->full_update();
+		return TRUE;
+		break;
 	default:
 		EXCEPT( "Unknown command (%d) in command_name_handler", cmd );
 	}
@@ -309,6 +309,9 @@ main_init( int, char* argv[] )
 	daemonCore->Register_Command( PCKPT_JOB, "PCKPT_JOB", 
 								  (CommandHandler)command_name_handler,
 								  "command_name_handler", 0, DAEMON );
+	daemonCore->Register_Command( SEND_FULL_STARTD_UPDATE, "SEND_FULL_STARTD_UPDATE",
+								  (CommandHandler)command_name_handler,
+								  "command_name_handler", 0, DAEMON );
 #if !defined(WIN32)
 	daemonCore->Register_Command( DELEGATE_GSI_CRED_STARTD, "DELEGATE_GSI_CRED_STARTD",
 	                              (CommandHandler)command_delegate_gsi_cred,
@@ -0,0 +1,144 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/* Convert a job queue log between the plain text format and a binary
+   snapshot plus text tail, or just time how long it takes to load.
+   The schedd must not be running while a log is converted.
+*/
+
+#include "condor_common.h"
+#include "condor_config.h"
+#include "condor_debug.h"
+#include "condor_distribution.h"
+#include "classad_collection.h"
+#include "stopwatch.h"
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [-debug] [-binary | -text | -time] <job queue log>\n"
+		"    -binary  rotate the log, writing the jobs to a binary snapshot\n"
+		"    -text    rotate the log, writing the jobs as text records\n"
+		"    -time    load the log without changing it and report how long it took (default)\n",
+		name);
+}
+
+	// Load the log into a private table, so that it isn't rotated, and
+	// report how long that took.
+static int
+time_load(const char *filename)
+{
+	HashTable<HashKey, ClassAd*> table(CLASSAD_LOG_HASHTABLE_SIZE, HashKey::hash);
+	ClassAdLogTable<HashKey, ClassAd*> la(table);
+	unsigned long sequence_number = 0;
+	time_t birthdate = 0;
+	bool is_clean = true, requires_cleaning = false, has_snapshot = false;
+	MyString errmsg;
+
+	Stopwatch load_time;
+	load_time.start();
+	FILE *fp = LoadClassAdLog(filename, la, DefaultMakeClassAdLogTableEntry,
+		sequence_number, birthdate, is_clean, requires_cleaning, has_snapshot, errmsg);
+	double ms = load_time.stop();
+	if ( ! fp) {
+		fprintf(stderr, "%s", errmsg.Value());
+		return 1;
+	}
+	fclose(fp);
+	if ( ! errmsg.empty()) {
+		fprintf(stderr, "%s", errmsg.Value());
+	}
+
+	printf("Loaded %d ads from %s in %.3f seconds (%s, sequence number %lu%s)\n",
+		table.getNumElements(), filename, ms / 1000.0,
+		has_snapshot ? "binary snapshot" : "text", sequence_number,
+		is_clean ? "" : ", needs rotation");
+
+	const char *key;
+	ClassAd *ad;
+	la.startIterations();
+	while (la.nextIteration(key, ad)) {
+		DefaultMakeClassAdLogTableEntry.Delete(ad);
+	}
+	return 0;
+}
+
+	// Rotate the log into the chosen form.  No historical logs are kept
+	// here, whatever SCHEDD's setting, so the old log is replaced and the
+	// snapshot it pointed to, if any, is removed.
+static int
+convert(const char *filename, bool binary)
+{
+	Stopwatch load_time;
+	load_time.start();
+	ClassAdCollection log(NULL, filename);
+	double ms = load_time.stop();
+	printf("Loaded %s in %.3f seconds\n", filename, ms / 1000.0);
+
+	log.SetBinarySnapshots(binary);
+	Stopwatch write_time;
+	write_time.start();
+	if ( ! log.TruncLog()) {
+		fprintf(stderr, "Failed to rotate %s\n", filename);
+		return 1;
+	}
+	ms = write_time.stop();
+	printf("Wrote %s %s in %.3f seconds\n", filename,
+		binary ? "with a binary snapshot" : "as text", ms / 1000.0);
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	myDistro->Init(argc, argv);
+	config();
+
+	const char *filename = NULL;
+	bool binary = false, text = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-binary") == 0) {
+			binary = true;
+		} else if (strcmp(argv[i], "-text") == 0) {
+			text = true;
+		} else if (strcmp(argv[i], "-time") == 0) {
+			binary = text = false;
+		} else if (strcmp(argv[i], "-debug") == 0) {
+			dprintf_set_tool_debug("TOOL", 0);
+		} else if (strcmp(argv[i], "-help") == 0) {
+			usage(argv[0]);
+			exit(0);
+		} else if (argv[i][0] == '-' || filename) {
+			usage(argv[0]);
+			exit(1);
+		} else {
+			filename = argv[i];
+		}
+	}
+	if ( ! filename || (binary && text)) {
+		usage(argv[0]);
+		exit(1);
+	}
+
+	if (binary || text) {
+		return convert(filename, binary);
+	}
+	return time_load(filename);
+}
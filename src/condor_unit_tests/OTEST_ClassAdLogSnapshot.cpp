@@ -0,0 +1,258 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/*
+ Test the binary snapshots written when a ClassAdLog is rotated.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+#include "classad_log.h"
+#include "classad_collection.h"
+
+static bool test_snapshot_round_trip(void);
+static bool test_corrupt_snapshot(void);
+static bool test_rotate_log(void);
+
+bool OTEST_ClassAdLogSnapshot(void) {
+	emit_object("ClassAdLogSnapshot");
+	emit_comment("Ads written to a binary snapshot should load back "
+		"unchanged, and damaged snapshots should be rejected.");
+
+	FunctionDriver driver;
+	driver.register_function(test_snapshot_round_trip);
+	driver.register_function(test_corrupt_snapshot);
+	driver.register_function(test_rotate_log);
+
+	return driver.do_all_functions();
+}
+
+typedef HashTable<HashKey, ClassAd*> SnapshotTable;
+
+static const char *snapshot_log = "OTEST_ClassAdLogSnapshot.log";
+
+static void fill_table(SnapshotTable &table) {
+	ClassAd *ad = new ClassAd();
+	SetMyTypeName(*ad, "Job");
+	SetTargetTypeName(*ad, "Machine");
+	ad->Assign("ClusterId", 1);
+	ad->Assign("ProcId", 0);
+	ad->Assign("Owner", "alice");
+	ad->Assign("ImageSize", 1.5);
+	ad->AssignExpr("Requirements", "TARGET.Memory >= 1024 && OpSys == \"LINUX\"");
+	table.insert(HashKey("1.0"), ad);
+
+	ad = new ClassAd();
+	SetMyTypeName(*ad, "Job");
+	ad->Assign("ClusterId", 1);
+	ad->AssignExpr("Args", "{ \"a\", 1 }");
+	table.insert(HashKey("01.-1"), ad);
+}
+
+static void clear_table(SnapshotTable &table) {
+	HashKey key;
+	ClassAd *ad;
+	table.startIterations();
+	while (table.iterate(key, ad) == 1) {
+		delete ad;
+	}
+	table.clear();
+}
+
+static bool same_ad(SnapshotTable &a, SnapshotTable &b, const char *key) {
+	ClassAd *ad1 = NULL, *ad2 = NULL;
+	if (a.lookup(HashKey(key), ad1) < 0 || b.lookup(HashKey(key), ad2) < 0) {
+		return false;
+	}
+	if (strcmp(GetMyTypeName(*ad1), GetMyTypeName(*ad2)) != 0 ||
+		strcmp(GetTargetTypeName(*ad1), GetTargetTypeName(*ad2)) != 0) {
+		return false;
+	}
+	return ad1->SameAs(ad2);
+}
+
+static bool test_snapshot_round_trip() {
+	emit_test("Test that ads written to a snapshot load back the same.");
+	SnapshotTable written(7, HashKey::hash), loaded(7, HashKey::hash);
+	ClassAdLogTable<HashKey, ClassAd*> wla(written), lla(loaded);
+	fill_table(written);
+
+	MyString errmsg;
+	unsigned long num_written = 0, num_loaded = 0;
+	bool wrote = WriteClassAdLogSnapshot(snapshot_log, 3, wla, num_written, errmsg);
+	bool read = wrote && LoadClassAdLogSnapshot(snapshot_log, 3, lla, DefaultMakeClassAdLogTableEntry, num_loaded, errmsg);
+	bool same = read && num_loaded == 2 &&
+		same_ad(written, loaded, "1.0") && same_ad(written, loaded, "01.-1");
+	emit_input_header();
+	emit_param("Ads", "%lu", num_written);
+	emit_output_expected_header();
+	emit_retval("2 ads, same");
+	emit_output_actual_header();
+	emit_retval("%lu ads, %s %s", num_loaded, same ? "same" : "different", errmsg.Value());
+	RemoveClassAdLogSnapshot(snapshot_log, 3);
+	clear_table(written);
+	clear_table(loaded);
+	if ( ! wrote || ! read || ! same) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_corrupt_snapshot() {
+	emit_test("Test that a snapshot with a flipped byte or a missing "
+		"end is rejected.");
+	SnapshotTable written(7, HashKey::hash), loaded(7, HashKey::hash);
+	ClassAdLogTable<HashKey, ClassAd*> wla(written), lla(loaded);
+	fill_table(written);
+
+	MyString errmsg, name;
+	unsigned long num_ads = 0;
+	bool wrote = WriteClassAdLogSnapshot(snapshot_log, 4, wla, num_ads, errmsg);
+	ClassAdLogSnapshotName(snapshot_log, 4, name);
+
+	bool flipped_rejected = false, truncated_rejected = false;
+	struct stat st;
+	if (wrote && stat(name.Value(), &st) == 0) {
+		int fd = safe_open_wrapper_follow(name.Value(), O_RDWR);
+		char c = 0;
+		if (fd >= 0 && pread(fd, &c, 1, st.st_size / 2) == 1) {
+			c ^= 0x10;
+			if (pwrite(fd, &c, 1, st.st_size / 2) == 1) {
+				flipped_rejected = ! LoadClassAdLogSnapshot(snapshot_log, 4, lla, DefaultMakeClassAdLogTableEntry, num_ads, errmsg);
+				clear_table(loaded);
+				c ^= 0x10;
+				if (pwrite(fd, &c, 1, st.st_size / 2) == 1 && ftruncate(fd, st.st_size - 1) == 0) {
+					truncated_rejected = ! LoadClassAdLogSnapshot(snapshot_log, 4, lla, DefaultMakeClassAdLogTableEntry, num_ads, errmsg);
+					clear_table(loaded);
+				}
+			}
+		}
+		if (fd >= 0) { close(fd); }
+	}
+	emit_input_header();
+	emit_param("Snapshot", "%s", name.Value());
+	emit_output_expected_header();
+	emit_retval("flipped rejected, truncated rejected");
+	emit_output_actual_header();
+	emit_retval("flipped %s, truncated %s",
+		flipped_rejected ? "rejected" : "accepted",
+		truncated_rejected ? "rejected" : "accepted");
+	RemoveClassAdLogSnapshot(snapshot_log, 4);
+	clear_table(written);
+	if ( ! wrote || ! flipped_rejected || ! truncated_rejected) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool snapshot_exists(unsigned long sequence_number) {
+	MyString name;
+	struct stat st;
+	ClassAdLogSnapshotName(snapshot_log, sequence_number, name);
+	return stat(name.Value(), &st) == 0;
+}
+
+	// Load the log the way condor_convert_job_queue_log -time does, and
+	// check that job 1.0 came back with its owner and status.
+static bool load_log(unsigned long &sequence_number, bool &has_snapshot, MyString &errmsg) {
+	SnapshotTable table(7, HashKey::hash);
+	ClassAdLogTable<HashKey, ClassAd*> la(table);
+	time_t birthdate = 0;
+	bool is_clean = true, requires_cleaning = false;
+	FILE *fp = LoadClassAdLog(snapshot_log, la, DefaultMakeClassAdLogTableEntry,
+		sequence_number, birthdate, is_clean, requires_cleaning, has_snapshot, errmsg);
+	if ( ! fp) {
+		return false;
+	}
+	fclose(fp);
+
+	ClassAd *ad = NULL;
+	std::string owner;
+	int status = 0;
+	bool loaded = is_clean && ! requires_cleaning && table.getNumElements() == 1 &&
+		table.lookup(HashKey("1.0"), ad) == 0 &&
+		ad->LookupString("Owner", owner) && owner == "alice" &&
+		ad->LookupInteger("JobStatus", status) && status == 2;
+	clear_table(table);
+	return loaded;
+}
+
+static bool test_rotate_log() {
+	emit_test("Test that a log rotated to a binary snapshot and back to "
+		"text, keeping no historical logs, loads back the same and "
+		"leaves no stale snapshots.");
+	RemoveClassAdLogSnapshot(snapshot_log, 2);
+	RemoveClassAdLogSnapshot(snapshot_log, 3);
+	unlink(snapshot_log);
+
+	MyString errmsg;
+	unsigned long seq_binary = 0, seq_text = 0;
+	bool snapshot_binary = false, snapshot_text = true;
+	bool rotated = false, loaded_binary = false, loaded_text = false;
+	bool kept_snapshot = false, removed_old = false, removed_last = false;
+
+		// what condor_convert_job_queue_log -binary does, then one more
+		// change in the text tail
+	{
+		ClassAdCollection log(NULL, snapshot_log);
+		log.NewClassAd("1.0", "Job", "Machine");
+		log.SetAttribute("1.0", "Owner", "\"alice\"");
+		log.SetAttribute("1.0", "JobStatus", "1");
+		log.SetBinarySnapshots(true);
+		rotated = log.TruncLog();
+		log.SetAttribute("1.0", "JobStatus", "2");
+	}
+	loaded_binary = rotated && load_log(seq_binary, snapshot_binary, errmsg);
+	kept_snapshot = snapshot_exists(seq_binary);
+
+		// rotating a log that has a snapshot writes another one, and
+		// rotating it to text removes the last
+	if (loaded_binary) {
+		ClassAdCollection log(NULL, snapshot_log);
+		rotated = log.TruncLog();
+		removed_old = rotated && ! snapshot_exists(seq_binary) && snapshot_exists(seq_binary + 1);
+		log.SetBinarySnapshots(false);
+		rotated = rotated && log.TruncLog();
+		removed_last = rotated && ! snapshot_exists(seq_binary + 1);
+	}
+	loaded_text = removed_last && load_log(seq_text, snapshot_text, errmsg);
+
+	emit_input_header();
+	emit_param("Log", "%s", snapshot_log);
+	emit_output_expected_header();
+	emit_retval("binary loaded at 2 with snapshot, text loaded at 4 without, no stale snapshots");
+	emit_output_actual_header();
+	emit_retval("binary %s at %lu %s snapshot, text %s at %lu %s snapshot, %s %s",
+		loaded_binary ? "loaded" : "not loaded", seq_binary, snapshot_binary ? "with" : "without",
+		loaded_text ? "loaded" : "not loaded", seq_text, snapshot_text ? "with" : "without",
+		(kept_snapshot && removed_old && removed_last) ? "no stale snapshots" : "stale snapshots",
+		errmsg.Value());
+	RemoveClassAdLogSnapshot(snapshot_log, 2);
+	RemoveClassAdLogSnapshot(snapshot_log, 3);
+	unlink(snapshot_log);
+	if ( ! loaded_binary || ! snapshot_binary || seq_binary != 2 || ! kept_snapshot ||
+		 ! removed_old || ! removed_last ||
+		 ! loaded_text || snapshot_text || seq_text != 4) {
+		FAIL;
+	}
+	PASS;
+}
@@ -0,0 +1,131 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/*
+ Test the background syncer used for group commit of a ClassAdLog.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+#include "classad_log.h"
+
+#if defined(HAVE_PTHREADS) && !defined(WIN32)
+static bool test_request_is_synced(void);
+static bool test_requests_share_sync(void);
+#endif
+
+bool OTEST_ClassAdLogSyncer(void) {
+	emit_object("ClassAdLogSyncer");
+	emit_comment("Tickets handed out by the syncer should become durable "
+		"after a background sync, and each sync should wake the notify fd.");
+
+	FunctionDriver driver;
+#if defined(HAVE_PTHREADS) && !defined(WIN32)
+	driver.register_function(test_request_is_synced);
+	driver.register_function(test_requests_share_sync);
+#endif
+
+	return driver.do_all_functions();
+}
+
+#if defined(HAVE_PTHREADS) && !defined(WIN32)
+
+static bool test_request_is_synced() {
+	emit_test("Test that a requested sync becomes durable and writes "
+		"to the notify pipe.");
+	int fds[2];
+	if (pipe(fds) != 0) {
+		FAIL;
+	}
+	FILE *fp = tmpfile();
+	if ( ! fp) {
+		close(fds[0]);
+		close(fds[1]);
+		FAIL;
+	}
+	fputs("record\n", fp);
+	fflush(fp);
+
+	ClassAdLogSyncer syncer;
+	bool started = syncer.Start(fds[1]);
+	unsigned long ticket = started ? syncer.Request(fileno(fp)) : 0;
+	syncer.Wait();
+	bool durable = ticket != 0 && syncer.Synced() >= ticket && syncer.Error() == 0;
+	char c = 0;
+	bool notified = read(fds[0], &c, 1) == 1;
+	emit_input_header();
+	emit_param("Ticket", "%lu", ticket);
+	emit_output_expected_header();
+	emit_retval("durable, notified");
+	emit_output_actual_header();
+	emit_retval("%s, %s", durable ? "durable" : "not durable",
+		notified ? "notified" : "not notified");
+	fclose(fp);
+	close(fds[0]);
+	close(fds[1]);
+	if( !started || !durable || !notified ) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_requests_share_sync() {
+	emit_test("Test that waiting on the syncer covers every ticket "
+		"requested so far.");
+	int fds[2];
+	if (pipe(fds) != 0) {
+		FAIL;
+	}
+	FILE *fp = tmpfile();
+	if ( ! fp) {
+		close(fds[0]);
+		close(fds[1]);
+		FAIL;
+	}
+
+	ClassAdLogSyncer syncer;
+	bool started = syncer.Start(fds[1]);
+	unsigned long first = 0, last = 0;
+	for (int i = 0; started && i < 10; i++) {
+		fprintf(fp, "record %d\n", i);
+		fflush(fp);
+		last = syncer.Request(fileno(fp));
+		if ( ! first) { first = last; }
+	}
+	syncer.Wait();
+	unsigned long synced = syncer.Synced();
+	emit_input_header();
+	emit_param("Tickets", "%lu to %lu", first, last);
+	emit_output_expected_header();
+	emit_retval("%lu", last);
+	emit_output_actual_header();
+	emit_retval("%lu", synced);
+	fclose(fp);
+	close(fds[0]);
+	close(fds[1]);
+	if( !started || first == 0 || synced != last ) {
+		FAIL;
+	}
+	PASS;
+}
+
+#endif
@@ -0,0 +1,318 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/*
+ Test the epoll mode of the Selector, which keeps fds registered with
+ the kernel from one round to the next.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+#include "selector.h"
+
+#include <algorithm>
+
+#ifdef CONDOR_HAVE_EPOLL
+static bool test_ready(void);
+static bool test_not_ready(void);
+static bool test_ready_again(void);
+static bool test_unwatched_fd(void);
+static bool test_unwatch_other_key(void);
+static bool test_reused_fd(void);
+static bool test_regular_file(void);
+#endif
+
+bool OTEST_Selector(void) {
+	emit_object("Selector");
+	emit_comment("The epoll mode of the Selector should report the same "
+		"ready fds as select() would, keeping the watched fds from one "
+		"round to the next.");
+
+	FunctionDriver driver;
+#ifdef CONDOR_HAVE_EPOLL
+	driver.register_function(test_ready);
+	driver.register_function(test_not_ready);
+	driver.register_function(test_ready_again);
+	driver.register_function(test_unwatched_fd);
+	driver.register_function(test_unwatch_other_key);
+	driver.register_function(test_reused_fd);
+	driver.register_function(test_regular_file);
+#endif
+
+	return driver.do_all_functions();
+}
+
+#ifdef CONDOR_HAVE_EPOLL
+
+	// one round of the selector, as DaemonCore::Driver() does it
+static void poll_fds(Selector &selector)
+{
+	selector.reset();
+	selector.set_timeout(0);
+	selector.execute();
+}
+
+	// true if fd is among the selector's ready fds
+static bool in_ready_fds(Selector &selector, int fd)
+{
+	const std::vector<int> &ready = selector.ready_fds();
+	return std::find(ready.begin(), ready.end(), fd) != ready.end();
+}
+
+static bool test_ready() {
+	emit_test("Test that a watched pipe with data in it is reported readable.");
+	int fds[2];
+	if (pipe(fds) != 0) {
+		FAIL;
+	}
+	Selector selector;
+	bool epoll = selector.use_epoll();
+	ssize_t ignored = write(fds[1], "x", 1);
+	(void)ignored;
+	if (epoll) {
+		selector.watch_fd(fds[0], Selector::IO_READ, 2);
+		poll_fds(selector);
+	}
+	bool ready = epoll && selector.has_ready() &&
+		selector.fd_ready(fds[0], Selector::IO_READ) && in_ready_fds(selector, fds[0]);
+	emit_input_header();
+	emit_param("Pipe", "%d with 1 byte", fds[0]);
+	emit_output_expected_header();
+	emit_retval("true");
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ready));
+	close(fds[0]);
+	close(fds[1]);
+	if(!ready) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_not_ready() {
+	emit_test("Test that an empty pipe is not reported readable.");
+	int fds[2];
+	if (pipe(fds) != 0) {
+		FAIL;
+	}
+	Selector selector;
+	bool epoll = selector.use_epoll();
+	if (epoll) {
+		selector.watch_fd(fds[0], Selector::IO_READ, 2);
+		poll_fds(selector);
+	}
+	bool timed_out = epoll && selector.timed_out() && selector.ready_fds().empty();
+	emit_input_header();
+	emit_param("Pipe", "%d, empty", fds[0]);
+	emit_output_expected_header();
+	emit_retval("timed out");
+	emit_output_actual_header();
+	emit_retval("%s", timed_out ? "timed out" : "ready");
+	close(fds[0]);
+	close(fds[1]);
+	if(!timed_out) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_ready_again() {
+	emit_test("Test that a pipe that is still readable is reported again "
+		"in the next round without being watched again.");
+	int fds[2];
+	if (pipe(fds) != 0) {
+		FAIL;
+	}
+	Selector selector;
+	bool epoll = selector.use_epoll();
+	ssize_t ignored = write(fds[1], "x", 1);
+	(void)ignored;
+	bool first = false, second = false;
+	if (epoll) {
+		selector.watch_fd(fds[0], Selector::IO_READ, 2);
+		poll_fds(selector);
+		first = selector.has_ready();
+		poll_fds(selector);
+		second = selector.has_ready() && selector.fd_ready(fds[0], Selector::IO_READ);
+	}
+	emit_input_header();
+	emit_param("Pipe", "%d with 1 byte, not read", fds[0]);
+	emit_output_expected_header();
+	emit_retval("true, true");
+	emit_output_actual_header();
+	emit_retval("%s, %s", tfstr(first), tfstr(second));
+	close(fds[0]);
+	close(fds[1]);
+	if(!first || !second) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_unwatched_fd() {
+	emit_test("Test that an unwatched fd is no longer reported.");
+	int fds1[2], fds2[2];
+	if (pipe(fds1) != 0) {
+		FAIL;
+	}
+	if (pipe(fds2) != 0) {
+		close(fds1[0]);
+		close(fds1[1]);
+		FAIL;
+	}
+	Selector selector;
+	bool epoll = selector.use_epoll();
+	if (epoll) {
+		selector.watch_fd(fds1[0], Selector::IO_READ, 2);
+		selector.watch_fd(fds2[0], Selector::IO_READ, 3);
+		poll_fds(selector);
+		selector.unwatch_fd(fds1[0], 2);
+	}
+	ssize_t ignored = write(fds1[1], "x", 1);
+	(void)ignored;
+	if (epoll) {
+		poll_fds(selector);
+	}
+	bool timed_out = epoll && selector.timed_out() &&
+		!selector.fd_ready(fds1[0], Selector::IO_READ);
+	emit_input_header();
+	emit_param("Pipes", "%d and %d, then %d only", fds1[0], fds2[0], fds2[0]);
+	emit_output_expected_header();
+	emit_retval("timed out");
+	emit_output_actual_header();
+	emit_retval("%s", timed_out ? "timed out" : "ready");
+	close(fds1[0]);
+	close(fds1[1]);
+	close(fds2[0]);
+	close(fds2[1]);
+	if(!timed_out) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_unwatch_other_key() {
+	emit_test("Test that unwatching an fd with a stale key leaves the "
+		"current watch in place.");
+	int fds[2];
+	if (pipe(fds) != 0) {
+		FAIL;
+	}
+	Selector selector;
+	bool epoll = selector.use_epoll();
+	ssize_t ignored = write(fds[1], "x", 1);
+	(void)ignored;
+	if (epoll) {
+		selector.watch_fd(fds[0], Selector::IO_READ, 2);
+		selector.watch_fd(fds[0], Selector::IO_READ, 3);
+		selector.unwatch_fd(fds[0], 2);
+		poll_fds(selector);
+	}
+	bool ready = epoll && selector.has_ready() &&
+		selector.fd_ready(fds[0], Selector::IO_READ);
+	emit_input_header();
+	emit_param("Pipe", "%d with 1 byte, watched with keys 2 and 3, unwatched with key 2", fds[0]);
+	emit_output_expected_header();
+	emit_retval("true");
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ready));
+	close(fds[0]);
+	close(fds[1]);
+	if(!ready) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_reused_fd() {
+	emit_test("Test that a closed fd whose number is reused with a new key "
+		"is watched again.");
+	int fds[2];
+	if (pipe(fds) != 0) {
+		FAIL;
+	}
+	Selector selector;
+	bool epoll = selector.use_epoll();
+	if (epoll) {
+		selector.watch_fd(fds[0], Selector::IO_READ, 2);
+		poll_fds(selector);
+	}
+	int old_fd = fds[0];
+	close(fds[0]);
+	close(fds[1]);
+	if (pipe(fds) != 0) {
+		FAIL;
+	}
+	ssize_t ignored = write(fds[1], "x", 1);
+	(void)ignored;
+	if (epoll) {
+		selector.watch_fd(fds[0], Selector::IO_READ, 3);
+		poll_fds(selector);
+	}
+	bool ready = epoll && selector.has_ready() &&
+		selector.fd_ready(fds[0], Selector::IO_READ);
+	emit_input_header();
+	emit_param("Pipe", "%d, then %d with 1 byte", old_fd, fds[0]);
+	emit_output_expected_header();
+	emit_retval("true");
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ready));
+	close(fds[0]);
+	close(fds[1]);
+	if(!ready) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_regular_file() {
+	emit_test("Test that a regular file, which epoll won't take, is "
+		"reported ready every round, as select() would.");
+	FILE *fp = tmpfile();
+	if ( ! fp) {
+		FAIL;
+	}
+	int fd = fileno(fp);
+	Selector selector;
+	bool epoll = selector.use_epoll();
+	bool first = false, second = false;
+	if (epoll) {
+		selector.watch_fd(fd, Selector::IO_READ, 2);
+		poll_fds(selector);
+		first = selector.has_ready() && selector.fd_ready(fd, Selector::IO_READ);
+		poll_fds(selector);
+		second = selector.has_ready() && in_ready_fds(selector, fd);
+	}
+	emit_input_header();
+	emit_param("File", "%d", fd);
+	emit_output_expected_header();
+	emit_retval("true, true");
+	emit_output_actual_header();
+	emit_retval("%s, %s", tfstr(first), tfstr(second));
+	fclose(fp);
+	if(!first || !second) {
+		FAIL;
+	}
+	PASS;
+}
+
+#endif
@@ -27,6 +27,7 @@
 #include "unit_test_utils.h"
 #include "emit.h"
 #include "user_job_policy.h"
+#include "compat_classad_util.h"
 
 #ifdef USE_NON_MUTATING_USERPOLICY
   #define POLICY_INIT(ad) policy.Init()
@@ -159,6 +160,20 @@ static bool test_hold_macro_analyze_policy(void);
 static bool test_hold_macro_firing_expression(void);
 static bool test_hold_macro_firing_expression_value(void);
 static bool test_hold_macro_firing_reason(void);
+static bool test_time_dependent_not(void);
+static bool test_time_dependent_time(void);
+static bool test_time_dependent_current_time(void);
+static bool test_next_time_change_greater(void);
+static bool test_next_time_change_reversed(void);
+static bool test_next_time_change_passed(void);
+static bool test_next_time_change_other_use(void);
+#ifdef USE_NON_MUTATING_USERPOLICY
+static bool test_periodic_dependencies_no_time(void);
+static bool test_periodic_dependencies_time_bound(void);
+static bool test_periodic_dependencies_time_passed(void);
+static bool test_periodic_dependencies_any_time(void);
+static bool test_periodic_dependencies_timer_remove(void);
+#endif
 
 //global variables
 static ClassAdParser parser;
@@ -321,6 +336,20 @@ bool OTEST_UserPolicy(void) {
 	driver.register_function(test_hold_macro_firing_expression);
 	driver.register_function(test_hold_macro_firing_expression_value);
 	driver.register_function(test_hold_macro_firing_reason);
+	driver.register_function(test_time_dependent_not);
+	driver.register_function(test_time_dependent_time);
+	driver.register_function(test_time_dependent_current_time);
+	driver.register_function(test_next_time_change_greater);
+	driver.register_function(test_next_time_change_reversed);
+	driver.register_function(test_next_time_change_passed);
+	driver.register_function(test_next_time_change_other_use);
+#ifdef USE_NON_MUTATING_USERPOLICY
+	driver.register_function(test_periodic_dependencies_no_time);
+	driver.register_function(test_periodic_dependencies_time_bound);
+	driver.register_function(test_periodic_dependencies_time_passed);
+	driver.register_function(test_periodic_dependencies_any_time);
+	driver.register_function(test_periodic_dependencies_timer_remove);
+#endif
 	
 	return driver.do_all_functions();
 }
@@ -3329,3 +3358,311 @@ static bool test_hold_macro_firing_reason() {
 	}
 	PASS;
 }
+
+// Returns what ExprTreeIsTimeDependent() says about expr, and whether it
+// added attr to the references.
+static bool time_dependent(const char * expr, const char * attr, bool & has_attr) {
+	classad::ExprTree * tree = NULL;
+	if (ParseClassAdRvalExpr(expr, tree) != 0) {
+		has_attr = false;
+		return false;
+	}
+	classad::References refs;
+	bool ret_val = ExprTreeIsTimeDependent(tree, &refs);
+	has_attr = refs.count(attr) > 0;
+	delete tree;
+	return ret_val;
+}
+
+static bool test_time_dependent_not() {
+	emit_test("Test that ExprTreeIsTimeDependent() returns false for an "
+		"expression that doesn't use the time, and still adds its references.");
+	const char * expr = "NumJobStarts > 3";
+	emit_input_header();
+	emit_param("Expression", "%s", expr);
+	emit_output_expected_header();
+	emit_retval("%s", "false");
+	emit_param("References NumJobStarts", "%s", "true");
+	bool has_attr;
+	bool ret_val = time_dependent(expr, "NumJobStarts", has_attr);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	emit_param("References NumJobStarts", "%s", tfstr(has_attr));
+	if(ret_val || ! has_attr) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_time_dependent_time() {
+	emit_test("Test that ExprTreeIsTimeDependent() returns true for an "
+		"expression that calls time().");
+	const char * expr = "(time() - QDate) > 3600";
+	emit_input_header();
+	emit_param("Expression", "%s", expr);
+	emit_output_expected_header();
+	emit_retval("%s", "true");
+	emit_param("References QDate", "%s", "true");
+	bool has_attr;
+	bool ret_val = time_dependent(expr, "QDate", has_attr);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	emit_param("References QDate", "%s", tfstr(has_attr));
+	if( ! ret_val || ! has_attr) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_time_dependent_current_time() {
+	emit_test("Test that ExprTreeIsTimeDependent() returns true for an "
+		"expression that refers to CurrentTime inside a function call.");
+	const char * expr = "ifThenElse(JobStatus == 5, CurrentTime - EnteredCurrentStatus, 0) > 60";
+	emit_input_header();
+	emit_param("Expression", "%s", expr);
+	emit_output_expected_header();
+	emit_retval("%s", "true");
+	emit_param("References EnteredCurrentStatus", "%s", "true");
+	bool has_attr;
+	bool ret_val = time_dependent(expr, "EnteredCurrentStatus", has_attr);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	emit_param("References EnteredCurrentStatus", "%s", tfstr(has_attr));
+	if( ! ret_val || ! has_attr) {
+		FAIL;
+	}
+	PASS;
+}
+
+// Runs ExprTreeNextTimeChange() on expr against an ad with QDate = 1000,
+// at time now.
+static bool next_time_change(const char * expr, time_t now, time_t & next_change) {
+	classad::ExprTree * tree = NULL;
+	next_change = 0;
+	if (ParseClassAdRvalExpr(expr, tree) != 0) {
+		return false;
+	}
+	compat_classad::ClassAd job;
+	job.Assign(ATTR_Q_DATE, 1000);
+	bool ret_val = ExprTreeNextTimeChange(tree, job, now, next_change);
+	delete tree;
+	return ret_val;
+}
+
+static bool test_next_time_change_greater() {
+	emit_test("Test that ExprTreeNextTimeChange() returns the second after "
+		"the bound for time() - QDate > 60 and the bound itself for >=.");
+	const char * expr1 = "PeriodicHold || time() - QDate > 60";
+	const char * expr2 = "time() - QDate >= 60";
+	emit_input_header();
+	emit_param("Expression", "%s", expr1);
+	emit_param("Expression", "%s", expr2);
+	emit_param("QDate", "%d", 1000);
+	emit_param("Now", "%d", 1010);
+	emit_output_expected_header();
+	emit_retval("%s", "true");
+	emit_param("Next Change", "%d", 1061);
+	emit_param("Next Change", "%d", 1060);
+	time_t next1, next2;
+	bool ret_val1 = next_time_change(expr1, 1010, next1);
+	bool ret_val2 = next_time_change(expr2, 1010, next2);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val1 && ret_val2));
+	emit_param("Next Change", "%d", (int)next1);
+	emit_param("Next Change", "%d", (int)next2);
+	if( ! ret_val1 || ! ret_val2 || next1 != 1061 || next2 != 1060) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_next_time_change_reversed() {
+	emit_test("Test that ExprTreeNextTimeChange() handles the time on the "
+		"right of the comparison, and CurrentTime with no offset.");
+	const char * expr = "(60 < CurrentTime - QDate) && (CurrentTime <= 1030)";
+	emit_input_header();
+	emit_param("Expression", "%s", expr);
+	emit_param("QDate", "%d", 1000);
+	emit_param("Now", "%d", 1010);
+	emit_output_expected_header();
+	emit_retval("%s", "true");
+	emit_param("Next Change", "%d", 1031);
+	time_t next_change;
+	bool ret_val = next_time_change(expr, 1010, next_change);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	emit_param("Next Change", "%d", (int)next_change);
+	if( ! ret_val || next_change != 1031) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_next_time_change_passed() {
+	emit_test("Test that ExprTreeNextTimeChange() returns true and leaves "
+		"next_change at 0 when the comparison can no longer change.");
+	const char * expr = "time() - QDate > 60";
+	emit_input_header();
+	emit_param("Expression", "%s", expr);
+	emit_param("QDate", "%d", 1000);
+	emit_param("Now", "%d", 2000);
+	emit_output_expected_header();
+	emit_retval("%s", "true");
+	emit_param("Next Change", "%d", 0);
+	time_t next_change;
+	bool ret_val = next_time_change(expr, 2000, next_change);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	emit_param("Next Change", "%d", (int)next_change);
+	if( ! ret_val || next_change != 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_next_time_change_other_use() {
+	emit_test("Test that ExprTreeNextTimeChange() returns false for an "
+		"expression that uses the time other than by comparing it to a bound.");
+	const char * expr = "(time() - QDate) % 60 == 0";
+	emit_input_header();
+	emit_param("Expression", "%s", expr);
+	emit_output_expected_header();
+	emit_retval("%s", "false");
+	time_t next_change;
+	bool ret_val = next_time_change(expr, 1010, next_change);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	if(ret_val) {
+		FAIL;
+	}
+	PASS;
+}
+
+#ifdef USE_NON_MUTATING_USERPOLICY
+// Runs PeriodicDependencies() on a job ad made from the given attributes,
+// and says whether attr is one of the dependencies.
+static bool periodic_dependencies(const char * attrs, const char * attr, bool & has_attr, time_t & next_change) {
+	ad = new compat_classad::ClassAd();
+	ad->initFromString(attrs);
+	unparser.Unparse(classad_string, ad);
+	emit_param("ClassAd", "%s", classad_string.c_str());
+	UserPolicy policy;
+	POLICY_INIT(ad);
+	classad::References refs;
+	bool ret_val = policy.PeriodicDependencies(*ad, refs, next_change);
+	has_attr = refs.count(attr) > 0;
+	CLEANUP;
+	return ret_val;
+}
+
+static bool test_periodic_dependencies_no_time() {
+	emit_test("Test that PeriodicDependencies() returns false for a policy "
+		"that doesn't use the time, and follows references through the ad.");
+	emit_input_header();
+	bool has_attr;
+	time_t next_change;
+	bool ret_val = periodic_dependencies(
+		"JobStatus = 1\nPeriodicHold = TooManyStarts\nTooManyStarts = NumJobStarts > 3",
+		"NumJobStarts", has_attr, next_change);
+	emit_output_expected_header();
+	emit_retval("%s", "false");
+	emit_param("Depends on NumJobStarts", "%s", "true");
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	emit_param("Depends on NumJobStarts", "%s", tfstr(has_attr));
+	if(ret_val || ! has_attr) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_periodic_dependencies_time_bound() {
+	emit_test("Test that PeriodicDependencies() returns true and the time "
+		"PeriodicRemove becomes true for time() - EnteredCurrentStatus > 3600.");
+	time_t now = time(NULL);
+	std::string attrs;
+	formatstr(attrs, "JobStatus = 1\nEnteredCurrentStatus = %d\n"
+		"PeriodicRemove = time() - EnteredCurrentStatus > 3600", (int)now);
+	emit_input_header();
+	bool has_attr;
+	time_t next_change;
+	bool ret_val = periodic_dependencies(attrs.c_str(), "EnteredCurrentStatus", has_attr, next_change);
+	emit_output_expected_header();
+	emit_retval("%s", "true");
+	emit_param("Depends on EnteredCurrentStatus", "%s", "true");
+	emit_param("Next Change", "%d", (int)now + 3601);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	emit_param("Depends on EnteredCurrentStatus", "%s", tfstr(has_attr));
+	emit_param("Next Change", "%d", (int)next_change);
+	if( ! ret_val || ! has_attr || next_change != now + 3601) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_periodic_dependencies_time_passed() {
+	emit_test("Test that PeriodicDependencies() returns false once every "
+		"comparison of the time in the policy has passed its bound.");
+	emit_input_header();
+	bool has_attr;
+	time_t next_change;
+	bool ret_val = periodic_dependencies(
+		"JobStatus = 1\nQDate = 1000\nPeriodicRemove = time() - QDate > 3600",
+		"QDate", has_attr, next_change);
+	emit_output_expected_header();
+	emit_retval("%s", "false");
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	if(ret_val) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_periodic_dependencies_any_time() {
+	emit_test("Test that PeriodicDependencies() returns true with no next "
+		"change time for a policy that refers to an attribute that uses the "
+		"time other than in a comparison.");
+	emit_input_header();
+	bool has_attr;
+	time_t next_change = 1;
+	bool ret_val = periodic_dependencies(
+		"JobStatus = 1\nQDate = 1000\nJobAge = time() - QDate\nPeriodicHold = JobAge > 3600",
+		"JobAge", has_attr, next_change);
+	emit_output_expected_header();
+	emit_retval("%s", "true");
+	emit_param("Depends on JobAge", "%s", "true");
+	emit_param("Next Change", "%d", 0);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	emit_param("Depends on JobAge", "%s", tfstr(has_attr));
+	emit_param("Next Change", "%d", (int)next_change);
+	if( ! ret_val || ! has_attr || next_change != 0) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_periodic_dependencies_timer_remove() {
+	emit_test("Test that PeriodicDependencies() returns the second after "
+		"TimerRemove as the next change time.");
+	time_t now = time(NULL);
+	std::string attrs;
+	formatstr(attrs, "JobStatus = 1\nTimerRemove = %d", (int)now + 600);
+	emit_input_header();
+	bool has_attr;
+	time_t next_change;
+	bool ret_val = periodic_dependencies(attrs.c_str(), ATTR_TIMER_REMOVE_CHECK, has_attr, next_change);
+	emit_output_expected_header();
+	emit_retval("%s", "true");
+	emit_param("Next Change", "%d", (int)now + 601);
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(ret_val));
+	emit_param("Next Change", "%d", (int)next_change);
+	if( ! ret_val || next_change != now + 601) {
+		FAIL;
+	}
+	PASS;
+}
+#endif
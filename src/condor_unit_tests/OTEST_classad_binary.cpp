@@ -0,0 +1,284 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/*
+ Test the binary ClassAd encoding.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+#include "classad_binary.h"
+#include "reli_sock.h"
+
+static bool test_literals(void);
+static bool test_expressions(void);
+static bool test_text(void);
+static bool test_dictionary_reuse(void);
+static bool test_dictionary_mismatch(void);
+static bool test_inherited_socket(void);
+
+bool OTEST_classad_binary(void) {
+	emit_object("ClassAdBinaryWriter/ClassAdBinaryReader");
+	emit_comment("The binary ClassAd encoding putClassAd() uses when the "
+		"peer can read it.");
+
+	FunctionDriver driver;
+	driver.register_function(test_literals);
+	driver.register_function(test_expressions);
+	driver.register_function(test_text);
+	driver.register_function(test_dictionary_reuse);
+	driver.register_function(test_dictionary_mismatch);
+	driver.register_function(test_inherited_socket);
+
+	return driver.do_all_functions();
+}
+
+	// An ad unparsed one attribute at a time, in name order, since the
+	// order an ad iterates in depends on how it was built
+static std::string
+unparse_sorted(classad::ClassAd *ad)
+{
+	classad::ClassAdUnParser unparser;
+	std::map<std::string, std::string> attrs;
+	for( classad::ClassAd::iterator itr = ad->begin(); itr != ad->end(); itr++ ) {
+		unparser.Unparse(attrs[itr->first], itr->second);
+	}
+	std::string result;
+	for( std::map<std::string, std::string>::iterator itr = attrs.begin();
+		 itr != attrs.end(); itr++ ) {
+		result += itr->first + " = " + itr->second + "; ";
+	}
+	return result;
+}
+
+	// Encode the attributes of the given ad with one set of dictionaries,
+	// decode them with another and return the decoded ad unparsed.  Sets
+	// size to the length of the encoded ad.
+static bool
+round_trip(const char *text, ClassAdBinaryNames &send_names,
+		   ClassAdBinaryNames &recv_names, std::string &result, size_t &size)
+{
+	classad::ClassAdParser parser;
+	classad::ClassAd *in = parser.ParseClassAd(text);
+	if( !in ) {
+		return false;
+	}
+
+	ClassAdBinaryWriter writer(send_names);
+	for( classad::ClassAd::iterator itr = in->begin(); itr != in->end(); itr++ ) {
+		if( !writer.Put(itr->first, itr->second) ) {
+			delete in;
+			return false;
+		}
+	}
+	delete in;
+
+	std::string data;
+	writer.GetHeader(data);
+	data += writer.Body();
+	size = data.size();
+
+	ClassAdBinaryReader reader(recv_names, data.c_str(), data.size());
+	int count = 0;
+	if( !reader.Begin(count) ) {
+		return false;
+	}
+	classad::ClassAd out;
+	for( int i = 0; i < count; i++ ) {
+		std::string attr, rhs;
+		classad::ExprTree *tree = NULL;
+		if( !reader.Get(attr, tree, rhs) || !tree ) {
+			return false;
+		}
+		out.Insert(attr, tree);
+	}
+	if( !reader.AtEnd() ) {
+		return false;
+	}
+
+	result = unparse_sorted(&out);
+	return true;
+}
+
+	// The ad as the text encoding would deliver it
+static std::string
+unparsed(const char *text)
+{
+	classad::ClassAdParser parser;
+	std::string result;
+	classad::ClassAd *ad = parser.ParseClassAd(text);
+	if( ad ) {
+		result = unparse_sorted(ad);
+		delete ad;
+	}
+	return result;
+}
+
+static bool
+check_round_trip(const char *text)
+{
+	ClassAdBinaryNames send_names, recv_names;
+	std::string expected = unparsed(text);
+	std::string actual;
+	size_t size = 0;
+	bool ok = round_trip(text, send_names, recv_names, actual, size);
+	emit_input_header();
+	emit_param("ClassAd", "%s", text);
+	emit_output_expected_header();
+	emit_retval("%s", expected.c_str());
+	emit_output_actual_header();
+	emit_retval("%s", ok ? actual.c_str() : "(decode failed)");
+	return ok && !expected.empty() && actual == expected;
+}
+
+static bool test_literals() {
+	emit_test("Test that literals of every type survive encoding.");
+	if( !check_round_trip("[ I = 42; N = -7; Big = 9223372036854775807; "
+			"R = 3.25; S = \"a \\\"quoted\\\" string\"; B = true; F = false; "
+			"U = undefined; E = error; A = absTime(\"2017-01-02T03:04:05-06:00\"); "
+			"T = relTime(\"1+02:03:04\"); K = 2K; M = 3G ]") ) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_expressions() {
+	emit_test("Test that operators, attribute references, function calls, "
+		"lists and nested ads survive encoding.");
+	if( !check_round_trip("[ Requirements = (TARGET.Memory >= 1024 * 2) && "
+			"(MY.Arch == \"X86_64\" || -x < 3) ? !isUndefined(y) : z[1]; "
+			"Rank = strcat(\"a\", Name, string(2.5)) =?= .Name; "
+			"L = { 1, \"two\", { 3.0 }, [ b = a + 1 ] }; "
+			"Sel = [ x = 1 ].x; P = ((1 + 2)) ]") ) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_text() {
+	emit_test("Test that attributes appended as text are handed back as "
+		"text for the receiver to parse.");
+	ClassAdBinaryNames send_names, recv_names;
+	ClassAdBinaryWriter writer(send_names);
+	writer.PutText("MyAddress", "\"<127.0.0.1:9618>\"");
+
+	std::string data;
+	writer.GetHeader(data);
+	data += writer.Body();
+
+	ClassAdBinaryReader reader(recv_names, data.c_str(), data.size());
+	int count = 0;
+	std::string attr, rhs;
+	classad::ExprTree *tree = NULL;
+	bool ok = reader.Begin(count) && count == 1 &&
+		reader.Get(attr, tree, rhs) && reader.AtEnd();
+	emit_input_header();
+	emit_param("Attribute", "MyAddress");
+	emit_param("Text", "\"<127.0.0.1:9618>\"");
+	emit_output_expected_header();
+	emit_retval("MyAddress = \"<127.0.0.1:9618>\"");
+	emit_output_actual_header();
+	emit_retval("%s = %s", attr.c_str(), rhs.c_str());
+	delete tree;
+	if( !ok || tree || attr != "MyAddress" || rhs != "\"<127.0.0.1:9618>\"" ) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_dictionary_reuse() {
+	emit_test("Test that a second ad on the same connection refers to the "
+		"names of the first by index, and so is smaller.");
+	const char *text = "[ SomeLongAttributeName = 1; AnotherLongAttributeName = 2; "
+		"Requirements = SomeLongAttributeName > AnotherLongAttributeName ]";
+	ClassAdBinaryNames send_names, recv_names;
+	std::string first, second;
+	size_t first_size = 0, second_size = 0;
+	bool ok = round_trip(text, send_names, recv_names, first, first_size) &&
+		round_trip(text, send_names, recv_names, second, second_size);
+	emit_input_header();
+	emit_param("ClassAd", "%s", text);
+	emit_output_expected_header();
+	emit_retval("second ad smaller than the first, both decoded alike");
+	emit_output_actual_header();
+	emit_retval("%d bytes, then %d bytes", (int)first_size, (int)second_size);
+	if( !ok || second_size >= first_size || first != second ||
+		first != unparsed(text) ) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_dictionary_mismatch() {
+	emit_test("Test that an ad referring to names the receiver never saw "
+		"is rejected.");
+	const char *text = "[ SomeAttribute = 1; OtherAttribute = SomeAttribute ]";
+	ClassAdBinaryNames send_names, recv_names, fresh_names;
+	std::string result;
+	size_t size = 0;
+	bool first = round_trip(text, send_names, recv_names, result, size);
+	bool second = round_trip(text, send_names, fresh_names, result, size);
+	emit_input_header();
+	emit_param("ClassAd", "%s", text);
+	emit_output_expected_header();
+	emit_retval("first decoded, second rejected");
+	emit_output_actual_header();
+	emit_retval("first %s, second %s", first ? "decoded" : "rejected",
+		second ? "decoded" : "rejected");
+	if( !first || second ) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_inherited_socket() {
+	emit_test("Test that a socket handed to another process starts its "
+		"dictionaries over, and that an ad decodes there once the sender "
+		"starts its side over too.");
+	const char *text = "[ SomeAttribute = 1; OtherAttribute = SomeAttribute ]";
+	ReliSock sender, receiver;
+	std::string result;
+	size_t size = 0;
+	bool first = round_trip(text, *ClassAdBinaryNames::ForStream(&sender),
+		*ClassAdBinaryNames::ForStream(&receiver), result, size);
+
+		// the copy goes through serialize(), as inheritance does
+	ReliSock inherited(receiver);
+	bool stale = round_trip(text, *ClassAdBinaryNames::ForStream(&sender),
+		*ClassAdBinaryNames::ForStream(&inherited), result, size);
+
+	sender.set_classad_state(NULL);
+	bool second = round_trip(text, *ClassAdBinaryNames::ForStream(&sender),
+		*ClassAdBinaryNames::ForStream(&inherited), result, size);
+	emit_input_header();
+	emit_param("ClassAd", "%s", text);
+	emit_output_expected_header();
+	emit_retval("first decoded, stale rejected, second decoded");
+	emit_output_actual_header();
+	emit_retval("first %s, stale %s, second %s",
+		first ? "decoded" : "rejected", stale ? "decoded" : "rejected",
+		second ? "decoded" : "rejected");
+	if( !first || stale || !second || result != unparsed(text) ) {
+		FAIL;
+	}
+	PASS;
+}
@@ -0,0 +1,149 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/*
+ Test the param_cached<T> implementation.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "function_test_driver.h"
+#include "unit_test_utils.h"
+#include "emit.h"
+#include "param_cached.h"
+
+static bool test_bool_default(void);
+static bool test_bool_configured(void);
+static bool test_bool_reconfig(void);
+static bool test_int_range(void);
+static bool test_double_reconfig(void);
+
+bool OTEST_param_cached(void) {
+	emit_object("param_cached<T>");
+	emit_comment("A handle on a config knob that only looks the value up "
+		"again when the configuration has changed since the last lookup.");
+
+	FunctionDriver driver;
+	driver.register_function(test_bool_default);
+	driver.register_function(test_bool_configured);
+	driver.register_function(test_bool_reconfig);
+	driver.register_function(test_int_range);
+	driver.register_function(test_double_reconfig);
+
+	return driver.do_all_functions();
+}
+
+static bool test_bool_default() {
+	emit_test("Test that a param_cached<bool> for an unset knob has the "
+		"default value.");
+	param_cached<bool> knob("OTEST_PARAM_CACHED_UNSET", true);
+	bool value = knob;
+	emit_input_header();
+	emit_param("Name", "%s", knob.name());
+	emit_param("Default", "true");
+	emit_output_expected_header();
+	emit_retval("true");
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(value));
+	if(!value) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_bool_configured() {
+	emit_test("Test that a param_cached<bool> has the configured value.");
+	param_insert("OTEST_PARAM_CACHED_BOOL", "false");
+	param_cached<bool> knob("OTEST_PARAM_CACHED_BOOL", true);
+	bool value = knob;
+	emit_input_header();
+	emit_param("Name", "%s", knob.name());
+	emit_param("Config", "false");
+	emit_output_expected_header();
+	emit_retval("false");
+	emit_output_actual_header();
+	emit_retval("%s", tfstr(value));
+	if(value) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_bool_reconfig() {
+	emit_test("Test that a param_cached<bool> sees a change to the "
+		"configuration made after it was first read.");
+	param_insert("OTEST_PARAM_CACHED_RECONFIG", "false");
+	param_cached<bool> knob("OTEST_PARAM_CACHED_RECONFIG", false);
+	bool before = knob;
+	param_insert("OTEST_PARAM_CACHED_RECONFIG", "true");
+	bool after = knob;
+	emit_input_header();
+	emit_param("Name", "%s", knob.name());
+	emit_param("Config", "false, then true");
+	emit_output_expected_header();
+	emit_retval("false, then true");
+	emit_output_actual_header();
+	emit_retval("%s, then %s", tfstr(before), tfstr(after));
+	if(before || !after) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_int_range() {
+	emit_test("Test that a param_cached<int> clamps the configured value "
+		"to its range.");
+	param_insert("OTEST_PARAM_CACHED_INT", "100");
+	param_cached<int> knob("OTEST_PARAM_CACHED_INT", 1, 0, 10);
+	int value = knob;
+	emit_input_header();
+	emit_param("Name", "%s", knob.name());
+	emit_param("Config", "100");
+	emit_param("Range", "0 - 10");
+	emit_output_expected_header();
+	emit_retval("%d", 10);
+	emit_output_actual_header();
+	emit_retval("%d", value);
+	if(value != 10) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_double_reconfig() {
+	emit_test("Test that a param_cached<double> sees a change to the "
+		"configuration made after it was first read.");
+	param_insert("OTEST_PARAM_CACHED_DOUBLE", "1.5");
+	param_cached<double> knob("OTEST_PARAM_CACHED_DOUBLE", 0.0);
+	double before = knob;
+	param_insert("OTEST_PARAM_CACHED_DOUBLE", "2.5");
+	double after = knob;
+	emit_input_header();
+	emit_param("Name", "%s", knob.name());
+	emit_param("Config", "1.5, then 2.5");
+	emit_output_expected_header();
+	emit_retval("1.5, then 2.5");
+	emit_output_actual_header();
+	emit_retval("%g, then %g", before, after);
+	if(before != 1.5 || after != 2.5) {
+		FAIL;
+	}
+	PASS;
+}
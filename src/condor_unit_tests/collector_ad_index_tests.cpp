@@ -0,0 +1,128 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+#include "compat_classad_util.h"
+
+#include "collector_ad_index.h"
+
+int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static ClassAd *
+make_slot_ad(const char * name, const char * state, int memory)
+{
+	ClassAd * ad = new ClassAd();
+	ad->Assign(ATTR_NAME, name);
+	ad->Assign(ATTR_STATE, state);
+	ad->Assign(ATTR_MEMORY, memory);
+	return ad;
+}
+
+	// The number of candidates the index gives for constraint, or -1
+	// if it can't narrow it down.
+static int
+count_candidates(CollectorAdIndex & index, const char * constraint)
+{
+	classad::ExprTree * tree = NULL;
+	if (ParseClassAdRvalExpr(constraint, tree) != 0 || ! tree) {
+		fprintf(stderr, "Can't parse %s\n", constraint);
+		++fail_count;
+		return -1;
+	}
+	std::vector<ClassAd *> ads;
+	int count = index.Candidates(tree, ads) ? (int)ads.size() : -1;
+	delete tree;
+	return count;
+}
+
+static void
+test_lookup(CollectorAdIndex & index)
+{
+	REQUIRE( count_candidates(index, "State == \"Unclaimed\"") == 2 );
+	REQUIRE( count_candidates(index, "State == \"UNCLAIMED\"") == 2 );
+	REQUIRE( count_candidates(index, "MY.State == \"Claimed\"") == 1 );
+	REQUIRE( count_candidates(index, "Memory >= 2048") == 2 );
+	REQUIRE( count_candidates(index, "State == \"Unclaimed\" && Memory > 2048") == 1 );
+	REQUIRE( count_candidates(index, "State != \"Claimed\"") == -1 );
+	REQUIRE( count_candidates(index, "Name == \"slot1@a\"") == -1 );
+}
+
+	// an ad changed in place, as the offline plugin does after an
+	// update, is found under its new values once it is updated
+static void
+test_update(CollectorAdIndex & index, ClassAd * slot1, ClassAd * slot2)
+{
+	slot1->Assign(ATTR_STATE, "Claimed");
+	REQUIRE( index.Update(slot1) );
+	REQUIRE( count_candidates(index, "State == \"Unclaimed\"") == 1 );
+	REQUIRE( count_candidates(index, "State == \"Claimed\"") == 2 );
+
+		// an ad the index doesn't have is left out of it
+	ClassAd * other = make_slot_ad("slot9@a", "Unclaimed", 512);
+	REQUIRE( ! index.Update(other) );
+	REQUIRE( count_candidates(index, "State == \"Unclaimed\"") == 1 );
+	delete other;
+
+		// an ad changed in place can still be removed
+	slot2->Assign(ATTR_MEMORY, 8192);
+	index.Remove(slot2);
+	REQUIRE( count_candidates(index, "Memory >= 2048") == 1 );
+	REQUIRE( count_candidates(index, "State == \"Claimed\"") == 1 );
+	REQUIRE( ! index.Update(slot2) );
+}
+
+int
+main( int /*argc*/, char ** /*argv*/ )
+{
+	CollectorAdIndex index;
+	std::vector<std::string> attrs;
+	attrs.push_back(ATTR_STATE);
+	attrs.push_back(ATTR_MEMORY);
+	REQUIRE( index.setAttributes(attrs) );
+	REQUIRE( ! index.setAttributes(attrs) );
+	REQUIRE( index.indexes("state") );
+
+	ClassAd * slot1 = make_slot_ad("slot1@a", "Unclaimed", 1024);
+	ClassAd * slot2 = make_slot_ad("slot2@a", "Claimed", 2048);
+	ClassAd * slot3 = make_slot_ad("slot3@a", "Unclaimed", 4096);
+	index.Insert(slot1);
+	index.Insert(slot2);
+	index.Insert(slot3);
+
+	test_lookup(index);
+	test_update(index, slot1, slot2);
+
+	delete slot1;
+	delete slot2;
+	delete slot3;
+
+	if( fail_count > 0 ) {
+		fprintf( stderr, "FAILED %d checks\n", fail_count );
+		return 1;
+	}
+	return 0;
+}
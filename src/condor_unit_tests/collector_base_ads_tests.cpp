@@ -0,0 +1,161 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+
+#include "collector_base_ads.h"
+
+int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static ClassAd *
+make_slot_ad(const char * name, const char * opsys, int memory)
+{
+	ClassAd * ad = new ClassAd();
+	ad->Assign(ATTR_NAME, name);
+	ad->Assign(ATTR_MACHINE, "machine.example.org");
+	ad->Assign(ATTR_SLOT_TYPE, "Static");
+	ad->Assign(ATTR_OPSYS, opsys);
+	ad->Assign(ATTR_ARCH, "X86_64");
+	ad->Assign(ATTR_MEMORY, memory);
+	ad->Assign(ATTR_CPUS, 1);
+	return ad;
+}
+
+static void
+insert_ad(CollectorHashTable & table, ClassAd * ad)
+{
+	AdNameHashKey hk;
+	ad->LookupString(ATTR_NAME, hk.name);
+	table.insert(hk, ad);
+}
+
+static void
+remove_ad(CollectorHashTable & table, ClassAd * ad)
+{
+	AdNameHashKey hk;
+	ad->LookupString(ATTR_NAME, hk.name);
+	table.remove(hk);
+}
+
+	// the slots of a machine share a base, and still look complete
+static void
+test_share(CollectorBaseAds & bases, ClassAd * slot1, ClassAd * slot2)
+{
+	bases.Share(slot1);
+	bases.Share(slot2);
+	REQUIRE( bases.NumBaseAds() == 1 );
+	REQUIRE( slot1->GetChainedParentAd() != NULL );
+	REQUIRE( slot2->GetChainedParentAd() == slot1->GetChainedParentAd() );
+
+		// only the attributes that differ from the base are its own
+	REQUIRE( slot2->size() == 3 );
+	std::string opsys;
+	REQUIRE( slot2->LookupString(ATTR_OPSYS, opsys) && opsys == "LINUX" );
+	int memory = 0;
+	REQUIRE( slot2->LookupInteger(ATTR_MEMORY, memory) && memory == 2048 );
+}
+
+	// an attribute deleted from an unshared ad is gone, rather than
+	// hidden behind an UNDEFINED value
+static void
+test_unshare(CollectorBaseAds & bases, ClassAd * slot2)
+{
+	bases.Unshare(slot2);
+	REQUIRE( slot2->GetChainedParentAd() == NULL );
+	REQUIRE( slot2->size() == 8 );
+
+	slot2->Delete(ATTR_ARCH);
+	REQUIRE( slot2->Lookup(ATTR_ARCH) == NULL );
+	REQUIRE( slot2->size() == 7 );
+	std::string opsys;
+	REQUIRE( slot2->LookupString(ATTR_OPSYS, opsys) && opsys == "LINUX" );
+
+		// unsharing an ad that isn't chained does nothing
+	bases.Unshare(slot2);
+	REQUIRE( slot2->size() == 7 );
+}
+
+	// a retired base is kept while a held ad still uses it
+static void
+test_collect(CollectorBaseAds & bases, CollectorHashTable & table, ClassAd * slot1)
+{
+	const classad::ClassAd * old_base = slot1->GetChainedParentAd();
+
+		// this ad doesn't fit the base, so it replaces it
+	ClassAd * slot3 = make_slot_ad("slot3@machine.example.org", "WINDOWS", 4096);
+	slot3->Delete(ATTR_CPUS);
+	bases.Share(slot3);
+	REQUIRE( slot3->GetChainedParentAd() != NULL );
+	REQUIRE( slot3->GetChainedParentAd() != old_base );
+	REQUIRE( bases.NumBaseAds() == 2 );
+	insert_ad(table, slot3);
+
+		// slot1 left the table, but a query still has it
+	remove_ad(table, slot1);
+	std::vector<ClassAd *> held;
+	held.push_back(slot1);
+	bases.Collect(table, held);
+	REQUIRE( bases.NumBaseAds() == 2 );
+	std::string arch;
+	REQUIRE( slot1->LookupString(ATTR_ARCH, arch) && arch == "X86_64" );
+
+		// once nothing holds it, it goes
+	delete slot1;
+	held.clear();
+	bases.Collect(table, held);
+	REQUIRE( bases.NumBaseAds() == 1 );
+}
+
+int
+main( int /*argc*/, char ** /*argv*/ )
+{
+	CollectorHashTable table(&adNameHashFunction);
+	CollectorBaseAds bases;
+	bases.setEnabled(true);
+
+	ClassAd * slot1 = make_slot_ad("slot1@machine.example.org", "LINUX", 1024);
+	ClassAd * slot2 = make_slot_ad("slot2@machine.example.org", "LINUX", 2048);
+	slot2->Assign(ATTR_STATE, "Claimed");
+	insert_ad(table, slot1);
+	insert_ad(table, slot2);
+
+	test_share(bases, slot1, slot2);
+	test_unshare(bases, slot2);
+	test_collect(bases, table, slot1);
+
+	ClassAd * ad;
+	table.startIterations();
+	while (table.iterate(ad)) {
+		delete ad;
+	}
+
+	if( fail_count > 0 ) {
+		fprintf( stderr, "FAILED %d checks\n", fail_count );
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,205 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+#include "compat_classad_util.h"
+
+#include "job_queue_index.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+// the job ads the index is built from, by job id
+static std::map<JOB_ID_KEY, classad::ClassAd *> job_ads;
+
+static void
+add_job(JobQueueIndex & index, int cluster, int proc, const char * attrs)
+{
+	classad::ClassAdParser parser;
+	std::string text = "[ ";
+	text += attrs;
+	text += " ]";
+	classad::ClassAd * ad = parser.ParseClassAd(text);
+	REQUIRE( ad != NULL );
+	if ( ! ad) {
+		return;
+	}
+	ad->InsertAttr(ATTR_CLUSTER_ID, cluster);
+	ad->InsertAttr(ATTR_PROC_ID, proc);
+
+	JOB_ID_KEY jid(cluster, proc);
+	delete job_ads[jid];
+	job_ads[jid] = ad;
+	index.AddJob(jid, *ad);
+}
+
+// The jobs for which the constraint is true, found by evaluating it
+// against every job.
+static std::vector<JOB_ID_KEY>
+matching_jobs(classad::ExprTree * constraint)
+{
+	std::vector<JOB_ID_KEY> matches;
+	std::map<JOB_ID_KEY, classad::ClassAd *>::iterator it;
+	for (it = job_ads.begin(); it != job_ads.end(); ++it) {
+		classad::Value val;
+		bool result = false;
+		if (it->second->EvaluateExpr(constraint, val) && val.IsBooleanValue(result) && result) {
+			matches.push_back(it->first);
+		}
+	}
+	return matches;
+}
+
+// Check that the index narrows the constraint down to exactly the
+// expected number of candidates, and that every job that matches is one
+// of them.
+static void
+check_candidates(JobQueueIndex & index, const char * constraint, int expected)
+{
+	classad::ExprTree * tree = NULL;
+	REQUIRE( ParseClassAdRvalExpr(constraint, tree) == 0 );
+	if ( ! tree) {
+		return;
+	}
+
+	std::vector<JOB_ID_KEY> candidates;
+	bool narrowed = index.GetCandidates(tree, candidates);
+	if (expected < 0) {
+		if (narrowed) {
+			fprintf(stderr, "Constraint %s was narrowed, but shouldn't be\n", constraint);
+			++fail_count;
+		}
+	} else if ( ! narrowed || (int)candidates.size() != expected) {
+		fprintf(stderr, "Constraint %s: expected %d candidates, got %d%s\n", constraint,
+			expected, (int)candidates.size(), narrowed ? "" : " (not narrowed)");
+		++fail_count;
+	}
+
+	std::vector<JOB_ID_KEY> matches = matching_jobs(tree);
+	for (size_t ix = 0; narrowed && ix < matches.size(); ++ix) {
+		if ( ! std::binary_search(candidates.begin(), candidates.end(), matches[ix])) {
+			fprintf(stderr, "Constraint %s matches job %d.%d, which isn't a candidate\n",
+				constraint, matches[ix].cluster, matches[ix].proc);
+			++fail_count;
+		}
+	}
+	delete tree;
+}
+
+static void
+test_attribute_values(JobQueueIndex & index)
+{
+	check_candidates(index, "Owner == \"alice\"", 4);
+	check_candidates(index, "Owner == \"ALICE\"", 4);
+	check_candidates(index, "Owner =?= \"alice\"", 4);
+	check_candidates(index, "\"bob\" == Owner", 2);
+	check_candidates(index, "JobStatus == 2", 2);
+	check_candidates(index, "JobStatus == 2.0", 2);
+	check_candidates(index, "Owner == \"alice\" && JobStatus == 1", 2);
+	check_candidates(index, "Owner == \"bob\" || JobStatus == 2", 3);
+	check_candidates(index, "Owner != \"alice\"", -1);
+}
+
+static void
+test_undefined_values(JobQueueIndex & index)
+{
+		// jobs 3.0 and 3.1 have no Owner and an undefined Owner,
+		// and job 2.1 has an Owner that isn't a literal
+	check_candidates(index, "Owner =?= UNDEFINED", 3);
+	check_candidates(index, "UNDEFINED =?= Owner", 3);
+	check_candidates(index, "Owner == UNDEFINED", 0);
+	check_candidates(index, "Owner =?= ERROR", -1);
+	check_candidates(index, "Owner == ERROR", -1);
+	check_candidates(index, "Owner =?= UNDEFINED || Owner == \"bob\"", 4);
+}
+
+static void
+test_clusters(JobQueueIndex & index)
+{
+	std::vector<JOB_ID_KEY> procs;
+	index.GetClusterProcs(1, procs);
+	REQUIRE( procs.size() == 3 );
+	REQUIRE( procs.size() == 3 && procs[0] == JOB_ID_KEY(1, 0) && procs[2] == JOB_ID_KEY(1, 2) );
+
+	check_candidates(index, "ClusterId == 2", 2);
+	check_candidates(index, "ClusterId == 1 || ClusterId == 3", 5);
+	check_candidates(index, "ClusterId == 9", 0);
+	check_candidates(index, "ClusterId =?= UNDEFINED", 0);
+}
+
+static void
+test_remove_and_update(JobQueueIndex & index)
+{
+	index.RemoveJob(JOB_ID_KEY(3, 0));
+	delete job_ads[JOB_ID_KEY(3, 0)];
+	job_ads.erase(JOB_ID_KEY(3, 0));
+	check_candidates(index, "Owner =?= UNDEFINED", 2);
+	check_candidates(index, "ClusterId == 3", 1);
+
+		// the job that had an undefined Owner gets one
+	add_job(index, 3, 1, "Owner = \"carol\"; JobStatus = 1");
+	check_candidates(index, "Owner =?= UNDEFINED", 1);
+	check_candidates(index, "Owner == \"carol\"", 2);
+	REQUIRE( index.NumJobs() == 6 );
+
+	index.Clear();
+	REQUIRE( index.NumJobs() == 0 );
+	check_candidates(index, "Owner =?= UNDEFINED", 0);
+}
+
+int
+main( int /*argc*/, char ** /*argv*/ )
+{
+	JobQueueIndex index;
+	add_job(index, 1, 0, "Owner = \"alice\"; JobStatus = 1");
+	add_job(index, 1, 1, "Owner = \"Alice\"; JobStatus = 2");
+	add_job(index, 1, 2, "Owner = \"alice\"; JobStatus = 1.0");
+	add_job(index, 2, 0, "Owner = \"bob\"; JobStatus = 2");
+	add_job(index, 2, 1, "Owner = strcat(\"b\", \"ob\"); JobStatus = 5");
+	add_job(index, 3, 0, "JobStatus = 1");
+	add_job(index, 3, 1, "Owner = undefined; JobStatus = 1");
+	REQUIRE( index.NumJobs() == 7 );
+
+	test_attribute_values(index);
+	test_undefined_values(index);
+	test_clusters(index);
+	test_remove_and_update(index);
+
+	std::map<JOB_ID_KEY, classad::ClassAd *>::iterator it;
+	for (it = job_ads.begin(); it != job_ads.end(); ++it) {
+		delete it->second;
+	}
+
+	if( fail_count > 0 ) {
+		fprintf( stderr, "FAILED %d checks\n", fail_count );
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,138 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/* Time the knob reads of a synthetic negotiation cycle, once with
+   param_boolean() and param_integer() and once with param_cached<T>.
+   Each request reads ALLOW_PSLOT_PREEMPTION and NEGOTIATOR_NUM_THREADS,
+   as matchmakingAlgorithm() does, and each candidate machine reads
+   ALLOW_PSLOT_PREEMPTION and CLAIM_RECYCLING_CONSIDER_LIMITS, as the
+   per-candidate and claim-reuse checks did before they were cached.
+
+   This only reports timings; it is not a pass/fail test.
+*/
+
+#include "condor_common.h"
+#include "condor_config.h"
+#include "condor_debug.h"
+#include "condor_distribution.h"
+#include "param_cached.h"
+#include "utc_time.h"
+
+static void
+usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [-requests <n>] [-candidates <n>]\n"
+		"    -requests    resource requests in the cycle (default 10000)\n"
+		"    -candidates  machines considered for each request (default 1000)\n",
+		name);
+}
+
+	// Run the cycle with a param lookup for every read.  Returns the
+	// number of reads that came back true, so none can be optimized out.
+static long
+cycle_param(int requests, int candidates)
+{
+	long count = 0;
+	for (int r = 0; r < requests; r++) {
+		bool allow_pslot_preemption = param_boolean("ALLOW_PSLOT_PREEMPTION", false);
+		int num_threads = param_integer("NEGOTIATOR_NUM_THREADS", 1);
+		count += allow_pslot_preemption + num_threads;
+		for (int c = 0; c < candidates; c++) {
+			if (param_boolean("ALLOW_PSLOT_PREEMPTION", false)) {
+				count++;
+			}
+			if (param_boolean("CLAIM_RECYCLING_CONSIDER_LIMITS", true)) {
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+	// The same cycle, reading the knobs through param_cached handles.
+static long
+cycle_cached(int requests, int candidates)
+{
+	static param_cached<bool> allow_pslot_preemption_knob("ALLOW_PSLOT_PREEMPTION", false);
+	static param_cached<int> num_threads_knob("NEGOTIATOR_NUM_THREADS", 1);
+	static param_cached<bool> consider_limits("CLAIM_RECYCLING_CONSIDER_LIMITS", true);
+
+	long count = 0;
+	for (int r = 0; r < requests; r++) {
+		bool allow_pslot_preemption = allow_pslot_preemption_knob;
+		int num_threads = num_threads_knob;
+		count += allow_pslot_preemption + num_threads;
+		for (int c = 0; c < candidates; c++) {
+			if (allow_pslot_preemption_knob) {
+				count++;
+			}
+			if (consider_limits) {
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int requests = 10000, candidates = 1000;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-requests") == 0 && i + 1 < argc) {
+			requests = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-candidates") == 0 && i + 1 < argc) {
+			candidates = atoi(argv[++i]);
+		} else {
+			usage(argv[0]);
+			exit(strcmp(argv[i], "-help") == 0 ? 0 : 1);
+		}
+	}
+	if (requests <= 0 || candidates <= 0) {
+		usage(argv[0]);
+		exit(1);
+	}
+
+	myDistro->Init(argc, argv);
+	config_ex(CONFIG_OPT_NO_EXIT);
+
+	double start = UtcTime::getTimeDouble();
+	long count_param = cycle_param(requests, candidates);
+	double param_time = UtcTime::getTimeDouble() - start;
+
+	start = UtcTime::getTimeDouble();
+	long count_cached = cycle_cached(requests, candidates);
+	double cached_time = UtcTime::getTimeDouble() - start;
+
+	long long reads = (long long)requests * (2 + 2 * (long long)candidates);
+	printf("%d requests x %d candidates, %lld knob reads\n", requests, candidates, reads);
+	printf("    param_boolean()/param_integer(): %.3f seconds, %.1f ns per read\n",
+		param_time, param_time * 1e9 / reads);
+	printf("    param_cached<T>:                 %.3f seconds, %.1f ns per read\n",
+		cached_time, cached_time * 1e9 / reads);
+	if (cached_time > 0) {
+		printf("    speedup: %.1fx\n", param_time / cached_time);
+	}
+	if (count_param != count_cached) {
+		printf("    WARNING: the two cycles read different values (%ld != %ld)\n",
+			count_param, count_cached);
+	}
+	return 0;
+}
@@ -0,0 +1,232 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+#include "proc.h"
+
+#include "runnable_jobs.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+// a small, repeatable source of priorities, so that many jobs tie
+static unsigned int rand_state = 12345;
+static int
+pick(int choices)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return (rand_state >> 16) % choices;
+}
+
+// a pre or post priority that is unset a third of the time
+static int
+pick_prio()
+{
+	int val = pick(3);
+	return val ? val : INT_MIN;
+}
+
+static std::vector<JOB_ID_KEY>
+owner_jobs(const RunnableJobLists & lists, const char * owner)
+{
+	std::vector<JOB_ID_KEY> ids;
+	const RunnableJobLists::JobList * jobs = lists.OwnerJobs(owner);
+	if (jobs) {
+		RunnableJobLists::JobList::const_iterator it;
+		for (it = jobs->begin(); it != jobs->end(); ++it) {
+			ids.push_back(it->id);
+		}
+	}
+	return ids;
+}
+
+// prio_compar skips a pre or post priority that is unset in either job, so
+// it only orders two jobs the way the lists do when each of those priorities
+// is either set in both or unset in both.  Mixing them, it isn't even
+// transitive.
+static bool
+same_prios_set(const prio_rec & a, const prio_rec & b)
+{
+	return (a.pre_job_prio1 == INT_MIN) == (b.pre_job_prio1 == INT_MIN) &&
+		(a.pre_job_prio2 == INT_MIN) == (b.pre_job_prio2 == INT_MIN) &&
+		(a.post_job_prio1 == INT_MIN) == (b.post_job_prio1 == INT_MIN) &&
+		(a.post_job_prio2 == INT_MIN) == (b.post_job_prio2 == INT_MIN);
+}
+
+// Each owner's list must never put a job before one that prio_compar says
+// should come first, wherever prio_compar gives the two jobs a strict order.
+static void
+test_order()
+{
+	RunnableJobLists lists;
+	std::map<JOB_ID_KEY, prio_rec> recs;
+	const char * owners[] = { "alice", "bob" };
+	for (int cluster = 1; cluster <= 20; ++cluster) {
+		for (int proc = 0; proc < 10; ++proc) {
+			prio_rec rec;
+			rec.id.cluster = cluster;
+			rec.id.proc = proc;
+			rec.pre_job_prio1 = pick_prio();
+			rec.pre_job_prio2 = pick_prio();
+			rec.job_prio = pick(3);
+			rec.post_job_prio1 = pick_prio();
+			rec.post_job_prio2 = pick_prio();
+			rec.qdate = 1000 + pick(4);
+			strcpy(rec.owner, owners[pick(2)]);
+			recs[JOB_ID_KEY(rec.id)] = rec;
+			lists.Insert(rec);
+		}
+	}
+	REQUIRE( lists.NumJobs() == recs.size() );
+
+	size_t listed = 0, compared = 0;
+	for (size_t ix = 0; ix < sizeof(owners)/sizeof(owners[0]); ++ix) {
+		std::vector<JOB_ID_KEY> ids = owner_jobs(lists, owners[ix]);
+		listed += ids.size();
+		for (size_t a = 0; a < ids.size(); ++a) {
+			REQUIRE( strcmp(recs[ids[a]].owner, owners[ix]) == 0 );
+			for (size_t b = a + 1; b < ids.size(); ++b) {
+				if ( ! same_prios_set(recs[ids[a]], recs[ids[b]])) {
+					continue;
+				}
+				++compared;
+				if (prio_compar(&recs[ids[a]], &recs[ids[b]]) >= 0) {
+					fprintf(stderr, "Job %d.%d is listed before %d.%d, but prio_compar puts it after\n",
+						ids[a].cluster, ids[a].proc, ids[b].cluster, ids[b].proc);
+					++fail_count;
+				}
+			}
+		}
+	}
+	REQUIRE( listed == recs.size() );
+	REQUIRE( compared > 0 );
+
+		// raising a job's priority moves it to the front of its list,
+		// and leaves it there only once
+	prio_rec rec = recs[JOB_ID_KEY(1, 0)];
+	rec.pre_job_prio1 = 100;
+	lists.Insert(rec);
+	std::vector<JOB_ID_KEY> ids = owner_jobs(lists, rec.owner);
+	REQUIRE( lists.NumJobs() == recs.size() );
+	REQUIRE( ! ids.empty() && ids[0] == JOB_ID_KEY(1, 0) );
+	REQUIRE( std::count(ids.begin(), ids.end(), JOB_ID_KEY(1, 0)) == 1 );
+}
+
+// Put a job in its owner's list, or take it out, as the schedd does when
+// one of its attributes changes.
+static void
+update_job(RunnableJobLists & lists, ClassAd & ad, int cluster, int proc)
+{
+	JOB_ID_KEY jid(cluster, proc);
+	prio_rec rec;
+	int cur_hosts = 0;
+	if (GetJobPrioRec(&ad, jid, rec, cur_hosts)) {
+		lists.Insert(rec);
+	} else {
+		lists.Remove(jid);
+	}
+}
+
+// Changes to a job, or to its cluster ad, move it within its owner's list,
+// into another owner's list, or out of the lists.
+static void
+test_membership()
+{
+	RunnableJobLists lists;
+	ClassAd cluster_ad;
+	cluster_ad.Assign(ATTR_OWNER, "alice");
+	cluster_ad.Assign(ATTR_JOB_PRIO, 0);
+	cluster_ad.Assign(ATTR_Q_DATE, 1000);
+	ClassAd procs[3];
+	for (int proc = 0; proc < 3; ++proc) {
+		procs[proc].Assign(ATTR_PROC_ID, proc);
+		procs[proc].Assign(ATTR_JOB_STATUS, IDLE);
+		procs[proc].ChainToAd(&cluster_ad);
+		update_job(lists, procs[proc], 1, proc);
+	}
+	std::vector<JOB_ID_KEY> ids = owner_jobs(lists, "alice");
+	REQUIRE( ids.size() == 3 );
+	REQUIRE( ids.size() == 3 && ids[0] == JOB_ID_KEY(1, 0) && ids[2] == JOB_ID_KEY(1, 2) );
+
+		// held jobs leave the list, and come back when released
+	procs[1].Assign(ATTR_JOB_STATUS, HELD);
+	update_job(lists, procs[1], 1, 1);
+	REQUIRE( ! lists.Contains(JOB_ID_KEY(1, 1)) );
+	REQUIRE( owner_jobs(lists, "alice").size() == 2 );
+	procs[1].Assign(ATTR_JOB_STATUS, IDLE);
+	update_job(lists, procs[1], 1, 1);
+	REQUIRE( lists.Contains(JOB_ID_KEY(1, 1)) );
+
+		// raising a job's priority moves it to the front
+	procs[2].Assign(ATTR_JOB_PRIO, 10);
+	update_job(lists, procs[2], 1, 2);
+	ids = owner_jobs(lists, "alice");
+	REQUIRE( ids.size() == 3 && ids[0] == JOB_ID_KEY(1, 2) );
+
+		// a cluster ad change moves the jobs that don't override it
+	cluster_ad.Assign(ATTR_JOB_PRIO, 20);
+	for (int proc = 0; proc < 3; ++proc) {
+		update_job(lists, procs[proc], 1, proc);
+	}
+	ids = owner_jobs(lists, "alice");
+	REQUIRE( ids.size() == 3 && ids[0] == JOB_ID_KEY(1, 0) && ids[2] == JOB_ID_KEY(1, 2) );
+
+		// and can move them all to another owner's list
+	cluster_ad.Assign(ATTR_ACCOUNTING_GROUP, "group_a.alice");
+	for (int proc = 0; proc < 3; ++proc) {
+		update_job(lists, procs[proc], 1, proc);
+	}
+	REQUIRE( lists.OwnerJobs("alice") == NULL );
+	REQUIRE( owner_jobs(lists, "group_a.alice").size() == 3 );
+
+		// a running job has all the hosts it wants
+	procs[0].Assign(ATTR_JOB_STATUS, RUNNING);
+	update_job(lists, procs[0], 1, 0);
+	REQUIRE( ! lists.Contains(JOB_ID_KEY(1, 0)) );
+	REQUIRE( lists.NumJobs() == 2 );
+
+	lists.Remove(JOB_ID_KEY(1, 1));
+	lists.Remove(JOB_ID_KEY(1, 2));
+	REQUIRE( lists.OwnerJobs("group_a.alice") == NULL );
+	REQUIRE( lists.NumJobs() == 0 );
+}
+
+int
+main( int /*argc*/, char ** /*argv*/ )
+{
+	test_order();
+	test_membership();
+
+	if( fail_count > 0 ) {
+		fprintf( stderr, "FAILED %d checks\n", fail_count );
+		return 1;
+	}
+	return 0;
+}
@@ -63,6 +63,11 @@ bool OTEST_Directory(void);
 bool OTEST_TmpDir(void);
 bool OTEST_StatInfo(void);
 bool OTEST_condor_sockaddr();
+bool OTEST_param_cached(void);
+bool OTEST_classad_binary(void);
+bool OTEST_Selector(void);
+bool OTEST_ClassAdLogSyncer(void);
+bool OTEST_ClassAdLogSnapshot(void);
 
 	// function map that maps testing function names to testing functions
 const static struct {
@@ -98,6 +103,11 @@ const static struct {
 	map(OTEST_TmpDir),
 	map(OTEST_StatInfo),
 	map(OTEST_condor_sockaddr),
+	map(OTEST_param_cached),
+	map(OTEST_classad_binary),
+	map(OTEST_Selector),
+	map(OTEST_ClassAdLogSyncer),
+	map(OTEST_ClassAdLogSnapshot),
 };
 int function_map_num_elems = sizeof(function_map) / sizeof(function_map[0]);
 
@@ -24,7 +24,6 @@
 Regex::Regex()
 {
 	this->options = 0;
-	this->re = NULL;
 }
 
 
@@ -44,9 +43,9 @@ Regex::Regex()
 
 
 Regex::Regex(const Regex & copy)
+	: re(copy.re)
 {
 	this->options = copy.options;
-	re = clone_re(copy.re);
 }
 
 
@@ -55,11 +54,7 @@ Regex::operator = (const Regex & copy)
 {
 	if (this != &copy) {
 		this->options = copy.options;
-
-		if (re) {
-			pcre_free(re); re = NULL;
-		}
-		re = clone_re(copy.re);
+		re = copy.re;
 	}
 
 	return *this;
@@ -68,9 +63,6 @@ Regex::operator = (const Regex & copy)
 
 Regex::~Regex()
 {
-	if (re) {
-		pcre_free(re); re = NULL;
-	}
 }
 
 
@@ -80,9 +72,7 @@ Regex::compile(const MyString & pattern,
 			   int * erroffset,
 			   int options_param)
 {
-	re = pcre_compile(pattern.Value(), options_param, errptr, erroffset, NULL);
-
-	return (NULL != re);
+	return re.Compile(pattern.Value(), options_param, errptr, erroffset);
 }
 
 
@@ -94,23 +84,19 @@ Regex::match(const MyString & string,
 		return false;
 	}
 
-	int group_count;
-	pcre_fullinfo(re, NULL, PCRE_INFO_CAPTURECOUNT, &group_count);
-	int oveccount = 3 * (group_count + 1); // +1 for the string itself
+	int oveccount = 3 * (re.CaptureCount() + 1); // +1 for the string itself
 	int * ovector = (int *) malloc(oveccount * sizeof(int));
 	if (!ovector) {
 			// XXX: EXCEPTing sucks
 		EXCEPT("No memory to allocate data for re match");
 	}
 
-	int rc = pcre_exec(re,
-					   NULL,
-					   string.Value(),
-					   string.Length(),
-					   0, // Index in string from which to start matching
-					   options,
-					   ovector,
-					   oveccount);
+	int rc = re.Exec(string.Value(),
+					 string.Length(),
+					 0, // Index in string from which to start matching
+					 options,
+					 ovector,
+					 oveccount);
 
 	if (NULL != groups) {
 		for (int i = 0; i < rc; i++) {
@@ -131,36 +117,11 @@ Regex::match(const MyString & string,
 bool
 Regex::isInitialized( )
 {
-	return ( this->re != NULL );
+	return re.IsCompiled();
 }
 
 size_t
 Regex::mem_used()
 {
-	if ( ! re) return 0;
-
-	size_t size = 0;
-	pcre_fullinfo(re, NULL, PCRE_INFO_SIZE, &size);
-	return size;
-}
-
-pcre *
-Regex::clone_re(pcre * re)
-{
-	if (!re) {
-		return NULL;
-	}
-
-	size_t size = 0;
-	pcre_fullinfo(re, NULL, PCRE_INFO_SIZE, &size);
-
-	pcre * newre = (pcre *) pcre_malloc(size * sizeof(char));
-	if (!newre) {
-			// XXX: EXCEPTing sucks
-		EXCEPT("No memory to allocate re clone");
-	}
-
-	memcpy(newre, re, size);
-
-	return newre;
+	return re.MemUsed();
 }
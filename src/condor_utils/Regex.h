@@ -28,6 +28,7 @@
 #else
 #  include "pcre.h"
 #endif
+#include "classad/regexCache.h"
 
 //Regex NULLRegex;
 
@@ -93,10 +94,10 @@ public:
 
 private:
 
-	pcre * re;
+		// compiled patterns are shared through the ClassAd regex
+		// cache, so copies of a Regex share one compiled pattern
+	classad::CachedRegex re;
 	int options;
-
-	static pcre * clone_re(pcre * re);
 };
 
 
@@ -0,0 +1,747 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#include "condor_common.h"
+#include "classad_binary.h"
+#include "classad/classadCache.h"
+
+using namespace classad;
+
+	// Node tags.  These are part of the wire protocol: don't renumber
+	// them.  Operators are sent as their Operation::OpKind, so that
+	// enum mustn't be reordered either.
+enum {
+	BIN_UNDEFINED = 1,
+	BIN_ERROR = 2,
+	BIN_TRUE = 3,
+	BIN_FALSE = 4,
+	BIN_INTEGER = 5,		// zigzag varint
+	BIN_REAL = 6,			// IEEE double, little endian
+	BIN_STRING = 7,			// varint length, bytes
+	BIN_ABSTIME = 8,		// zigzag seconds, zigzag offset
+	BIN_RELTIME = 9,		// IEEE double
+	BIN_FACTOR = 10,		// factor byte, then the numeric literal
+	BIN_ATTR = 11,			// name
+	BIN_ATTR_ABSOLUTE = 12,	// name (.name)
+	BIN_ATTR_SCOPED = 13,	// name, scope expression (expr.name)
+	BIN_OP = 14,			// OpKind byte, then one to three operands
+	BIN_FN = 15,			// name, varint count, arguments
+	BIN_CLASSAD = 16,		// varint count, (name, expression) pairs
+	BIN_LIST = 17,			// varint count, expressions
+	BIN_TEXT = 18			// varint length, old ClassAd expression string
+};
+
+	// header flags
+static const unsigned int BIN_FLAG_RESET = 0x01;
+
+	// Start the dictionary over rather than let it grow past this.
+static const size_t MAX_DICTIONARY_NAMES = 65536;
+
+	// Deeper expressions than this are sent as text.
+static const int MAX_DEPTH = 500;
+
+static void
+put_unsigned(std::string &buf, unsigned long long n)
+{
+	while (n >= 0x80) {
+		buf += (char)((n & 0x7f) | 0x80);
+		n >>= 7;
+	}
+	buf += (char)n;
+}
+
+static void
+put_signed(std::string &buf, long long n)
+{
+		// zigzag, so small negative numbers are short too
+	put_unsigned(buf, ((unsigned long long)n << 1) ^ (unsigned long long)(n >> 63));
+}
+
+static void
+put_double(std::string &buf, double d)
+{
+	unsigned long long bits;
+	memcpy(&bits, &d, sizeof(bits));
+	for (int ix = 0; ix < 8; ++ix) {
+		buf += (char)(bits & 0xff);
+		bits >>= 8;
+	}
+}
+
+static void
+put_bytes(std::string &buf, const char *data, size_t len)
+{
+	put_unsigned(buf, len);
+	buf.append(data, len);
+}
+
+ClassAdBinaryNames::ClassAdBinaryNames() :
+	m_send_reset(true)
+{
+}
+
+ClassAdBinaryNames::~ClassAdBinaryNames()
+{
+}
+
+ClassAdBinaryNames *
+ClassAdBinaryNames::ForStream(Stream *sock)
+{
+	if ( ! sock || sock->type() != Stream::reli_sock) {
+		return NULL;
+	}
+	ClassAdBinaryNames *names = dynamic_cast<ClassAdBinaryNames*>(sock->get_classad_state());
+	if ( ! names) {
+		names = new ClassAdBinaryNames;
+		sock->set_classad_state(names);
+	}
+	return names;
+}
+
+void
+ClassAdBinaryNames::Reset()
+{
+	m_sent.clear();
+	m_send_reset = true;
+	m_received.clear();
+}
+
+//
+// ClassAdBinaryWriter
+//
+
+ClassAdBinaryWriter::ClassAdBinaryWriter(ClassAdBinaryNames &names) :
+	m_names(names),
+	m_count(0)
+{
+	if (m_names.m_sent.size() >= MAX_DICTIONARY_NAMES) {
+		m_names.m_sent.clear();
+		m_names.m_send_reset = true;
+	}
+	m_reset = m_names.m_send_reset;
+	m_names.m_send_reset = false;
+	m_base = (unsigned int)m_names.m_sent.size();
+	m_body.reserve(1024);
+}
+
+void
+ClassAdBinaryWriter::GetHeader(std::string &header) const
+{
+	header.clear();
+	put_unsigned(header, m_reset ? BIN_FLAG_RESET : 0);
+	put_unsigned(header, m_base);
+	put_unsigned(header, m_count);
+}
+
+bool
+ClassAdBinaryWriter::Put(const std::string &attr, const ExprTree *tree)
+{
+	size_t mark = m_body.size();
+	m_new_names.clear();
+
+	PutName(attr);
+	if ( ! PutTree(tree, 0)) {
+		m_body.resize(mark);
+		for (size_t ix = 0; ix < m_new_names.size(); ++ix) {
+			m_names.m_sent.erase(m_new_names[ix]);
+		}
+		m_new_names.clear();
+		return false;
+	}
+	m_count++;
+	return true;
+}
+
+void
+ClassAdBinaryWriter::PutText(const std::string &attr, const std::string &rhs)
+{
+	PutName(attr);
+	m_body += (char)BIN_TEXT;
+	put_bytes(m_body, rhs.data(), rhs.size());
+	m_count++;
+}
+
+	// A name already in the dictionary is sent as its index plus one;
+	// a new one as 0 followed by the name, and it gets the next index.
+void
+ClassAdBinaryWriter::PutName(const std::string &name)
+{
+	std::map<std::string, unsigned int>::iterator it = m_names.m_sent.find(name);
+	if (it != m_names.m_sent.end()) {
+		put_unsigned(m_body, it->second + 1);
+		return;
+	}
+	unsigned int index = (unsigned int)m_names.m_sent.size();
+	m_names.m_sent.insert(std::make_pair(name, index));
+	m_new_names.push_back(name);
+	put_unsigned(m_body, 0);
+	put_bytes(m_body, name.data(), name.size());
+}
+
+bool
+ClassAdBinaryWriter::PutValue(const Value &val)
+{
+	switch (val.GetType()) {
+	case Value::UNDEFINED_VALUE:
+		m_body += (char)BIN_UNDEFINED;
+		return true;
+	case Value::ERROR_VALUE:
+		m_body += (char)BIN_ERROR;
+		return true;
+	case Value::BOOLEAN_VALUE: {
+		bool b = false;
+		val.IsBooleanValue(b);
+		m_body += (char)(b ? BIN_TRUE : BIN_FALSE);
+		return true;
+	}
+	case Value::INTEGER_VALUE: {
+		long long i = 0;
+		val.IsIntegerValue(i);
+		m_body += (char)BIN_INTEGER;
+		put_signed(m_body, i);
+		return true;
+	}
+	case Value::REAL_VALUE: {
+		double d = 0;
+		val.IsRealValue(d);
+		m_body += (char)BIN_REAL;
+		put_double(m_body, d);
+		return true;
+	}
+	case Value::STRING_VALUE: {
+		const char *str = NULL;
+		int len = 0;
+		val.IsStringValue(str);
+		val.IsStringValue(len);
+		m_body += (char)BIN_STRING;
+		put_bytes(m_body, str, len);
+		return true;
+	}
+	case Value::ABSOLUTE_TIME_VALUE: {
+		abstime_t t;
+		val.IsAbsoluteTimeValue(t);
+		m_body += (char)BIN_ABSTIME;
+		put_signed(m_body, t.secs);
+		put_signed(m_body, t.offset);
+		return true;
+	}
+	case Value::RELATIVE_TIME_VALUE: {
+		double secs = 0;
+		val.IsRelativeTimeValue(secs);
+		m_body += (char)BIN_RELTIME;
+		put_double(m_body, secs);
+		return true;
+	}
+	default:
+			// lists and ads only turn up in literals built by hand
+		return false;
+	}
+}
+
+bool
+ClassAdBinaryWriter::PutTree(const ExprTree *tree, int depth)
+{
+	if ( ! tree || depth > MAX_DEPTH) {
+		return false;
+	}
+
+	switch (tree->GetKind()) {
+	case ExprTree::LITERAL_NODE: {
+		Value val;
+		Value::NumberFactor factor;
+		((const Literal*)tree)->GetComponents(val, factor);
+		if (factor != Value::NO_FACTOR && (val.IsIntegerValue() || val.IsRealValue())) {
+			m_body += (char)BIN_FACTOR;
+			m_body += (char)factor;
+		}
+		return PutValue(val);
+	}
+
+	case ExprTree::ATTRREF_NODE: {
+		ExprTree *scope = NULL;
+		std::string name;
+		bool absolute = false;
+		((const AttributeReference*)tree)->GetComponents(scope, name, absolute);
+		if (scope) {
+			m_body += (char)BIN_ATTR_SCOPED;
+			PutName(name);
+			return PutTree(scope, depth + 1);
+		}
+		m_body += (char)(absolute ? BIN_ATTR_ABSOLUTE : BIN_ATTR);
+		PutName(name);
+		return true;
+	}
+
+	case ExprTree::OP_NODE: {
+		Operation::OpKind op;
+		ExprTree *t1 = NULL, *t2 = NULL, *t3 = NULL;
+		((const Operation*)tree)->GetComponents(op, t1, t2, t3);
+		if (op < Operation::__FIRST_OP__ || op > Operation::__LAST_OP__) {
+			return false;
+		}
+		m_body += (char)BIN_OP;
+		m_body += (char)op;
+		if ( ! PutTree(t1, depth + 1)) {
+			return false;
+		}
+		if (op == Operation::PARENTHESES_OP || op == Operation::UNARY_PLUS_OP ||
+			op == Operation::UNARY_MINUS_OP || op == Operation::LOGICAL_NOT_OP ||
+			op == Operation::BITWISE_NOT_OP)
+		{
+			return true;
+		}
+		if ( ! PutTree(t2, depth + 1)) {
+			return false;
+		}
+		if (op == Operation::TERNARY_OP) {
+			return PutTree(t3, depth + 1);
+		}
+		return true;
+	}
+
+	case ExprTree::FN_CALL_NODE: {
+		std::string name;
+		std::vector<ExprTree*> args;
+		((const FunctionCall*)tree)->GetComponents(name, args);
+		m_body += (char)BIN_FN;
+		PutName(name);
+		put_unsigned(m_body, args.size());
+		for (size_t ix = 0; ix < args.size(); ++ix) {
+			if ( ! PutTree(args[ix], depth + 1)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	case ExprTree::CLASSAD_NODE: {
+		const ClassAd *ad = (const ClassAd*)tree;
+		m_body += (char)BIN_CLASSAD;
+		put_unsigned(m_body, ad->size());
+		for (ClassAd::const_iterator it = ad->begin(); it != ad->end(); ++it) {
+			PutName(it->first);
+			if ( ! PutTree(it->second, depth + 1)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	case ExprTree::EXPR_LIST_NODE: {
+		const ExprList *list = (const ExprList*)tree;
+		m_body += (char)BIN_LIST;
+		put_unsigned(m_body, list->size());
+		for (ExprList::const_iterator it = list->begin(); it != list->end(); ++it) {
+			if ( ! PutTree(*it, depth + 1)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	case ExprTree::EXPR_ENVELOPE:
+		return PutTree(((const CachedExprEnvelope*)tree)->get(), depth);
+
+	default:
+		return false;
+	}
+}
+
+//
+// ClassAdBinaryReader
+//
+
+ClassAdBinaryReader::ClassAdBinaryReader(ClassAdBinaryNames &names, const char *data, size_t len) :
+	m_names(names),
+	m_data(data),
+	m_len(len),
+	m_pos(0)
+{
+}
+
+bool
+ClassAdBinaryReader::Begin(int &count)
+{
+	unsigned long long flags, base, n;
+	if ( ! GetUnsigned(flags) || ! GetUnsigned(base) || ! GetUnsigned(n) || n > INT_MAX) {
+		return false;
+	}
+	if (flags & BIN_FLAG_RESET) {
+		m_names.m_received.clear();
+	}
+	if (base != m_names.m_received.size()) {
+		dprintf(D_ALWAYS, "Binary ClassAd refers to %llu attribute names, but only %d were received\n",
+				base, (int)m_names.m_received.size());
+		return false;
+	}
+	count = (int)n;
+	return true;
+}
+
+bool
+ClassAdBinaryReader::Get(std::string &attr, ExprTree *&tree, std::string &text)
+{
+	tree = NULL;
+	if ( ! GetName(attr)) {
+		return false;
+	}
+	if (m_pos < m_len && (unsigned char)m_data[m_pos] == BIN_TEXT) {
+		m_pos++;
+		return GetBytes(text);
+	}
+	tree = GetTree(0);
+	return tree != NULL;
+}
+
+bool
+ClassAdBinaryReader::GetName(std::string &name)
+{
+	unsigned long long index;
+	if ( ! GetUnsigned(index)) {
+		return false;
+	}
+	if (index == 0) {
+		if ( ! GetBytes(name)) {
+			return false;
+		}
+		m_names.m_received.push_back(name);
+		return true;
+	}
+	if (index > m_names.m_received.size()) {
+		dprintf(D_ALWAYS, "Binary ClassAd refers to unknown attribute name %llu\n", index - 1);
+		return false;
+	}
+	name = m_names.m_received[index - 1];
+	return true;
+}
+
+bool
+ClassAdBinaryReader::GetValue(unsigned char tag, Value &val)
+{
+	switch (tag) {
+	case BIN_UNDEFINED:
+		val.SetUndefinedValue();
+		return true;
+	case BIN_ERROR:
+		val.SetErrorValue();
+		return true;
+	case BIN_TRUE:
+	case BIN_FALSE:
+		val.SetBooleanValue(tag == BIN_TRUE);
+		return true;
+	case BIN_INTEGER: {
+		long long i;
+		if ( ! GetSigned(i)) {
+			return false;
+		}
+		val.SetIntegerValue(i);
+		return true;
+	}
+	case BIN_REAL: {
+		double d;
+		if ( ! GetDouble(d)) {
+			return false;
+		}
+		val.SetRealValue(d);
+		return true;
+	}
+	case BIN_STRING: {
+		unsigned long long len;
+		if ( ! GetUnsigned(len) || len > m_len - m_pos) {
+			return false;
+		}
+		val.SetStringValue(m_data + m_pos, (size_t)len);
+		m_pos += (size_t)len;
+		return true;
+	}
+	case BIN_ABSTIME: {
+		long long secs, offset;
+		if ( ! GetSigned(secs) || ! GetSigned(offset)) {
+			return false;
+		}
+		abstime_t t;
+		t.secs = (time_t)secs;
+		t.offset = (int)offset;
+		val.SetAbsoluteTimeValue(t);
+		return true;
+	}
+	case BIN_RELTIME: {
+		double secs;
+		if ( ! GetDouble(secs)) {
+			return false;
+		}
+		val.SetRelativeTimeValue(secs);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+ExprTree *
+ClassAdBinaryReader::GetTree(int depth)
+{
+	unsigned char tag;
+	if (depth > MAX_DEPTH || ! GetByte(tag)) {
+		return NULL;
+	}
+
+	switch (tag) {
+	case BIN_UNDEFINED:
+	case BIN_ERROR:
+	case BIN_TRUE:
+	case BIN_FALSE:
+	case BIN_INTEGER:
+	case BIN_REAL:
+	case BIN_STRING:
+	case BIN_ABSTIME:
+	case BIN_RELTIME: {
+		Value val;
+		if ( ! GetValue(tag, val)) {
+			return NULL;
+		}
+		return Literal::MakeLiteral(val);
+	}
+
+	case BIN_FACTOR: {
+		unsigned char factor, numtag;
+		Value val;
+		if ( ! GetByte(factor) || factor > Value::T_FACTOR ||
+			 ! GetByte(numtag) || (numtag != BIN_INTEGER && numtag != BIN_REAL) ||
+			 ! GetValue(numtag, val))
+		{
+			return NULL;
+		}
+		return Literal::MakeLiteral(val, (Value::NumberFactor)factor);
+	}
+
+	case BIN_ATTR:
+	case BIN_ATTR_ABSOLUTE: {
+		std::string name;
+		if ( ! GetName(name)) {
+			return NULL;
+		}
+		return AttributeReference::MakeAttributeReference(NULL, name, tag == BIN_ATTR_ABSOLUTE);
+	}
+
+	case BIN_ATTR_SCOPED: {
+		std::string name;
+		if ( ! GetName(name)) {
+			return NULL;
+		}
+		ExprTree *scope = GetTree(depth + 1);
+		if ( ! scope) {
+			return NULL;
+		}
+		return AttributeReference::MakeAttributeReference(scope, name, false);
+	}
+
+	case BIN_OP: {
+		unsigned char opbyte;
+		if ( ! GetByte(opbyte) || opbyte < Operation::__FIRST_OP__ || opbyte > Operation::__LAST_OP__) {
+			return NULL;
+		}
+		Operation::OpKind op = (Operation::OpKind)opbyte;
+		int operands = 2;
+		if (op == Operation::PARENTHESES_OP || op == Operation::UNARY_PLUS_OP ||
+			op == Operation::UNARY_MINUS_OP || op == Operation::LOGICAL_NOT_OP ||
+			op == Operation::BITWISE_NOT_OP)
+		{
+			operands = 1;
+		} else if (op == Operation::TERNARY_OP) {
+			operands = 3;
+		}
+		ExprTree *t[3] = { NULL, NULL, NULL };
+		for (int ix = 0; ix < operands; ++ix) {
+			t[ix] = GetTree(depth + 1);
+			if ( ! t[ix]) {
+				delete t[0];
+				delete t[1];
+				return NULL;
+			}
+		}
+		return Operation::MakeOperation(op, t[0], t[1], t[2]);
+	}
+
+	case BIN_FN: {
+		std::string name;
+		unsigned long long count;
+		if ( ! GetName(name) || ! GetUnsigned(count) || count > m_len - m_pos) {
+			return NULL;
+		}
+		std::vector<ExprTree*> args;
+		args.reserve((size_t)count);
+		for (unsigned long long ix = 0; ix < count; ++ix) {
+			ExprTree *arg = GetTree(depth + 1);
+			if ( ! arg) {
+				for (size_t jx = 0; jx < args.size(); ++jx) {
+					delete args[jx];
+				}
+				return NULL;
+			}
+			args.push_back(arg);
+		}
+		return FunctionCall::MakeFunctionCall(name, args);
+	}
+
+	case BIN_CLASSAD: {
+		unsigned long long count;
+		if ( ! GetUnsigned(count) || count > m_len - m_pos) {
+			return NULL;
+		}
+		ClassAd *ad = new ClassAd();
+		std::string name;
+		for (unsigned long long ix = 0; ix < count; ++ix) {
+			ExprTree *expr = NULL;
+			if ( ! GetName(name) || ! (expr = GetTree(depth + 1)) || ! ad->Insert(name, expr)) {
+				delete expr;
+				delete ad;
+				return NULL;
+			}
+		}
+		return ad;
+	}
+
+	case BIN_LIST: {
+		unsigned long long count;
+		if ( ! GetUnsigned(count) || count > m_len - m_pos) {
+			return NULL;
+		}
+		std::vector<ExprTree*> exprs;
+		exprs.reserve((size_t)count);
+		for (unsigned long long ix = 0; ix < count; ++ix) {
+			ExprTree *expr = GetTree(depth + 1);
+			if ( ! expr) {
+				for (size_t jx = 0; jx < exprs.size(); ++jx) {
+					delete exprs[jx];
+				}
+				return NULL;
+			}
+			exprs.push_back(expr);
+		}
+		return ExprList::MakeExprList(exprs);
+	}
+
+	default:
+		return NULL;
+	}
+}
+
+bool
+ClassAdBinaryReader::GetByte(unsigned char &c)
+{
+	if (m_pos >= m_len) {
+		return false;
+	}
+	c = (unsigned char)m_data[m_pos++];
+	return true;
+}
+
+bool
+ClassAdBinaryReader::GetUnsigned(unsigned long long &n)
+{
+	n = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		unsigned char c;
+		if ( ! GetByte(c)) {
+			return false;
+		}
+		n |= (unsigned long long)(c & 0x7f) << shift;
+		if ( ! (c & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool
+ClassAdBinaryReader::GetSigned(long long &n)
+{
+	unsigned long long z;
+	if ( ! GetUnsigned(z)) {
+		return false;
+	}
+	n = (long long)(z >> 1) ^ -(long long)(z & 1);
+	return true;
+}
+
+bool
+ClassAdBinaryReader::GetDouble(double &d)
+{
+	if (m_len - m_pos < 8) {
+		return false;
+	}
+	unsigned long long bits = 0;
+	for (int ix = 7; ix >= 0; --ix) {
+		bits = (bits << 8) | (unsigned char)m_data[m_pos + ix];
+	}
+	m_pos += 8;
+	memcpy(&d, &bits, sizeof(d));
+	return true;
+}
+
+bool
+ClassAdBinaryReader::GetBytes(std::string &str)
+{
+	unsigned long long len;
+	if ( ! GetUnsigned(len) || len > m_len - m_pos) {
+		return false;
+	}
+	str.assign(m_data + m_pos, (size_t)len);
+	m_pos += (size_t)len;
+	return true;
+}
+
+bool
+InsertClassAdBinaryAttr(ClassAd &ad, std::string &attr, ExprTree *tree,
+	std::string &text, bool use_cache)
+{
+	if ( ! tree) {
+		if (use_cache) {
+			return ad.InsertViaCache(attr, text);
+		}
+		ClassAdParser parser;
+		parser.SetOldClassAd(true);
+		tree = parser.ParseExpression(text);
+		return tree && ad.Insert(attr, tree);
+	}
+
+		// The cache is keyed by the unparsed expression, so an
+		// expression that might be cached is unparsed here, which is
+		// still much cheaper than parsing it.
+	if (use_cache && ClassAdGetExpressionCaching() && attr[0] != '\'' &&
+		(tree->GetKind() == ExprTree::OP_NODE ||
+		 tree->GetKind() == ExprTree::FN_CALL_NODE ||
+		 tree->GetKind() == ExprTree::ATTRREF_NODE))
+	{
+		ClassAdUnParser unp;
+		unp.SetOldClassAd(true, true);
+		text.clear();
+		unp.Unparse(text, tree);
+		ExprTree *cached = CachedExprEnvelope::check_hit(attr, text);
+		if (cached) {
+			delete tree;
+		} else {
+			cached = CachedExprEnvelope::cache(attr, tree, text);
+		}
+		return ad.Insert(attr, cached);
+	}
+	return ad.Insert(attr, tree);
+}
@@ -0,0 +1,139 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#ifndef CLASSAD_BINARY_H
+#define CLASSAD_BINARY_H
+
+#include "condor_common.h"
+#include "stream.h"
+#include "classad/classad_distribution.h"
+
+/* A binary encoding of ClassAds, which putClassAd() uses in place of
+ * "Name = expr" strings when the peer is new enough to read it (see
+ * classad_oldnew.cpp).  Literals are sent in their native form and
+ * other expressions as a pre-order walk of the tree, so the receiver
+ * doesn't have to parse anything.  Attribute and function names are
+ * sent as indexes into a dictionary that both ends build up as ads go
+ * by, so on a connection that carries many ads each name is spelled
+ * out only once.
+ *
+ * An encoded ad is a header (flags, the size of the sender's dictionary
+ * when the ad was started, and the number of attributes) followed by
+ * the attributes.  The receiver checks the dictionary size against its
+ * own, so an ad that refers to names the receiver never saw (because it
+ * skipped a message, say) is rejected rather than misread.
+ */
+
+/* The attribute name dictionaries for one connection, one for each
+ * direction.  Streams keep theirs as their ClassAd state.
+ */
+class ClassAdBinaryNames : public StreamConnectionState {
+ public:
+	ClassAdBinaryNames();
+	virtual ~ClassAdBinaryNames();
+
+		// The dictionaries for ads sent and received on sock, or NULL
+		// if names can't be carried from one ad to the next because
+		// messages on sock may be lost or reordered.
+	static ClassAdBinaryNames *ForStream(Stream *sock);
+
+		// Start both dictionaries over
+	void Reset();
+
+ private:
+	friend class ClassAdBinaryWriter;
+	friend class ClassAdBinaryReader;
+
+	std::map<std::string, unsigned int> m_sent;
+	bool m_send_reset;			// the next ad sent starts the peer over
+	std::vector<std::string> m_received;
+};
+
+class ClassAdBinaryWriter {
+ public:
+	ClassAdBinaryWriter(ClassAdBinaryNames &names);
+
+		// Append an attribute.  Returns false, having appended nothing,
+		// if the expression can't be encoded; send it with PutText().
+	bool Put(const std::string &attr, const classad::ExprTree *tree);
+
+		// Append an attribute as an old ClassAd expression string, for
+		// the receiver to parse.
+	void PutText(const std::string &attr, const std::string &rhs);
+
+	int Count() const { return m_count; }
+
+		// The encoded ad is the header followed by the body.
+	void GetHeader(std::string &header) const;
+	const std::string &Body() const { return m_body; }
+
+ private:
+	bool PutTree(const classad::ExprTree *tree, int depth);
+	bool PutValue(const classad::Value &val);
+	void PutName(const std::string &name);
+
+	ClassAdBinaryNames &m_names;
+	std::string m_body;
+	unsigned int m_base;
+	bool m_reset;
+	int m_count;
+		// names added while encoding the current attribute, so they can
+		// be taken back out if it can't be encoded
+	std::vector<std::string> m_new_names;
+};
+
+class ClassAdBinaryReader {
+ public:
+	ClassAdBinaryReader(ClassAdBinaryNames &names, const char *data, size_t len);
+
+		// Read the header.  Returns false if the ad is malformed or
+		// doesn't fit the receiver's dictionary.
+	bool Begin(int &count);
+
+		// Read an attribute.  On success, either tree is the value
+		// (owned by the caller) or it is NULL and text holds an old
+		// ClassAd expression to be parsed.
+	bool Get(std::string &attr, classad::ExprTree *&tree, std::string &text);
+
+	bool AtEnd() const { return m_pos == m_len; }
+
+ private:
+	classad::ExprTree *GetTree(int depth);
+	bool GetValue(unsigned char tag, classad::Value &val);
+	bool GetName(std::string &name);
+	bool GetByte(unsigned char &c);
+	bool GetUnsigned(unsigned long long &n);
+	bool GetSigned(long long &n);
+	bool GetDouble(double &d);
+	bool GetBytes(std::string &str);
+
+	ClassAdBinaryNames &m_names;
+	const char *m_data;
+	size_t m_len;
+	size_t m_pos;
+};
+
+	// Insert an attribute read by ClassAdBinaryReader::Get() into ad,
+	// parsing it if it came as text, and going through the expression
+	// cache if use_cache is true.  Takes ownership of tree.
+bool InsertClassAdBinaryAttr(classad::ClassAd &ad, std::string &attr,
+	classad::ExprTree *tree, std::string &text, bool use_cache);
+
+#endif
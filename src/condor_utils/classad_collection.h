@@ -110,6 +110,24 @@ public:
   */
   void CommitNondurableTransaction() { ClassAdLog<K,AltK,AD>::CommitNondurableTransaction(); }
 
+  /** Sync committed transactions on a background thread
+    @param notify_fd a byte is written to this fd after each sync
+    @return false if not supported, in which case commits stay synchronous
+  */
+  bool EnableGroupCommit(int notify_fd) { return ClassAdLog<K,AltK,AD>::EnableGroupCommit(notify_fd); }
+
+  /** Write the state to a binary snapshot when the log is rotated
+    @param enable true to write snapshots, false for a plain text log
+    @return nothing
+  */
+  void SetBinarySnapshots(bool enable) { ClassAdLog<K,AltK,AD>::SetBinarySnapshots(enable); }
+
+  /** Commit a transaction without waiting for the sync to disk
+    @return a ticket for IsDurable(), or 0 if there is nothing to wait for
+  */
+  unsigned long CommitGroupTransaction() { return ClassAdLog<K,AltK,AD>::CommitGroupTransaction(); }
+  bool IsDurable(unsigned long ticket) { return ClassAdLog<K,AltK,AD>::IsDurable(ticket); }
+
   /** Abort a transaction
     @return true if a transaction aborted, false if no transaction active
   */
@@ -74,6 +74,7 @@ FILE* LoadClassAdLog(
 	time_t & m_original_log_birthdate,
 	bool & is_clean,
 	bool & requires_successful_cleaning,
+	bool & has_snapshot,
 	MyString & errmsg)
 {
 	FILE* log_fp = NULL;
@@ -97,10 +98,14 @@ FILE* LoadClassAdLog(
 
 	is_clean = true; // was cleanly closed (until we find out otherwise)
 	requires_successful_cleaning = false;
+	has_snapshot = false;
 
 	// Read all of the log records
 	LogRecord		*log_rec;
 	unsigned long count = 0;
+	unsigned long snapshot_ads = 0;
+	Stopwatch load_time;
+	load_time.start();
 	long long next_log_entry_pos = 0;
     long long curr_log_entry_pos = 0;
 	while ((log_rec = ReadLogEntry(log_fp, 1+count, InstantiateLogEntry, maker)) != 0) {
@@ -145,6 +150,35 @@ FILE* LoadClassAdLog(
 			m_original_log_birthdate = ((LogHistoricalSequenceNumber *)log_rec)->get_timestamp();
 			delete log_rec;
 			break;
+		case CondorLogOp_LogSnapshot: {
+			// the state of the log when it was rotated, in place of the
+			// records that would otherwise start the log
+			unsigned long snapshot_seq = ((LogSnapshot *)log_rec)->get_sequence_number();
+			unsigned long expected_ads = ((LogSnapshot *)log_rec)->get_num_ads();
+			delete log_rec;
+			if (count != 2 || active_transaction || snapshot_seq != historical_sequence_number) {
+				errmsg.formatstr("ERROR: in log %s snapshot record %lu is out of place\n", filename, count);
+				fclose(log_fp);
+				delete active_transaction;
+				return NULL;
+			}
+			Stopwatch snapshot_time;
+			snapshot_time.start();
+			if ( ! LoadClassAdLogSnapshot(filename, snapshot_seq, la, maker, snapshot_ads, errmsg)) {
+				fclose(log_fp);
+				return NULL;
+			}
+			if (snapshot_ads != expected_ads) {
+				errmsg.formatstr("ERROR: snapshot of log %s has %lu ads, expected %lu\n",
+					filename, snapshot_ads, expected_ads);
+				fclose(log_fp);
+				return NULL;
+			}
+			dprintf(D_FULLDEBUG, "Loaded %lu ads from snapshot of %s in %.3f seconds\n",
+				snapshot_ads, filename, snapshot_time.stop() / 1000.0);
+			has_snapshot = true;
+			break;
+		}
 		default:
 			if (active_transaction) {
 				active_transaction->AppendLog(log_rec);
@@ -177,6 +211,9 @@ FILE* LoadClassAdLog(
 			requires_successful_cleaning = true;
 		}
 	}
+	dprintf(D_ALWAYS, "Loaded log %s in %.3f seconds: %lu ads from snapshot, %lu log records\n",
+		filename, load_time.stop() / 1000.0, snapshot_ads, count);
+
 	if(!count) {
 		log_rec = new LogHistoricalSequenceNumber( historical_sequence_number, m_original_log_birthdate );
 		if (log_rec->Write(log_fp) < 0) {
@@ -209,6 +246,158 @@ int FlushClassAdLog(FILE* fp, bool force)
 }
 
 
+#if defined(HAVE_PTHREADS) && !defined(WIN32)
+
+struct ClassAdLogSyncerState {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;		// signaled on new requests and finished syncs
+	bool running;
+	bool stop;
+	int notify_fd;
+	int fd;						// the log fd of the latest request
+	unsigned long requested;	// the latest ticket handed out
+	unsigned long synced;		// the latest ticket known durable
+	int error;
+};
+
+ClassAdLogSyncer::ClassAdLogSyncer()
+{
+	m_state = new ClassAdLogSyncerState;
+	m_state->running = false;
+	m_state->stop = false;
+	m_state->notify_fd = -1;
+	m_state->fd = -1;
+	m_state->requested = 0;
+	m_state->synced = 0;
+	m_state->error = 0;
+	pthread_mutex_init(&m_state->mutex, NULL);
+	pthread_cond_init(&m_state->cond, NULL);
+}
+
+ClassAdLogSyncer::~ClassAdLogSyncer()
+{
+	if (m_state->running) {
+		pthread_mutex_lock(&m_state->mutex);
+		m_state->stop = true;
+		pthread_cond_broadcast(&m_state->cond);
+		pthread_mutex_unlock(&m_state->mutex);
+		pthread_join(m_state->thread, NULL);
+	}
+	pthread_cond_destroy(&m_state->cond);
+	pthread_mutex_destroy(&m_state->mutex);
+	delete m_state;
+}
+
+bool
+ClassAdLogSyncer::Start(int notify_fd)
+{
+	if (m_state->running) {
+		return true;
+	}
+	m_state->notify_fd = notify_fd;
+	if (pthread_create(&m_state->thread, NULL, ClassAdLogSyncer::Run, m_state) != 0) {
+		dprintf(D_ALWAYS, "Failed to start the log sync thread, errno = %d\n", errno);
+		return false;
+	}
+	m_state->running = true;
+	return true;
+}
+
+unsigned long
+ClassAdLogSyncer::Request(int fd)
+{
+	pthread_mutex_lock(&m_state->mutex);
+	m_state->fd = fd;
+	unsigned long ticket = ++m_state->requested;
+	pthread_cond_broadcast(&m_state->cond);
+	pthread_mutex_unlock(&m_state->mutex);
+	return ticket;
+}
+
+unsigned long
+ClassAdLogSyncer::Synced()
+{
+	pthread_mutex_lock(&m_state->mutex);
+	unsigned long synced = m_state->synced;
+	pthread_mutex_unlock(&m_state->mutex);
+	return synced;
+}
+
+void
+ClassAdLogSyncer::Wait()
+{
+	pthread_mutex_lock(&m_state->mutex);
+	while (m_state->running && m_state->synced < m_state->requested) {
+		pthread_cond_wait(&m_state->cond, &m_state->mutex);
+	}
+	pthread_mutex_unlock(&m_state->mutex);
+}
+
+int
+ClassAdLogSyncer::Error()
+{
+	pthread_mutex_lock(&m_state->mutex);
+	int error = m_state->error;
+	pthread_mutex_unlock(&m_state->mutex);
+	return error;
+}
+
+void *
+ClassAdLogSyncer::Run(void *arg)
+{
+	ClassAdLogSyncerState *state = (ClassAdLogSyncerState *)arg;
+
+	pthread_mutex_lock(&state->mutex);
+	for (;;) {
+		while (state->synced == state->requested && !state->stop) {
+			pthread_cond_wait(&state->cond, &state->mutex);
+		}
+		if (state->synced == state->requested) {
+			break;	// stopping, and nothing left to sync
+		}
+
+			// everything requested up to now has been written to fd,
+			// so one sync covers all of it
+		unsigned long target = state->requested;
+		int fd = state->fd;
+		pthread_mutex_unlock(&state->mutex);
+
+		int rc = condor_fdatasync(fd);
+		int err = errno;
+
+		pthread_mutex_lock(&state->mutex);
+		if (rc < 0 && !state->error) {
+			state->error = err ? err : -1;
+		}
+		state->synced = target;
+		pthread_cond_broadcast(&state->cond);
+
+		if (state->notify_fd >= 0) {
+			// a full pipe already has a wakeup in it, so errors are ignored
+			ssize_t ignored = write(state->notify_fd, "s", 1);
+			(void)ignored;
+		}
+	}
+	pthread_mutex_unlock(&state->mutex);
+	return NULL;
+}
+
+#else
+
+	// no threads, so group commit is never enabled
+ClassAdLogSyncer::ClassAdLogSyncer() : m_state(NULL) {}
+ClassAdLogSyncer::~ClassAdLogSyncer() {}
+bool ClassAdLogSyncer::Start(int /*notify_fd*/) { return false; }
+unsigned long ClassAdLogSyncer::Request(int fd) { condor_fdatasync(fd); return 0; }
+unsigned long ClassAdLogSyncer::Synced() { return 0; }
+void ClassAdLogSyncer::Wait() {}
+int ClassAdLogSyncer::Error() { return 0; }
+void *ClassAdLogSyncer::Run(void * /*arg*/) { return NULL; }
+
+#endif
+
+
 bool SaveHistoricalClassAdLogs(
 	const char * filename,
 	const unsigned long max_historical_logs,
@@ -253,6 +442,37 @@ bool SaveHistoricalClassAdLogs(
 }
 
 
+// Start a rotated log that refers to a binary snapshot of the state,
+// rather than holding the state itself.
+static bool WriteClassAdLogSnapshotState(
+	FILE *fp,                       // in
+	const char * tmp_filename,      // in: used for error messages
+	const char * filename,          // in: the log the snapshot belongs to
+	unsigned long sequence_number,  // in
+	time_t original_log_birthdate,  // in
+	LoggableClassAdTable & la,      // in
+	MyString & errmsg)              // out
+{
+	unsigned long num_ads = 0;
+	if ( ! WriteClassAdLogSnapshot(filename, sequence_number, la, num_ads, errmsg)) {
+		return false;
+	}
+
+	LogHistoricalSequenceNumber seq_rec(sequence_number, original_log_birthdate);
+	LogSnapshot snapshot_rec(sequence_number, num_ads);
+	if (seq_rec.Write(fp) < 0 || snapshot_rec.Write(fp) < 0) {
+		errmsg.formatstr("write to %s failed, errno = %d", tmp_filename, errno);
+		return false;
+	}
+	if (fflush(fp) !=0){
+		errmsg.formatstr("fflush of %s failed, errno = %d", tmp_filename, errno);
+	}
+	if (condor_fdatasync(fileno(fp)) < 0) {
+		errmsg.formatstr("fsync of %s failed, errno = %d", tmp_filename, errno);
+	}
+	return true;
+}
+
 bool TruncateClassAdLog(
 	const char * filename,	        // in
 	LoggableClassAdTable & la,      // in
@@ -260,7 +480,8 @@ bool TruncateClassAdLog(
 	FILE* &log_fp,                  // in,out
 	unsigned long & historical_sequence_number, // in,out
 	time_t & m_original_log_birthdate, // in,out
-	MyString & errmsg) // out
+	MyString & errmsg, // out
+	bool binary_snapshot) // in
 {
 	MyString	tmp_log_filename;
 	int new_log_fd;
@@ -287,9 +508,16 @@ bool TruncateClassAdLog(
 
 	// flush our current state into the temp file,
 	// with a future value for sequence number
-	bool success = WriteClassAdLogState(new_log_fp, tmp_log_filename.Value(),
-		future_sequence_number, m_original_log_birthdate,
-		la, maker, errmsg);
+	bool success;
+	if (binary_snapshot) {
+		success = WriteClassAdLogSnapshotState(new_log_fp, tmp_log_filename.Value(),
+			filename, future_sequence_number, m_original_log_birthdate,
+			la, errmsg);
+	} else {
+		success = WriteClassAdLogState(new_log_fp, tmp_log_filename.Value(),
+			future_sequence_number, m_original_log_birthdate,
+			la, maker, errmsg);
+	}
 
 	fclose(log_fp);
 	log_fp = NULL;
@@ -615,6 +843,48 @@ LogHistoricalSequenceNumber::WriteBody(FILE *fp)
 	return (fwrite(buf, 1, len, fp) < (unsigned)len) ? -1: len;
 }
 
+LogSnapshot::LogSnapshot(unsigned long sequence_number_arg, unsigned long num_ads_arg)
+{
+	op_type = CondorLogOp_LogSnapshot;
+	sequence_number = sequence_number_arg;
+	num_ads = num_ads_arg;
+}
+
+int
+LogSnapshot::Play(void *  /*data_structure*/)
+{
+	// The snapshot is loaded by LoadClassAdLog, which knows the
+	// name of the log it belongs to.
+	return 1;
+}
+
+int
+LogSnapshot::ReadBody(FILE *fp)
+{
+	int rval,rval1;
+	char *buf = NULL;
+	rval = readword(fp, buf);
+	if (rval < 0) return rval;
+	sequence_number = strtoul(buf, NULL, 10);
+	free(buf);
+
+	rval1 = readword(fp, buf);
+	if (rval1 < 0) return rval1;
+	num_ads = strtoul(buf, NULL, 10);
+	free(buf);
+	return rval + rval1;
+}
+
+int
+LogSnapshot::WriteBody(FILE *fp)
+{
+	char buf[100];
+	snprintf(buf,COUNTOF(buf),"%lu %lu", sequence_number, num_ads);
+	buf[COUNTOF(buf)-1] = 0; // snprintf not guranteed to null terminate.
+	int len = strlen(buf);
+	return (fwrite(buf, 1, len, fp) < (unsigned)len) ? -1: len;
+}
+
 LogNewClassAd::LogNewClassAd(const char *k, const char *m, const char *t, const ConstructLogEntry & c) : ctor(c)
 {
 	op_type = CondorLogOp_NewClassAd;
@@ -1036,6 +1306,9 @@ InstantiateLogEntry(FILE *fp, unsigned long recnum, int type, const ConstructLog
 		case CondorLogOp_LogHistoricalSequenceNumber:
 			log_rec = new LogHistoricalSequenceNumber(0,0);
 			break;
+		case CondorLogOp_LogSnapshot:
+			log_rec = new LogSnapshot(0,0);
+			break;
 	    default:
 		    return NULL;
 			break;
@@ -80,6 +80,35 @@ const ConstructClassAdLogTableEntry<ClassAd*> DefaultMakeClassAdLogTableEntry;
 extern const ConstructClassAdLogTableEntry<ClassAd*> DefaultMakeClassAdLogTableEntry;
 #endif
 
+// Runs the fdatasync() of a log on a background thread for group commit.
+// Each Request() returns a ticket that is durable once Synced() reaches
+// it; requests made while a sync is in progress are all covered by the
+// next one.  After each sync a byte is written to the notify fd, so the
+// caller can wait for durability in its event loop.
+struct ClassAdLogSyncerState;
+class ClassAdLogSyncer {
+public:
+	ClassAdLogSyncer();
+	~ClassAdLogSyncer();	// waits for pending syncs, then stops the thread
+
+		// start the sync thread; returns false if there are no threads
+		// on this platform, in which case the caller should sync itself
+	bool Start(int notify_fd);
+		// request a sync of fd, which must stay open until the ticket
+		// returned is durable (or Wait() returns)
+	unsigned long Request(int fd);
+		// the highest ticket known to be durable
+	unsigned long Synced();
+		// block until every ticket requested so far is durable
+	void Wait();
+		// errno of the first failed sync, or 0
+	int Error();
+
+private:
+	static void *Run(void *arg);
+	ClassAdLogSyncerState *m_state;
+};
+
 template <typename K, typename AltK, typename AD>
 class ClassAdLog {
 public:
@@ -150,6 +179,16 @@ public:
 	int SetTransactionTriggers(int mask);
 	int GetTransactionTriggers();
 
+		// Sync committed transactions on a background thread, writing a
+		// byte to notify_fd after each sync.  Returns false if that is
+		// not supported here, in which case commits stay synchronous.
+	bool EnableGroupCommit(int notify_fd);
+		// Commit the active transaction without waiting for the fsync.
+		// Returns a ticket to pass to IsDurable(), or 0 if there was
+		// nothing to wait for.
+	unsigned long CommitGroupTransaction();
+	bool IsDurable(unsigned long ticket);
+
 	/** Get a list of all new keys created in this transaction
 		@param new_keys List object to populate
 	*/
@@ -208,6 +247,11 @@ public:
 
 	time_t GetOrigLogBirthdate() {return m_original_log_birthdate;}
 
+	// When true, TruncLog() writes the state to a binary snapshot file
+	// that loads much faster than replaying the text log records.  A log
+	// that was loaded from a snapshot starts out true.
+	void SetBinarySnapshots(bool enable) { m_binary_snapshots = enable; }
+
 protected:
 	/** Returns handle to active transaction.  Upon return of this
 		method, any active transaction is forgotten.  It is the caller's
@@ -243,6 +287,8 @@ private:
 	unsigned long historical_sequence_number;
 	time_t m_original_log_birthdate;
 	int m_nondurable_level;
+	ClassAdLogSyncer *m_syncer;
+	bool m_binary_snapshots;
 
 	bool SaveHistoricalLogs();
 };
@@ -267,6 +313,27 @@ private:
 					  // regardless of how many times the log has rotated
 };
 
+// The second record of a log whose state at rotation was written to a
+// binary snapshot file (see classad_log_snapshot.cpp) instead of to the
+// log itself.  Loading the log loads the snapshot in its place.
+class LogSnapshot : public LogRecord {
+public:
+	LogSnapshot(unsigned long sequence_number, unsigned long num_ads);
+	int Play(void *data_structure);
+
+	unsigned long get_sequence_number() {return sequence_number;}
+	unsigned long get_num_ads() {return num_ads;}
+
+private:
+	virtual int WriteBody(FILE *fp);
+	virtual int ReadBody(FILE *fp);
+
+	virtual char const *get_key() {return NULL;}
+
+	unsigned long sequence_number;
+	unsigned long num_ads;
+};
+
 // this class is the interface that is consumed by classes in this file that are derived from LogRecord
 class LoggableClassAdTable {
 public:
@@ -423,7 +490,8 @@ bool TruncateClassAdLog(
 	FILE* &log_fp,                  // in,out
 	unsigned long & historical_sequence_number, // in,out
 	time_t & m_original_log_birthdate, // in,out
-	MyString & errmsg);             // out
+	MyString & errmsg,              // out
+	bool binary_snapshot = false);  // in: write the state to a snapshot
 
 bool WriteClassAdLogState(
 	FILE *fp,                       // in
@@ -442,10 +510,37 @@ FILE* LoadClassAdLog(
 	time_t & m_original_log_birthdate, // in,out
 	bool & is_clean,  // out: true if log was shutdown cleanly
 	bool & requires_successful_cleaning, // out: true if log must be cleaned (i.e rotated) before it can be written to again.
+	bool & has_snapshot, // out: true if the log started from a binary snapshot
 	MyString & errmsg);             // out, contains error or warning messages
 
 int FlushClassAdLog(FILE* fp, bool force);
 
+// Binary snapshots of the state of a log, one per sequence number,
+// kept next to the log as <log>.snapshot.<sequence number>.
+void ClassAdLogSnapshotName(
+	const char * filename,          // in: the log
+	unsigned long sequence_number,  // in
+	MyString & snapshot_name);      // out
+
+bool WriteClassAdLogSnapshot(
+	const char * filename,          // in: the log
+	unsigned long sequence_number,  // in
+	LoggableClassAdTable & la,      // in
+	unsigned long & num_ads,        // out
+	MyString & errmsg);             // out
+
+bool LoadClassAdLogSnapshot(
+	const char * filename,          // in: the log
+	unsigned long sequence_number,  // in
+	LoggableClassAdTable & la,      // in
+	const ConstructLogEntry& maker, // in
+	unsigned long & num_ads,        // out
+	MyString & errmsg);             // out
+
+void RemoveClassAdLogSnapshot(
+	const char * filename,
+	unsigned long sequence_number);
+
 bool SaveHistoricalClassAdLogs(
 	const char * filename,
 	const unsigned long max_historical_logs,
@@ -483,6 +578,8 @@ ClassAdLog<K,AltK,AD>::ClassAdLog(const char *filename,int max_historical_logs_a
 	log_filename_buf = filename;
 	active_transaction = NULL;
 	m_nondurable_level = 0;
+	m_syncer = NULL;
+	m_binary_snapshots = false;
 
 	bool open_read_only = max_historical_logs_arg < 0;
 	if (open_read_only) { max_historical_logs_arg = -max_historical_logs_arg; }
@@ -497,7 +594,7 @@ ClassAdLog<K,AltK,AD>::ClassAdLog(const char *filename,int max_historical_logs_a
 	log_fp = LoadClassAdLog(filename,
 		la, this->GetTableEntryMaker(),
 		historical_sequence_number, m_original_log_birthdate,
-		is_clean, requires_successful_cleaning, errmsg);
+		is_clean, requires_successful_cleaning, m_binary_snapshots, errmsg);
 
 	if ( ! log_fp) {
 		EXCEPT("%s", errmsg.Value());
@@ -522,6 +619,8 @@ ClassAdLog<K,AltK,AD>::ClassAdLog(const ConstructLogEntry* maker)
 	active_transaction = NULL;
 	log_fp = NULL;
 	m_nondurable_level = 0;
+	m_syncer = NULL;
+	m_binary_snapshots = false;
 	max_historical_logs = 0;
 	historical_sequence_number = 0;
 }
@@ -530,6 +629,7 @@ template <typename K, typename AltK, typename AD>
 ClassAdLog<K,AltK,AD>::~ClassAdLog()
 {
 	if (active_transaction) delete active_transaction;
+	delete m_syncer;
 
 	// cache the effective table entry maker for use in the loop.
 	const ConstructLogEntry & dtor = this->GetTableEntryMaker();
@@ -616,12 +716,17 @@ ClassAdLog<K,AltK,AD>::TruncLog()
 		return false;
 	}
 
+		// the syncer must be done with the old log before it is replaced
+	if (m_syncer) {
+		m_syncer->Wait();
+	}
+
 	MyString errmsg;
 	ClassAdLogTable<K,AD> la(table); // this gives the ability to add & remove table items.
 	bool rotated = TruncateClassAdLog(logFilename(),
 		la, this->GetTableEntryMaker(),
 		log_fp, historical_sequence_number, m_original_log_birthdate,
-		errmsg);
+		errmsg, m_binary_snapshots);
 	if ( ! log_fp) {
 		// if after rotation, the log is no longer open, the the failure is fatal, and we must except
 		EXCEPT("%s", errmsg.Value());
@@ -629,6 +734,10 @@ ClassAdLog<K,AltK,AD>::TruncLog()
 	if ( ! errmsg.empty()) {
 		dprintf(D_ALWAYS, "%s", errmsg.Value());
 	}
+	if (rotated && historical_sequence_number > 1 + (unsigned long)max_historical_logs) {
+		// the snapshot of the newest log we no longer keep, if it had one
+		RemoveClassAdLogSnapshot(logFilename(), historical_sequence_number - 1 - max_historical_logs);
+	}
 
 	return rotated;
 }
@@ -715,6 +824,61 @@ ClassAdLog<K,AltK,AD>::CommitNondurableTransaction()
 	DecNondurableCommitLevel( old_level );
 }
 
+template <typename K, typename AltK, typename AD>
+bool
+ClassAdLog<K,AltK,AD>::EnableGroupCommit(int notify_fd)
+{
+	if (m_syncer) {
+		return true;
+	}
+	m_syncer = new ClassAdLogSyncer();
+	if ( ! m_syncer->Start(notify_fd)) {
+		delete m_syncer;
+		m_syncer = NULL;
+		return false;
+	}
+	return true;
+}
+
+template <typename K, typename AltK, typename AD>
+unsigned long
+ClassAdLog<K,AltK,AD>::CommitGroupTransaction()
+{
+	if ( ! m_syncer || m_nondurable_level > 0) {
+		CommitTransaction();
+		return 0;
+	}
+	if (!active_transaction) return 0;
+
+	unsigned long ticket = 0;
+	if (!active_transaction->EmptyTransaction()) {
+		LogEndTransaction *log = new LogEndTransaction;
+		active_transaction->AppendLog(log);
+		ClassAdLogTable<K,AD> la(table);
+			// written and flushed here, synced by the syncer thread
+		active_transaction->Commit(log_fp, logFilename(), &la, true);
+		FlushLog();
+		ticket = m_syncer->Request(fileno(log_fp));
+	}
+	delete active_transaction;
+	active_transaction = NULL;
+	return ticket;
+}
+
+template <typename K, typename AltK, typename AD>
+bool
+ClassAdLog<K,AltK,AD>::IsDurable(unsigned long ticket)
+{
+	if ( ! m_syncer) {
+		return true;
+	}
+	int err = m_syncer->Error();
+	if (err) {
+		EXCEPT("fsync of %s failed, errno = %d", logFilename(), err);
+	}
+	return ticket <= m_syncer->Synced();
+}
+
 template <typename K, typename AltK, typename AD>
 bool
 ClassAdLog<K,AltK,AD>::AdExistsInTableOrTransaction(const K& key)
@@ -0,0 +1,474 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/* Binary snapshots of the state of a ClassAdLog.
+
+   When a log is rotated with snapshots enabled, its state goes into
+   <log>.snapshot.<sequence number> instead of into the new log as text
+   records, and the new log starts with a LogSnapshot record that refers
+   to it.  Loading a snapshot doesn't parse anything: the ads are in the
+   binary ClassAd encoding (see classad_binary.h), with one attribute
+   name dictionary for the whole file.
+
+   The file is an 8 byte magic string followed by records, each of which
+   is a 4 byte length and a 4 byte CRC-32 of the payload (both little
+   endian), then the payload.  The first byte of the payload is the
+   record type:
+
+     SNAP_HEADER  sequence number
+     SNAP_AD      key, MyType, TargetType, binary ad
+     SNAP_END     number of ads
+
+   Numbers are varints and strings are a varint length then the bytes.
+   A snapshot that doesn't end with a SNAP_END record, or that has a
+   record whose CRC doesn't match, is rejected.
+*/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "classad_log.h"
+#include "classad_binary.h"
+#include "condor_fsync.h"
+#include "util_lib_proto.h"
+
+#if defined(HAVE_DLOPEN)
+#include "ClassAdLogPlugin.h"
+#endif
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+static const char SNAP_MAGIC[8] = { 'C','A','L','O','G','S','N','1' };
+
+	// record types.  These are part of the file format: don't renumber them.
+enum {
+	SNAP_HEADER = 1,
+	SNAP_AD = 2,
+	SNAP_END = 3
+};
+
+	// no single record may claim to be bigger than this
+static const unsigned int MAX_RECORD_SIZE = 0x40000000;
+
+static unsigned int
+snapshot_crc32(const char *data, size_t len)
+{
+	static unsigned int table[256];
+	static bool initialized = false;
+	if ( ! initialized) {
+		for (unsigned int i = 0; i < 256; i++) {
+			unsigned int c = i;
+			for (int k = 0; k < 8; k++) {
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			}
+			table[i] = c;
+		}
+		initialized = true;
+	}
+
+	unsigned int crc = 0xFFFFFFFF;
+	for (size_t i = 0; i < len; i++) {
+		crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFF;
+}
+
+static void
+put_unsigned(std::string &buf, unsigned long long n)
+{
+	while (n >= 0x80) {
+		buf += (char)((n & 0x7f) | 0x80);
+		n >>= 7;
+	}
+	buf += (char)n;
+}
+
+static void
+put_string(std::string &buf, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+	put_unsigned(buf, len);
+	buf.append(str ? str : "", len);
+}
+
+static void
+put_uint32(char *p, unsigned int n)
+{
+	p[0] = (char)(n & 0xff);
+	p[1] = (char)((n >> 8) & 0xff);
+	p[2] = (char)((n >> 16) & 0xff);
+	p[3] = (char)((n >> 24) & 0xff);
+}
+
+static unsigned int
+get_uint32(const char *p)
+{
+	const unsigned char *u = (const unsigned char *)p;
+	return u[0] | (u[1] << 8) | (u[2] << 16) | ((unsigned int)u[3] << 24);
+}
+
+static bool
+write_record(FILE *fp, const std::string &payload)
+{
+	char frame[8];
+	put_uint32(frame, (unsigned int)payload.size());
+	put_uint32(frame + 4, snapshot_crc32(payload.data(), payload.size()));
+	return fwrite(frame, 1, sizeof(frame), fp) == sizeof(frame) &&
+		fwrite(payload.data(), 1, payload.size(), fp) == payload.size();
+}
+
+	// Reads the payloads of the records of a snapshot held in memory.
+class SnapshotReader {
+public:
+	SnapshotReader(const char *data, size_t len) : m_data(data), m_len(len), m_pos(0) {}
+
+	bool Magic() {
+		if (m_len < sizeof(SNAP_MAGIC) || memcmp(m_data, SNAP_MAGIC, sizeof(SNAP_MAGIC)) != 0) {
+			return false;
+		}
+		m_pos = sizeof(SNAP_MAGIC);
+		return true;
+	}
+
+		// the next record, checked against its CRC
+	bool Next(const char *&payload, size_t &len) {
+		if (m_len - m_pos < 8) {
+			return false;
+		}
+		unsigned int size = get_uint32(m_data + m_pos);
+		unsigned int crc = get_uint32(m_data + m_pos + 4);
+		m_pos += 8;
+		if (size == 0 || size > MAX_RECORD_SIZE || size > m_len - m_pos) {
+			return false;
+		}
+		payload = m_data + m_pos;
+		len = size;
+		m_pos += size;
+		return snapshot_crc32(payload, len) == crc;
+	}
+
+	bool AtEnd() const { return m_pos == m_len; }
+
+private:
+	const char *m_data;
+	size_t m_len;
+	size_t m_pos;
+};
+
+static bool
+get_unsigned(const char *data, size_t len, size_t &pos, unsigned long long &n)
+{
+	n = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (pos >= len) {
+			return false;
+		}
+		unsigned char c = (unsigned char)data[pos++];
+		n |= (unsigned long long)(c & 0x7f) << shift;
+		if ( ! (c & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool
+get_string(const char *data, size_t len, size_t &pos, std::string &str)
+{
+	unsigned long long n;
+	if ( ! get_unsigned(data, len, pos, n) || n > len - pos) {
+		return false;
+	}
+	str.assign(data + pos, (size_t)n);
+	pos += (size_t)n;
+	return true;
+}
+
+void
+ClassAdLogSnapshotName(const char *filename, unsigned long sequence_number, MyString &snapshot_name)
+{
+	snapshot_name.formatstr("%s.snapshot.%lu", filename, sequence_number);
+}
+
+void
+RemoveClassAdLogSnapshot(const char *filename, unsigned long sequence_number)
+{
+	MyString snapshot_name;
+	ClassAdLogSnapshotName(filename, sequence_number, snapshot_name);
+	if (unlink(snapshot_name.Value()) == 0) {
+		dprintf(D_FULLDEBUG, "Removed snapshot %s\n", snapshot_name.Value());
+	} else if (errno != ENOENT) {
+		dprintf(D_ALWAYS, "WARNING: failed to remove '%s': %s\n", snapshot_name.Value(), strerror(errno));
+	}
+}
+
+bool
+WriteClassAdLogSnapshot(
+	const char *filename,
+	unsigned long sequence_number,
+	LoggableClassAdTable &la,
+	unsigned long &num_ads,
+	MyString &errmsg)
+{
+	MyString snapshot_name, tmp_name;
+	ClassAdLogSnapshotName(filename, sequence_number, snapshot_name);
+	tmp_name.formatstr("%s.tmp", snapshot_name.Value());
+
+	int fd = safe_open_wrapper_follow(tmp_name.Value(), O_WRONLY | O_CREAT | O_TRUNC | O_LARGEFILE | _O_NOINHERIT | O_BINARY, 0600);
+	if (fd < 0) {
+		errmsg.formatstr("failed to create snapshot %s, errno = %d", tmp_name.Value(), errno);
+		return false;
+	}
+	FILE *fp = fdopen(fd, "wb");
+	if ( ! fp) {
+		errmsg.formatstr("failed to fdopen snapshot %s, errno = %d", tmp_name.Value(), errno);
+		close(fd);
+		return false;
+	}
+
+	bool ok = fwrite(SNAP_MAGIC, 1, sizeof(SNAP_MAGIC), fp) == sizeof(SNAP_MAGIC);
+
+	std::string payload;
+	payload += (char)SNAP_HEADER;
+	put_unsigned(payload, sequence_number);
+	ok = ok && write_record(fp, payload);
+
+	ClassAdBinaryNames names;
+	classad::ClassAdUnParser unparser;
+	unparser.SetOldClassAd(true, true);
+	std::string header, rhs;
+	const char *key;
+	ClassAd *ad;
+
+	num_ads = 0;
+	la.startIterations();
+	while (ok && la.nextIteration(key, ad)) {
+		ClassAdBinaryWriter writer(names);
+			// only the ad's own attributes, not those of its chained parent
+		for (classad::ClassAd::iterator it = ad->begin(); it != ad->end(); ++it) {
+			if ( ! writer.Put(it->first, it->second)) {
+				rhs.clear();
+				unparser.Unparse(rhs, it->second);
+				writer.PutText(it->first, rhs);
+			}
+		}
+		writer.GetHeader(header);
+
+		payload.clear();
+		payload += (char)SNAP_AD;
+		put_string(payload, key);
+		put_string(payload, GetMyTypeName(*ad));
+		put_string(payload, GetTargetTypeName(*ad));
+		payload += header;
+		payload += writer.Body();
+		ok = write_record(fp, payload);
+		num_ads++;
+	}
+
+	payload.clear();
+	payload += (char)SNAP_END;
+	put_unsigned(payload, num_ads);
+	ok = ok && write_record(fp, payload);
+
+	if ( ! ok) {
+		errmsg.formatstr("write to %s failed, errno = %d", tmp_name.Value(), errno);
+	} else if (fflush(fp) != 0) {
+		errmsg.formatstr("fflush of %s failed, errno = %d", tmp_name.Value(), errno);
+		ok = false;
+	} else if (condor_fsync(fileno(fp)) < 0) {
+		errmsg.formatstr("fsync of %s failed, errno = %d", tmp_name.Value(), errno);
+		ok = false;
+	}
+	fclose(fp);
+
+	if (ok && rotate_file(tmp_name.Value(), snapshot_name.Value()) < 0) {
+		errmsg.formatstr("failed to rename %s to %s", tmp_name.Value(), snapshot_name.Value());
+		ok = false;
+	}
+	if ( ! ok) {
+		unlink(tmp_name.Value());
+	}
+	return ok;
+}
+
+	// Load the records of a snapshot held in memory into la.
+static bool
+LoadSnapshotRecords(
+	const char *snapshot_name,
+	const char *data,
+	size_t len,
+	unsigned long sequence_number,
+	LoggableClassAdTable &la,
+	const ConstructLogEntry &maker,
+	unsigned long &num_ads,
+	MyString &errmsg)
+{
+	SnapshotReader snap(data, len);
+	const char *payload;
+	size_t size, pos;
+	unsigned long long n;
+
+	if ( ! snap.Magic()) {
+		errmsg.formatstr("ERROR: %s is not a ClassAd log snapshot\n", snapshot_name);
+		return false;
+	}
+	pos = 1;
+	if ( ! snap.Next(payload, size) || payload[0] != SNAP_HEADER ||
+		 ! get_unsigned(payload, size, pos, n) || n != sequence_number)
+	{
+		errmsg.formatstr("ERROR: snapshot %s has a bad header\n", snapshot_name);
+		return false;
+	}
+
+#if defined(HAVE_DLOPEN)
+	bool notify_plugins = ! ClassAdLogPluginManager::getPlugins().IsEmpty();
+	classad::ClassAdUnParser unparser;
+	unparser.SetOldClassAd(true, true);
+#endif
+
+	ClassAdBinaryNames names;
+	std::string key, mytype, targettype, attr, rhs;
+	num_ads = 0;
+	for (;;) {
+		if ( ! snap.Next(payload, size)) {
+			errmsg.formatstr("ERROR: snapshot %s is corrupt after ad %lu\n", snapshot_name, num_ads);
+			return false;
+		}
+		pos = 1;
+		if (payload[0] == SNAP_END) {
+			if ( ! get_unsigned(payload, size, pos, n) || n != num_ads || ! snap.AtEnd()) {
+				errmsg.formatstr("ERROR: snapshot %s has a bad trailer\n", snapshot_name);
+				return false;
+			}
+			return true;
+		}
+		if (payload[0] != SNAP_AD ||
+			! get_string(payload, size, pos, key) ||
+			! get_string(payload, size, pos, mytype) ||
+			! get_string(payload, size, pos, targettype))
+		{
+			errmsg.formatstr("ERROR: snapshot %s has a bad record after ad %lu\n", snapshot_name, num_ads);
+			return false;
+		}
+
+		ClassAdBinaryReader reader(names, payload + pos, size - pos);
+		int count = 0;
+		if ( ! reader.Begin(count)) {
+			errmsg.formatstr("ERROR: snapshot %s has a bad ad %s\n", snapshot_name, key.c_str());
+			return false;
+		}
+
+		ClassAd *ad = maker.New(key.c_str(), mytype.c_str());
+		SetMyTypeName(*ad, mytype.c_str());
+		SetTargetTypeName(*ad, targettype.c_str());
+		ad->EnableDirtyTracking();
+#if defined(HAVE_DLOPEN)
+		ClassAdLogPluginManager::NewClassAd(key.c_str());
+#endif
+		for (int i = 0; i < count; i++) {
+			classad::ExprTree *tree = NULL;
+			if ( ! reader.Get(attr, tree, rhs) ||
+				 ! InsertClassAdBinaryAttr(*ad, attr, tree, rhs, true))
+			{
+				errmsg.formatstr("ERROR: snapshot %s has a bad attribute in ad %s\n", snapshot_name, key.c_str());
+				maker.Delete(ad);
+				return false;
+			}
+#if defined(HAVE_DLOPEN)
+			if (notify_plugins) {
+				rhs.clear();
+				unparser.Unparse(rhs, ad->Lookup(attr));
+				ClassAdLogPluginManager::SetAttribute(key.c_str(), attr.c_str(), rhs.c_str());
+			}
+#endif
+		}
+		ad->ClearAllDirtyFlags();
+
+		if ( ! la.insert(key.c_str(), ad)) {
+			errmsg.formatstr("ERROR: snapshot %s has ad %s twice\n", snapshot_name, key.c_str());
+			maker.Delete(ad);
+			return false;
+		}
+		num_ads++;
+	}
+}
+
+bool
+LoadClassAdLogSnapshot(
+	const char *filename,
+	unsigned long sequence_number,
+	LoggableClassAdTable &la,
+	const ConstructLogEntry &maker,
+	unsigned long &num_ads,
+	MyString &errmsg)
+{
+	MyString snapshot_name;
+	ClassAdLogSnapshotName(filename, sequence_number, snapshot_name);
+
+	int fd = safe_open_wrapper_follow(snapshot_name.Value(), O_RDONLY | O_LARGEFILE | _O_NOINHERIT | O_BINARY);
+	if (fd < 0) {
+		errmsg.formatstr("ERROR: failed to open snapshot %s of log %s, errno = %d\n",
+			snapshot_name.Value(), filename, errno);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		errmsg.formatstr("ERROR: failed to stat snapshot %s, errno = %d\n", snapshot_name.Value(), errno);
+		close(fd);
+		return false;
+	}
+	size_t len = (size_t)st.st_size;
+	bool ok;
+
+#ifndef WIN32
+	void *map = len ? mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	if (map != MAP_FAILED) {
+		madvise(map, len, MADV_SEQUENTIAL);
+		ok = LoadSnapshotRecords(snapshot_name.Value(), (const char *)map, len,
+			sequence_number, la, maker, num_ads, errmsg);
+		munmap(map, len);
+		close(fd);
+		return ok;
+	}
+#endif
+
+		// no mmap, so read the whole thing
+	std::string data(len, '\0');
+	size_t got = 0;
+	while (got < len) {
+		ssize_t rc = read(fd, &data[got], len - got);
+		if (rc <= 0) {
+			break;
+		}
+		got += rc;
+	}
+	close(fd);
+	if (got != len) {
+		errmsg.formatstr("ERROR: failed to read snapshot %s, errno = %d\n", snapshot_name.Value(), errno);
+		return false;
+	}
+	ok = LoadSnapshotRecords(snapshot_name.Value(), data.data(), len,
+		sequence_number, la, maker, num_ads, errmsg);
+	return ok;
+}
@@ -31,12 +31,16 @@ using namespace std;
 //#define ENABLE_V0_PUT_CLASSAD
 
 #include "classad/classad_distribution.h"
+#include "classad/classadCache.h"
 #include "classad_oldnew.h"
+#include "classad_binary.h"
 #include "compat_classad.h"
+#include "condor_ver_info.h"
 
 // local helper functions, options are one or more of PUT_CLASSAD_* flags
 int _putClassAd(Stream *sock, classad::ClassAd& ad, int options);
 int _putClassAd(Stream *sock, classad::ClassAd& ad, int options, const classad::References &whitelist);
+int _putClassAdBinary(Stream *sock, classad::ClassAd& ad, int options, const classad::References *whitelist);
 int _mergeStringListIntoWhitelist(StringList & list_in, classad::References & whitelist_out);
 #ifdef ENABLE_V0_PUT_CLASSAD
  // these are the 8.2.0 _putClassAd implementations, available for timing comparison
@@ -55,6 +59,99 @@ void AttrList_setPublishServerTimeMangled( bool publish)
 
 static const char *SECRET_MARKER = "ZKM"; // "it's a Zecret Klassad, Mon!"
 
+	// Sent in place of the attribute count to say that the ad is in the
+	// binary encoding.  Only sent to peers that know what it means.
+static const int BINARY_CLASSAD_MARKER = -0x42494e;
+
+static bool send_binary_classads = true;
+void AttrList_setBinaryEncoding( bool enable )
+{
+	send_binary_classads = enable;
+}
+
+	// The peer's version comes from the security handshake, so this is
+	// false for connections that didn't have one.
+static bool
+peer_reads_binary_classads( Stream *sock )
+{
+	if ( ! send_binary_classads) {
+		return false;
+	}
+	CondorVersionInfo const *peer_version = sock->get_peer_version();
+	return peer_version && peer_version->built_since_version(8, 7, 4);
+}
+
+// Read the rest of an ad sent in the binary encoding, after the marker.
+// Leaves the type info that follows it on the stream.
+static bool
+getClassAdBinary( Stream *sock, classad::ClassAd& ad, bool use_cache )
+{
+	int len = 0;
+	if ( ! sock->code(len) || len < 0) {
+		dprintf(D_FULLDEBUG, "getClassAd FAILED to get binary ClassAd length\n");
+		return false;
+	}
+	std::string data(len, '\0');
+	if (len > 0 && sock->get_bytes(&data[0], len) != len) {
+		dprintf(D_FULLDEBUG, "getClassAd FAILED to get binary ClassAd\n");
+		return false;
+	}
+
+	ClassAdBinaryNames local_names;
+	ClassAdBinaryNames *names = ClassAdBinaryNames::ForStream(sock);
+	if ( ! names) {
+		names = &local_names;
+	}
+	ClassAdBinaryReader reader(*names, data.data(), data.size());
+
+	int count = 0;
+	if ( ! reader.Begin(count)) {
+		dprintf(D_ALWAYS, "getClassAd FAILED to read binary ClassAd from %s\n", sock->peer_description());
+		return false;
+	}
+	if (ad.size() == 0) {
+		ad.rehash(count + 2 + 7);
+	}
+
+	std::string attr;
+	std::string rhs;
+
+	for (int ii = 0; ii < count; ++ii) {
+		classad::ExprTree *tree = NULL;
+		if ( ! reader.Get(attr, tree, rhs)) {
+			dprintf(D_ALWAYS, "getClassAd FAILED to read attribute %d of binary ClassAd from %s\n",
+					ii, sock->peer_description());
+			return false;
+		}
+
+		bool inserted = InsertClassAdBinaryAttr(ad, attr, tree, rhs, use_cache);
+		if ( ! inserted) {
+			dprintf(D_ALWAYS, "getClassAd FAILED to insert %s from binary ClassAd\n", attr.c_str());
+			return false;
+		}
+	}
+
+		// private attributes that were sent encrypted
+	int num_secrets = 0;
+	if ( ! sock->code(num_secrets)) {
+		return false;
+	}
+	for (int ii = 0; ii < num_secrets; ++ii) {
+		const char *strptr = NULL;
+		int cb = 0;
+		if ( ! sock->get_secret(strptr, cb) || ! strptr) {
+			dprintf(D_FULLDEBUG, "getClassAd Failed to read encrypted ClassAd expression.\n");
+			return false;
+		}
+		if ( ! InsertLongFormAttrValue(ad, strptr, use_cache)) {
+			dprintf(D_ALWAYS, "getClassAd FAILED to insert secret %s\n", strptr);
+			return false;
+		}
+	}
+
+	return true;
+}
+
 compat_classad::ClassAd *
 getClassAd( Stream *sock )
 {
@@ -81,6 +178,13 @@ bool getClassAd( Stream *sock, classad::ClassAd& ad )
  		return false;
 	}
 
+	if( numExprs == BINARY_CLASSAD_MARKER ) {
+		if( !getClassAdBinary( sock, ad, true ) ) {
+			return false;
+		}
+		numExprs = 0; // all of the attributes have been read
+	}
+
 	// at least numExprs are coming, but we may add
 	// my, target, and a couple extra right away
 
@@ -267,6 +371,13 @@ bool getClassAdEx( Stream *sock, classad::ClassAd& ad, int options)
 		return false;
 	}
 
+	if (numExprs == BINARY_CLASSAD_MARKER) {
+		if ( ! getClassAdBinary(sock, ad, use_cache)) {
+			return false;
+		}
+		numExprs = 0; // all of the attributes have been read
+	}
+
 	// at least numExprs are coming, but we may add
 	// my, target, and a couple extra right away
 	// Auth (id,method) update(total,seq,lost,history)
@@ -449,6 +560,24 @@ getClassAdNoTypes( Stream *sock, classad::ClassAd& ad )
  		return false;
 	}
 
+	if( numExprs == BINARY_CLASSAD_MARKER ) {
+		if( !getClassAdBinary( sock, ad, false ) ) {
+			return false;
+		}
+		std::vector<std::string> limits;
+		for( classad::ClassAd::iterator itr = ad.begin(); itr != ad.end(); ++itr ) {
+			if( strncmp( itr->first.c_str(), "ConcurrencyLimit.", 17 ) == 0 ) {
+				limits.push_back( itr->first );
+			}
+		}
+		for( size_t ix = 0; ix < limits.size(); ix++ ) {
+			classad::ExprTree *tree = ad.Remove( limits[ix] );
+			limits[ix][16] = '_';
+			ad.Insert( limits[ix], tree );
+		}
+		return true;
+	}
+
 		// pack exprs into classad
 	buffer = "[";
 	for( int i = 0 ; i < numExprs ; i++ ) {
@@ -560,6 +689,9 @@ int putClassAd ( Stream *sock, classad::ClassAd& ad )
 	}
 #endif
 
+	if (peer_reads_binary_classads(sock)) {
+		return _putClassAdBinary(sock, ad, options, NULL);
+	}
 	return _putClassAd(sock, ad, options);
 }
 
@@ -916,12 +1048,15 @@ int putClassAd (Stream *sock, classad::ClassAd& ad, int options, const classad::
 		whitelist = &expanded_whitelist;
 	}
 
+	bool binary = peer_reads_binary_classads(sock);
 	bool non_blocking = (options & PUT_CLASSAD_NON_BLOCKING) != 0;
 	ReliSock* rsock = static_cast<ReliSock*>(sock);
 	if (non_blocking && rsock)
 	{
 		BlockingModeGuard guard(rsock, true);
-		if (whitelist) {
+		if (binary) {
+			retval = _putClassAdBinary(sock, ad, options, whitelist);
+		} else if (whitelist) {
 			retval = _putClassAd(sock, ad, options, *whitelist);
 		} else {
 			retval = _putClassAd(sock, ad, options);
@@ -931,7 +1066,9 @@ int putClassAd (Stream *sock, classad::ClassAd& ad, int options, const classad::
 	}
 	else // normal blocking mode put
 	{
-		if (whitelist) {
+		if (binary) {
+			retval = _putClassAdBinary(sock, ad, options, whitelist);
+		} else if (whitelist) {
 			retval = _putClassAd(sock, ad, options, *whitelist);
 		} else {
 			retval = _putClassAd(sock, ad, options);
@@ -1179,6 +1316,135 @@ int _putClassAd( Stream *sock, classad::ClassAd& ad, int options, const classad:
 	return _putClassAdTrailingInfo(sock, ad, send_server_time, excludeTypes);
 }
 
+// helper function for _putClassAdBinary
+static void _putClassAdBinaryAttr(Stream *sock, ClassAdBinaryWriter &writer, classad::ClassAdUnParser &unp,
+	std::string const &attr, classad::ExprTree *expr, bool secrets_apart, std::vector<std::string> &secrets)
+{
+	if (secrets_apart && compat_classad::ClassAdAttributeIsPrivate(attr.c_str())) {
+		std::string line = attr;
+		line += " = ";
+		unp.Unparse(line, expr);
+		secrets.push_back(line);
+		return;
+	}
+
+		// ConvertDefaultIPToSocketIP() rewrites "Name = expr" strings, so
+		// a string that may hold an address is unparsed to give it a look.
+	classad::ExprTree *letter = expr;
+	if (letter->GetKind() == classad::ExprTree::EXPR_ENVELOPE) {
+		letter = ((classad::CachedExprEnvelope*)letter)->get();
+	}
+	const char *str = NULL;
+	if (letter && letter->GetKind() == classad::ExprTree::LITERAL_NODE) {
+		classad::Value::NumberFactor factor;
+		((classad::Literal*)letter)->getValue(factor).IsStringValue(str);
+	}
+	if ( ! (str && str[0] == '<') && writer.Put(attr, expr)) {
+		return;
+	}
+
+	std::string line = attr;
+	line += " = ";
+	size_t prefix = line.size();
+	unp.Unparse(line, expr);
+	std::string unconverted;
+	if (str) {
+		unconverted = line;
+		ConvertDefaultIPToSocketIP(attr.c_str(), line, *sock);
+		if (line == unconverted && writer.Put(attr, expr)) {
+			return;
+		}
+	}
+	writer.PutText(attr, line.substr(prefix));
+}
+
+// Send the ad in the binary encoding (see classad_binary.h).  It has
+// the same attributes _putClassAd() would send.
+int _putClassAdBinary( Stream *sock, classad::ClassAd& ad, int options, const classad::References *whitelist)
+{
+	bool excludeTypes = (options & PUT_CLASSAD_NO_TYPES) == PUT_CLASSAD_NO_TYPES;
+	bool exclude_private = (options & PUT_CLASSAD_NO_PRIVATE) == PUT_CLASSAD_NO_PRIVATE;
+	bool secrets_apart = ! sock->prepare_crypto_for_secret_is_noop();
+
+	ClassAdBinaryNames local_names;
+	ClassAdBinaryNames *names = ClassAdBinaryNames::ForStream(sock);
+	if ( ! names) {
+		names = &local_names;
+	}
+	ClassAdBinaryWriter writer(*names);
+
+	classad::ClassAdUnParser unp;
+	unp.SetOldClassAd( true, true );
+	std::vector<std::string> secrets;
+
+	if (whitelist) {
+		for (classad::References::const_iterator attr = whitelist->begin(); attr != whitelist->end(); ++attr) {
+			classad::ExprTree *expr = ad.Lookup(*attr);
+			if ( ! expr || (exclude_private && compat_classad::ClassAdAttributeIsPrivate(attr->c_str()))) {
+				continue;
+			}
+			if (publish_server_timeMangled && strcasecmp(attr->c_str(), ATTR_SERVER_TIME) == 0) {
+				continue;
+			}
+			_putClassAdBinaryAttr(sock, writer, unp, *attr, expr, secrets_apart, secrets);
+		}
+	} else {
+			// the chained attrs first, so that the ad's own attrs
+			// override them
+		classad::ClassAd *chainedAd = ad.GetChainedParentAd();
+		for (int pass = 0; pass < 2; pass++) {
+			classad::ClassAd *from = pass ? &ad : chainedAd;
+			if ( ! from) {
+				continue;
+			}
+			for (classad::ClassAd::iterator itor = from->begin(); itor != from->end(); ++itor) {
+				std::string const &attr = itor->first;
+				if (strcasecmp(ATTR_CURRENT_TIME, attr.c_str()) == 0) {
+					continue;
+				}
+				if (exclude_private && compat_classad::ClassAdAttributeIsPrivate(attr.c_str())) {
+					continue;
+				}
+				if (excludeTypes && (strcasecmp(ATTR_MY_TYPE, attr.c_str()) == 0 ||
+									 strcasecmp(ATTR_TARGET_TYPE, attr.c_str()) == 0)) {
+					continue;
+				}
+				_putClassAdBinaryAttr(sock, writer, unp, attr, itor->second, secrets_apart, secrets);
+			}
+		}
+	}
+
+	if (publish_server_timeMangled) {
+			// see _putClassAdTrailingInfo()
+		classad::Literal *now = classad::Literal::MakeLong(time(NULL));
+		writer.Put(ATTR_SERVER_TIME, now);
+		delete now;
+	}
+
+	std::string header;
+	writer.GetHeader(header);
+	std::string const &body = writer.Body();
+	int marker = BINARY_CLASSAD_MARKER;
+	int len = (int)(header.size() + body.size());
+	int num_secrets = (int)secrets.size();
+
+	sock->encode( );
+	if ( ! sock->code(marker) || ! sock->code(len) ||
+		 sock->put_bytes(header.data(), (int)header.size()) != (int)header.size() ||
+		 ( ! body.empty() && sock->put_bytes(body.data(), (int)body.size()) != (int)body.size()) ||
+		 ! sock->code(num_secrets))
+	{
+		return false;
+	}
+	for (size_t ix = 0; ix < secrets.size(); ++ix) {
+		if ( ! sock->put_secret(secrets[ix].c_str())) {
+			return false;
+		}
+	}
+
+	return _putClassAdTrailingInfo(sock, ad, false, excludeTypes);
+}
+
 bool EvalTree(classad::ExprTree* eTree, classad::ClassAd* mine, classad::Value* v)
 {
     return EvalTree(eTree, mine, NULL, v);
@@ -36,6 +36,11 @@ class ReliSock;
 
 void AttrList_setPublishServerTimeMangled( bool publish);
 
+// Enable or disable sending ClassAds in the binary encoding (see
+// classad_binary.h) to peers that can read it.  Ads in that encoding
+// are always accepted.
+void AttrList_setBinaryEncoding( bool enable );
+
 namespace compat_classad { class ClassAd; } //forward declaration
 compat_classad::ClassAd* getClassAd( Stream *sock );
 
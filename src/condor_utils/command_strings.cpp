@@ -242,6 +242,7 @@ const struct Translation DCTranslation[] = {
 	{ "QUERY_JOB_ADS", QUERY_JOB_ADS },
 	{ "SWAP_CLAIM_AND_ACTIVATION", SWAP_CLAIM_AND_ACTIVATION },
 	{ "FETCH_PROXY_DELEGATION", FETCH_PROXY_DELEGATION },
+	{ "SEND_FULL_STARTD_UPDATE", SEND_FULL_STARTD_UPDATE },
 	{ "", 0 }
 };
 
@@ -306,6 +307,8 @@ const struct Translation CollectorTranslation[] = {
 	{ "QUERY_GRID_ADS", QUERY_GRID_ADS },
 	{ "INVALIDATE_GRID_ADS", INVALIDATE_GRID_ADS },
 	{ "MERGE_STARTD_AD", MERGE_STARTD_AD },
+	{ "UPDATE_STARTD_AD_DELTA", UPDATE_STARTD_AD_DELTA },
+	{ "UPDATE_STARTD_ADS", UPDATE_STARTD_ADS },
 	{ "UPDATE_QUILL_AD", UPDATE_QUILL_AD },
 	{ "QUERY_QUILL_ADS", QUERY_QUILL_ADS },
 	{ "INVALIDATE_QUILL_ADS", INVALIDATE_QUILL_ADS },
@@ -73,6 +73,12 @@ Reconfig()
 
 	classad::ClassAdSetExpressionCaching( param_boolean( "ENABLE_CLASSAD_CACHING", false ) );
 
+	classad::SetRegexCacheSize( param_integer( "CLASSAD_REGEX_CACHE_SIZE", 1000, 0 ) );
+
+	classad::AttrName::SetTableLimit( param_integer( "CLASSAD_ATTR_NAME_TABLE_SIZE", 250000, 0 ) );
+
+	AttrList_setBinaryEncoding( param_boolean( "ENABLE_BINARY_CLASSAD_ENCODING", true ) );
+
 	char *new_libs = param( "CLASSAD_USER_LIBS" );
 	if ( new_libs ) {
 		StringList new_libs_list( new_libs );
@@ -134,7 +140,8 @@ Reconfig()
 static classad::MatchClassAd *the_match_ad = NULL;
 static bool the_match_ad_in_use = false;
 classad::MatchClassAd *getTheMatchAd( classad::ClassAd *source,
-									  classad::ClassAd *target )
+									  classad::ClassAd *target,
+									  bool compile_source )
 {
 	ASSERT( !the_match_ad_in_use );
 	the_match_ad_in_use = true;
@@ -142,6 +149,7 @@ classad::MatchClassAd *getTheMatchAd( classad::ClassAd *source,
 	if( !the_match_ad ) {
 		the_match_ad = new classad::MatchClassAd( );
 	}
+	the_match_ad->SetCompiledEval( compile_source, false );
 	the_match_ad->ReplaceLeftAd( source );
 	the_match_ad->ReplaceRightAd( target );
 
@@ -166,6 +174,14 @@ void releaseTheMatchAd()
 	the_match_ad_in_use = false;
 }
 
+void flushTheMatchAdCompiledExprs()
+{
+	ASSERT( !the_match_ad_in_use );
+	if( the_match_ad ) {
+		the_match_ad->FlushCompiledExprs();
+	}
+}
+
 
 static
 bool stringListSize_func( const char * /*name*/,
@@ -659,9 +659,15 @@ void SetTargetTypeName(classad::ClassAd &ad, const char *);
 const char*	GetTargetTypeName(const classad::ClassAd& ad);
 
 
+// If compile_source is true, the source ad's Requirements are evaluated
+// through compiled programs, which the match ad caches by expression until
+// flushTheMatchAdCompiledExprs() is called.  The cache must be flushed
+// before a source ad matched this way is modified or deleted.
 classad::MatchClassAd *getTheMatchAd( classad::ClassAd *source,
-									  classad::ClassAd *target );
+									  classad::ClassAd *target,
+									  bool compile_source = false );
 void releaseTheMatchAd();
+void flushTheMatchAdCompiledExprs();
 
 
 // Modify all expressions in the given ad, such that if they refer
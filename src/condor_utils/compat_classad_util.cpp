@@ -277,6 +277,206 @@ bool IsValidClassAdExpression(const char * str, classad::References * attrs /*=N
 	return rval == 0;
 }
 
+// walk an ExprTree looking for calls to time() and references to CurrentTime
+//
+static bool walk_time_refs(const classad::ExprTree * tree, classad::References * attrs)
+{
+	bool timed = false;
+	if ( ! tree) return false;
+	switch (tree->GetKind()) {
+		case classad::ExprTree::LITERAL_NODE: {
+			classad::ClassAd * ad;
+			classad::Value val;
+			classad::Value::NumberFactor	factor;
+			((const classad::Literal*)tree)->GetComponents( val, factor );
+			if (val.IsClassAdValue(ad)) {
+				timed = walk_time_refs(ad, attrs);
+			}
+		}
+		break;
+
+		case classad::ExprTree::ATTRREF_NODE: {
+			classad::ExprTree *expr;
+			std::string ref;
+			bool absolute;
+			std::string scope;
+			((const classad::AttributeReference*)tree)->GetComponents(expr, ref, absolute);
+			// for a scoped reference like MY.X, X is the attribute that matters
+			if (expr && ! ExprTreeIsAttrRef(expr, scope)) {
+				timed = walk_time_refs(expr, attrs);
+			} else {
+				if (strcasecmp(ref.c_str(), "CurrentTime") == 0) timed = true;
+				if (attrs) attrs->insert(ref);
+			}
+		}
+		break;
+
+		case classad::ExprTree::OP_NODE: {
+			classad::Operation::OpKind	op;
+			classad::ExprTree *t1, *t2, *t3;
+			((const classad::Operation*)tree)->GetComponents( op, t1, t2, t3 );
+			if (t1 && walk_time_refs(t1, attrs)) timed = true;
+			if (t2 && walk_time_refs(t2, attrs)) timed = true;
+			if (t3 && walk_time_refs(t3, attrs)) timed = true;
+		}
+		break;
+
+		case classad::ExprTree::FN_CALL_NODE: {
+			std::string fnName;
+			std::vector<classad::ExprTree*> args;
+			((const classad::FunctionCall*)tree)->GetComponents( fnName, args );
+			if (strcasecmp(fnName.c_str(), "time") == 0) timed = true;
+			for (std::vector<classad::ExprTree*>::iterator it = args.begin(); it != args.end(); ++it) {
+				if (walk_time_refs(*it, attrs)) timed = true;
+			}
+		}
+		break;
+
+		case classad::ExprTree::CLASSAD_NODE: {
+			std::vector< std::pair<std::string, classad::ExprTree*> > attrs_list;
+			((const classad::ClassAd*)tree)->GetComponents(attrs_list);
+			for (std::vector< std::pair<std::string, classad::ExprTree*> >::iterator it = attrs_list.begin(); it != attrs_list.end(); ++it) {
+				if (walk_time_refs(it->second, attrs)) timed = true;
+			}
+		}
+		break;
+
+		case classad::ExprTree::EXPR_LIST_NODE: {
+			std::vector<classad::ExprTree*> exprs;
+			((const classad::ExprList*)tree)->GetComponents( exprs );
+			for (std::vector<classad::ExprTree*>::iterator it = exprs.begin(); it != exprs.end(); ++it) {
+				if (walk_time_refs(*it, attrs)) timed = true;
+			}
+		}
+		break;
+
+		case classad::ExprTree::EXPR_ENVELOPE: {
+			classad::ExprTree * expr = SkipExprEnvelope(const_cast<classad::ExprTree*>(tree));
+			if (expr) timed = walk_time_refs(expr, attrs);
+		}
+		break;
+
+		default:
+		break;
+	}
+	return timed;
+}
+
+bool ExprTreeIsTimeDependent(classad::ExprTree * expr, classad::References * attrs /*=NULL*/)
+{
+	return walk_time_refs(expr, attrs);
+}
+
+// returns true if tree is time() or CurrentTime, or that minus something else,
+// in which case offset is set to the something else, or to NULL
+static bool is_time_minus_offset(classad::ExprTree * tree, classad::ExprTree *& offset)
+{
+	offset = NULL;
+	tree = SkipExprParens(tree);
+	if (tree->GetKind() == classad::ExprTree::OP_NODE) {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((const classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+		if (op != classad::Operation::SUBTRACTION_OP || ! t1 || ! t2 || walk_time_refs(t2, NULL)) {
+			return false;
+		}
+		offset = t2;
+		tree = SkipExprParens(t1);
+	}
+	if (tree->GetKind() == classad::ExprTree::FN_CALL_NODE) {
+		std::string fnName;
+		std::vector<classad::ExprTree*> args;
+		((const classad::FunctionCall*)tree)->GetComponents(fnName, args);
+		return args.empty() && strcasecmp(fnName.c_str(), "time") == 0;
+	}
+	if (tree->GetKind() == classad::ExprTree::ATTRREF_NODE) {
+		classad::ExprTree *expr;
+		std::string ref, scope;
+		bool absolute;
+		((const classad::AttributeReference*)tree)->GetComponents(expr, ref, absolute);
+		return ( ! expr || ExprTreeIsAttrRef(expr, scope)) && strcasecmp(ref.c_str(), "CurrentTime") == 0;
+	}
+	return false;
+}
+
+// walk an ExprTree looking for comparisons of the time against a bound, see ExprTreeNextTimeChange
+//
+static bool walk_time_changes(classad::ExprTree * tree, classad::ClassAd & ad, time_t now, time_t & next_change)
+{
+	if ( ! tree || ! walk_time_refs(tree, NULL)) return true;
+	switch (tree->GetKind()) {
+		case classad::ExprTree::OP_NODE: {
+			classad::Operation::OpKind	op;
+			classad::ExprTree *t1, *t2, *t3;
+			((const classad::Operation*)tree)->GetComponents( op, t1, t2, t3 );
+			if (op >= classad::Operation::LESS_THAN_OP && op <= classad::Operation::GREATER_THAN_OP &&
+				op != classad::Operation::NOT_EQUAL_OP && op != classad::Operation::EQUAL_OP) {
+				// put the time on the left, so that it reads  time() - offset op limit
+				classad::ExprTree * offset = NULL;
+				classad::ExprTree * limit = t2;
+				if ( ! is_time_minus_offset(t1, offset)) {
+					if ( ! is_time_minus_offset(t2, offset)) return false;
+					limit = t1;
+					switch (op) {
+						case classad::Operation::LESS_THAN_OP: op = classad::Operation::GREATER_THAN_OP; break;
+						case classad::Operation::LESS_OR_EQUAL_OP: op = classad::Operation::GREATER_OR_EQUAL_OP; break;
+						case classad::Operation::GREATER_OR_EQUAL_OP: op = classad::Operation::LESS_OR_EQUAL_OP; break;
+						default: op = classad::Operation::LESS_THAN_OP; break;
+					}
+				}
+				if (walk_time_refs(limit, NULL)) return false;
+
+				// so it compares time() to offset + limit.  if either isn't a number,
+				// neither is the comparison, whatever the time.
+				classad::Value val;
+				double off = 0, bound = 0;
+				if (offset && ( ! ad.EvaluateExpr(offset, val) || ! val.IsNumber(off))) return true;
+				if ( ! ad.EvaluateExpr(limit, val) || ! val.IsNumber(bound)) return true;
+				bound += off;
+
+				// the time is a whole number of seconds, so > and <= change
+				// one second after bound, and >= and < change at bound
+				time_t change;
+				if (op == classad::Operation::GREATER_THAN_OP || op == classad::Operation::LESS_OR_EQUAL_OP) {
+					change = (time_t)floor(bound) + 1;
+				} else {
+					change = (time_t)ceil(bound);
+				}
+				if (change > now && ( ! next_change || change < next_change)) {
+					next_change = change;
+				}
+				return true;
+			}
+			return walk_time_changes(t1, ad, now, next_change) &&
+				walk_time_changes(t2, ad, now, next_change) &&
+				walk_time_changes(t3, ad, now, next_change);
+		}
+
+		case classad::ExprTree::FN_CALL_NODE: {
+			std::string fnName;
+			std::vector<classad::ExprTree*> args;
+			((const classad::FunctionCall*)tree)->GetComponents( fnName, args );
+			if (strcasecmp(fnName.c_str(), "time") == 0) return false;
+			for (std::vector<classad::ExprTree*>::iterator it = args.begin(); it != args.end(); ++it) {
+				if ( ! walk_time_changes(*it, ad, now, next_change)) return false;
+			}
+			return true;
+		}
+
+		case classad::ExprTree::EXPR_ENVELOPE:
+			return walk_time_changes(SkipExprEnvelope(tree), ad, now, next_change);
+
+		default:
+			// CurrentTime, or the time inside a nested ad or list
+			return false;
+	}
+}
+
+bool ExprTreeNextTimeChange(classad::ExprTree * expr, classad::ClassAd & ad, time_t now, time_t & next_change)
+{
+	return walk_time_changes(expr, ad, now, next_change);
+}
+
 // walk an ExprTree, calling a function each time a ATTRREF_NODE is found.
 //
 int walk_attr_refs (
@@ -647,9 +847,9 @@ int EvalExprTree( classad::ExprTree *expr, compat_classad::ClassAd *source,
 	return rc;
 }
 
-bool IsAMatch( compat_classad::ClassAd *ad1, compat_classad::ClassAd *ad2 )
+bool IsAMatch( compat_classad::ClassAd *ad1, compat_classad::ClassAd *ad2, bool compile_ad1 )
 {
-	classad::MatchClassAd *mad = compat_classad::getTheMatchAd( ad1, ad2 );
+	classad::MatchClassAd *mad = compat_classad::getTheMatchAd( ad1, ad2, compile_ad1 );
 
 	bool result = mad->symmetricMatch();
 
@@ -44,6 +44,18 @@ bool ExprTreeIsAttrRef(classad::ExprTree * expr, std::string & attr, bool * is_a
 // if attrs is not NULL, it also adds attribute references from the expression into the current set.
 bool IsValidClassAdExpression(const char * expr, classad::References * attrs=NULL, classad::References *scopes=NULL);
 
+// returns true if the value of the expression can change with the passage of time alone,
+// that is, if it calls time() or refers to CurrentTime.
+// if attrs is not NULL, it also adds attribute references from the expression into the current set.
+bool ExprTreeIsTimeDependent(classad::ExprTree * expr, classad::References * attrs=NULL);
+
+// for an expression that uses the time only in comparisons like  time() - X > C  or  CurrentTime > C,
+// with any ordering comparison and the time on either side, sets next_change to the earliest time
+// after now at which one of those comparisons can change value, if that is sooner than next_change
+// or next_change is 0.  X and C are evaluated in ad, and the attributes they refer to are assumed
+// not to change with the time.  returns false if the expression uses the time in any other way.
+bool ExprTreeNextTimeChange(classad::ExprTree * expr, classad::ClassAd & ad, time_t now, time_t & next_change);
+
 typedef std::map<std::string, std::string, classad::CaseIgnLTStr> NOCASE_STRING_MAP;
 // edit the given expr changing attribute references as the mapping indicates
 // for instance if mapping["TARGET"] = "My" it will change all instance of "TARGET" to "MY"
@@ -70,7 +82,9 @@ int EvalExprTree( classad::ExprTree *expr, compat_classad::ClassAd *source,
 				  compat_classad::ClassAd *target, classad::Value &result );
 
 //ad2 treated as candidate to match against ad1, so we want to find a match for ad1
-bool IsAMatch( compat_classad::ClassAd *ad1, compat_classad::ClassAd *ad2 );
+//if compile_ad1 is true, ad1's Requirements are compiled and cached until
+//compat_classad::flushTheMatchAdCompiledExprs() is called
+bool IsAMatch( compat_classad::ClassAd *ad1, compat_classad::ClassAd *ad2, bool compile_ad1 = false );
 
 bool IsAHalfMatch( compat_classad::ClassAd *my, compat_classad::ClassAd *target );
 
@@ -143,6 +143,12 @@ const MACRO_SOURCE DefaultMacro  = { true,  false, 1, -2, -1, -2 };
 const MACRO_SOURCE EnvMacro      = { false, false, 2, -2, -1, -2 };
 const MACRO_SOURCE WireMacro     = { false, false, 3, -2, -1, -2 };
 
+// bumped whenever ConfigMacroSet changes, so that param_cached<T>
+// handles know to look their value up again.  0 is never a generation.
+static unsigned int ConfigGeneration = 1;
+static void config_changed() { if (++ConfigGeneration == 0) ConfigGeneration = 1; }
+unsigned int param_config_generation() { return ConfigGeneration; }
+
 #ifdef _POOL_ALLOCATOR
 
 // set the initial size of the system allocation for an empty allocation hunk
@@ -1194,6 +1200,7 @@ real_config(const char* host, int wantsQuiet, int config_options)
 		// Re-initialize the ClassAd compat data (in case if CLASSAD_USER_LIBS is set).
 	ClassAd::Reconfig();
 
+	config_changed();
 	return true;
 }
 
@@ -1894,6 +1901,7 @@ param_insert(const char * name, const char * value)
 	MACRO_EVAL_CONTEXT ctx;
 	init_macro_eval_context(ctx);
 	insert_macro(name, value, ConfigMacroSet, WireMacro, ctx);
+	config_changed();
 }
 
 // set the value of a param equal to the given pointer. if the param is
@@ -1920,6 +1928,7 @@ const char * set_live_param_value(const char * name, const char * live_value)
 	} else {
 		pitem->raw_value = live_value;
 	}
+	config_changed();
 	return old_value;
 }
 
@@ -1975,6 +1984,7 @@ clear_config()
 	}
 	ConfigMacroSet.size = 0;
 	ConfigMacroSet.sorted = 0;
+	config_changed();
 	ConfigMacroSet.apool.clear();
 	ConfigMacroSet.sources.clear();
 	if (ConfigMacroSet.defaults && ConfigMacroSet.defaults->metat) {
@@ -2890,6 +2900,7 @@ config_insert( const char* attrName, const char* attrValue )
 	MACRO_EVAL_CONTEXT ctx;
 	init_macro_eval_context(ctx);
 	insert_macro(attrName, attrValue, ConfigMacroSet, WireMacro, ctx);
+	config_changed();
 }
 
 int macro_stats(MACRO_SET& set, struct _macro_stats &stats)
@@ -553,12 +553,12 @@ static void formatUsageAd( std::string &out, ClassAd * pusageAd )
 		int ixu = (int)iter->first.size() - 5; // size "Usage" == 5
 		std::string key = "";
 		int efld = -1;
-		if (0 == iter->first.find("Request")) {
-			key = iter->first.substr(7); // size "Request" == 7
+		if (0 == iter->first.str().find("Request")) {
+			key = iter->first.str().substr(7); // size "Request" == 7
 			efld = 1;
-		} else if (ixu > 0 && 0 == iter->first.substr(ixu).compare("Usage")) {
+		} else if (ixu > 0 && 0 == iter->first.str().substr(ixu).compare("Usage")) {
 			efld = 0;
-			key = iter->first.substr(0,ixu);
+			key = iter->first.str().substr(0,ixu);
 		} 
 		else /*if (useMap[iter->first])*/ { // Allocated
 			efld = 2;
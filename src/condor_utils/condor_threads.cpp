@@ -252,6 +252,7 @@ WorkerThread::WorkerThread()
 	tid_ = 0;
 	enable_parallel_flag_ = false;
 	parallel_mode_count_ = 0;
+	state_exclusive_count_ = 0;
 	status_ = THREAD_UNBORN;
 }
 
@@ -264,6 +265,7 @@ WorkerThread::WorkerThread(const char* name, condor_thread_func_t routine, void*
 	tid_ = 0;
 	enable_parallel_flag_ = false;
 	parallel_mode_count_ = 0;
+	state_exclusive_count_ = 0;
 	status_ = THREAD_UNBORN;
 
 
@@ -500,6 +502,11 @@ ThreadImplementation::hashFuncThreadInfo(const ThreadInfo & mythread)
 int
 ThreadImplementation::yield()
 {
+	// Inside a thread safe block we do not have the big lock to give up.
+	if ( get_handle()->parallel_mode_count_ > 0 ) {
+		return 1;
+	}
+
 	// Let someone else run...
 	if ( get_handle()->status_ == WorkerThread::THREAD_RUNNING ) {
 		get_handle()->set_status( WorkerThread::THREAD_READY );
@@ -817,6 +824,12 @@ ThreadImplementation::ThreadImplementation()
 	pthread_mutex_init(&big_lock,&mutex_attrs);
 	pthread_mutex_init(&get_handle_lock,&mutex_attrs);
 	pthread_mutex_init(&set_status_lock,&mutex_attrs);
+	pthread_mutex_init(&state_lock,NULL);
+	pthread_mutex_init(&state_readers_lock,NULL);
+	pthread_cond_init(&state_cond,NULL);
+	state_readers_ = 0;
+	state_writers_waiting_ = 0;
+	state_writer_ = false;
 	pthread_cond_init(&work_queue_cond,NULL);
 	pthread_cond_init(&workers_avail_cond,NULL);	
 	initCurrentTid();
@@ -829,6 +842,8 @@ ThreadImplementation::~ThreadImplementation()
 	pthread_mutex_destroy(&big_lock);
 	pthread_mutex_destroy(&get_handle_lock);
 	pthread_mutex_destroy(&set_status_lock);
+	pthread_mutex_destroy(&state_lock);
+	pthread_mutex_destroy(&state_readers_lock);
 #ifndef WIN32
 	pthread_key_delete(m_CurrentTidKey);
 #endif
@@ -840,8 +855,10 @@ ThreadImplementation::pool_init()
 {
 	int i;
 	
-		// For now, only allow the COLLECTOR to have a thread pool.
-	if ( strcmp(get_mySubSystem()->getName(),"COLLECTOR")==0 ) {
+		// For now, only allow the COLLECTOR and the SCHEDD to have a
+		// thread pool; both answer queries on it.
+	if ( strcmp(get_mySubSystem()->getName(),"COLLECTOR")==0 ||
+		 strcmp(get_mySubSystem()->getName(),"SCHEDD")==0 ) {
 		num_threads_ = param_integer("THREAD_WORKER_POOL_SIZE",0,0);
 	} else {
 		num_threads_ = 0;
@@ -894,30 +911,21 @@ ThreadImplementation::start_thread_safe_block()
 	// note: get_handle() should be thread safe at this point.
 	WorkerThreadPtr_t context = get_handle();
 
+	// note: we should be able to safely  mess with parallel_mode_count_
+	// since the end user is not able to twiddle with it (it is private).
+	// Blocks nest; only the outermost one gives up the big lock.
+	if ( context->parallel_mode_count_ > 0 ) {
+		context->parallel_mode_count_ += 1;
+		return 0;
+	}
+
 	// TODO - perhaps protect parallel flag?
 	if (!context->enable_parallel_flag_) {
 		// parallel mode disabled; this method should be a no-op
 		return 1;
 	}
 
-#if 0 // until we fix how this interacts w/ yield
-	// TODO --- record global process state here if not yet parallel?
-
-	// note: we should be able to safely  mess with parallel_mode_count_
-	// since the end user is not able to twiddle with it (it is private).
-	context->parallel_mode_count_ += 1;
-
-	// is ASSERT/EXCEPT thread safe?  dunno, but not much we can do.
-	if ( context->parallel_mode_count_ < 1 ) {		
-		EXCEPT("Thread %d has thread safe block mismatch",context->tid_);
-	}
-	
-	
-	if ( context->parallel_mode_count_ == 1 ) {
-		// lord help us.  release the big lock!
-		mutex_biglock_unlock();
-	}
-#endif
+	context->parallel_mode_count_ = 1;
 
 	// TODO - once set_status is for certain thread safe, perhaps
 	// we should set the status of the thread to IO.
@@ -936,28 +944,15 @@ ThreadImplementation::stop_thread_safe_block()
 	// note: get_handle() should be thread safe at this point.
 	WorkerThreadPtr_t context = get_handle();
 
-	// TODO - perhaps protect parallel flag?
-	if (!context->enable_parallel_flag_) {
-		// parallel mode disabled; this method should be a no-op
+	if ( context->parallel_mode_count_ < 1 ) {
+		// not in a thread safe block; this method should be a no-op
 		return 1;
 	}
 
-#if 0 // until we fix how this interacts w/ yield
-	// note: we should be able to safely  mess with parallel_mode_count_
-	// since the end user is not able to twiddle with it (it is private).
 	context->parallel_mode_count_ -= 1;
-
-	// is ASSERT/EXCEPT thread safe?  dunno, but not much we can do.
-	if ( context->parallel_mode_count_ < 0 ) {
-		EXCEPT("Thread %d has thread safe block mismatch",context->tid_);
-	}
-
-	if ( context->parallel_mode_count_ == 0 ) {
-		context->set_status( WorkerThread::THREAD_READY );
-		// block until we can grab our big lock
-		mutex_biglock_lock();
+	if ( context->parallel_mode_count_ > 0 ) {
+		return 0;
 	}
-#endif
 
 	mutex_biglock_lock();
 		// don't use context anymore, we are now in a different thread!
@@ -966,6 +961,104 @@ ThreadImplementation::stop_thread_safe_block()
 	return 0;
 }
 
+void
+ThreadImplementation::lock_state_exclusive()
+{
+	// The caller has the big lock.
+	WorkerThreadPtr_t context = get_handle();
+
+	context->state_exclusive_count_ += 1;
+	if ( context->state_exclusive_count_ > 1 ) {
+		return;
+	}
+
+	pthread_mutex_lock(&state_lock);
+	if ( state_writer_ || state_readers_ > 0 ) {
+		// Wait without the big lock: the readers do not need it to
+		// finish, but a thread that left the big lock while holding
+		// the state lock exclusively needs it back before it can
+		// release the state lock.
+		state_writers_waiting_++;
+		if ( context->status_ == WorkerThread::THREAD_RUNNING ) {
+			context->set_status( WorkerThread::THREAD_READY );
+		}
+		mutex_biglock_unlock();
+		while ( state_writer_ || state_readers_ > 0 ) {
+			pthread_cond_wait(&state_cond,&state_lock);
+		}
+		state_writers_waiting_--;
+		state_writer_ = true;
+		pthread_mutex_unlock(&state_lock);
+
+		mutex_biglock_lock();
+		get_handle()->set_status( WorkerThread::THREAD_RUNNING );
+		return;
+	}
+	state_writer_ = true;
+	pthread_mutex_unlock(&state_lock);
+}
+
+bool
+ThreadImplementation::holds_state_exclusive()
+{
+	return get_handle()->state_exclusive_count_ > 0;
+}
+
+void
+ThreadImplementation::unlock_state_exclusive()
+{
+	WorkerThreadPtr_t context = get_handle();
+
+	if ( context->state_exclusive_count_ < 1 ) {
+		EXCEPT("Thread %d has daemon state lock mismatch",context->tid_);
+	}
+	context->state_exclusive_count_ -= 1;
+	if ( context->state_exclusive_count_ > 0 ) {
+		return;
+	}
+
+	pthread_mutex_lock(&state_lock);
+	state_writer_ = false;
+	pthread_cond_broadcast(&state_cond);
+	pthread_mutex_unlock(&state_lock);
+}
+
+void
+ThreadImplementation::lock_state_shared()
+{
+	// The caller does not have the big lock.  Waiting writers go
+	// first, so a steady stream of readers cannot starve them.
+	pthread_mutex_lock(&state_lock);
+	while ( state_writer_ || state_writers_waiting_ > 0 ) {
+		pthread_cond_wait(&state_cond,&state_lock);
+	}
+	state_readers_++;
+	pthread_mutex_unlock(&state_lock);
+}
+
+void
+ThreadImplementation::unlock_state_shared()
+{
+	pthread_mutex_lock(&state_lock);
+	state_readers_--;
+	if ( state_readers_ == 0 ) {
+		pthread_cond_broadcast(&state_cond);
+	}
+	pthread_mutex_unlock(&state_lock);
+}
+
+void
+ThreadImplementation::lock_state_readers()
+{
+	pthread_mutex_lock(&state_readers_lock);
+}
+
+void
+ThreadImplementation::unlock_state_readers()
+{
+	pthread_mutex_unlock(&state_readers_lock);
+}
+
 void
 ThreadImplementation::remove_tid(int tid)
 {
@@ -1022,6 +1115,41 @@ int ThreadImplementation::stop_thread_safe_block()
 	return -1;
 }
 
+void ThreadImplementation::lock_state_exclusive()
+{
+	return;
+}
+
+void ThreadImplementation::unlock_state_exclusive()
+{
+	return;
+}
+
+bool ThreadImplementation::holds_state_exclusive()
+{
+	return false;
+}
+
+void ThreadImplementation::lock_state_shared()
+{
+	return;
+}
+
+void ThreadImplementation::unlock_state_shared()
+{
+	return;
+}
+
+void ThreadImplementation::lock_state_readers()
+{
+	return;
+}
+
+void ThreadImplementation::unlock_state_readers()
+{
+	return;
+}
+
 int ThreadImplementation::yield() 
 {
 	return -1;
@@ -1127,6 +1255,55 @@ CondorThreads::stop_thread_safe_block()
 	return TI->stop_thread_safe_block();
 }
 
+void
+CondorThreads::lock_state_exclusive()
+{
+	if (!TI) return;
+	TI->lock_state_exclusive();
+}
+
+void
+CondorThreads::unlock_state_exclusive()
+{
+	if (!TI) return;
+	TI->unlock_state_exclusive();
+}
+
+bool
+CondorThreads::holds_state_exclusive()
+{
+	if (!TI) return false;
+	return TI->holds_state_exclusive();
+}
+
+void
+CondorThreads::lock_state_shared()
+{
+	if (!TI) return;
+	TI->lock_state_shared();
+}
+
+void
+CondorThreads::unlock_state_shared()
+{
+	if (!TI) return;
+	TI->unlock_state_shared();
+}
+
+void
+CondorThreads::lock_state_readers()
+{
+	if (!TI) return;
+	TI->lock_state_readers();
+}
+
+void
+CondorThreads::unlock_state_readers()
+{
+	if (!TI) return;
+	TI->unlock_state_readers();
+}
+
 int 
 CondorThreads::yield()
 {
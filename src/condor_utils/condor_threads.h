@@ -96,6 +96,7 @@ private:
 	int tid_;
 	bool enable_parallel_flag_;
 	int parallel_mode_count_;
+	int state_exclusive_count_;
 	thread_status_t status_;	// use set_status(), get_status()
 };
 
@@ -119,6 +120,26 @@ public:
 	static int stop_thread_safe_block();
 
 	inline static bool enable_parallel(bool flag) {return get_handle()->enable_parallel(flag); }
+
+	/** The daemon state lock lets command handlers that only read the
+		daemon's state run on pool threads without the big lock, while
+		everything else that runs under the big lock keeps seeing that
+		state change only one handler at a time.  Code holding the big
+		lock takes it exclusively around anything that may change the
+		daemon's state; exclusive locks nest, and waiting for one
+		releases the big lock.  A reader takes it shared after leaving
+		the big lock (see start_thread_safe_block()), and may use
+		lock_state_readers() to serialize the few things readers
+		still change among themselves, such as statistics.
+		All of these are no-ops unless the thread pool is enabled.
+	*/
+	static void lock_state_exclusive();
+	static void unlock_state_exclusive();
+	static bool holds_state_exclusive();
+	static void lock_state_shared();
+	static void unlock_state_shared();
+	static void lock_state_readers();
+	static void unlock_state_readers();
 };
 
 class EnableParallel
@@ -133,6 +154,13 @@ private:
 
 };
 
+class ExclusiveStateAccess
+{
+public:
+	ExclusiveStateAccess() { CondorThreads::lock_state_exclusive(); }
+	~ExclusiveStateAccess() { CondorThreads::unlock_state_exclusive(); }
+};
+
 #endif // __cplusplus
 
 #endif // _CONDOR_THREADS_H
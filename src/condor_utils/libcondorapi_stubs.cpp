@@ -286,6 +286,8 @@ void Stream::set_deadline_timeout(int){not_impl();}
 void Stream::set_deadline(time_t){not_impl();}
 time_t Stream::get_deadline() const{not_impl();return 0;}
 bool Stream::deadline_expired() const{not_impl();return false;}
+CondorVersionInfo const *Stream::get_peer_version() const{not_impl();return NULL;}
+char const *Stream::peer_description() const{not_impl();return "";}
 
 
 /* stubs for generic query object */
@@ -61,6 +61,7 @@ bool valid_record_optype(int optype) {
         case CondorLogOp_BeginTransaction:
         case CondorLogOp_EndTransaction:
         case CondorLogOp_LogHistoricalSequenceNumber:
+        case CondorLogOp_LogSnapshot:
             return true;
         default:
             return false;
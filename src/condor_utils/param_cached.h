@@ -0,0 +1,100 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2017, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _PARAM_CACHED_H
+#define _PARAM_CACHED_H
+
+#include "condor_config.h"
+
+/* param_cached<T> is a handle on a config knob for code that reads it
+ * far more often than the configuration changes, such as once per job
+ * or per machine in a scheduling loop.  The value is looked up with
+ * param_boolean(), param_integer() or param_double() the first time,
+ * and again only after a reconfig (or a param_insert()).  Checking
+ * costs one integer compare.
+ *
+ *     static param_cached<bool> consider_limits("CLAIM_RECYCLING_CONSIDER_LIMITS", true);
+ *     if (consider_limits) { ... }
+ *
+ * Not thread safe: a handle must not be read by two threads at once.
+ */
+
+inline void param_cached_lookup(const char *name, bool default_value, bool, bool, bool &value)
+{
+	value = param_boolean(name, default_value);
+}
+
+inline void param_cached_lookup(const char *name, int default_value, int min_value, int max_value, int &value)
+{
+	value = param_integer(name, default_value, min_value, max_value);
+}
+
+inline void param_cached_lookup(const char *name, double default_value, double min_value, double max_value, double &value)
+{
+	value = param_double(name, default_value, min_value, max_value);
+}
+
+template <class T>
+class param_cached {
+ public:
+	param_cached(const char *name, T default_value)
+		: m_name(name), m_default(default_value),
+		  m_min(default_min()), m_max(default_max()),
+		  m_value(default_value), m_generation(0) {}
+
+	param_cached(const char *name, T default_value, T min_value, T max_value)
+		: m_name(name), m_default(default_value),
+		  m_min(min_value), m_max(max_value),
+		  m_value(default_value), m_generation(0) {}
+
+	T get() {
+		unsigned int generation = param_config_generation();
+		if (generation != m_generation) {
+			param_cached_lookup(m_name, m_default, m_min, m_max, m_value);
+			m_generation = generation;
+		}
+		return m_value;
+	}
+	operator T() { return get(); }
+
+		// look the value up again on the next get()
+	void invalidate() { m_generation = 0; }
+
+	const char *name() const { return m_name; }
+
+ private:
+	static T default_min();
+	static T default_max();
+
+	const char *m_name;
+	T m_default;
+	T m_min;
+	T m_max;
+	T m_value;
+	unsigned int m_generation;
+};
+
+template <> inline bool param_cached<bool>::default_min() { return false; }
+template <> inline bool param_cached<bool>::default_max() { return true; }
+template <> inline int param_cached<int>::default_min() { return INT_MIN; }
+template <> inline int param_cached<int>::default_max() { return INT_MAX; }
+template <> inline double param_cached<double>::default_min() { return -DBL_MAX; }
+template <> inline double param_cached<double>::default_max() { return DBL_MAX; }
+
+#endif
@@ -71,11 +71,21 @@ Selector::Selector()
 	save_write_fds = read_fds + ( 4 * fd_set_size );
 	save_except_fds = read_fds + ( 5 * fd_set_size );
 
+#ifdef CONDOR_HAVE_EPOLL
+	m_use_epoll = false;
+	m_epfd = -1;
+	m_epoll_pid = 0;
+	m_always_ready = 0;
+#endif
+
 	reset();
 }
 
 Selector::~Selector()
 {
+#ifdef CONDOR_HAVE_EPOLL
+	epoll_close();
+#endif
 	free( read_fds );
 }
 
@@ -89,6 +99,12 @@ Selector::reset()
 	timeout.tv_sec = timeout.tv_usec = 0;
 
 	max_fd = -1;
+#ifdef CONDOR_HAVE_EPOLL
+		// the watched fds carry over from one round to the next, and
+		// the fd_sets are only used if epoll goes away
+	if ( ! m_use_epoll)
+#endif
+	{
 #if defined(WIN32)
 	FD_ZERO( save_read_fds );
 	FD_ZERO( save_write_fds );
@@ -98,6 +114,7 @@ Selector::reset()
 	memset( save_write_fds, 0, fd_set_size * sizeof(fd_set) );
 	memset( save_except_fds, 0, fd_set_size * sizeof(fd_set) );
 #endif
+	}
 #ifdef SELECTOR_USE_POLL
 	m_single_shot = SINGLE_SHOT_VIRGIN;
 #else
@@ -167,6 +184,30 @@ describe_fd(int fd) {
   return strdup("");
 }
 
+bool
+Selector::use_epoll()
+{
+#ifdef CONDOR_HAVE_EPOLL
+	if ( ! m_use_epoll) {
+		m_epfd = epoll_create1(EPOLL_CLOEXEC);
+		if (m_epfd < 0) {
+			dprintf(D_ALWAYS, "Selector: epoll_create1() failed, errno=%d (%s); using select()\n",
+					errno, strerror(errno));
+			return false;
+		}
+		m_epoll_pid = getpid();
+		m_use_epoll = true;
+			// from here on, execute() only clears the bits it set
+		memset( read_fds, 0, fd_set_size * sizeof(fd_set) );
+		memset( write_fds, 0, fd_set_size * sizeof(fd_set) );
+		memset( except_fds, 0, fd_set_size * sizeof(fd_set) );
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
 void
 Selector::add_fd( int fd, IO_FUNC interest )
 {
@@ -276,6 +317,81 @@ Selector::delete_fd( int fd, IO_FUNC interest )
 	}
 }
 
+void
+Selector::watch_fd( int fd, IO_FUNC interest, unsigned int key )
+{
+#if !defined(WIN32)
+	if ( fd < 0 || fd >= fd_select_size() ) {
+		EXCEPT( "Selector::watch_fd(): fd %d outside valid range 0-%d",
+				fd, _fd_select_size-1 );
+	}
+#endif
+
+	if (IsDebugLevel(D_DAEMONCORE)) {
+		dprintf(D_DAEMONCORE | D_VERBOSE, "selector %p watching fd %d\n", this, fd);
+	}
+
+#ifdef CONDOR_HAVE_EPOLL
+	if ( ! m_use_epoll) {
+		EXCEPT( "Selector::watch_fd() called without use_epoll()" );
+	}
+	if ((size_t)fd >= m_epoll_fds.size()) {
+		EpollFd unused;
+		memset(&unused, 0, sizeof(unused));
+		unused.watched_index = -1;
+		m_epoll_fds.resize(fd + 1, unused);
+	}
+	EpollFd &e = m_epoll_fds[fd];
+	if (e.watched_index < 0) {
+		e.watched_index = (int)m_watched_fds.size();
+		m_watched_fds.push_back(fd);
+	} else if (e.key != key) {
+			// someone else's fd now
+		e.wanted = 0;
+	}
+	e.key = key;
+	switch( interest ) {
+	  case IO_READ: e.wanted |= EPOLLIN; break;
+	  case IO_WRITE: e.wanted |= EPOLLOUT; break;
+	  case IO_EXCEPT: e.wanted |= EPOLLPRI; break;
+	}
+	epoll_dirty(fd);
+#else
+	(void)interest;
+	(void)key;
+	EXCEPT( "Selector::watch_fd() called without use_epoll()" );
+#endif
+}
+
+void
+Selector::unwatch_fd( int fd, unsigned int key )
+{
+#ifdef CONDOR_HAVE_EPOLL
+	if (fd < 0 || (size_t)fd >= m_epoll_fds.size()) {
+		return;
+	}
+	EpollFd &e = m_epoll_fds[fd];
+	if (e.watched_index < 0 || e.key != key) {
+		return;
+	}
+
+	if (IsDebugLevel(D_DAEMONCORE)) {
+		dprintf(D_DAEMONCORE | D_VERBOSE, "selector %p unwatching fd %d\n", this, fd);
+	}
+
+	e.wanted = 0;
+	int last = m_watched_fds.back();
+	m_watched_fds[e.watched_index] = last;
+	m_epoll_fds[last].watched_index = e.watched_index;
+	m_watched_fds.pop_back();
+	e.watched_index = -1;
+	epoll_dirty(fd);
+#else
+	(void)fd;
+	(void)key;
+#endif
+}
+
 void
 Selector::set_timeout( time_t sec, long usec )
 {
@@ -306,10 +422,6 @@ Selector::execute()
 	struct timeval timeout_copy;
 	struct timeval	*tp;
 
-	memcpy( read_fds, save_read_fds, fd_set_size * sizeof(fd_set) );
-	memcpy( write_fds, save_write_fds, fd_set_size * sizeof(fd_set) );
-	memcpy( except_fds, save_except_fds, fd_set_size * sizeof(fd_set) );
-
 	if( timeout_wanted ) {
 		timeout_copy = timeout;
 		tp = &timeout_copy;
@@ -317,6 +429,35 @@ Selector::execute()
 		tp = NULL;
 	}
 
+#ifdef CONDOR_HAVE_EPOLL
+	if (m_use_epoll) {
+		m_single_shot = SINGLE_SHOT_SKIP;
+			// round up, so we don't wake just before a timer is due
+		int timeout_ms = tp ? (int)(1000*tp->tv_sec + (tp->tv_usec + 999)/1000) : -1;
+		if (epoll_execute(timeout_ms)) {
+			return;
+		}
+			// we have no epoll set (see epoll_execute()), so select()
+			// on the watched fds this round
+		memset( save_read_fds, 0, fd_set_size * sizeof(fd_set) );
+		memset( save_write_fds, 0, fd_set_size * sizeof(fd_set) );
+		memset( save_except_fds, 0, fd_set_size * sizeof(fd_set) );
+		max_fd = -1;
+		for (size_t i = 0; i < m_watched_fds.size(); i++) {
+			int fd = m_watched_fds[i];
+			int wanted = m_epoll_fds[fd].wanted;
+			if (wanted & EPOLLIN) MY_FD_SET( fd, save_read_fds );
+			if (wanted & EPOLLOUT) MY_FD_SET( fd, save_write_fds );
+			if (wanted & EPOLLPRI) MY_FD_SET( fd, save_except_fds );
+			if (fd > max_fd) max_fd = fd;
+		}
+	}
+#endif
+
+	memcpy( read_fds, save_read_fds, fd_set_size * sizeof(fd_set) );
+	memcpy( write_fds, save_write_fds, fd_set_size * sizeof(fd_set) );
+	memcpy( except_fds, save_except_fds, fd_set_size * sizeof(fd_set) );
+
 		// select() ignores its first argument on Windows. We still track
 		// max_fd for the display() functions.
 	start_thread_safe("select");
@@ -353,9 +494,204 @@ Selector::execute()
 	} else {
 		state = FDS_READY;
 	}
+
+#ifdef CONDOR_HAVE_EPOLL
+	if (m_use_epoll) {
+		m_ready_fds.clear();
+		for (size_t i = 0; i < m_watched_fds.size(); i++) {
+			int fd = m_watched_fds[i];
+			if (MY_FD_ISSET( fd, read_fds ) || MY_FD_ISSET( fd, write_fds ) ||
+				MY_FD_ISSET( fd, except_fds )) {
+				m_ready_fds.push_back(fd);
+			}
+		}
+	}
+#endif
 	return;
 }
 
+#ifdef CONDOR_HAVE_EPOLL
+void
+Selector::epoll_dirty( int fd )
+{
+	EpollFd &e = m_epoll_fds[fd];
+	if ( ! e.dirty) {
+		e.dirty = true;
+		m_dirty_fds.push_back(fd);
+	}
+}
+
+	// Bring the kernel up to date with the fds that were watched,
+	// unwatched or reported since the last call, then wait.  Returns
+	// false if we have no epoll set to wait on.
+bool
+Selector::epoll_execute( int timeout_ms )
+{
+	struct epoll_event ev;
+
+	if (m_epfd >= 0 && m_epoll_pid != getpid()) {
+			// we've been forked; the epoll set belongs to our parent,
+			// so make our own rather than change theirs
+		close(m_epfd);
+		m_epfd = -1;
+		for (size_t fd = 0; fd < m_epoll_fds.size(); fd++) {
+			m_epoll_fds[fd].in_kernel = false;
+			m_epoll_fds[fd].armed = 0;
+		}
+		for (size_t i = 0; i < m_watched_fds.size(); i++) {
+			epoll_dirty(m_watched_fds[i]);
+		}
+	}
+	if (m_epfd < 0) {
+		m_epfd = epoll_create1(EPOLL_CLOEXEC);
+		if (m_epfd < 0) {
+			dprintf(D_ALWAYS, "Selector: epoll_create1() failed, errno=%d (%s); using select()\n",
+					errno, strerror(errno));
+			return false;
+		}
+		m_epoll_pid = getpid();
+	}
+
+	for (size_t i = 0; i < m_dirty_fds.size(); i++) {
+		int fd = m_dirty_fds[i];
+		EpollFd &e = m_epoll_fds[fd];
+		e.dirty = false;
+		if (e.always_ready) {
+			e.always_ready = false;
+			m_always_ready--;
+		}
+		if (e.in_kernel && (e.wanted == 0 || e.armed_key != e.key)) {
+				// fails harmlessly if fd has been closed
+			epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, &ev);
+			e.in_kernel = false;
+			e.armed = 0;
+		}
+		if (e.wanted == 0 || (e.in_kernel && e.armed == e.wanted)) {
+			continue;
+		}
+		memset(&ev, 0, sizeof(ev));
+		ev.events = e.wanted | EPOLLONESHOT;
+		ev.data.u64 = ((uint64_t)e.key << 32) | (uint32_t)fd;
+		int op = e.in_kernel ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+		int rc = epoll_ctl(m_epfd, op, fd, &ev);
+		if (rc < 0 && op == EPOLL_CTL_ADD && errno == EEXIST) {
+			rc = epoll_ctl(m_epfd, EPOLL_CTL_MOD, fd, &ev);
+		} else if (rc < 0 && op == EPOLL_CTL_MOD && errno == ENOENT) {
+			rc = epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev);
+		}
+		if (rc < 0) {
+				// e.g. a regular file, which epoll won't take but
+				// select() says is always ready
+			dprintf(D_FULLDEBUG, "Selector: can't add fd %d to epoll, errno=%d (%s)\n",
+					fd, errno, strerror(errno));
+			e.in_kernel = false;
+			e.armed = 0;
+			e.always_ready = true;
+			m_always_ready++;
+			continue;
+		}
+		e.in_kernel = true;
+		e.armed = e.wanted;
+		e.armed_key = e.key;
+	}
+	m_dirty_fds.clear();
+
+	if (m_always_ready) {
+		timeout_ms = 0;
+	}
+	if (m_events.size() < m_watched_fds.size() || m_events.empty()) {
+		m_events.resize(m_watched_fds.size() + 1);
+	}
+
+	start_thread_safe("select");
+	int nevents = epoll_wait(m_epfd, &m_events[0], (int)m_events.size(), timeout_ms);
+	_select_errno = errno;
+	stop_thread_safe("select");
+
+		// only the bits of the last round's ready fds can be set
+	for (size_t i = 0; i < m_ready_fds.size(); i++) {
+		int fd = m_ready_fds[i];
+		MY_FD_CLR( fd, read_fds );
+		MY_FD_CLR( fd, write_fds );
+		MY_FD_CLR( fd, except_fds );
+	}
+	m_ready_fds.clear();
+
+	if (nevents < 0) {
+		_select_retval = nevents;
+		state = (_select_errno == EINTR) ? SIGNALLED : FAILED;
+		return true;
+	}
+	_select_errno = 0;
+
+	for (int i = 0; i < nevents; i++) {
+		int fd = (int)(m_events[i].data.u64 & 0xffffffff);
+		unsigned int key = (unsigned int)(m_events[i].data.u64 >> 32);
+		if (fd < 0 || (size_t)fd >= m_epoll_fds.size()) {
+			continue;
+		}
+		EpollFd &e = m_epoll_fds[fd];
+		if ( ! e.in_kernel || ! e.armed || e.armed_key != key) {
+				// left over from an fd that has since been closed
+			continue;
+		}
+			// one-shot, so it has to be re-armed next round
+		e.armed = 0;
+		epoll_dirty(fd);
+
+		unsigned int revents = m_events[i].events;
+		bool ready = false;
+		if ((e.wanted & EPOLLIN) && (revents & (EPOLLIN|EPOLLHUP|EPOLLERR))) {
+			MY_FD_SET( fd, read_fds );
+			ready = true;
+		}
+		if ((e.wanted & EPOLLOUT) && (revents & (EPOLLOUT|EPOLLHUP|EPOLLERR))) {
+			MY_FD_SET( fd, write_fds );
+			ready = true;
+		}
+		if ((e.wanted & EPOLLPRI) && (revents & (EPOLLPRI|EPOLLERR))) {
+			MY_FD_SET( fd, except_fds );
+			ready = true;
+		}
+		if (ready) {
+			m_ready_fds.push_back(fd);
+		}
+	}
+
+	if (m_always_ready) {
+		for (size_t i = 0; i < m_watched_fds.size(); i++) {
+			int fd = m_watched_fds[i];
+			EpollFd &e = m_epoll_fds[fd];
+			if ( ! e.always_ready) {
+				continue;
+			}
+			if (e.wanted & EPOLLIN) MY_FD_SET( fd, read_fds );
+			if (e.wanted & EPOLLOUT) MY_FD_SET( fd, write_fds );
+			if (e.wanted & EPOLLPRI) MY_FD_SET( fd, except_fds );
+			m_ready_fds.push_back(fd);
+		}
+	}
+
+	_select_retval = (int)m_ready_fds.size();
+	state = m_ready_fds.empty() ? TIMED_OUT : FDS_READY;
+	return true;
+}
+
+void
+Selector::epoll_close()
+{
+	if (m_epfd >= 0) {
+		close(m_epfd);
+		m_epfd = -1;
+	}
+	m_epoll_fds.clear();
+	m_watched_fds.clear();
+	m_dirty_fds.clear();
+	m_always_ready = 0;
+	m_use_epoll = false;
+}
+#endif
+
 int
 Selector::select_retval()
 {
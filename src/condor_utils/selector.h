@@ -27,6 +27,12 @@
 #define SELECTOR_USE_POLL 1
 #endif
 
+#include <vector>
+
+#ifdef CONDOR_HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef SELECTOR_USE_POLL
 #include <poll.h>
 #else
@@ -55,6 +61,22 @@ public:
 
 	void reset();
 	void add_fd( int fd, IO_FUNC interest );
+
+		// In epoll mode, the fds to wait on stay registered with the
+		// kernel from one execute() to the next: watch_fd() and
+		// unwatch_fd() take the place of add_fd() and delete_fd(), and
+		// execute() only makes epoll_ctl() calls for the fds that were
+		// watched, unwatched or reported since the last one.  reset()
+		// clears the timeout but not the watches.  key identifies what
+		// fd refers to: watching fd with a different key replaces the
+		// old watch, in case fd was closed and reused, and unwatch_fd()
+		// does nothing unless key matches.  Returns false if epoll isn't
+		// available, in which case use add_fd() as usual.
+	bool use_epoll();
+	void watch_fd( int fd, IO_FUNC interest, unsigned int key );
+	void unwatch_fd( int fd, unsigned int key );
+		// the fds the last execute() found ready in epoll mode
+	const std::vector<int> & ready_fds() const { return m_ready_fds; }
 	void delete_fd( int fd, IO_FUNC interest );
 	void set_timeout( time_t sec, long usec = 0 );
 	void set_timeout( timeval tv );
@@ -92,6 +114,36 @@ private:
 #else
 	struct fake_pollfd m_poll;
 #endif
+
+#ifdef CONDOR_HAVE_EPOLL
+		// fds are registered EPOLLONESHOT, so a registration that
+		// outlives its fd (e.g. one shared with a child process) can
+		// wake us at most once; the fds that fired are re-armed by
+		// the next execute().
+	struct EpollFd {
+		int		wanted;		// events being watched for, 0 if none
+		unsigned int key;
+		int		armed;		// events the kernel will report
+		unsigned int armed_key;
+		bool	in_kernel;
+		bool	dirty;		// on m_dirty_fds
+		bool	always_ready;	// epoll won't take it, e.g. a regular file
+		int		watched_index;	// position in m_watched_fds
+	};
+	bool epoll_execute( int timeout_ms );
+	void epoll_dirty( int fd );
+	void epoll_close();
+
+	bool	m_use_epoll;
+	int		m_epfd;
+	pid_t	m_epoll_pid;	// a forked child must not share our epoll set
+	int		m_always_ready;	// number of watched fds epoll won't take
+	std::vector<EpollFd> m_epoll_fds;	// indexed by fd
+	std::vector<int> m_watched_fds;		// fds with wanted events
+	std::vector<int> m_dirty_fds;		// fds whose registration is out of date
+	std::vector<struct epoll_event> m_events;
+#endif
+	std::vector<int> m_ready_fds;
 };
 
 void display_fd_set( const char *msg, fd_set *set, int max,
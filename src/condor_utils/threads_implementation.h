@@ -67,6 +67,13 @@ public:
 	/******* IMPLEMENT CondorThreads INTERFACE *********/
 	int start_thread_safe_block();
 	int stop_thread_safe_block();
+	void lock_state_exclusive();
+	void unlock_state_exclusive();
+	bool holds_state_exclusive();
+	void lock_state_shared();
+	void unlock_state_shared();
+	void lock_state_readers();
+	void unlock_state_readers();
 	int yield();
 	int pool_init();
 	int pool_add(condor_thread_func_t routine, void* arg, int* tid=NULL,
@@ -92,6 +99,12 @@ public:
 	pthread_mutex_t big_lock;	// big lock protecting condor code
 	pthread_mutex_t get_handle_lock;	// lock protecting method get_handle()
 	pthread_mutex_t set_status_lock;	// lock protecting set_status() shared data
+	pthread_mutex_t state_lock;	// lock protecting the state_* members below
+	pthread_cond_t state_cond;	// signalled when the daemon state lock is released
+	int state_readers_;			// threads holding the daemon state lock shared
+	int state_writers_waiting_;	// threads waiting to hold it exclusively
+	bool state_writer_;			// true if a thread holds it exclusively
+	pthread_mutex_t state_readers_lock;	// see CondorThreads::lock_state_readers()
 	HashTable<ThreadInfo,WorkerThreadPtr_t> hashThreadToWorker;
 	HashTable<int,WorkerThreadPtr_t> hashTidToWorker;
 	condor_thread_switch_callback_t switch_callback;
@@ -436,6 +436,61 @@ void UserPolicy::Config()
 	}
 }
 
+bool UserPolicy::PeriodicDependencies(ClassAd & ad, classad::References & attrs, time_t & next_change)
+{
+	time_t now = time(NULL);
+	bool every_time = false;
+	next_change = 0;
+
+	classad::References pending;
+	pending.insert(ATTR_JOB_STATUS);
+	pending.insert(ATTR_TIMER_REMOVE_CHECK);
+	pending.insert(ATTR_PERIODIC_HOLD_CHECK);
+	pending.insert(ATTR_PERIODIC_RELEASE_CHECK);
+	pending.insert(ATTR_PERIODIC_REMOVE_CHECK);
+
+	// TimerRemove is compared to the current time, see AnalyzePolicy()
+	int timer_remove = -1;
+	if (ad.LookupInteger(ATTR_TIMER_REMOVE_CHECK, timer_remove) && timer_remove >= now) {
+		next_change = (time_t)timer_remove + 1;
+	}
+
+	// an expression that uses the time other than by comparing it to a
+	// bound could change at any time, so it is evaluated every time.
+	ExprTree * sys_exprs[] = { m_sys_periodic_hold, m_sys_periodic_release, m_sys_periodic_remove };
+	for (size_t ix = 0; ix < COUNTOF(sys_exprs); ++ix) {
+		if (sys_exprs[ix] && ExprTreeIsTimeDependent(sys_exprs[ix], &pending)) {
+			if ( ! ExprTreeNextTimeChange(sys_exprs[ix], ad, now, next_change)) {
+				every_time = true;
+			}
+		}
+	}
+
+	// follow references through the job ad, an attribute we have already
+	// seen has already had its own references added to pending.
+	classad::References seen;
+	while ( ! pending.empty()) {
+		std::string attr = *pending.begin();
+		pending.erase(pending.begin());
+		if ( ! seen.insert(attr).second) {
+			continue;
+		}
+		attrs.insert(attr);
+		ExprTree * expr = ad.Lookup(attr);
+		if (expr && ExprTreeIsTimeDependent(expr, &pending)) {
+			if ( ! ExprTreeNextTimeChange(expr, ad, now, next_change)) {
+				every_time = true;
+			}
+		}
+	}
+
+	if (every_time) {
+		next_change = 0;
+		return true;
+	}
+	return next_change != 0;
+}
+
 void UserPolicy::ResetTriggers()
 {
 	m_fire_expr_val = -1;
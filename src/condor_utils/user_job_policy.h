@@ -216,6 +216,16 @@ class UserPolicy
 		int AnalyzePolicy(int mode);
 	#endif
 
+	#ifdef USE_NON_MUTATING_USERPOLICY
+		/* Adds the names of the job attributes that the periodic policy of
+			this job depends on to attrs, following references from the policy
+			expressions to other attributes of the job.  Returns true if the
+			outcome can also change with the passage of time alone, and sets
+			next_change to the earliest time it can, or to 0 if that isn't
+			known and the policy should be evaluated every time. */
+		bool PeriodicDependencies(ClassAd &ad, classad::References &attrs, time_t &next_change);
+	#endif
+
 		/* This explains what expression caused the above action, if no 
 			firing expression occurred, then return NULL. The user does NOT
 			free this memory and it is overwritten whenever an Init() or
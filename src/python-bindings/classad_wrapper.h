@@ -18,7 +18,7 @@ classad::ExprTree* convert_python_to_exprtree(boost::python::object value);
 struct ExprTreeHolder;
 
 struct AttrPairToFirst :
-  public std::unary_function<std::pair<std::string, classad::ExprTree*> const&, std::string>
+  public std::unary_function<classad::AttrList::value_type const&, std::string>
 {
   AttrPairToFirst::result_type operator()(AttrPairToFirst::argument_type p) const
   {
@@ -31,7 +31,7 @@ typedef boost::transform_iterator<AttrPairToFirst, classad::AttrList::iterator>
 struct ExprTreeHolder;
 
 struct AttrPairToSecond :
-  public std::unary_function<std::pair<std::string, classad::ExprTree*> const&, boost::python::object>
+  public std::unary_function<classad::AttrList::value_type const&, boost::python::object>
 {
   AttrPairToSecond::result_type operator()(AttrPairToSecond::argument_type p) const;
 };
@@ -39,7 +39,7 @@ struct AttrPairToSecond :
 typedef boost::transform_iterator<AttrPairToSecond, classad::AttrList::iterator> AttrValueIter;
 
 struct AttrPair :
-  public std::unary_function<std::pair<std::string, classad::ExprTree*> const&, boost::python::object>
+  public std::unary_function<classad::AttrList::value_type const&, boost::python::object>
 {
   AttrPair::result_type operator()(AttrPair::argument_type p) const;
 };